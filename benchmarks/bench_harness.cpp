@@ -0,0 +1,148 @@
+#include "bench_harness.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+
+#include <nlohmann/json.hpp>
+
+namespace {
+
+thread_local simple_data_server::bench::AllocationCounts counts;
+
+void* allocate(std::size_t size, std::size_t alignment) {
+    ++counts.allocations;
+    counts.bytes += size;
+    void* pointer = alignment <= alignof(std::max_align_t)
+                        ? std::malloc(size == 0 ? 1 : size)
+                        : std::aligned_alloc(alignment, (size + alignment - 1) / alignment *
+                                                            alignment);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+} // namespace
+
+// Replacement allocation functions; every other form of new and delete
+// forwards to these in the standard library.
+void* operator new(std::size_t size) {
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size) {
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+namespace simple_data_server::bench {
+
+AllocationCounts thread_allocations() noexcept {
+    return counts;
+}
+
+Suite::Suite(Options options) : options_(std::move(options)) {
+}
+
+bool Suite::selected(std::string_view name) const {
+    return name.find(options_.filter) != std::string_view::npos;
+}
+
+void Suite::add(Measurement measurement) {
+    if (!selected(measurement.name)) {
+        return;
+    }
+    char line[160];
+    if (measurement.allocations_per_op) {
+        std::snprintf(line, sizeof(line), "%-36s %14.1f ns/op %10.2f allocs/op %12.1f B/op",
+                      measurement.name.c_str(), measurement.ns_per_op,
+                      *measurement.allocations_per_op, measurement.bytes_per_op.value_or(0));
+    } else {
+        std::snprintf(line, sizeof(line), "%-36s %14.1f ns/op", measurement.name.c_str(),
+                      measurement.ns_per_op);
+    }
+    std::cout << line << std::endl;
+    results_.push_back(std::move(measurement));
+}
+
+bool Suite::finish() const {
+    if (options_.json_path.empty()) {
+        return true;
+    }
+    auto results = nlohmann::ordered_json::array();
+    for (const auto& measurement : results_) {
+        nlohmann::ordered_json entry;
+        entry["name"] = measurement.name;
+        entry["iterations"] = measurement.iterations;
+        entry["ns_per_op"] = measurement.ns_per_op;
+        if (measurement.allocations_per_op) {
+            entry["allocs_per_op"] = *measurement.allocations_per_op;
+            entry["bytes_per_op"] = measurement.bytes_per_op.value_or(0);
+        }
+        results.push_back(std::move(entry));
+    }
+    std::ofstream output(options_.json_path);
+    output << results.dump(2) << '\n';
+    if (!output) {
+        std::cerr << "Cannot write " << options_.json_path << "\n";
+        return false;
+    }
+    return true;
+}
+
+std::uint64_t Suite::next_iterations(std::uint64_t iterations,
+                                     std::chrono::nanoseconds elapsed) const {
+    // Aim a little past the minimum time so the next batch is usually the last.
+    const auto target = std::chrono::duration<double>(options_.min_time).count() * 1.2;
+    const auto seconds = std::max(std::chrono::duration<double>(elapsed).count(), 1e-9);
+    const auto estimate = static_cast<double>(iterations) * target / seconds;
+    return std::min<std::uint64_t>(
+        MAX_ITERATIONS,
+        std::max<std::uint64_t>(iterations * 2,
+                                static_cast<std::uint64_t>(std::min(estimate, 1e12))));
+}
+
+} // namespace simple_data_server::bench
@@ -0,0 +1,138 @@
+#ifndef SIMPLE_DATA_SERVER_BENCHMARKS_BENCH_HARNESS_HPP
+#define SIMPLE_DATA_SERVER_BENCHMARKS_BENCH_HARNESS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simple_data_server::bench {
+
+/**
+ * @brief Heap allocations made by the calling thread since it started.
+ *
+ * Counted by the replacement operator new in bench_harness.cpp, so only
+ * executables that link it count anything.
+ */
+struct AllocationCounts {
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+};
+
+/**
+ * @brief Get the calling thread's allocation counts.
+ *
+ * @return AllocationCounts The counts.
+ */
+[[nodiscard]] AllocationCounts thread_allocations() noexcept;
+
+/**
+ * @brief Keep the compiler from optimizing a value, and the work behind it, away.
+ */
+template <typename T>
+void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief One benchmark's result.
+ */
+struct Measurement {
+    std::string name;
+    std::uint64_t iterations = 0;
+    double ns_per_op = 0;
+    /** Unset for figures derived from another benchmark rather than measured. */
+    std::optional<double> allocations_per_op;
+    std::optional<double> bytes_per_op;
+};
+
+/**
+ * @brief Runs benchmarks, prints one line per benchmark and optionally writes JSON.
+ *
+ * Each benchmark runs once to warm up, then in batches that double (or grow
+ * towards the minimum time) until a batch takes at least the minimum time;
+ * that batch is reported. Allocations are counted on the calling thread
+ * only, so background threads of the code under test do not add noise.
+ */
+class Suite {
+public:
+    struct Options {
+        /** Only run benchmarks whose name contains this. */
+        std::string filter;
+        std::chrono::milliseconds min_time{200};
+        /** File to write the results to as JSON; empty for none. */
+        std::string json_path;
+    };
+
+    explicit Suite(Options options);
+
+    /**
+     * @brief Check whether a benchmark passes the filter, e.g. to skip its setup.
+     *
+     * @param name The benchmark's name.
+     * @return bool true if it would run.
+     */
+    [[nodiscard]] bool selected(std::string_view name) const;
+
+    /**
+     * @brief Measure a function.
+     *
+     * @param name The benchmark's name, e.g. "get_json/tmpfs/4096".
+     * @param function Called once per operation.
+     */
+    template <typename Function>
+    void run(std::string_view name, Function&& function) {
+        if (!selected(name)) {
+            return;
+        }
+        function();
+        std::uint64_t iterations = 1;
+        while (true) {
+            const auto before = thread_allocations();
+            const auto start = std::chrono::steady_clock::now();
+            for (std::uint64_t i = 0; i < iterations; ++i) {
+                function();
+            }
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            const auto after = thread_allocations();
+            if (elapsed >= options_.min_time || iterations >= MAX_ITERATIONS) {
+                const auto n = static_cast<double>(iterations);
+                add(Measurement{std::string(name), iterations,
+                                std::chrono::duration<double, std::nano>(elapsed).count() / n,
+                                static_cast<double>(after.allocations - before.allocations) / n,
+                                static_cast<double>(after.bytes - before.bytes) / n});
+                return;
+            }
+            iterations = next_iterations(iterations, elapsed);
+        }
+    }
+
+    /**
+     * @brief Record a figure computed outside run(), e.g. one stage of a measured call.
+     *
+     * @param measurement The figure; only printed if its name passes the filter.
+     */
+    void add(Measurement measurement);
+
+    /**
+     * @brief Write the JSON results, if requested.
+     *
+     * @return bool false if the file could not be written.
+     */
+    [[nodiscard]] bool finish() const;
+
+private:
+    static constexpr std::uint64_t MAX_ITERATIONS = 1'000'000'000;
+
+    [[nodiscard]] std::uint64_t next_iterations(std::uint64_t iterations,
+                                                std::chrono::nanoseconds elapsed) const;
+
+    Options options_;
+    std::vector<Measurement> results_;
+};
+
+} // namespace simple_data_server::bench
+
+#endif // SIMPLE_DATA_SERVER_BENCHMARKS_BENCH_HARNESS_HPP
@@ -0,0 +1,295 @@
+// Measures the request hot path piece by piece: filename sanitizing, key
+// directory resolution, put_json/get_json/get_raw at several document sizes
+// on tmpfs and on disk, ApiHandler's put and get including the time spent
+// parsing the request, and building the response body. Reports ns/op,
+// heap allocations/op and allocated bytes/op for each.
+// Run with: bench-hot-paths [--filter TEXT] [--min-time MS] [--json FILE]
+//                           [--tmpfs DIR] [--disk DIR]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+#include "bench_harness.hpp"
+#include "handlers/api_handler.hpp"
+#include "server/response_body.hpp"
+#include "storage/file_manager.hpp"
+#include "storage/name_validation.hpp"
+#include "util/request_trace.hpp"
+
+using simple_data_server::ApiHandler;
+using simple_data_server::ApiResult;
+using simple_data_server::FileManager;
+using simple_data_server::HttpStatus;
+using simple_data_server::RequestTrace;
+using simple_data_server::ResponseBody;
+using simple_data_server::StorageOptions;
+using simple_data_server::TraceStage;
+using simple_data_server::bench::keep;
+using simple_data_server::bench::Measurement;
+using simple_data_server::bench::Suite;
+
+namespace {
+
+constexpr std::array<std::size_t, 4> DOCUMENT_SIZES = {256, 4 * 1024, 64 * 1024, 512 * 1024};
+constexpr std::string_view KEY = "bench";
+constexpr std::string_view VERSION = "0123456789abcdef";
+
+/**
+ * @brief A document of roughly the given size, shaped like typical stored data.
+ *
+ * @param target_size Approximate serialized size in bytes.
+ * @param variant Stored in the document so that two variants differ.
+ */
+nlohmann::json make_document(std::size_t target_size, int variant) {
+    nlohmann::json document = {{"variant", variant}};
+    for (int i = 0; document.dump().size() < target_size; ++i) {
+        document["item" + std::to_string(i)] = {
+            {"name", "item number " + std::to_string(i)},
+            {"price", i * 1.25},
+            {"tags", {"red", "green", "blue"}},
+            {"in_stock", i % 2 == 0}};
+    }
+    return document;
+}
+
+/**
+ * @brief A fresh directory below parent, removed with everything in it on destruction.
+ */
+class ScratchDirectory {
+public:
+    explicit ScratchDirectory(const std::filesystem::path& parent) {
+        auto pattern = (parent / "sds-hot-paths-XXXXXX").string();
+        if (::mkdtemp(pattern.data()) != nullptr) {
+            path_ = pattern;
+        }
+    }
+
+    ~ScratchDirectory() {
+        if (!path_.empty()) {
+            std::error_code error;
+            std::filesystem::remove_all(path_, error);
+        }
+    }
+
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+    /** Empty if the directory could not be created. */
+    [[nodiscard]] const std::filesystem::path& path() const noexcept {
+        return path_;
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+/**
+ * @brief A FileManager over a scratch directory with the benchmark key created.
+ */
+std::shared_ptr<FileManager> open_storage(const std::filesystem::path& directory) {
+    StorageOptions options;
+    // The scrubber re-reads documents in the background; keep it out of the numbers.
+    options.scrub.enabled = false;
+    auto file_manager = std::make_shared<FileManager>(directory.string(), std::move(options));
+    std::filesystem::create_directory(directory / KEY);
+    return file_manager;
+}
+
+void run_name_cases(Suite& suite) {
+    std::array<char, 256> out{};
+    for (const std::string_view filename :
+         {std::string_view("config.json"),
+          std::string_view("user-preferences/../dashboard layout (copy 2).json"),
+          std::string_view("a_rather_long_document_name_made_only_of_characters_that_are_kept_"
+                           "as_they_are_so_whole_blocks_can_be_copied_at_once_2026-10-16.json")}) {
+        suite.run("sanitize_filename/" + std::to_string(filename.size()),
+                  [&] { keep(simple_data_server::sanitize_filename(filename, out.data())); });
+    }
+}
+
+/**
+ * @brief Storage cases on one filesystem; skipped if no scratch directory can be made there.
+ */
+void run_storage_cases(Suite& suite, std::string_view label, const std::filesystem::path& parent) {
+    const ScratchDirectory scratch(parent);
+    if (scratch.path().empty()) {
+        std::cerr << "Skipping " << label << ": cannot create a directory in " << parent << "\n";
+        return;
+    }
+    const auto file_manager = open_storage(scratch.path());
+
+    suite.run("key_directory_exists/" + std::string(label),
+              [&] { keep(file_manager->key_directory_exists(KEY)); });
+
+    for (const auto size : DOCUMENT_SIZES) {
+        const auto suffix = "/" + std::string(label) + "/" + std::to_string(size);
+        const std::array<nlohmann::json, 2> documents = {make_document(size, 0),
+                                                         make_document(size, 1)};
+        const auto filename = "doc" + std::to_string(size) + ".json";
+        if (!file_manager->put_json(KEY, filename, documents[0])) {
+            std::cerr << "Skipping " << label << ": put_json failed in " << scratch.path()
+                      << "\n";
+            return;
+        }
+
+        // Alternate the contents so that every put really writes a new version.
+        std::size_t next = 0;
+        suite.run("put_json" + suffix, [&] {
+            keep(file_manager->put_json(KEY, filename, documents[next++ & 1]));
+        });
+        suite.run("get_json" + suffix, [&] { keep(file_manager->get_json(KEY, filename)); });
+        suite.run("get_raw" + suffix, [&] { keep(file_manager->get_raw(KEY, filename)); });
+    }
+}
+
+/**
+ * @brief Run one handler case, then report the share of it spent parsing the request.
+ */
+template <typename Call>
+void run_handler_case(Suite& suite, const std::string& name, Call&& call) {
+    std::chrono::nanoseconds parse_time{0};
+    std::uint64_t calls = 0;
+    suite.run(name, [&] {
+        RequestTrace trace;
+        {
+            const RequestTrace::Scope scope(trace);
+            keep(call());
+        }
+        parse_time += trace.duration(TraceStage::Parse);
+        ++calls;
+    });
+    if (calls > 0) {
+        // Averaged over every call, including warm-up and calibration batches.
+        suite.add(Measurement{name + "/parse", calls,
+                              static_cast<double>(parse_time.count()) /
+                                  static_cast<double>(calls),
+                              std::nullopt, std::nullopt});
+    }
+}
+
+void run_handler_cases(Suite& suite, const std::filesystem::path& parent) {
+    const ScratchDirectory scratch(parent);
+    if (scratch.path().empty()) {
+        std::cerr << "Skipping handlers: cannot create a directory in " << parent << "\n";
+        return;
+    }
+    const ApiHandler handler(open_storage(scratch.path()));
+
+    for (const auto size : DOCUMENT_SIZES) {
+        const auto filename = "doc" + std::to_string(size) + ".json";
+        std::array<std::string, 2> put_bodies;
+        for (int variant = 0; variant < 2; ++variant) {
+            put_bodies[variant] = nlohmann::json{{"key", KEY},
+                                                 {"filename", filename},
+                                                 {"data", make_document(size, variant)}}
+                                      .dump();
+        }
+        const auto get_body = nlohmann::json{{"key", KEY}, {"filename", filename}}.dump();
+        if (handler.handle_put(put_bodies[0]).status != HttpStatus::Ok) {
+            std::cerr << "Skipping handlers: handle_put failed in " << scratch.path() << "\n";
+            return;
+        }
+
+        const auto suffix = "/" + std::to_string(size);
+        std::size_t next = 0;
+        run_handler_case(suite, "handle_put" + suffix,
+                         [&] { return handler.handle_put(put_bodies[next++ & 1]); });
+        run_handler_case(suite, "handle_get" + suffix,
+                         [&] { return handler.handle_get(get_body); });
+    }
+}
+
+void run_response_cases(Suite& suite) {
+    // Concatenating the fragments stands in for the socket write.
+    const auto assemble = [](const ResponseBody& body) {
+        std::string out;
+        out.reserve(body.size());
+        for (const auto fragment : body.fragments()) {
+            out += fragment;
+        }
+        return out;
+    };
+
+    suite.run("response_body/put", [&] {
+        const ResponseBody body(
+            ApiResult{HttpStatus::Ok, "success", nlohmann::json{{"version", VERSION}}});
+        keep(assemble(body));
+    });
+    for (const auto size : DOCUMENT_SIZES) {
+        const auto stored = make_document(size, 0).dump();
+        suite.run("response_body/get/" + std::to_string(size), [&] {
+            ApiResult result{HttpStatus::Ok, "success", nlohmann::json{{"version", VERSION}}};
+            result.raw_data.push_back({"data", stored});
+            const ResponseBody body(std::move(result));
+            keep(assemble(body));
+        });
+    }
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --filter TEXT  Only run benchmarks whose name contains TEXT\n"
+              << "  --min-time MS  Minimum measured time per benchmark (default: 200)\n"
+              << "  --json FILE    Also write the results to FILE as JSON\n"
+              << "  --tmpfs DIR    Directory on tmpfs for the storage benchmarks "
+                 "(default: /dev/shm)\n"
+              << "  --disk DIR     Directory on disk for the storage benchmarks "
+                 "(default: current directory)\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Suite::Options options;
+    std::filesystem::path tmpfs_directory = "/dev/shm";
+    std::filesystem::path disk_directory = ".";
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        const std::string value = argv[++i];
+        if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--min-time") {
+            options.min_time = std::chrono::milliseconds(std::max(1, std::atoi(value.c_str())));
+        } else if (arg == "--json") {
+            options.json_path = value;
+        } else if (arg == "--tmpfs") {
+            tmpfs_directory = value;
+        } else if (arg == "--disk") {
+            disk_directory = value;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Calibrate before measuring so the first handler case does not pay for it.
+    simple_data_server::TraceClock::calibrate();
+
+    Suite suite(std::move(options));
+    run_name_cases(suite);
+    run_storage_cases(suite, "tmpfs", tmpfs_directory);
+    run_storage_cases(suite, "disk", disk_directory);
+    run_handler_cases(suite, tmpfs_directory);
+    run_response_cases(suite);
+    return suite.finish() ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+// Compares the speed of the vectorized key and filename kernels with their
+// scalar references and with the previous sanitize_filename() and
+// ensure_json_extension(). Their equivalence is checked by
+// name-validation-test.
+// Run with: bench-name-validation [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "stored_filename_reference.hpp"
+
+namespace {
+
+constexpr int DEFAULT_ITERATIONS = 1'000'000;
+
+using simple_data_server::testing::legacy_stored_filename;
+using simple_data_server::testing::stored_filename;
+
+template <typename Function>
+double time_per_call_ns(int iterations, std::size_t& sink, Function function) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        sink += function();
+    }
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+void run_case(std::string_view label, const std::string& name, int iterations) {
+    std::size_t sink = 0;
+    std::vector<char> out(name.size());
+
+    const auto legacy_ns = time_per_call_ns(iterations, sink, [&] {
+        return legacy_stored_filename(name).size();
+    });
+    const auto stored_ns = time_per_call_ns(iterations, sink, [&] {
+        return stored_filename(name).size();
+    });
+    const auto scalar_ns = time_per_call_ns(iterations, sink, [&] {
+        return simple_data_server::sanitize_filename_scalar(name, out.data());
+    });
+    const auto vector_ns = time_per_call_ns(iterations, sink, [&] {
+        return simple_data_server::sanitize_filename(name, out.data());
+    });
+    const auto key_scalar_ns = time_per_call_ns(iterations, sink, [&] {
+        return static_cast<std::size_t>(simple_data_server::is_valid_key_scalar(name));
+    });
+    const auto key_vector_ns = time_per_call_ns(iterations, sink, [&] {
+        return static_cast<std::size_t>(simple_data_server::is_valid_key(name));
+    });
+
+    std::cout << label << " (" << name.size() << " bytes): stored filename " << legacy_ns
+              << " ns -> " << stored_ns << " ns; sanitize scalar " << scalar_ns
+              << " ns, vector " << vector_ns << " ns; key scalar " << key_scalar_ns
+              << " ns, vector " << key_vector_ns << " ns [" << sink % 10 << "]\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : DEFAULT_ITERATIONS;
+
+    run_case("short", "order-000123", iterations);
+    run_case("typical", "customer_4711-invoice-2024-06-30.final", iterations);
+    run_case("long", std::string(200, 'n') + "-v2", iterations / 4 + 1);
+    run_case("needs dropping", "report (copy) #2: \"final\" version", iterations);
+    return 0;
+}
@@ -0,0 +1,148 @@
+// Compares building /api/get and /api/put responses with ResponseBody against
+// the previous send_response(), which merged the result into a nlohmann::json
+// envelope and dumped it. Run with: bench-response-body [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include <nlohmann/json.hpp>
+
+#include "json/json_validator.hpp"
+#include "server/response_body.hpp"
+
+using simple_data_server::ApiResult;
+using simple_data_server::HttpStatus;
+using simple_data_server::ResponseBody;
+
+namespace {
+
+constexpr int DEFAULT_ITERATIONS = 200;
+constexpr std::string_view VERSION = "0123456789abcdef";
+
+/**
+ * @brief The response body as the previous send_response() produced it.
+ */
+std::string legacy_body(const ApiResult& result) {
+    nlohmann::json response_json;
+    response_json["status"] = result.message;
+    if (result.data.has_value()) {
+        response_json.merge_patch(result.data.value());
+    }
+    return response_json.dump();
+}
+
+/**
+ * @brief Concatenate the fragments, standing in for the socket write.
+ */
+std::string assemble(const ResponseBody& body) {
+    std::string out;
+    out.reserve(body.size());
+    for (const auto fragment : body.fragments()) {
+        out += fragment;
+    }
+    return out;
+}
+
+/**
+ * @brief A stored document of roughly the given size without null values,
+ *        which the previous merge_patch() silently dropped.
+ */
+std::string make_document(std::size_t target_size) {
+    nlohmann::json document = nlohmann::json::object();
+    for (int i = 0; document.dump().size() < target_size; ++i) {
+        document["item" + std::to_string(i)] = {
+            {"name", "item number " + std::to_string(i)},
+            {"price", i * 1.25},
+            {"tags", {"red", "green", "blue"}},
+            {"in_stock", i % 2 == 0}};
+    }
+    return document.dump();
+}
+
+template <typename Function>
+double time_per_call_us(int iterations, std::size_t& sink, Function function) {
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        sink += function();
+    }
+    const std::chrono::duration<double, std::micro> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+bool run_get_case(std::string_view label, std::size_t document_size, int iterations) {
+    const auto stored = make_document(document_size);
+    std::size_t sink = 0;
+
+    // Previously: parse the stored bytes into a DOM, then send_response().
+    const auto legacy_us = time_per_call_us(iterations, sink, [&] {
+        nlohmann::json data;
+        data["data"] = nlohmann::json::parse(stored);
+        data["version"] = VERSION;
+        return legacy_body({HttpStatus::Ok, "success", std::move(data)}).size();
+    });
+
+    // Now: validate the stored bytes and reference them from the body.
+    const auto current_us = time_per_call_us(iterations, sink, [&] {
+        if (!simple_data_server::validate_json(stored)) {
+            std::abort();
+        }
+        ApiResult result{HttpStatus::Ok, "success", nlohmann::json{{"version", VERSION}}};
+        result.raw_data.push_back({"data", stored});
+        const ResponseBody body(std::move(result));
+        return assemble(body).size();
+    });
+
+    ApiResult check{HttpStatus::Ok, "success", nlohmann::json{{"version", VERSION}}};
+    check.raw_data.push_back({"data", stored});
+    const ResponseBody body(std::move(check));
+    const auto expected = nlohmann::json{{"status", "success"},
+                                         {"data", nlohmann::json::parse(stored)},
+                                         {"version", VERSION}};
+    const bool same = nlohmann::json::parse(assemble(body)) == expected;
+
+    std::cout << label << " (" << stored.size() << " bytes): send_response " << legacy_us
+              << " us, ResponseBody " << current_us << " us, " << legacy_us / current_us
+              << "x" << (same ? "" : "  OUTPUT MISMATCH") << " [" << sink % 10 << "]\n";
+    return same;
+}
+
+bool run_put_case(int iterations) {
+    std::size_t sink = 0;
+    const auto make_result = [] {
+        return ApiResult{HttpStatus::Ok, "success", nlohmann::json{{"version", VERSION}}};
+    };
+
+    const auto legacy_us = time_per_call_us(iterations * 100, sink, [&] {
+        return legacy_body(make_result()).size();
+    });
+    const auto current_us = time_per_call_us(iterations * 100, sink, [&] {
+        const ResponseBody body(make_result());
+        return assemble(body).size();
+    });
+
+    const ResponseBody body(make_result());
+    const bool same = nlohmann::json::parse(assemble(body)) ==
+                      nlohmann::json::parse(legacy_body(make_result()));
+
+    std::cout << "put response: send_response " << legacy_us << " us, ResponseBody "
+              << current_us << " us, " << legacy_us / current_us << "x"
+              << (same ? "" : "  OUTPUT MISMATCH") << " [" << sink % 10 << "]\n";
+    return same;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : DEFAULT_ITERATIONS;
+
+    bool ok = run_put_case(iterations);
+    ok = run_get_case("get small", 1024, iterations * 10) && ok;
+    ok = run_get_case("get medium", 64 * 1024, iterations) && ok;
+    ok = run_get_case("get large", 900 * 1024, iterations / 10 + 1) && ok;
+    return ok ? 0 : 1;
+}
@@ -1,42 +1,146 @@
 #include "handlers/api_handler.hpp"
 
+#include "handlers/import_session.hpp"
+#include "handlers/query_source.hpp"
+#include "json/json_validator.hpp"
+#include "query/aggregation.hpp"
+#include "query/filter.hpp"
+#include "query/json_path.hpp"
+#include "query/text_search.hpp"
+#include "storage/expiry_manager.hpp"
+#include "storage/text_index.hpp"
+#include "util/request_trace.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
 #include <optional>
 
 namespace simple_data_server {
 
+namespace {
+
+constexpr std::size_t DEFAULT_QUERY_LIMIT = 100;
+constexpr std::size_t MAX_QUERY_LIMIT = 10000;
+constexpr std::size_t MAX_INDEXES_PER_KEY = 16;
+constexpr std::size_t MAX_AGGREGATE_GROUPS = 10000;
+constexpr std::size_t DEFAULT_SEARCH_LIMIT = 20;
+constexpr std::size_t MAX_SEARCH_LIMIT = 1000;
+
+/**
+ * @brief Streams an export: the header line, then one line per document.
+ */
+class ExportSource : public LineSource {
+public:
+    ExportSource(const ApiHandler& handler, ExportPlan plan)
+        : handler_(handler), plan_(std::move(plan)) {
+    }
+
+    bool read(std::string& out, std::size_t budget) override {
+        const auto start_size = out.size();
+        if (!header_sent_) {
+            out += handler_.export_header_line(plan_);
+            header_sent_ = true;
+        }
+        while (next_file_ < plan_.files.size() && out.size() - start_size < budget) {
+            if (auto line = handler_.export_line(plan_, plan_.files[next_file_])) {
+                out += line.value();
+            }
+            ++next_file_;
+        }
+        return next_file_ < plan_.files.size();
+    }
+
+private:
+    const ApiHandler& handler_;
+    ExportPlan plan_;
+    bool header_sent_ = false;
+    std::size_t next_file_ = 0;
+};
+
+/**
+ * @brief Read a member that must be a positive integer, e.g. 30 but not 30.0.
+ */
+std::optional<std::int64_t> parse_positive_integer(const JsonMember& member) {
+    if (member.type != JsonType::Number) {
+        return std::nullopt;
+    }
+    std::int64_t value = 0;
+    const auto* end = member.value.data() + member.value.size();
+    const auto [ptr, ec] = std::from_chars(member.value.data(), end, value);
+    if (ec != std::errc() || ptr != end || value <= 0) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+} // namespace
+
 ApiHandler::ApiHandler(std::shared_ptr<FileManager> file_manager)
-    : file_manager_(std::move(file_manager)) {
+    : file_manager_(std::move(file_manager)), query_pool_(std::make_unique<ThreadPool>(0)) {
 }
 
 ApiResult ApiHandler::handle_put(std::string_view request_body) const noexcept {
+    if (is_read_only()) {
+        return {HttpStatus::Forbidden, "Server is a read-only replica", std::nullopt};
+    }
+
     try {
-        auto request = nlohmann::json::parse(request_body);
+        // Validate and index the body without building a DOM; "data" is
+        // stored as the exact bytes the client sent.
+        const auto request = index_json_object(request_body);
+        if (!request) {
+            return {HttpStatus::BadRequest, "Invalid JSON", std::nullopt};
+        }
 
-        if (!request.contains("key") || !request["key"].is_string()) {
+        const auto* key = request->find("key");
+        if (key == nullptr || key->type != JsonType::String) {
             return {HttpStatus::BadRequest, "Missing or invalid 'key' field", std::nullopt};
         }
 
-        if (!request.contains("filename") || !request["filename"].is_string()) {
+        const auto* filename = request->find("filename");
+        if (filename == nullptr || filename->type != JsonType::String) {
             return {HttpStatus::BadRequest, "Missing or invalid 'filename' field", std::nullopt};
         }
 
-        if (!request.contains("data")) {
+        const auto* data = request->find("data");
+        if (data == nullptr) {
             return {HttpStatus::BadRequest, "Missing 'data' field", std::nullopt};
         }
 
-        const auto key = request["key"].get<std::string>();
-        const auto filename = request["filename"].get<std::string>();
-        const auto& data = request["data"];
+        std::string if_version;
+        PutOptions options;
+        if (const auto* member = request->find("if_version")) {
+            if (member->type != JsonType::String) {
+                return {HttpStatus::BadRequest, "Invalid 'if_version' field", std::nullopt};
+            }
+            if_version = json_string_value(member->value);
+            options.if_version = if_version;
+        }
+
+        if (const auto* member = request->find("ttl_seconds")) {
+            const auto ttl = parse_positive_integer(*member);
+            if (!ttl || ttl.value() > ExpiryManager::MAX_TTL.count()) {
+                return {HttpStatus::BadRequest, "Invalid 'ttl_seconds' field", std::nullopt};
+            }
+            options.ttl = std::chrono::seconds(ttl.value());
+        }
 
-        const auto result = file_manager_->put_json(key, filename, data);
+        const auto key_value = json_string_value(key->value);
+        const auto filename_value = json_string_value(filename->value);
+        trace_target(key_value, filename_value);
+        trace_stage(TraceStage::Parse);
+
+        const auto result = file_manager_->put_raw(key_value, filename_value, data->value, options);
         if (!result) {
             return file_error_to_api_result(result.error());
         }
 
-        return {HttpStatus::Ok, "success", std::nullopt};
+        nlohmann::json response_data;
+        response_data["version"] = result.value();
+        return {HttpStatus::Ok, "success", response_data};
 
-    } catch (const nlohmann::json::parse_error&) {
-        return {HttpStatus::BadRequest, "Invalid JSON", std::nullopt};
     } catch (const std::exception& e) {
         return {HttpStatus::InternalServerError, e.what(), std::nullopt};
     }
@@ -57,14 +161,20 @@ ApiResult ApiHandler::handle_get(std::string_view request_body) const noexcept {
         const auto key = request["key"].get<std::string>();
         const auto filename = request["filename"].get<std::string>();
 
-        const auto result = file_manager_->get_json(key, filename);
+        trace_target(key, filename);
+        trace_stage(TraceStage::Parse);
+
+        auto result = file_manager_->get_raw(key, filename);
         if (!result) {
             return file_error_to_api_result(result.error());
         }
 
+        // The stored bytes go into the response as they are, without a DOM.
         nlohmann::json response_data;
-        response_data["data"] = result.value();
-        return {HttpStatus::Ok, "success", response_data};
+        response_data["version"] = std::move(result->version);
+        ApiResult api_result{HttpStatus::Ok, "success", std::move(response_data)};
+        api_result.raw_data.push_back({"data", std::move(result->bytes)});
+        return api_result;
 
     } catch (const nlohmann::json::parse_error&) {
         return {HttpStatus::BadRequest, "Invalid JSON", std::nullopt};
@@ -83,6 +193,9 @@ ApiResult ApiHandler::handle_list(std::string_view request_body) const noexcept
 
         const auto key = request["key"].get<std::string>();
 
+        trace_target(key);
+        trace_stage(TraceStage::Parse);
+
         const auto result = file_manager_->list_files(key);
         if (!result) {
             return file_error_to_api_result(result.error());
@@ -99,24 +212,441 @@ ApiResult ApiHandler::handle_list(std::string_view request_body) const noexcept
     }
 }
 
+ApiResult ApiHandler::handle_aggregate(std::string_view request_body) const noexcept {
+    try {
+        auto request = nlohmann::json::parse(request_body);
+
+        if (!request.contains("key") || !request["key"].is_string()) {
+            return {HttpStatus::BadRequest, "Missing or invalid 'key' field", std::nullopt};
+        }
+        const auto key = request["key"].get<std::string>();
+
+        const auto spec = AggregationSpec::parse(request);
+        if (!spec) {
+            return {HttpStatus::BadRequest, spec.error(), std::nullopt};
+        }
+
+        trace_target(key);
+        trace_stage(TraceStage::Parse);
+
+        std::expected<std::vector<std::string>, FileError> files;
+        if (auto candidates = file_manager_->find_candidates(key, spec->filter)) {
+            if (!file_manager_->key_directory_exists(key)) {
+                return file_error_to_api_result(FileError::KeyDirectoryNotFound);
+            }
+            files = std::move(candidates.value());
+        } else {
+            files = file_manager_->list_files(key);
+        }
+        if (!files) {
+            return file_error_to_api_result(files.error());
+        }
+
+        AggregationTable table(spec.value(), files->size());
+        query_pool_->parallel_for(files->size(), [&](std::size_t i) {
+            if (const auto content = file_manager_->get_json_bytes(key, (*files)[i])) {
+                table.add_row(i, content.value());
+            }
+        });
+
+        auto response_data = table.finish(MAX_AGGREGATE_GROUPS);
+        response_data["scanned"] = files->size();
+        return {HttpStatus::Ok, "success", std::move(response_data)};
+
+    } catch (const nlohmann::json::parse_error&) {
+        return {HttpStatus::BadRequest, "Invalid JSON", std::nullopt};
+    } catch (const std::exception& e) {
+        return {HttpStatus::InternalServerError, e.what(), std::nullopt};
+    }
+}
+
+ApiResult ApiHandler::handle_index(std::string_view request_body) const noexcept {
+    try {
+        auto request = nlohmann::json::parse(request_body);
+
+        if (!request.contains("key") || !request["key"].is_string()) {
+            return {HttpStatus::BadRequest, "Missing or invalid 'key' field", std::nullopt};
+        }
+        const auto key = request["key"].get<std::string>();
+
+        const auto action = request.value("action", std::string("list"));
+        if (action != "list" && action != "create" && action != "drop") {
+            return {HttpStatus::BadRequest, "Invalid 'action' field", std::nullopt};
+        }
+        const auto type = request.value("type", std::string("field"));
+        if (type != "field" && type != "text") {
+            return {HttpStatus::BadRequest, "Invalid 'type' field", std::nullopt};
+        }
+
+        trace_target(key);
+        trace_stage(TraceStage::Parse);
+
+        if (action != "list" && type == "text") {
+            const auto changed = action == "create" ? file_manager_->create_text_index(key)
+                                                    : file_manager_->drop_text_index(key);
+            if (!changed) {
+                return file_error_to_api_result(changed.error());
+            }
+        } else if (action != "list") {
+            if (!request.contains("path") || !request["path"].is_string()) {
+                return {HttpStatus::BadRequest, "Missing or invalid 'path' field", std::nullopt};
+            }
+            const auto path_text = request["path"].get<std::string>();
+            const auto path = JsonPath::parse(path_text);
+            if (!path || path->tokens().empty()) {
+                return {HttpStatus::BadRequest, "Invalid JSON Pointer in 'path'", std::nullopt};
+            }
+
+            std::expected<void, FileError> changed;
+            if (action == "create") {
+                const auto existing = file_manager_->list_indexes(key);
+                if (existing && existing->size() >= MAX_INDEXES_PER_KEY &&
+                    std::find(existing->begin(), existing->end(), path_text) == existing->end()) {
+                    return {HttpStatus::BadRequest,
+                            "Too many indexes (max " + std::to_string(MAX_INDEXES_PER_KEY) + ")",
+                            std::nullopt};
+                }
+                changed = file_manager_->create_index(key, path.value());
+            } else {
+                changed = file_manager_->drop_index(key, path_text);
+            }
+            if (!changed) {
+                return file_error_to_api_result(changed.error());
+            }
+        }
+
+        const auto result = file_manager_->list_indexes(key);
+        if (!result) {
+            return file_error_to_api_result(result.error());
+        }
+
+        nlohmann::json response_data;
+        response_data["indexes"] = result.value();
+        response_data["text"] = nullptr;
+        if (const auto text = file_manager_->get_text_index_stats(key)) {
+            response_data["text"] = {{"documents", text->documents},
+                                     {"trigrams", text->trigrams},
+                                     {"posting_bytes", text->posting_bytes}};
+        }
+        return {HttpStatus::Ok, "success", response_data};
+
+    } catch (const nlohmann::json::parse_error&) {
+        return {HttpStatus::BadRequest, "Invalid JSON", std::nullopt};
+    } catch (const std::exception& e) {
+        return {HttpStatus::InternalServerError, e.what(), std::nullopt};
+    }
+}
+
+ApiResult ApiHandler::handle_search(std::string_view request_body) const noexcept {
+    try {
+        auto request = nlohmann::json::parse(request_body);
+
+        if (!request.contains("key") || !request["key"].is_string()) {
+            return {HttpStatus::BadRequest, "Missing or invalid 'key' field", std::nullopt};
+        }
+        const auto key = request["key"].get<std::string>();
+
+        if (!request.contains("query") || !request["query"].is_string()) {
+            return {HttpStatus::BadRequest, "Missing or invalid 'query' field", std::nullopt};
+        }
+        const auto query = TextQuery::parse(request["query"].get<std::string>());
+        if (!query) {
+            return {HttpStatus::BadRequest, query.error(), std::nullopt};
+        }
+
+        auto limit = DEFAULT_SEARCH_LIMIT;
+        if (request.contains("limit")) {
+            const auto& value = request["limit"];
+            if (!value.is_number_integer() || value.get<std::int64_t>() < 1 ||
+                value.get<std::int64_t>() > static_cast<std::int64_t>(MAX_SEARCH_LIMIT)) {
+                return {HttpStatus::BadRequest,
+                        "'limit' must be an integer from 1 to " + std::to_string(MAX_SEARCH_LIMIT),
+                        std::nullopt};
+            }
+            limit = value.get<std::size_t>();
+        }
+
+        trace_target(key);
+        trace_stage(TraceStage::Parse);
+
+        std::expected<std::vector<std::string>, FileError> files;
+        if (auto candidates = file_manager_->find_text_candidates(key, query.value())) {
+            if (!file_manager_->key_directory_exists(key)) {
+                return file_error_to_api_result(FileError::KeyDirectoryNotFound);
+            }
+            files = std::move(candidates.value());
+        } else {
+            files = file_manager_->list_files(key);
+        }
+        if (!files) {
+            return file_error_to_api_result(files.error());
+        }
+
+        std::vector<TextMatch> matches(files->size());
+        query_pool_->parallel_for(files->size(), [&](std::size_t i) {
+            const auto content = file_manager_->get_json_bytes(key, (*files)[i]);
+            if (!content) {
+                return;
+            }
+            const auto document = nlohmann::json::parse(content.value(), nullptr, false);
+            if (!document.is_discarded()) {
+                matches[i] = query->match(document);
+            }
+        });
+
+        std::vector<std::size_t> ranked;
+        for (std::size_t i = 0; i < matches.size(); ++i) {
+            if (matches[i].score > 0) {
+                ranked.push_back(i);
+            }
+        }
+        // Files are sorted, so equal scores keep filename order.
+        std::stable_sort(ranked.begin(), ranked.end(), [&](std::size_t a, std::size_t b) {
+            return matches[a].score > matches[b].score;
+        });
+
+        nlohmann::json response_data;
+        response_data["total"] = ranked.size();
+        response_data["scanned"] = files->size();
+        auto& results = response_data["results"] = nlohmann::json::array();
+        for (std::size_t i = 0; i < ranked.size() && i < limit; ++i) {
+            const auto& match = matches[ranked[i]];
+            auto hits = nlohmann::json::array();
+            for (const auto& hit : match.hits) {
+                hits.push_back({{"pointer", hit.pointer}, {"count", hit.count}});
+            }
+            results.push_back({{"filename", (*files)[ranked[i]]},
+                               {"score", match.score},
+                               {"hits", std::move(hits)}});
+        }
+        return {HttpStatus::Ok, "success", std::move(response_data)};
+
+    } catch (const nlohmann::json::parse_error&) {
+        return {HttpStatus::BadRequest, "Invalid JSON", std::nullopt};
+    } catch (const std::exception& e) {
+        return {HttpStatus::InternalServerError, e.what(), std::nullopt};
+    }
+}
+
+ApiResult ApiHandler::handle_stats(std::string_view request_body) const noexcept {
+    try {
+        auto request = nlohmann::json::parse(request_body);
+
+        if (!request.contains("key") || !request["key"].is_string()) {
+            return {HttpStatus::BadRequest, "Missing or invalid 'key' field", std::nullopt};
+        }
+
+        const auto key = request["key"].get<std::string>();
+
+        trace_target(key);
+        trace_stage(TraceStage::Parse);
+
+        const auto result = file_manager_->get_usage(key);
+        if (!result) {
+            return file_error_to_api_result(result.error());
+        }
+
+        const auto& quota = file_manager_->get_quota();
+        nlohmann::json response_data;
+        response_data["usage"] = {{"bytes", result.value().bytes}, {"files", result.value().files}};
+        response_data["quota"] = {{"bytes", quota.max_bytes}, {"files", quota.max_files}};
+        return {HttpStatus::Ok, "success", response_data};
+
+    } catch (const nlohmann::json::parse_error&) {
+        return {HttpStatus::BadRequest, "Invalid JSON", std::nullopt};
+    } catch (const std::exception& e) {
+        return {HttpStatus::InternalServerError, e.what(), std::nullopt};
+    }
+}
+
+ApiResult ApiHandler::handle_replication(std::string_view /*request_body*/) const noexcept {
+    try {
+        nlohmann::json response_data;
+        response_data["replication"] =
+            replication_ ? replication_->status() : nlohmann::json{{"role", "standalone"}};
+        return {HttpStatus::Ok, "success", response_data};
+    } catch (const std::exception& e) {
+        return {HttpStatus::InternalServerError, e.what(), std::nullopt};
+    }
+}
+
+std::expected<std::unique_ptr<LineSource>, ApiResult>
+ApiHandler::begin_export(std::string_view request_body) const noexcept {
+    try {
+        auto request = nlohmann::json::parse(request_body);
+
+        if (!request.contains("key") || !request["key"].is_string()) {
+            return std::unexpected(
+                ApiResult{HttpStatus::BadRequest, "Missing or invalid 'key' field", std::nullopt});
+        }
+
+        auto key = request["key"].get<std::string>();
+
+        trace_target(key);
+        trace_stage(TraceStage::Parse);
+
+        auto files = file_manager_->list_files(key);
+        if (!files) {
+            return std::unexpected(file_error_to_api_result(files.error()));
+        }
+
+        return std::make_unique<ExportSource>(
+            *this, ExportPlan{std::move(key), std::move(files.value())});
+
+    } catch (const nlohmann::json::parse_error&) {
+        return std::unexpected(ApiResult{HttpStatus::BadRequest, "Invalid JSON", std::nullopt});
+    } catch (const std::exception& e) {
+        return std::unexpected(ApiResult{HttpStatus::InternalServerError, e.what(), std::nullopt});
+    }
+}
+
+std::expected<std::unique_ptr<LineSource>, ApiResult>
+ApiHandler::begin_query(std::string_view request_body) const noexcept {
+    try {
+        auto request = nlohmann::json::parse(request_body);
+
+        if (!request.contains("key") || !request["key"].is_string()) {
+            return std::unexpected(
+                ApiResult{HttpStatus::BadRequest, "Missing or invalid 'key' field", std::nullopt});
+        }
+
+        auto filter = Filter::parse(request.value("filter", nlohmann::json()));
+        if (!filter) {
+            return std::unexpected(ApiResult{HttpStatus::BadRequest, filter.error(), std::nullopt});
+        }
+
+        std::optional<Projection> projection;
+        if (request.contains("fields")) {
+            auto parsed = Projection::parse(request["fields"]);
+            if (!parsed) {
+                return std::unexpected(
+                    ApiResult{HttpStatus::BadRequest, parsed.error(), std::nullopt});
+            }
+            projection = std::move(parsed.value());
+        }
+
+        auto limit = DEFAULT_QUERY_LIMIT;
+        if (request.contains("limit")) {
+            const auto& value = request["limit"];
+            if (!value.is_number_integer() || value.get<std::int64_t>() <= 0 ||
+                value.get<std::int64_t>() > static_cast<std::int64_t>(MAX_QUERY_LIMIT)) {
+                return std::unexpected(ApiResult{
+                    HttpStatus::BadRequest,
+                    "'limit' must be an integer from 1 to " + std::to_string(MAX_QUERY_LIMIT),
+                    std::nullopt});
+            }
+            limit = value.get<std::size_t>();
+        }
+
+        if (request.contains("cursor") && !request["cursor"].is_string()) {
+            return std::unexpected(
+                ApiResult{HttpStatus::BadRequest, "Invalid 'cursor' field", std::nullopt});
+        }
+
+        auto key = request["key"].get<std::string>();
+        trace_target(key);
+        trace_stage(TraceStage::Parse);
+
+        std::expected<std::vector<std::string>, FileError> files;
+        if (auto candidates = file_manager_->find_candidates(key, filter.value())) {
+            if (!file_manager_->key_directory_exists(key)) {
+                return std::unexpected(file_error_to_api_result(FileError::KeyDirectoryNotFound));
+            }
+            files = std::move(candidates.value());
+        } else {
+            files = file_manager_->list_files(key);
+        }
+        if (!files) {
+            return std::unexpected(file_error_to_api_result(files.error()));
+        }
+
+        // Both lists are sorted, so a page continues after the last filename returned.
+        if (request.contains("cursor")) {
+            const auto cursor = request["cursor"].get<std::string>();
+            auto& names = files.value();
+            names.erase(names.begin(), std::upper_bound(names.begin(), names.end(), cursor));
+        }
+
+        return std::make_unique<QuerySource>(
+            file_manager_,
+            QueryPlan{std::move(key), std::move(files.value()), std::move(filter.value()),
+                      std::move(projection), limit},
+            *query_pool_);
+
+    } catch (const nlohmann::json::parse_error&) {
+        return std::unexpected(ApiResult{HttpStatus::BadRequest, "Invalid JSON", std::nullopt});
+    } catch (const std::exception& e) {
+        return std::unexpected(ApiResult{HttpStatus::InternalServerError, e.what(), std::nullopt});
+    }
+}
+
+std::string ApiHandler::export_header_line(const ExportPlan& plan) const {
+    nlohmann::json header;
+    header["key"] = plan.key;
+    header["files"] = plan.files.size();
+    return header.dump() + "\n";
+}
+
+std::optional<std::string> ApiHandler::export_line(const ExportPlan& plan,
+                                                   const std::string& filename) const {
+    auto content = file_manager_->get_json_bytes(plan.key, filename);
+    if (!content) {
+        return std::nullopt;
+    }
+
+    // Raw line breaks can only be insignificant whitespace in valid JSON (inside
+    // strings they must be escaped), so replacing them keeps the document
+    // intact and on one line without parsing it.
+    auto& data = content.value();
+    std::replace(data.begin(), data.end(), '\n', ' ');
+    std::replace(data.begin(), data.end(), '\r', ' ');
+
+    const auto quoted_filename = nlohmann::json(filename).dump();
+    std::string line;
+    line.reserve(data.size() + quoted_filename.size() + 24);
+    line += "{\"filename\":";
+    line += quoted_filename;
+    line += ",\"data\":";
+    line += data;
+    line += "}\n";
+    return line;
+}
+
+ImportSession ApiHandler::begin_import() const {
+    return ImportSession(file_manager_, *this);
+}
+
+void ApiHandler::tick() noexcept {
+    file_manager_->process_expirations();
+}
+
 ApiResult ApiHandler::file_error_to_api_result(FileError error) const noexcept {
-    switch (error) {
-        case FileError::KeyDirectoryNotFound:
-            return {HttpStatus::NotFound, "Key directory not found", std::nullopt};
-        case FileError::FileNotFound:
-            return {HttpStatus::NotFound, "File not found", std::nullopt};
-        case FileError::InvalidJson:
-            return {HttpStatus::BadRequest, "Invalid JSON data", std::nullopt};
-        case FileError::FileTooLarge:
-            return {HttpStatus::PayloadTooLarge, "File exceeds maximum size (1MB)", std::nullopt};
-        case FileError::InvalidFilename:
-            return {HttpStatus::BadRequest, "Invalid filename", std::nullopt};
-        case FileError::IoError:
-            return {HttpStatus::InternalServerError, "File I/O error", std::nullopt};
-        case FileError::JsonEncodingError:
-            return {HttpStatus::InternalServerError, "JSON encoding error", std::nullopt};
-    }
-    return {HttpStatus::InternalServerError, "Unknown error", std::nullopt};
+    auto result = [error]() -> ApiResult {
+        switch (error) {
+            case FileError::KeyDirectoryNotFound:
+                return {HttpStatus::NotFound, "Key directory not found", std::nullopt};
+            case FileError::FileNotFound:
+                return {HttpStatus::NotFound, "File not found", std::nullopt};
+            case FileError::InvalidJson:
+                return {HttpStatus::BadRequest, "Invalid JSON data", std::nullopt};
+            case FileError::FileTooLarge:
+                return {HttpStatus::PayloadTooLarge, "File exceeds maximum size (1MB)",
+                        std::nullopt};
+            case FileError::InvalidFilename:
+                return {HttpStatus::BadRequest, "Invalid filename", std::nullopt};
+            case FileError::IoError:
+                return {HttpStatus::InternalServerError, "File I/O error", std::nullopt};
+            case FileError::JsonEncodingError:
+                return {HttpStatus::InternalServerError, "JSON encoding error", std::nullopt};
+            case FileError::VersionMismatch:
+                return {HttpStatus::Conflict, "Version mismatch", std::nullopt};
+            case FileError::QuotaExceeded:
+                return {HttpStatus::InsufficientStorage, "Key quota exceeded", std::nullopt};
+        }
+        return {HttpStatus::InternalServerError, "Unknown error", std::nullopt};
+    }();
+    result.file_error = error;
+    return result;
 }
 
 } // namespace simple_data_server
@@ -1,10 +1,15 @@
 #ifndef SIMPLE_DATA_SERVER_HANDLERS_API_HANDLER_HPP
 #define SIMPLE_DATA_SERVER_HANDLERS_API_HANDLER_HPP
 
+#include <optional>
 #include <string>
 #include <string_view>
 #include <memory>
+#include <vector>
+#include "handlers/line_source.hpp"
+#include "replication/replication_node.hpp"
 #include "storage/file_manager.hpp"
+#include "util/thread_pool.hpp"
 
 namespace simple_data_server {
 
@@ -14,9 +19,20 @@ namespace simple_data_server {
 enum class HttpStatus : int {
     Ok = 200,
     BadRequest = 400,
+    Forbidden = 403,
     NotFound = 404,
+    Conflict = 409,
     PayloadTooLarge = 413,
-    InternalServerError = 500
+    InternalServerError = 500,
+    InsufficientStorage = 507
+};
+
+/**
+ * @brief A response member whose value is already serialized JSON.
+ */
+struct RawJsonMember {
+    std::string name;
+    std::string json;
 };
 
 /**
@@ -26,8 +42,28 @@ struct ApiResult {
     HttpStatus status;
     std::string message;
     std::optional<nlohmann::json> data;
+
+    /**
+     * @brief Members written to the response unchanged, after those of data.
+     */
+    std::vector<RawJsonMember> raw_data{};
+
+    /**
+     * @brief The storage error the status reports, if any; counted by /metrics.
+     */
+    std::optional<FileError> file_error{};
 };
 
+/**
+ * @brief The documents to stream for one /api/export request.
+ */
+struct ExportPlan {
+    std::string key;
+    std::vector<std::string> files;
+};
+
+class ImportSession;
+
 /**
  * @brief Handles API requests for put, get, and list operations.
  *
@@ -44,15 +80,32 @@ public:
      */
     explicit ApiHandler(std::shared_ptr<FileManager> file_manager);
 
+    /**
+     * @brief Set this server's replication role.
+     *
+     * On a read-only replica, put and import requests are rejected with status
+     * Forbidden. Must be called before requests are handled.
+     *
+     * @param replication The replication role, or nullptr when not replicating.
+     */
+    void set_replication(std::shared_ptr<const ReplicationNode> replication) {
+        replication_ = std::move(replication);
+    }
+
     /**
      * @brief Handle a PUT request to store JSON data.
      *
      * Expected JSON body: {"key": "...", "filename": "...", "data": {...}}
+     * Optional fields: "if_version" (string) makes the write conditional on the
+     * document's current version; "" requires that the document does not exist.
+     * "ttl_seconds" (positive integer, at most ExpiryManager::MAX_TTL) deletes
+     * the document after that many seconds.
      *
      * @param request_body The raw request body string.
      * @return ApiResult The result of the operation.
      * @pre request_body must be a valid JSON string.
-     * @post On success, returns status Ok. On failure, returns appropriate error.
+     * @post On success, returns status Ok with the new version. On version
+     *       mismatch, returns status Conflict. On failure, returns appropriate error.
      */
     [[nodiscard]] ApiResult handle_put(std::string_view request_body) const noexcept;
 
@@ -64,7 +117,8 @@ public:
      * @param request_body The raw request body string.
      * @return ApiResult The result of the operation.
      * @pre request_body must be a valid JSON string.
-     * @post On success, returns status Ok with data field. On failure, returns appropriate error.
+     * @post On success, returns status Ok with data and version fields. On failure,
+     *       returns appropriate error.
      */
     [[nodiscard]] ApiResult handle_get(std::string_view request_body) const noexcept;
 
@@ -80,15 +134,149 @@ public:
      */
     [[nodiscard]] ApiResult handle_list(std::string_view request_body) const noexcept;
 
-private:
     /**
-     * @brief Parse request body JSON and extract key field.
+     * @brief Handle a STATS request to report a key's storage usage and quota.
      *
-     * @param request_body The raw request body.
-     * @return std::expected<std::string, ApiResult> The key or error.
+     * Expected JSON body: {"key": "..."}
+     *
+     * @param request_body The raw request body string.
+     * @return ApiResult The result of the operation.
+     * @pre request_body must be a valid JSON string.
+     * @post On success, returns status Ok with usage and quota objects. On failure,
+     *       returns appropriate error.
      */
-    [[nodiscard]] std::expected<std::string, ApiResult>
-    parse_and_get_key(std::string_view request_body) const noexcept;
+    [[nodiscard]] ApiResult handle_stats(std::string_view request_body) const noexcept;
+
+    /**
+     * @brief Handle an AGGREGATE request to reduce numeric fields of a key's documents.
+     *
+     * Expected JSON body: {"key": "...", "filter": {...}, "group_by": "/a",
+     * "aggregates": [{"op": "sum", "path": "/b", "as": "total"}, ...]}; see
+     * AggregationSpec. Documents are read and reduced in parallel, so this
+     * blocks for the whole scan and should not be called on the event loop.
+     *
+     * @param request_body The raw request body string.
+     * @return ApiResult The result of the operation.
+     * @pre request_body must be a valid JSON string.
+     * @post On success, returns status Ok with matched and scanned counts and
+     *       the results, per group when grouping. On failure, returns
+     *       appropriate error.
+     */
+    [[nodiscard]] ApiResult handle_aggregate(std::string_view request_body) const noexcept;
+
+    /**
+     * @brief Handle an INDEX request to create, drop or list a key's secondary indexes.
+     *
+     * Expected JSON body: {"key": "...", "action": "create" | "drop" | "list",
+     * "type": "field" | "text", "path": "/a/b"} where action defaults to "list",
+     * type defaults to "field" and path is required to create or drop a field index.
+     *
+     * @param request_body The raw request body string.
+     * @return ApiResult The result of the operation.
+     * @pre request_body must be a valid JSON string.
+     * @post On success, returns status Ok with the key's indexed paths and its
+     *       text index counts, or null if it has none. On failure, returns
+     *       appropriate error.
+     */
+    [[nodiscard]] ApiResult handle_index(std::string_view request_body) const noexcept;
+
+    /**
+     * @brief Handle a SEARCH request to find documents containing text.
+     *
+     * Expected JSON body: {"key": "...", "query": "terms ...", "limit": 20}; see
+     * TextQuery. Candidates come from the key's text index if it has one and
+     * are otherwise all documents; either way they are read and checked in
+     * parallel, so this blocks for the whole scan and should not be called on
+     * the event loop.
+     *
+     * @param request_body The raw request body string.
+     * @return ApiResult The result of the operation.
+     * @pre request_body must be a valid JSON string.
+     * @post On success, returns status Ok with the total number of matches and
+     *       the best ones, each with its score and hit locations. On failure,
+     *       returns appropriate error.
+     */
+    [[nodiscard]] ApiResult handle_search(std::string_view request_body) const noexcept;
+
+    /**
+     * @brief Handle a REPLICATION request to report the replication state.
+     *
+     * The request body is ignored.
+     *
+     * @param request_body The raw request body string.
+     * @return ApiResult The result of the operation.
+     * @post Returns status Ok with a replication object describing the role,
+     *       sequence numbers and lag; {"role": "standalone"} when not replicating.
+     */
+    [[nodiscard]] ApiResult handle_replication(std::string_view request_body) const noexcept;
+
+    /**
+     * @brief Check whether writes are rejected because this server is a replica.
+     *
+     * @return bool true on a read-only replica.
+     */
+    [[nodiscard]] bool is_read_only() const noexcept {
+        return replication_ && replication_->is_read_only();
+    }
+
+    /**
+     * @brief Validate an EXPORT request and list the documents to stream.
+     *
+     * Expected JSON body: {"key": "..."}
+     *
+     * The source emits a header line followed by one export_line() per document.
+     *
+     * @param request_body The raw request body string.
+     * @return std::expected<std::unique_ptr<LineSource>, ApiResult> The lines
+     *         to stream, or the error to send.
+     */
+    [[nodiscard]] std::expected<std::unique_ptr<LineSource>, ApiResult>
+    begin_export(std::string_view request_body) const noexcept;
+
+    /**
+     * @brief Validate a QUERY request and prepare its evaluation.
+     *
+     * Expected JSON body:
+     * {"key": "...", "filter": {...}, "fields": ["/a", ...], "limit": 100, "cursor": "..."}
+     * where only key is required. See Filter for the filter language. Results
+     * start after the stored filename given as cursor. Only the documents the
+     * key's secondary indexes allow are scanned when the filter can use them.
+     *
+     * @param request_body The raw request body string.
+     * @return std::expected<std::unique_ptr<LineSource>, ApiResult> A
+     *         QuerySource, or the error to send.
+     */
+    [[nodiscard]] std::expected<std::unique_ptr<LineSource>, ApiResult>
+    begin_query(std::string_view request_body) const noexcept;
+
+    /**
+     * @brief Build the JSON Lines header line of an export.
+     *
+     * @param plan The export plan.
+     * @return std::string The line, including the trailing newline.
+     */
+    [[nodiscard]] std::string export_header_line(const ExportPlan& plan) const;
+
+    /**
+     * @brief Build the JSON Lines record for one exported document.
+     *
+     * The stored bytes are spliced in without being parsed. Safe to call from
+     * any thread.
+     *
+     * @param plan The export plan.
+     * @param filename A stored filename from plan.files.
+     * @return std::optional<std::string> The line, or std::nullopt if the
+     *         document disappeared since the plan was made.
+     */
+    [[nodiscard]] std::optional<std::string> export_line(const ExportPlan& plan,
+                                                         const std::string& filename) const;
+
+    /**
+     * @brief Start an IMPORT request.
+     *
+     * @return ImportSession A session to feed the streamed request body into.
+     */
+    [[nodiscard]] ImportSession begin_import() const;
 
     /**
      * @brief Convert FileError to ApiResult.
@@ -98,7 +286,26 @@ private:
      */
     [[nodiscard]] ApiResult file_error_to_api_result(FileError error) const noexcept;
 
+    /**
+     * @brief Run periodic maintenance such as TTL expiry.
+     *
+     * Called once per second from the server's event loop.
+     */
+    void tick() noexcept;
+
+private:
+    /**
+     * @brief Parse request body JSON and extract key field.
+     *
+     * @param request_body The raw request body.
+     * @return std::expected<std::string, ApiResult> The key or error.
+     */
+    [[nodiscard]] std::expected<std::string, ApiResult>
+    parse_and_get_key(std::string_view request_body) const noexcept;
+
     std::shared_ptr<FileManager> file_manager_;
+    std::shared_ptr<const ReplicationNode> replication_;
+    std::unique_ptr<ThreadPool> query_pool_;
 };
 
 } // namespace simple_data_server
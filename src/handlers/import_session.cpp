@@ -0,0 +1,137 @@
+#include "handlers/import_session.hpp"
+
+#include "json/json_validator.hpp"
+#include "storage/file_io.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::size_t MAX_IMPORT_LINE_SIZE = 2 * 1024 * 1024;
+constexpr std::size_t MAX_REPORTED_ERRORS = 100;
+
+} // namespace
+
+ImportSession::ImportSession(std::shared_ptr<FileManager> file_manager, const ApiHandler& handler)
+    : file_manager_(std::move(file_manager)), handler_(handler) {
+    if (handler_.is_read_only()) {
+        abort_result_ = ApiResult{HttpStatus::Forbidden, "Server is a read-only replica",
+                                  std::nullopt};
+    }
+}
+
+void ImportSession::feed(std::string_view chunk) {
+    if (abort_result_) {
+        return;
+    }
+
+    pending_.append(chunk.data(), chunk.size());
+
+    std::size_t line_start = 0;
+    for (auto newline = pending_.find('\n'); newline != std::string::npos;
+         newline = pending_.find('\n', line_start)) {
+        process_line(std::string_view(pending_).substr(line_start, newline - line_start));
+        line_start = newline + 1;
+        if (abort_result_) {
+            pending_.clear();
+            return;
+        }
+    }
+    pending_.erase(0, line_start);
+
+    if (pending_.size() > MAX_IMPORT_LINE_SIZE) {
+        abort_result_ = ApiResult{HttpStatus::PayloadTooLarge, "Import line too large", std::nullopt};
+        pending_.clear();
+    }
+}
+
+ApiResult ImportSession::finish() {
+    if (!abort_result_ && !pending_.empty()) {
+        process_line(pending_);
+        pending_.clear();
+    }
+
+    if (abort_result_) {
+        return abort_result_.value();
+    }
+    if (!key_) {
+        return {HttpStatus::BadRequest, "Missing import header line", std::nullopt};
+    }
+
+    nlohmann::json response_data;
+    response_data["imported"] = imported_;
+    response_data["failed"] = failed_;
+    response_data["errors"] = errors_;
+    return {HttpStatus::Ok, "success", response_data};
+}
+
+void ImportSession::process_line(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (line.find_first_not_of(" \t") == std::string_view::npos) {
+        return;
+    }
+
+    // Indexed rather than parsed, so each document is stored as the exact
+    // bytes exported and keeps its version.
+    const auto record = index_json_object(line);
+    if (!record) {
+        if (!key_) {
+            abort_result_ = ApiResult{HttpStatus::BadRequest, "Invalid import header line", std::nullopt};
+        } else {
+            record_failure("", "Invalid JSON");
+        }
+        return;
+    }
+
+    if (!key_) {
+        const auto* key_member = record->find("key");
+        if (key_member == nullptr || key_member->type != JsonType::String) {
+            abort_result_ = ApiResult{HttpStatus::BadRequest, "Missing or invalid 'key' field", std::nullopt};
+            return;
+        }
+        auto key = json_string_value(key_member->value);
+        if (!file_manager_->key_directory_exists(key)) {
+            abort_result_ = handler_.file_error_to_api_result(FileError::KeyDirectoryNotFound);
+            return;
+        }
+        key_ = std::move(key);
+        return;
+    }
+
+    const auto* filename_member = record->find("filename");
+    if (filename_member == nullptr || filename_member->type != JsonType::String) {
+        record_failure("", "Missing or invalid 'filename' field");
+        return;
+    }
+    const auto filename = json_string_value(filename_member->value);
+    const auto* data = record->find("data");
+    if (data == nullptr) {
+        record_failure(filename, "Missing 'data' field");
+        return;
+    }
+
+    // Exported filenames are stored names; drop the extension so that
+    // sanitization maps them back onto the same stored name.
+    std::string_view name(filename);
+    if (name.ends_with(JSON_EXTENSION)) {
+        name.remove_suffix(JSON_EXTENSION.size());
+    }
+
+    const auto result = file_manager_->put_raw(key_.value(), name, data->value);
+    if (!result) {
+        record_failure(filename, handler_.file_error_to_api_result(result.error()).message);
+        return;
+    }
+    ++imported_;
+}
+
+void ImportSession::record_failure(std::string_view filename, std::string_view message) {
+    ++failed_;
+    if (errors_.size() < MAX_REPORTED_ERRORS) {
+        errors_.push_back({{"filename", filename}, {"error", message}});
+    }
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,65 @@
+#ifndef SIMPLE_DATA_SERVER_HANDLERS_IMPORT_SESSION_HPP
+#define SIMPLE_DATA_SERVER_HANDLERS_IMPORT_SESSION_HPP
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "handlers/api_handler.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Applies a streamed /api/import request body line by line.
+ *
+ * The body uses the /api/export format: JSON Lines whose first line is a
+ * header {"key": "..."} followed by one {"filename": "...", "data": ...}
+ * record per document. Each complete line is stored as soon as it arrives,
+ * so the body is never buffered as a whole. Failures of individual records
+ * are collected and reported at the end; an invalid header, a missing key
+ * directory or an oversized line abort the import.
+ */
+class ImportSession {
+public:
+    /**
+     * @brief Construct an ImportSession.
+     *
+     * @param file_manager The FileManager to store documents with.
+     * @param handler The ApiHandler used to map storage errors to results.
+     */
+    ImportSession(std::shared_ptr<FileManager> file_manager, const ApiHandler& handler);
+
+    /**
+     * @brief Process the next chunk of the request body.
+     *
+     * @param chunk Bytes of the body, split at arbitrary positions.
+     */
+    void feed(std::string_view chunk);
+
+    /**
+     * @brief Process any final unterminated line and build the response.
+     *
+     * @return ApiResult Status Ok with imported/failed counts and errors, or the
+     *         error that aborted the import.
+     */
+    [[nodiscard]] ApiResult finish();
+
+private:
+    void process_line(std::string_view line);
+    void record_failure(std::string_view filename, std::string_view message);
+
+    std::shared_ptr<FileManager> file_manager_;
+    const ApiHandler& handler_;
+    std::string pending_;
+    std::optional<std::string> key_;
+    std::optional<ApiResult> abort_result_;
+    std::size_t imported_ = 0;
+    std::size_t failed_ = 0;
+    nlohmann::json errors_ = nlohmann::json::array();
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_HANDLERS_IMPORT_SESSION_HPP
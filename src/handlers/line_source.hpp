@@ -0,0 +1,30 @@
+#ifndef SIMPLE_DATA_SERVER_HANDLERS_LINE_SOURCE_HPP
+#define SIMPLE_DATA_SERVER_HANDLERS_LINE_SOURCE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace simple_data_server {
+
+/**
+ * @brief Produces the body of a streamed JSON Lines response, a batch at a time.
+ *
+ * read() is called on a background thread, never concurrently with itself.
+ */
+class LineSource {
+public:
+    virtual ~LineSource() = default;
+
+    /**
+     * @brief Append the next complete lines to a buffer.
+     *
+     * @param out Buffer to append to.
+     * @param budget Stop appending once about this many bytes were added.
+     * @return bool true while more lines remain.
+     */
+    virtual bool read(std::string& out, std::size_t budget) = 0;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_HANDLERS_LINE_SOURCE_HPP
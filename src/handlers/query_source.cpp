@@ -0,0 +1,114 @@
+#include "handlers/query_source.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "util/thread_pool.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::size_t MAX_BATCH_FILES = 256;
+
+/**
+ * @brief Build a result line in the /api/export record format.
+ *
+ * @param data Serialized JSON; raw line breaks in it are whitespace and are
+ *        replaced to keep the record on one line.
+ */
+std::string result_line(const std::string& filename, std::string data) {
+    std::replace(data.begin(), data.end(), '\n', ' ');
+    std::replace(data.begin(), data.end(), '\r', ' ');
+
+    const auto quoted_filename = nlohmann::json(filename).dump();
+    std::string line;
+    line.reserve(data.size() + quoted_filename.size() + 24);
+    line += "{\"filename\":";
+    line += quoted_filename;
+    line += ",\"data\":";
+    line += data;
+    line += "}\n";
+    return line;
+}
+
+} // namespace
+
+QuerySource::QuerySource(std::shared_ptr<FileManager> file_manager, QueryPlan plan,
+                         ThreadPool& pool)
+    : file_manager_(std::move(file_manager)), plan_(std::move(plan)), pool_(pool) {
+}
+
+bool QuerySource::read(std::string& out, std::size_t budget) {
+    const auto start_size = out.size();
+
+    while (!done_ && out.size() - start_size < budget) {
+        if (next_file_ >= plan_.files.size() || matched_ >= plan_.limit) {
+            append_trailer(out);
+            done_ = true;
+            break;
+        }
+
+        // Read no more documents than the remaining limit needs, but enough to
+        // keep every worker busy. The batch cap wins over the pool size, which
+        // may exceed it on large hosts.
+        const auto wanted =
+            std::min(std::max(plan_.limit - matched_, pool_.size()), MAX_BATCH_FILES);
+        const auto count = std::min(wanted, plan_.files.size() - next_file_);
+
+        std::vector<std::optional<std::string>> results(count);
+        pool_.parallel_for(count, [&](std::size_t i) {
+            results[i] = evaluate(plan_.files[next_file_ + i]);
+        });
+
+        // Results past the limit are dropped so the next page starts right
+        // after the last returned document.
+        for (std::size_t i = 0; i < count && matched_ < plan_.limit; ++i) {
+            ++next_file_;
+            if (results[i]) {
+                out += results[i].value();
+                ++matched_;
+            }
+        }
+    }
+    return !done_;
+}
+
+std::optional<std::string> QuerySource::evaluate(const std::string& filename) const noexcept {
+    try {
+        auto content = file_manager_->get_json_bytes(plan_.key, filename);
+        if (!content || !plan_.filter.may_match(content.value())) {
+            return std::nullopt;
+        }
+        if (plan_.filter.empty() && !plan_.projection) {
+            return result_line(filename, std::move(content.value()));
+        }
+
+        const auto document = nlohmann::json::parse(content.value(), nullptr, false);
+        if (document.is_discarded() || !plan_.filter.matches(document)) {
+            return std::nullopt;
+        }
+        if (!plan_.projection) {
+            return result_line(filename, std::move(content.value()));
+        }
+        return result_line(filename, plan_.projection->apply(document).dump());
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+void QuerySource::append_trailer(std::string& out) const {
+    nlohmann::json trailer;
+    trailer["matched"] = matched_;
+    trailer["scanned"] = next_file_;
+    // More documents may match only if the scan stopped at the limit.
+    if (matched_ >= plan_.limit && next_file_ < plan_.files.size()) {
+        trailer["next_cursor"] = plan_.files[next_file_ - 1];
+    } else {
+        trailer["next_cursor"] = nullptr;
+    }
+    out += trailer.dump();
+    out += '\n';
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,76 @@
+#ifndef SIMPLE_DATA_SERVER_HANDLERS_QUERY_SOURCE_HPP
+#define SIMPLE_DATA_SERVER_HANDLERS_QUERY_SOURCE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "handlers/line_source.hpp"
+#include "query/filter.hpp"
+#include "storage/file_manager.hpp"
+
+namespace simple_data_server {
+
+class ThreadPool;
+
+/**
+ * @brief The documents to scan and what to return for one /api/query request.
+ */
+struct QueryPlan {
+    std::string key;
+
+    /**
+     * @brief Stored filenames to scan, in order.
+     */
+    std::vector<std::string> files;
+
+    Filter filter;
+    std::optional<Projection> projection;
+
+    /**
+     * @brief Stop after this many matches.
+     */
+    std::size_t limit;
+};
+
+/**
+ * @brief Evaluates a query and produces its JSON Lines result.
+ *
+ * Emits one {"filename": "...", "data": ...} line per matching document, in
+ * filename order, followed by a trailer line
+ * {"matched": M, "scanned": S, "next_cursor": "..." | null}. Documents are
+ * evaluated in batches across a thread pool; each one is first checked with
+ * Filter::may_match and only parsed if it passes. Without a filter or
+ * projection, documents are not parsed at all.
+ */
+class QuerySource : public LineSource {
+public:
+    /**
+     * @brief Construct a QuerySource.
+     *
+     * @param file_manager The FileManager to read documents from.
+     * @param plan The query.
+     * @param pool Thread pool for evaluating documents; must not be the pool
+     *        read() is called on.
+     */
+    QuerySource(std::shared_ptr<FileManager> file_manager, QueryPlan plan, ThreadPool& pool);
+
+    bool read(std::string& out, std::size_t budget) override;
+
+private:
+    [[nodiscard]] std::optional<std::string> evaluate(const std::string& filename) const noexcept;
+    void append_trailer(std::string& out) const;
+
+    std::shared_ptr<FileManager> file_manager_;
+    QueryPlan plan_;
+    ThreadPool& pool_;
+    std::size_t next_file_ = 0;
+    std::size_t matched_ = 0;
+    bool done_ = false;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_HANDLERS_QUERY_SOURCE_HPP
@@ -0,0 +1,411 @@
+#include "json/json_validator.hpp"
+
+#include "json/structural_index.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::size_t MAX_FINITE_DIGITS = 308;
+
+bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/**
+ * @brief Whether a byte may follow a number or literal.
+ */
+bool ends_atom(std::string_view json, std::size_t pos) {
+    if (pos >= json.size()) {
+        return true;
+    }
+    switch (json[pos]) {
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+        case ',':
+        case ':':
+        case '}':
+        case ']':
+        case '{':
+        case '[':
+        case '"':
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Validate the number or literal starting at pos.
+ *
+ * @return std::size_t Offset just past the atom, or 0 if it is invalid.
+ */
+std::size_t scan_atom(std::string_view json, std::size_t pos, JsonType& type) {
+    const auto matches = [&](std::string_view literal) {
+        return json.compare(pos, literal.size(), literal) == 0 &&
+               ends_atom(json, pos + literal.size());
+    };
+
+    switch (json[pos]) {
+        case 't':
+            type = JsonType::Boolean;
+            return matches("true") ? pos + 4 : 0;
+        case 'f':
+            type = JsonType::Boolean;
+            return matches("false") ? pos + 5 : 0;
+        case 'n':
+            type = JsonType::Null;
+            return matches("null") ? pos + 4 : 0;
+        default:
+            break;
+    }
+
+    // -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+    type = JsonType::Number;
+    const auto size = json.size();
+    const auto start = pos;
+    bool has_exponent = false;
+    if (json[pos] == '-') {
+        ++pos;
+    }
+    if (pos >= size || !is_digit(json[pos])) {
+        return 0;
+    }
+    if (json[pos] == '0') {
+        ++pos;
+    } else {
+        while (pos < size && is_digit(json[pos])) {
+            ++pos;
+        }
+    }
+    if (pos < size && json[pos] == '.') {
+        ++pos;
+        if (pos >= size || !is_digit(json[pos])) {
+            return 0;
+        }
+        while (pos < size && is_digit(json[pos])) {
+            ++pos;
+        }
+    }
+    if (pos < size && (json[pos] == 'e' || json[pos] == 'E')) {
+        has_exponent = true;
+        ++pos;
+        if (pos < size && (json[pos] == '+' || json[pos] == '-')) {
+            ++pos;
+        }
+        if (pos >= size || !is_digit(json[pos])) {
+            return 0;
+        }
+        while (pos < size && is_digit(json[pos])) {
+            ++pos;
+        }
+    }
+    if (!ends_atom(json, pos)) {
+        return 0;
+    }
+
+    // Like a DOM parse, reject numbers that overflow a double. Only a large
+    // exponent or more than 308 digits can.
+    if (has_exponent || pos - start > MAX_FINITE_DIGITS) {
+        const std::string number(json.substr(start, pos - start));
+        if (!std::isfinite(std::strtod(number.c_str(), nullptr))) {
+            return 0;
+        }
+    }
+    return pos;
+}
+
+/**
+ * @brief Stage 2: check the grammar over the structural positions.
+ *
+ * Strings were fully checked by stage 1, and since no structurals are
+ * recorded inside strings, every opening quote is immediately followed by
+ * its closing quote in positions.
+ *
+ * @param members If not null, receives the members of a root object.
+ */
+bool walk_structure(std::string_view json,
+                    const std::vector<std::uint32_t>& positions,
+                    JsonType& root_type,
+                    std::vector<JsonMember>* members) {
+    const auto count = positions.size();
+    std::vector<char> stack; // Open containers: '{' or '['.
+    std::size_t i = 0;
+
+    // Where the current member of the root object starts.
+    std::string_view member_name;
+    std::size_t member_value_start = 0;
+    JsonType member_type = JsonType::Null;
+
+    const auto token = [&](std::size_t index) { return json[positions[index]]; };
+
+    enum class State { Value, ObjectKey, AfterValue };
+    auto state = State::Value;
+
+    while (true) {
+        switch (state) {
+            case State::Value: {
+                if (i >= count) {
+                    return false;
+                }
+                const auto pos = positions[i];
+                const bool is_member_value = stack.size() == 1 && stack.back() == '{';
+                if (is_member_value) {
+                    member_value_start = pos;
+                }
+
+                JsonType type;
+                std::size_t end = 0;
+                switch (json[pos]) {
+                    case '{':
+                    case '[': {
+                        type = json[pos] == '{' ? JsonType::Object : JsonType::Array;
+                        const char close = json[pos] == '{' ? '}' : ']';
+                        if (stack.empty()) {
+                            root_type = type;
+                        }
+                        if (is_member_value) {
+                            member_type = type;
+                        }
+                        ++i;
+                        if (i < count && token(i) == close) {
+                            end = positions[i] + 1;
+                            ++i;
+                            break;
+                        }
+                        stack.push_back(json[pos]);
+                        state = type == JsonType::Object ? State::ObjectKey : State::Value;
+                        continue;
+                    }
+                    case '"':
+                        type = JsonType::String;
+                        end = positions[i + 1] + 1;
+                        i += 2;
+                        break;
+                    case '}':
+                    case ']':
+                    case ':':
+                    case ',':
+                        return false;
+                    default:
+                        end = scan_atom(json, pos, type);
+                        if (end == 0) {
+                            return false;
+                        }
+                        ++i;
+                        break;
+                }
+
+                if (stack.empty()) {
+                    root_type = type;
+                }
+                if (is_member_value && members) {
+                    members->push_back(
+                        {member_name, json.substr(member_value_start, end - member_value_start),
+                         type});
+                }
+                state = State::AfterValue;
+                break;
+            }
+
+            case State::ObjectKey: {
+                if (i + 2 >= count || token(i) != '"' || token(i + 2) != ':') {
+                    return false;
+                }
+                if (stack.size() == 1) {
+                    const auto start = positions[i] + 1;
+                    member_name = json.substr(start, positions[i + 1] - start);
+                }
+                i += 3;
+                state = State::Value;
+                break;
+            }
+
+            case State::AfterValue: {
+                if (stack.empty()) {
+                    return i == count;
+                }
+                if (i >= count) {
+                    return false;
+                }
+
+                const char c = token(i);
+                if (c == ',') {
+                    ++i;
+                    state = stack.back() == '{' ? State::ObjectKey : State::Value;
+                    break;
+                }
+                if ((c == '}' && stack.back() == '{') || (c == ']' && stack.back() == '[')) {
+                    const auto end = positions[i] + 1;
+                    ++i;
+                    stack.pop_back();
+                    if (stack.size() == 1 && stack.back() == '{' && members) {
+                        members->push_back(
+                            {member_name,
+                             json.substr(member_value_start, end - member_value_start),
+                             member_type});
+                    }
+                    break;
+                }
+                return false;
+            }
+        }
+    }
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool parse_hex4(std::string_view text, std::size_t pos, std::uint32_t& value) {
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    value = 0;
+    for (std::size_t i = pos; i < pos + 4; ++i) {
+        const auto digit = hex_value(text[i]);
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | static_cast<std::uint32_t>(digit);
+    }
+    return true;
+}
+
+void append_utf8(std::string& out, std::uint32_t code_point) {
+    if (code_point < 0x80) {
+        out.push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+} // namespace
+
+const JsonMember* JsonObjectIndex::find(std::string_view name) const {
+    for (auto it = members.rbegin(); it != members.rend(); ++it) {
+        if (it->name == name) {
+            return &*it;
+        }
+        if (it->name.find('\\') != std::string_view::npos) {
+            const auto unescaped = unescape_json_string(it->name);
+            if (unescaped && unescaped.value() == name) {
+                return &*it;
+            }
+        }
+    }
+    return nullptr;
+}
+
+bool validate_json(std::string_view json) {
+    std::vector<std::uint32_t> positions;
+    JsonType root_type;
+    return build_structural_index(json, positions) &&
+           walk_structure(json, positions, root_type, nullptr);
+}
+
+std::optional<JsonObjectIndex> index_json_object(std::string_view json) {
+    std::vector<std::uint32_t> positions;
+    if (!build_structural_index(json, positions)) {
+        return std::nullopt;
+    }
+
+    JsonObjectIndex index{JsonType::Null, {}};
+    if (!walk_structure(json, positions, index.root_type, &index.members)) {
+        return std::nullopt;
+    }
+    return index;
+}
+
+std::optional<std::string> unescape_json_string(std::string_view raw) {
+    std::string result;
+    result.reserve(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] != '\\') {
+            result.push_back(raw[i]);
+            continue;
+        }
+        if (++i >= raw.size()) {
+            return std::nullopt;
+        }
+        switch (raw[i]) {
+            case '"':
+            case '\\':
+            case '/':
+                result.push_back(raw[i]);
+                break;
+            case 'b':
+                result.push_back('\b');
+                break;
+            case 'f':
+                result.push_back('\f');
+                break;
+            case 'n':
+                result.push_back('\n');
+                break;
+            case 'r':
+                result.push_back('\r');
+                break;
+            case 't':
+                result.push_back('\t');
+                break;
+            case 'u': {
+                std::uint32_t code_point;
+                if (!parse_hex4(raw, i + 1, code_point)) {
+                    return std::nullopt;
+                }
+                i += 4;
+                if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                    std::uint32_t low;
+                    if (i + 2 >= raw.size() || raw[i + 1] != '\\' || raw[i + 2] != 'u' ||
+                        !parse_hex4(raw, i + 3, low) || low < 0xDC00 || low > 0xDFFF) {
+                        return std::nullopt;
+                    }
+                    i += 6;
+                    code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+                } else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                    return std::nullopt;
+                }
+                append_utf8(result, code_point);
+                break;
+            }
+            default:
+                return std::nullopt;
+        }
+    }
+    return result;
+}
+
+std::string json_string_value(std::string_view value) {
+    const auto raw = value.substr(1, value.size() - 2);
+    if (raw.find('\\') == std::string_view::npos) {
+        return std::string(raw);
+    }
+    return unescape_json_string(raw).value_or(std::string());
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,107 @@
+#ifndef SIMPLE_DATA_SERVER_JSON_JSON_VALIDATOR_HPP
+#define SIMPLE_DATA_SERVER_JSON_JSON_VALIDATOR_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simple_data_server {
+
+/**
+ * @brief Type of a JSON value.
+ */
+enum class JsonType : std::uint8_t {
+    Object,
+    Array,
+    String,
+    Number,
+    Boolean,
+    Null
+};
+
+/**
+ * @brief One member of a top-level JSON object, as byte ranges of the input.
+ */
+struct JsonMember {
+    /**
+     * @brief The member name between its quotes, still escaped.
+     */
+    std::string_view name;
+
+    /**
+     * @brief The complete value text, e.g. {"a":1}, "text" (with quotes) or 42.
+     */
+    std::string_view value;
+
+    JsonType type;
+};
+
+/**
+ * @brief A validated JSON text and the members of its root object.
+ */
+struct JsonObjectIndex {
+    JsonType root_type;
+
+    /**
+     * @brief The root object's members in input order; empty unless the root is an object.
+     */
+    std::vector<JsonMember> members;
+
+    /**
+     * @brief Find a member by name.
+     *
+     * As with a DOM parse, the last occurrence of a duplicated name wins.
+     *
+     * @param name The unescaped member name.
+     * @return const JsonMember* The member, or nullptr if absent.
+     */
+    [[nodiscard]] const JsonMember* find(std::string_view name) const;
+};
+
+/**
+ * @brief Check whether a text is valid JSON (RFC 8259) without building a DOM.
+ *
+ * Runs the SIMD structural indexer (build_structural_index()) and then
+ * checks the grammar by walking the structural positions, so the input is
+ * only read byte by byte inside numbers and literals.
+ *
+ * @param json The text to check.
+ * @return bool true if json is one valid JSON value surrounded by optional whitespace.
+ */
+[[nodiscard]] bool validate_json(std::string_view json);
+
+/**
+ * @brief Validate a JSON text and index the members of its root object.
+ *
+ * Lets a request be inspected and a member's value passed on as raw bytes
+ * without parsing the values into a DOM.
+ *
+ * @param json The text to index.
+ * @return std::optional<JsonObjectIndex> The index, or std::nullopt if json
+ *         is not valid JSON. A valid non-object root yields no members.
+ */
+[[nodiscard]] std::optional<JsonObjectIndex> index_json_object(std::string_view json);
+
+/**
+ * @brief Decode the escape sequences of a JSON string.
+ *
+ * @param raw The characters between the quotes.
+ * @return std::optional<std::string> The decoded UTF-8 string, or
+ *         std::nullopt if an escape sequence is invalid.
+ */
+[[nodiscard]] std::optional<std::string> unescape_json_string(std::string_view raw);
+
+/**
+ * @brief Decode a string value taken from a JsonMember.
+ *
+ * @param value The value text including its quotes.
+ * @return std::string The decoded string.
+ * @pre value must be a string that passed validation.
+ */
+[[nodiscard]] std::string json_string_value(std::string_view value);
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_JSON_JSON_VALIDATOR_HPP
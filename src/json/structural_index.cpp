@@ -0,0 +1,386 @@
+#include "json/structural_index.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define SDS_JSON_X86 1
+#endif
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::size_t BLOCK_SIZE = 64;
+constexpr std::uint64_t EVEN_BITS = 0x5555555555555555ULL;
+
+/**
+ * @brief Per-byte character classes of one 64-byte block, one bit per byte.
+ */
+struct BlockMasks {
+    std::uint64_t quote;
+    std::uint64_t backslash;
+    std::uint64_t whitespace;
+    std::uint64_t op;      // { } [ ] : ,
+    std::uint64_t control; // below 0x20
+    std::uint64_t non_ascii;
+};
+
+#ifndef SDS_JSON_X86
+
+void classify_scalar(const char* block, BlockMasks& masks) {
+    masks = {};
+    for (std::size_t i = 0; i < BLOCK_SIZE; ++i) {
+        const auto c = static_cast<unsigned char>(block[i]);
+        const auto bit = std::uint64_t{1} << i;
+        switch (c) {
+            case '"':
+                masks.quote |= bit;
+                break;
+            case '\\':
+                masks.backslash |= bit;
+                break;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                masks.whitespace |= bit;
+                break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                masks.op |= bit;
+                break;
+        }
+        if (c < 0x20) {
+            masks.control |= bit;
+        }
+        if (c >= 0x80) {
+            masks.non_ascii |= bit;
+        }
+    }
+}
+
+#else
+
+void classify_sse2(const char* block, BlockMasks& masks) {
+    masks = {};
+    const auto control_max = _mm_set1_epi8(0x1F);
+    for (std::size_t i = 0; i < BLOCK_SIZE; i += 16) {
+        const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        const auto eq = [&](char c) { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); };
+        const auto bits = [](__m128i m) {
+            return static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(m)));
+        };
+
+        const auto whitespace =
+            _mm_or_si128(_mm_or_si128(eq(' '), eq('\t')), _mm_or_si128(eq('\n'), eq('\r')));
+        const auto op = _mm_or_si128(
+            _mm_or_si128(_mm_or_si128(eq('{'), eq('}')), _mm_or_si128(eq('['), eq(']'))),
+            _mm_or_si128(eq(':'), eq(',')));
+        const auto control = _mm_cmpeq_epi8(_mm_max_epu8(v, control_max), control_max);
+
+        masks.quote |= bits(eq('"')) << i;
+        masks.backslash |= bits(eq('\\')) << i;
+        masks.whitespace |= bits(whitespace) << i;
+        masks.op |= bits(op) << i;
+        masks.control |= bits(control) << i;
+        masks.non_ascii |= bits(v) << i;
+    }
+}
+
+__attribute__((target("avx2"))) void classify_avx2(const char* block, BlockMasks& masks) {
+    masks = {};
+    const auto control_max = _mm256_set1_epi8(0x1F);
+    for (std::size_t i = 0; i < BLOCK_SIZE; i += 32) {
+        const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+        const auto eq = [&](char c) __attribute__((target("avx2"))) {
+            return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c));
+        };
+        const auto bits = [](__m256i m) __attribute__((target("avx2"))) {
+            return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(m)));
+        };
+
+        const auto whitespace = _mm256_or_si256(_mm256_or_si256(eq(' '), eq('\t')),
+                                                _mm256_or_si256(eq('\n'), eq('\r')));
+        const auto op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_or_si256(eq('{'), eq('}')), _mm256_or_si256(eq('['), eq(']'))),
+            _mm256_or_si256(eq(':'), eq(',')));
+        const auto control = _mm256_cmpeq_epi8(_mm256_max_epu8(v, control_max), control_max);
+
+        masks.quote |= bits(eq('"')) << i;
+        masks.backslash |= bits(eq('\\')) << i;
+        masks.whitespace |= bits(whitespace) << i;
+        masks.op |= bits(op) << i;
+        masks.control |= bits(control) << i;
+        masks.non_ascii |= bits(v) << i;
+    }
+}
+
+#endif // SDS_JSON_X86
+
+using Classifier = void (*)(const char*, BlockMasks&);
+
+Classifier select_classifier() {
+#ifdef SDS_JSON_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return classify_avx2;
+    }
+    return classify_sse2;
+#else
+    return classify_scalar;
+#endif
+}
+
+/**
+ * @brief Running XOR of all lower bits; turns quote positions into a string mask.
+ */
+std::uint64_t prefix_xor(std::uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool parse_hex4(std::string_view text, std::size_t pos, std::uint32_t& value) {
+    if (pos + 4 > text.size()) {
+        return false;
+    }
+    value = 0;
+    for (std::size_t i = pos; i < pos + 4; ++i) {
+        const auto digit = hex_value(text[i]);
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 4) | static_cast<std::uint32_t>(digit);
+    }
+    return true;
+}
+
+/**
+ * @brief Validate UTF-8 from a resumable position, one sequence at a time.
+ */
+class Utf8Validator {
+public:
+    explicit Utf8Validator(std::string_view text) : text_(text) {
+    }
+
+    /**
+     * @brief Validate every sequence starting before end.
+     *
+     * Sequences may extend past end; the following call resumes after them.
+     */
+    bool validate_until(std::size_t begin, std::size_t end) {
+        auto pos = std::max(begin, next_);
+        const auto* bytes = reinterpret_cast<const unsigned char*>(text_.data());
+        while (pos < end) {
+            const auto c = bytes[pos];
+            if (c < 0x80) {
+                ++pos;
+                continue;
+            }
+
+            std::size_t length;
+            unsigned char min_second = 0x80;
+            unsigned char max_second = 0xBF;
+            if (c >= 0xC2 && c <= 0xDF) {
+                length = 2;
+            } else if (c >= 0xE0 && c <= 0xEF) {
+                length = 3;
+                if (c == 0xE0) {
+                    min_second = 0xA0; // Overlong.
+                } else if (c == 0xED) {
+                    max_second = 0x9F; // UTF-16 surrogates.
+                }
+            } else if (c >= 0xF0 && c <= 0xF4) {
+                length = 4;
+                if (c == 0xF0) {
+                    min_second = 0x90; // Overlong.
+                } else if (c == 0xF4) {
+                    max_second = 0x8F; // Above U+10FFFF.
+                }
+            } else {
+                return false;
+            }
+
+            if (pos + length > text_.size() || bytes[pos + 1] < min_second ||
+                bytes[pos + 1] > max_second) {
+                return false;
+            }
+            for (std::size_t i = 2; i < length; ++i) {
+                if ((bytes[pos + i] & 0xC0) != 0x80) {
+                    return false;
+                }
+            }
+            pos += length;
+        }
+        next_ = pos;
+        return true;
+    }
+
+private:
+    std::string_view text_;
+    std::size_t next_ = 0;
+};
+
+/**
+ * @brief Check the characters following backslashes, given as a bit mask of one block.
+ *
+ * @param expected_low_surrogate Offset of the \\u escape that must complete a
+ *        surrogate pair started earlier, carried between blocks.
+ */
+bool validate_escapes(std::string_view json,
+                      std::size_t block_start,
+                      std::uint64_t escaped,
+                      std::size_t& expected_low_surrogate) {
+    while (escaped != 0) {
+        const auto pos = block_start + static_cast<std::size_t>(__builtin_ctzll(escaped));
+        escaped &= escaped - 1;
+        if (pos >= json.size()) {
+            return false;
+        }
+
+        switch (json[pos]) {
+            case '"':
+            case '\\':
+            case '/':
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+                if (expected_low_surrogate != 0) {
+                    return false;
+                }
+                break;
+            case 'u': {
+                std::uint32_t code_unit;
+                if (!parse_hex4(json, pos + 1, code_unit)) {
+                    return false;
+                }
+                const bool is_low = code_unit >= 0xDC00 && code_unit <= 0xDFFF;
+                if (expected_low_surrogate != 0) {
+                    if (pos != expected_low_surrogate || !is_low) {
+                        return false;
+                    }
+                    expected_low_surrogate = 0;
+                } else if (is_low) {
+                    return false;
+                } else if (code_unit >= 0xD800 && code_unit <= 0xDBFF) {
+                    // The pair's second half must be the very next escape.
+                    expected_low_surrogate = pos + 6;
+                }
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool build_structural_index(std::string_view json, std::vector<std::uint32_t>& positions) {
+    static const Classifier classify = select_classifier();
+
+    positions.clear();
+    if (json.size() >= std::numeric_limits<std::uint32_t>::max()) {
+        return false;
+    }
+
+    Utf8Validator utf8(json);
+    std::uint64_t prev_escaped = 0;   // 1 if the next block starts with an escaped byte
+    std::uint64_t prev_in_string = 0; // all ones if the next block starts inside a string
+    std::uint64_t prev_separator = 1; // 1 if the byte before the next block ends an atom
+    std::size_t expected_low_surrogate = 0;
+
+    char tail[BLOCK_SIZE];
+    for (std::size_t block_start = 0; block_start < json.size(); block_start += BLOCK_SIZE) {
+        const char* block = json.data() + block_start;
+        const auto remaining = json.size() - block_start;
+        if (remaining < BLOCK_SIZE) {
+            // Pad the last block with whitespace, which never adds structurals.
+            std::memset(tail, ' ', BLOCK_SIZE);
+            std::memcpy(tail, block, remaining);
+            block = tail;
+        }
+
+        BlockMasks masks;
+        classify(block, masks);
+
+        // Bytes preceded by an odd number of backslashes are escaped.
+        auto backslash = masks.backslash & ~prev_escaped;
+        const auto follows_escape = (backslash << 1) | prev_escaped;
+        const auto odd_sequence_starts = backslash & ~EVEN_BITS & ~follows_escape;
+        std::uint64_t sequences_starting_on_even_bits;
+        prev_escaped = __builtin_add_overflow(odd_sequence_starts, backslash,
+                                              &sequences_starting_on_even_bits)
+                           ? 1
+                           : 0;
+        const auto invert_mask = sequences_starting_on_even_bits << 1;
+        const auto escaped = (EVEN_BITS ^ invert_mask) & follows_escape;
+
+        if (escaped != 0 || expected_low_surrogate != 0) {
+            if (!validate_escapes(json, block_start, escaped, expected_low_surrogate)) {
+                return false;
+            }
+            if (expected_low_surrogate != 0 && expected_low_surrogate < block_start + BLOCK_SIZE) {
+                return false; // The high surrogate was not followed by a \u escape.
+            }
+        }
+
+        const auto quote = masks.quote & ~escaped;
+        const auto in_string = prefix_xor(quote) ^ prev_in_string;
+        prev_in_string = static_cast<std::uint64_t>(static_cast<std::int64_t>(in_string) >> 63);
+
+        if ((masks.control & in_string) != 0) {
+            return false;
+        }
+        if (masks.non_ascii != 0 &&
+            !utf8.validate_until(block_start, block_start + std::min(remaining, BLOCK_SIZE))) {
+            return false;
+        }
+
+        // Atoms (numbers and literals) start after whitespace, operators or quotes.
+        const auto separator = masks.op | masks.whitespace | masks.quote;
+        const auto atom = ~(separator | in_string);
+        const auto atom_start = atom & ((separator << 1) | prev_separator);
+        prev_separator = separator >> 63;
+
+        auto structural = (masks.op & ~in_string) | quote | atom_start;
+        if (remaining < BLOCK_SIZE) {
+            structural &= (std::uint64_t{1} << remaining) - 1;
+        }
+        while (structural != 0) {
+            positions.push_back(static_cast<std::uint32_t>(
+                block_start + static_cast<std::size_t>(__builtin_ctzll(structural))));
+            structural &= structural - 1;
+        }
+    }
+
+    return prev_in_string == 0 && prev_escaped == 0 && expected_low_surrogate == 0;
+}
+
+} // namespace simple_data_server
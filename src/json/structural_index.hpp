@@ -0,0 +1,31 @@
+#ifndef SIMPLE_DATA_SERVER_JSON_STRUCTURAL_INDEX_HPP
+#define SIMPLE_DATA_SERVER_JSON_STRUCTURAL_INDEX_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace simple_data_server {
+
+/**
+ * @brief Find the structural characters of a JSON text (stage 1 of validation).
+ *
+ * Classifies the input 64 bytes at a time with SIMD instructions (AVX2 when
+ * the CPU supports it, otherwise SSE2, or a portable fallback) and records
+ * the offset of every brace, bracket, colon and comma outside strings, of
+ * both quotes of every string, and of the first byte of every number or
+ * literal. Along the way it checks everything about strings that does not
+ * need the grammar: escape sequences (including \\u surrogate pairs),
+ * unescaped control characters, unterminated strings and UTF-8 encoding.
+ * Blocks that are pure ASCII skip the UTF-8 check entirely.
+ *
+ * @param json The JSON text; must be smaller than 4GB.
+ * @param positions Cleared and filled with the structural offsets, in order.
+ * @return bool false if the input cannot be valid JSON.
+ */
+[[nodiscard]] bool build_structural_index(std::string_view json,
+                                          std::vector<std::uint32_t>& positions);
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_JSON_STRUCTURAL_INDEX_HPP
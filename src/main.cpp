@@ -1,23 +1,125 @@
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <optional>
+#include <stdexcept>
 #include <string>
 #include <string_view>
 #include <cstdint>
 
 #include "server/data_server.hpp"
 #include "handlers/api_handler.hpp"
+#include "replication/change_log.hpp"
+#include "replication/replica_client.hpp"
+#include "replication/replication_source.hpp"
+#include "router/router_server.hpp"
 #include "storage/file_manager.hpp"
+#include "util/capture_file.hpp"
 
 namespace {
 
 constexpr std::uint16_t DEFAULT_PORT = 8080;
 constexpr std::string_view DEFAULT_DATA_DIR = "data";
+constexpr std::size_t DEFAULT_REPLICATION_BACKLOG = 64 * 1024 * 1024; // 64MB
+constexpr std::string_view DEFAULT_REPLICATION_BIND = "127.0.0.1";
+constexpr unsigned DEFAULT_VIRTUAL_NODES = 160;
+constexpr unsigned DEFAULT_ROUTER_THREADS = 32;
+constexpr unsigned DEFAULT_SLOW_THRESHOLD_MS = 500;
+constexpr std::size_t DEFAULT_CAPTURE_SIZE = 64 * 1024 * 1024; // 64MB
+
+/**
+ * @brief Parse a "HOST:PORT" address.
+ *
+ * @param address The address text.
+ * @return std::optional<simple_data_server::BackendAddress> The address, or
+ *         std::nullopt if it is malformed.
+ */
+std::optional<simple_data_server::BackendAddress> parse_address(std::string_view address) {
+    const auto colon = address.rfind(':');
+    if (colon == std::string_view::npos || colon == 0) {
+        return std::nullopt;
+    }
+    try {
+        const auto value = std::stoul(std::string(address.substr(colon + 1)));
+        if (value == 0 || value > UINT16_MAX) {
+            return std::nullopt;
+        }
+        return simple_data_server::BackendAddress{std::string(address.substr(0, colon)),
+                                                  static_cast<std::uint16_t>(value)};
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+/**
+ * @brief Read a shared secret from the first line of a file.
+ *
+ * @param path The file.
+ * @return std::optional<std::string> The secret without trailing whitespace,
+ *         or std::nullopt if the file cannot be read or the secret is empty.
+ */
+std::optional<std::string> read_secret_file(const std::string& path) {
+    std::ifstream input(path);
+    std::string secret;
+    if (!input || !std::getline(input, secret)) {
+        return std::nullopt;
+    }
+    const auto end = secret.find_last_not_of(" \t\r\n");
+    if (end == std::string::npos) {
+        return std::nullopt;
+    }
+    secret.erase(end + 1);
+    return secret;
+}
 
 void print_usage(const char* program_name) {
     std::cout << "Usage: " << program_name << " [options]\n"
               << "Options:\n"
               << "  -p, --port PORT    Port to listen on (default: " << DEFAULT_PORT << ")\n"
               << "  -d, --dir DIR      Data directory (default: " << DEFAULT_DATA_DIR << ")\n"
+              << "  --no-dedup         Store every document separately instead of sharing\n"
+              << "                     identical content through the blob store\n"
+              << "  --quota-bytes N    Maximum bytes stored per key (default: unlimited)\n"
+              << "  --quota-files N    Maximum files stored per key (default: unlimited)\n"
+              << "  --scan-threads N   Threads for the startup index scan (default: all cores)\n"
+              << "  --dir-cache N      Key directories kept open (default: 256)\n"
+              << "  --fd-cache N       Hot documents kept open for single-read gets\n"
+              << "                     (default: 512, 0 disables)\n"
+              << "  --scrub-iops N     Documents per second the integrity scrubber may read\n"
+              << "                     (default: 100)\n"
+              << "  --scrub-bandwidth N  Bytes per second the integrity scrubber may read\n"
+              << "                     (default: 4194304)\n"
+              << "  --no-scrub         Disable the background integrity scrubber\n"
+              << "  --slow-log FILE    Append requests slower than --slow-ms to FILE as JSON\n"
+              << "                     lines with a per-stage breakdown ('-' for stderr)\n"
+              << "  --slow-ms N        Slow log threshold in milliseconds (default: "
+              << DEFAULT_SLOW_THRESHOLD_MS << ")\n"
+              << "  --server-timing    Add a Server-Timing header with stage durations\n"
+              << "  --capture FILE     Record every request's route, timing, sizes and hashed\n"
+              << "                     key and filename in a ring file for sds-replay\n"
+              << "  --capture-size N   Bytes the capture ring holds before the oldest\n"
+              << "                     requests are overwritten (default: " << DEFAULT_CAPTURE_SIZE
+              << ")\n"
+              << "  --capture-bodies   Also capture request bodies, for exact replay\n"
+              << "  --access-log FILE  Log every request to FILE as a JSON line, written in\n"
+              << "                     batches by a background thread ('-' for stderr)\n"
+              << "  --replication-port PORT  Publish the change log to replicas on PORT\n"
+              << "  --replication-bind ADDR  Local address of the replication port (default: "
+              << DEFAULT_REPLICATION_BIND << ";\n"
+              << "                     other addresses need --replication-secret-file)\n"
+              << "  --replication-secret-file FILE  Shared secret, the first line of FILE,\n"
+              << "                     that replicas must present to the primary\n"
+              << "  --replication-backlog N  Bytes of recent changes kept for replica catch-up\n"
+              << "                     (default: " << DEFAULT_REPLICATION_BACKLOG << ")\n"
+              << "  --replica-of HOST:PORT  Run as a read-only replica of the primary whose\n"
+              << "                     replication port is HOST:PORT\n"
+              << "  --router           Run as a router sharding keys across the --backend servers\n"
+              << "  --backend HOST:PORT  A backend server for --router (repeatable)\n"
+              << "  --vnodes N         Hash ring points per backend (default: "
+              << DEFAULT_VIRTUAL_NODES << ")\n"
+              << "  --router-threads N Threads forwarding requests to backends (default: "
+              << DEFAULT_ROUTER_THREADS << ")\n"
               << "  -h, --help         Show this help message\n";
 }
 
@@ -26,6 +128,20 @@ void print_usage(const char* program_name) {
 int main(int argc, char* argv[]) {
     std::uint16_t port = DEFAULT_PORT;
     std::string data_dir(DEFAULT_DATA_DIR);
+    simple_data_server::StorageOptions storage_options;
+    std::uint16_t replication_port = 0;
+    std::size_t replication_backlog = DEFAULT_REPLICATION_BACKLOG;
+    std::string replication_bind(DEFAULT_REPLICATION_BIND);
+    std::string replication_secret;
+    std::string primary_host;
+    std::uint16_t primary_port = 0;
+    bool router = false;
+    simple_data_server::RouterOptions router_options;
+    router_options.virtual_nodes = DEFAULT_VIRTUAL_NODES;
+    router_options.threads = DEFAULT_ROUTER_THREADS;
+    simple_data_server::TracingOptions tracing_options;
+    tracing_options.slow_threshold = std::chrono::milliseconds(DEFAULT_SLOW_THRESHOLD_MS);
+    tracing_options.capture_size = DEFAULT_CAPTURE_SIZE;
 
     for (int i = 1; i < argc; ++i) {
         std::string_view arg(argv[i]);
@@ -49,6 +165,221 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Option -d/--dir requires an argument\n";
                 return 1;
             }
+        } else if (arg == "--quota-bytes" || arg == "--quota-files") {
+            if (i + 1 < argc) {
+                try {
+                    const auto limit = std::stoll(argv[++i]);
+                    if (limit < 0) {
+                        throw std::out_of_range("negative quota");
+                    }
+                    if (arg == "--quota-bytes") {
+                        storage_options.quota.max_bytes = limit;
+                    } else {
+                        storage_options.quota.max_files = limit;
+                    }
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid quota: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Option " << arg << " requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--scan-threads") {
+            if (i + 1 < argc) {
+                try {
+                    storage_options.scan_threads = static_cast<unsigned>(std::stoul(argv[++i]));
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Option --scan-threads requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--dir-cache") {
+            if (i + 1 < argc) {
+                try {
+                    storage_options.directory_cache_size = std::stoul(argv[++i]);
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid directory cache size: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Option --dir-cache requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--fd-cache") {
+            if (i + 1 < argc) {
+                try {
+                    storage_options.file_cache_size = std::stoul(argv[++i]);
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid file cache size: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Option --fd-cache requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--slow-log") {
+            if (i + 1 < argc) {
+                tracing_options.slow_log_path = argv[++i];
+            } else {
+                std::cerr << "Option --slow-log requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--slow-ms") {
+            if (i + 1 < argc) {
+                try {
+                    tracing_options.slow_threshold = std::chrono::milliseconds(
+                        std::stoul(argv[++i]));
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid slow log threshold: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Option --slow-ms requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--server-timing") {
+            tracing_options.server_timing = true;
+        } else if (arg == "--capture") {
+            if (i + 1 < argc) {
+                tracing_options.capture_path = argv[++i];
+            } else {
+                std::cerr << "Option --capture requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--capture-size") {
+            if (i + 1 < argc) {
+                try {
+                    const auto size = std::stoull(argv[++i]);
+                    if (size < simple_data_server::CaptureWriter::MIN_CAPACITY) {
+                        throw std::out_of_range("capture size");
+                    }
+                    tracing_options.capture_size = static_cast<std::size_t>(size);
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid capture size (at least "
+                              << simple_data_server::CaptureWriter::MIN_CAPACITY
+                              << " bytes): " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Option --capture-size requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--capture-bodies") {
+            tracing_options.capture_bodies = true;
+        } else if (arg == "--access-log") {
+            if (i + 1 < argc) {
+                tracing_options.access_log_path = argv[++i];
+            } else {
+                std::cerr << "Option --access-log requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--scrub-iops" || arg == "--scrub-bandwidth") {
+            if (i + 1 < argc) {
+                try {
+                    const auto limit = std::stod(argv[++i]);
+                    if (limit < 0) {
+                        throw std::out_of_range("negative limit");
+                    }
+                    if (arg == "--scrub-iops") {
+                        storage_options.scrub.max_iops = limit;
+                    } else {
+                        storage_options.scrub.max_bytes_per_second = limit;
+                    }
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid scrub limit: " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Option " << arg << " requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--replication-port" || arg == "--replication-backlog") {
+            if (i + 1 < argc) {
+                try {
+                    const auto value = std::stoull(argv[++i]);
+                    if (arg == "--replication-port") {
+                        if (value == 0 || value > UINT16_MAX) {
+                            throw std::out_of_range("port");
+                        }
+                        replication_port = static_cast<std::uint16_t>(value);
+                    } else {
+                        replication_backlog = static_cast<std::size_t>(value);
+                    }
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Option " << arg << " requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--replication-bind") {
+            if (i + 1 < argc) {
+                replication_bind = argv[++i];
+            } else {
+                std::cerr << "Option " << arg << " requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--replication-secret-file") {
+            if (i + 1 < argc) {
+                auto secret = read_secret_file(argv[++i]);
+                if (!secret) {
+                    std::cerr << "Cannot read a replication secret from " << argv[i] << std::endl;
+                    return 1;
+                }
+                replication_secret = std::move(secret.value());
+            } else {
+                std::cerr << "Option " << arg << " requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--replica-of" || arg == "--backend") {
+            if (i + 1 < argc) {
+                const std::string_view text(argv[++i]);
+                auto address = parse_address(text);
+                if (!address) {
+                    std::cerr << "Invalid address for " << arg << ": " << text << std::endl;
+                    return 1;
+                }
+                if (arg == "--backend") {
+                    router_options.backends.push_back(std::move(address.value()));
+                } else {
+                    primary_host = std::move(address->host);
+                    primary_port = address->port;
+                }
+            } else {
+                std::cerr << "Option " << arg << " requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--vnodes" || arg == "--router-threads") {
+            if (i + 1 < argc) {
+                try {
+                    const auto value = std::stoul(argv[++i]);
+                    if (value == 0 || value > 65536) {
+                        throw std::out_of_range("count");
+                    }
+                    if (arg == "--vnodes") {
+                        router_options.virtual_nodes = static_cast<unsigned>(value);
+                    } else {
+                        router_options.threads = static_cast<unsigned>(value);
+                    }
+                } catch (const std::exception&) {
+                    std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else {
+                std::cerr << "Option " << arg << " requires an argument\n";
+                return 1;
+            }
+        } else if (arg == "--router") {
+            router = true;
+        } else if (arg == "--no-scrub") {
+            storage_options.scrub.enabled = false;
+        } else if (arg == "--no-dedup") {
+            storage_options.deduplicate = false;
         } else if (arg == "-h" || arg == "--help") {
             print_usage(argv[0]);
             return 0;
@@ -59,13 +390,65 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (replication_port != 0 && primary_port != 0) {
+        std::cerr << "--replication-port and --replica-of cannot be combined\n";
+        return 1;
+    }
+
+    if (router) {
+        if (router_options.backends.empty()) {
+            std::cerr << "--router requires at least one --backend\n";
+            return 1;
+        }
+        if (replication_port != 0 || primary_port != 0) {
+            std::cerr << "--router cannot be combined with replication options\n";
+            return 1;
+        }
+
+        std::cout << "SimpleDataServer router starting...\n"
+                  << "  Port: " << port << "\n"
+                  << "  Backends: " << router_options.backends.size() << "\n";
+
+        simple_data_server::RouterServer router_server(port, router_options);
+        if (!router_server.start()) {
+            std::cerr << "Failed to start router\n";
+            return 1;
+        }
+        return 0;
+    }
+
     std::cout << "SimpleDataServer starting...\n"
               << "  Port: " << port << "\n"
               << "  Data directory: " << data_dir << "\n";
 
-    auto file_manager = std::make_shared<simple_data_server::FileManager>(data_dir);
+    std::shared_ptr<simple_data_server::ChangeLog> change_log;
+    if (replication_port != 0) {
+        change_log = std::make_shared<simple_data_server::ChangeLog>(replication_backlog);
+        storage_options.change_listener = [change_log](
+                                              const simple_data_server::DocumentChange& change) {
+            change_log->append(change);
+        };
+    }
+
+    auto file_manager = std::make_shared<simple_data_server::FileManager>(data_dir,
+                                                                          storage_options);
     auto api_handler = std::make_shared<simple_data_server::ApiHandler>(file_manager);
-    simple_data_server::DataServer server(port, api_handler);
+
+    if (change_log) {
+        auto source = std::make_shared<simple_data_server::ReplicationSource>(
+            *file_manager, change_log, replication_bind, replication_port, replication_secret);
+        if (!source->start()) {
+            return 1;
+        }
+        api_handler->set_replication(source);
+    } else if (primary_port != 0) {
+        auto replica = std::make_shared<simple_data_server::ReplicaClient>(
+            *file_manager, primary_host, primary_port, replication_secret);
+        replica->start();
+        api_handler->set_replication(replica);
+    }
+
+    simple_data_server::DataServer server(port, api_handler, std::move(tracing_options));
 
     if (!server.start()) {
         std::cerr << "Failed to start server\n";
@@ -0,0 +1,392 @@
+#include "query/aggregation.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <span>
+#include <unordered_map>
+
+#include "json/json_validator.hpp"
+#include "query/column_reduce.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::size_t MAX_AGGREGATES = 32;
+constexpr std::size_t PLAIN_COUNT = std::numeric_limits<std::size_t>::max();
+constexpr double MISSING = std::numeric_limits<double>::quiet_NaN();
+constexpr std::string_view NULL_GROUP = "null";
+
+std::optional<AggregateOp> parse_op(std::string_view name) {
+    if (name == "count") {
+        return AggregateOp::Count;
+    }
+    if (name == "sum") {
+        return AggregateOp::Sum;
+    }
+    if (name == "min") {
+        return AggregateOp::Min;
+    }
+    if (name == "max") {
+        return AggregateOp::Max;
+    }
+    if (name == "avg") {
+        return AggregateOp::Avg;
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Spell a number the same way whatever its JSON form, so 2, 2.0 and
+ *        2e0 fall into one group.
+ */
+std::string canonical_number(double value) {
+    constexpr double EXACT_INTEGER_LIMIT = 9007199254740992.0; // 2^53
+    if (std::trunc(value) == value && std::abs(value) < EXACT_INTEGER_LIMIT) {
+        return std::to_string(static_cast<std::int64_t>(value));
+    }
+    return nlohmann::json(value).dump();
+}
+
+std::string group_key(const nlohmann::json* value) {
+    if (value == nullptr) {
+        return std::string(NULL_GROUP);
+    }
+    if (value->is_number()) {
+        return canonical_number(value->get<double>());
+    }
+    return value->dump();
+}
+
+double parse_number(std::string_view text) {
+    double value = MISSING;
+    std::from_chars(text.data(), text.data() + text.size(), value);
+    return value;
+}
+
+enum class RawLookup {
+    Found,
+    Missing,
+    NeedsDom
+};
+
+/**
+ * @brief Follow a path through nested objects without building a DOM.
+ *
+ * Array steps are left to the DOM.
+ */
+RawLookup find_raw(const JsonObjectIndex& root, const JsonPath& path, JsonMember& found) {
+    const auto& tokens = path.tokens();
+    if (tokens.empty()) {
+        return RawLookup::NeedsDom;
+    }
+
+    const auto* current = &root;
+    std::optional<JsonObjectIndex> nested;
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        if (current->root_type == JsonType::Array) {
+            return RawLookup::NeedsDom;
+        }
+        const auto* member = current->find(tokens[i]);
+        if (member == nullptr) {
+            return RawLookup::Missing;
+        }
+        if (i + 1 == tokens.size()) {
+            found = *member;
+            return RawLookup::Found;
+        }
+        if (member->type == JsonType::Array) {
+            return RawLookup::NeedsDom;
+        }
+        if (member->type != JsonType::Object) {
+            return RawLookup::Missing;
+        }
+        nested = index_json_object(member->value);
+        if (!nested) {
+            return RawLookup::NeedsDom;
+        }
+        current = &nested.value();
+    }
+    return RawLookup::Missing;
+}
+
+} // namespace
+
+std::expected<AggregationSpec, std::string> AggregationSpec::parse(const nlohmann::json& request) {
+    AggregationSpec spec;
+
+    auto filter = Filter::parse(request.value("filter", nlohmann::json()));
+    if (!filter) {
+        return std::unexpected(std::move(filter.error()));
+    }
+    spec.filter = std::move(filter.value());
+
+    if (request.contains("group_by")) {
+        const auto& group_by = request["group_by"];
+        auto path = group_by.is_string() ? JsonPath::parse(group_by.get<std::string>())
+                                         : std::nullopt;
+        if (!path) {
+            return std::unexpected("'group_by' must be a JSON Pointer");
+        }
+        spec.group_by = std::move(path);
+    }
+
+    if (!request.contains("aggregates") || !request["aggregates"].is_array() ||
+        request["aggregates"].empty()) {
+        return std::unexpected("Missing or invalid 'aggregates' field");
+    }
+    if (request["aggregates"].size() > MAX_AGGREGATES) {
+        return std::unexpected("Too many aggregates (max " + std::to_string(MAX_AGGREGATES) + ")");
+    }
+
+    for (const auto& item : request["aggregates"]) {
+        if (!item.is_object() || !item.contains("op") || !item["op"].is_string()) {
+            return std::unexpected("Each aggregate needs an 'op'");
+        }
+        const auto op_name = item["op"].get<std::string>();
+        const auto op = parse_op(op_name);
+        if (!op) {
+            return std::unexpected("Unknown aggregate op '" + op_name + "'");
+        }
+
+        AggregateSpec aggregate{op.value(), std::nullopt, {}};
+        if (item.contains("path")) {
+            aggregate.path = item["path"].is_string()
+                                 ? JsonPath::parse(item["path"].get<std::string>())
+                                 : std::nullopt;
+            if (!aggregate.path) {
+                return std::unexpected("Invalid JSON Pointer in aggregate '" + op_name + "'");
+            }
+        } else if (op != AggregateOp::Count) {
+            return std::unexpected("Aggregate '" + op_name + "' needs a 'path'");
+        }
+
+        if (item.contains("as")) {
+            if (!item["as"].is_string()) {
+                return std::unexpected("Aggregate names ('as') must be strings");
+            }
+            aggregate.name = item["as"].get<std::string>();
+        } else {
+            aggregate.name = aggregate.path ? op_name + "(" + aggregate.path->text() + ")"
+                                            : op_name;
+        }
+
+        const bool duplicate =
+            std::any_of(spec.aggregates.begin(), spec.aggregates.end(),
+                        [&](const auto& existing) { return existing.name == aggregate.name; });
+        if (duplicate) {
+            return std::unexpected("Duplicate aggregate name '" + aggregate.name + "'");
+        }
+        spec.aggregates.push_back(std::move(aggregate));
+    }
+    return spec;
+}
+
+AggregationTable::AggregationTable(const AggregationSpec& spec, std::size_t rows)
+    : spec_(spec), matched_(rows, 0) {
+    for (const auto& aggregate : spec_.aggregates) {
+        if (!aggregate.path) {
+            aggregate_columns_.push_back(PLAIN_COUNT);
+            continue;
+        }
+        const auto existing =
+            std::find_if(column_paths_.begin(), column_paths_.end(), [&](const auto& path) {
+                return path.tokens() == aggregate.path->tokens();
+            });
+        aggregate_columns_.push_back(static_cast<std::size_t>(existing - column_paths_.begin()));
+        if (existing == column_paths_.end()) {
+            column_paths_.push_back(aggregate.path.value());
+        }
+    }
+
+    columns_.assign(column_paths_.size(), std::vector<double>(rows, MISSING));
+    if (spec_.group_by) {
+        group_keys_.resize(rows);
+    }
+}
+
+void AggregationTable::add_row(std::size_t row, std::string_view document) noexcept {
+    try {
+        if (!spec_.filter.may_match(document)) {
+            return;
+        }
+        if (spec_.filter.empty() && document.find('\\') == std::string_view::npos &&
+            add_row_without_dom(row, document) == Extraction::Done) {
+            return;
+        }
+
+        const auto parsed = nlohmann::json::parse(document, nullptr, false);
+        if (parsed.is_discarded() || !spec_.filter.matches(parsed)) {
+            return;
+        }
+        add_row_from_dom(row, parsed);
+    } catch (const std::exception&) {
+        matched_[row] = 0;
+    }
+}
+
+AggregationTable::Extraction AggregationTable::add_row_without_dom(std::size_t row,
+                                                                   std::string_view document) {
+    const auto index = index_json_object(document);
+    if (!index) {
+        return Extraction::Done;
+    }
+
+    JsonMember member{};
+    for (std::size_t c = 0; c < column_paths_.size(); ++c) {
+        const auto lookup = find_raw(index.value(), column_paths_[c], member);
+        if (lookup == RawLookup::NeedsDom) {
+            return Extraction::NeedsDom;
+        }
+        columns_[c][row] = lookup == RawLookup::Found && member.type == JsonType::Number
+                               ? parse_number(member.value)
+                               : MISSING;
+    }
+
+    if (spec_.group_by) {
+        const auto lookup = find_raw(index.value(), spec_.group_by.value(), member);
+        if (lookup == RawLookup::NeedsDom ||
+            (lookup == RawLookup::Found &&
+             (member.type == JsonType::Object || member.type == JsonType::Array))) {
+            return Extraction::NeedsDom;
+        }
+        if (lookup == RawLookup::Missing) {
+            group_keys_[row] = NULL_GROUP;
+        } else if (member.type == JsonType::Number) {
+            group_keys_[row] = canonical_number(parse_number(member.value));
+        } else {
+            // Without escapes, strings and literals are already in canonical form.
+            group_keys_[row] = member.value;
+        }
+    }
+
+    matched_[row] = 1;
+    return Extraction::Done;
+}
+
+void AggregationTable::add_row_from_dom(std::size_t row, const nlohmann::json& document) {
+    for (std::size_t c = 0; c < column_paths_.size(); ++c) {
+        const auto* value = column_paths_[c].resolve(document);
+        columns_[c][row] = value != nullptr && value->is_number() ? value->get<double>() : MISSING;
+    }
+    if (spec_.group_by) {
+        group_keys_[row] = group_key(spec_.group_by->resolve(document));
+    }
+    matched_[row] = 1;
+}
+
+nlohmann::json AggregationTable::finish(std::size_t max_groups) const {
+    const auto rows = matched_.size();
+
+    // Number the groups and count their rows.
+    std::unordered_map<std::string_view, std::uint32_t> group_ids;
+    std::vector<std::string_view> group_names;
+    std::vector<std::size_t> group_sizes;
+    std::vector<std::uint32_t> row_groups(rows, 0);
+    for (std::size_t row = 0; row < rows; ++row) {
+        if (!matched_[row]) {
+            continue;
+        }
+        const std::string_view name = spec_.group_by ? std::string_view(group_keys_[row]) : "";
+        const auto [it, inserted] =
+            group_ids.try_emplace(name, static_cast<std::uint32_t>(group_names.size()));
+        if (inserted) {
+            group_names.push_back(name);
+            group_sizes.push_back(0);
+        }
+        row_groups[row] = it->second;
+        ++group_sizes[it->second];
+    }
+
+    // Counting sort: lay each column out group by group.
+    std::vector<std::size_t> offsets(group_sizes.size() + 1, 0);
+    std::partial_sum(group_sizes.begin(), group_sizes.end(), offsets.begin() + 1);
+    const auto matched = offsets.back();
+
+    std::vector<std::vector<double>> sorted(columns_.size(), std::vector<double>(matched));
+    auto positions = offsets;
+    for (std::size_t row = 0; row < rows; ++row) {
+        if (!matched_[row]) {
+            continue;
+        }
+        const auto position = positions[row_groups[row]]++;
+        for (std::size_t c = 0; c < columns_.size(); ++c) {
+            sorted[c][position] = columns_[c][row];
+        }
+    }
+
+    nlohmann::json result;
+    result["matched"] = matched;
+    if (!spec_.group_by) {
+        result["results"] = reduce(sorted, 0, matched);
+        return result;
+    }
+
+    std::vector<std::uint32_t> order(group_sizes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        if (group_sizes[a] != group_sizes[b]) {
+            return group_sizes[a] > group_sizes[b];
+        }
+        return group_names[a] < group_names[b];
+    });
+    order.resize(std::min(order.size(), max_groups));
+
+    result["total_groups"] = group_sizes.size();
+    auto& groups = result["groups"] = nlohmann::json::array();
+    for (const auto id : order) {
+        nlohmann::json group;
+        group["value"] = nlohmann::json::parse(group_names[id], nullptr, false);
+        group["count"] = group_sizes[id];
+        group["results"] = reduce(sorted, offsets[id], offsets[id + 1]);
+        groups.push_back(std::move(group));
+    }
+    return result;
+}
+
+nlohmann::json AggregationTable::reduce(const std::vector<std::vector<double>>& columns,
+                                        std::size_t begin, std::size_t end) const {
+    std::vector<ColumnSummary> summaries;
+    summaries.reserve(columns.size());
+    for (const auto& column : columns) {
+        summaries.push_back(
+            summarize_column(std::span<const double>(column.data() + begin, end - begin)));
+    }
+
+    nlohmann::json results = nlohmann::json::object();
+    for (std::size_t a = 0; a < spec_.aggregates.size(); ++a) {
+        const auto& aggregate = spec_.aggregates[a];
+        auto& value = results[aggregate.name];
+        if (aggregate_columns_[a] == PLAIN_COUNT) {
+            value = end - begin;
+            continue;
+        }
+
+        const auto& summary = summaries[aggregate_columns_[a]];
+        switch (aggregate.op) {
+            case AggregateOp::Count:
+                value = summary.count;
+                break;
+            case AggregateOp::Sum:
+                value = summary.sum;
+                break;
+            case AggregateOp::Min:
+                value = summary.count > 0 ? nlohmann::json(summary.min) : nlohmann::json();
+                break;
+            case AggregateOp::Max:
+                value = summary.count > 0 ? nlohmann::json(summary.max) : nlohmann::json();
+                break;
+            case AggregateOp::Avg:
+                value = summary.count > 0
+                            ? nlohmann::json(summary.sum / static_cast<double>(summary.count))
+                            : nlohmann::json();
+                break;
+        }
+    }
+    return results;
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,140 @@
+#ifndef SIMPLE_DATA_SERVER_QUERY_AGGREGATION_HPP
+#define SIMPLE_DATA_SERVER_QUERY_AGGREGATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <expected.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "query/filter.hpp"
+#include "query/json_path.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief A reduction computed by /api/aggregate.
+ */
+enum class AggregateOp {
+    Count,
+    Sum,
+    Min,
+    Max,
+    Avg
+};
+
+/**
+ * @brief One requested aggregate, e.g. the sum of /amount.
+ */
+struct AggregateSpec {
+    AggregateOp op;
+
+    /**
+     * @brief The numbers to reduce; only absent for a plain document count.
+     */
+    std::optional<JsonPath> path;
+
+    /**
+     * @brief The name of the result, e.g. "sum(/amount)".
+     */
+    std::string name;
+};
+
+/**
+ * @brief A parsed aggregation request.
+ *
+ * Request form:
+ * @code
+ * {"filter": {...},
+ *  "group_by": "/status",
+ *  "aggregates": [{"op": "count"}, {"op": "sum", "path": "/amount", "as": "total"}]}
+ * @endcode
+ * where filter and group_by are optional. Values that are missing or not
+ * numbers are skipped by every op; count with a path counts the numbers.
+ */
+struct AggregationSpec {
+    Filter filter;
+    std::optional<JsonPath> group_by;
+    std::vector<AggregateSpec> aggregates;
+
+    /**
+     * @brief Parse the aggregation members of a request.
+     *
+     * @param request The request object.
+     * @return std::expected<AggregationSpec, std::string> The spec, or an error message.
+     */
+    [[nodiscard]] static std::expected<AggregationSpec, std::string>
+    parse(const nlohmann::json& request);
+};
+
+/**
+ * @brief Columnar scratch space for one aggregation.
+ *
+ * Rows are documents. The scan stores each document's numbers in one dense
+ * column of doubles per distinct path (NaN where missing) and its group in a
+ * separate column; finish() then orders the rows by group so that every
+ * group's values are contiguous and reduces each slice with
+ * summarize_column(). Documents that need no filtering and contain no escape
+ * sequences are read with index_json_object() instead of being parsed into
+ * a DOM.
+ */
+class AggregationTable {
+public:
+    /**
+     * @brief Allocate the columns.
+     *
+     * @param spec The aggregation; must outlive the table.
+     * @param rows The number of documents to scan.
+     */
+    AggregationTable(const AggregationSpec& spec, std::size_t rows);
+
+    /**
+     * @brief Fill one row from a document.
+     *
+     * Different rows may be filled concurrently.
+     *
+     * @param row The row index.
+     * @param document The stored document.
+     */
+    void add_row(std::size_t row, std::string_view document) noexcept;
+
+    /**
+     * @brief Reduce the columns.
+     *
+     * @param max_groups Report at most this many groups, the largest first.
+     * @return nlohmann::json {"matched": N, "results": {...}} without group_by;
+     *         {"matched": N, "total_groups": G, "groups": [{"value": v,
+     *         "count": n, "results": {...}}, ...]} with it.
+     */
+    [[nodiscard]] nlohmann::json finish(std::size_t max_groups) const;
+
+private:
+    enum class Extraction : std::uint8_t {
+        Done,
+        NeedsDom
+    };
+
+    [[nodiscard]] Extraction add_row_without_dom(std::size_t row, std::string_view document);
+    void add_row_from_dom(std::size_t row, const nlohmann::json& document);
+    [[nodiscard]] nlohmann::json reduce(const std::vector<std::vector<double>>& columns,
+                                        std::size_t begin, std::size_t end) const;
+
+    const AggregationSpec& spec_;
+    std::vector<JsonPath> column_paths_;
+
+    /**
+     * @brief Column of each aggregate, or SIZE_MAX for a plain count.
+     */
+    std::vector<std::size_t> aggregate_columns_;
+
+    std::vector<std::vector<double>> columns_;
+    std::vector<std::uint8_t> matched_;
+    std::vector<std::string> group_keys_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_QUERY_AGGREGATION_HPP
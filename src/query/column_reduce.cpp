@@ -0,0 +1,156 @@
+#include "query/column_reduce.hpp"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define SDS_REDUCE_X86 1
+#endif
+
+namespace simple_data_server {
+
+namespace {
+
+/**
+ * @brief Fold values into a summary one at a time; also used for vector tails.
+ */
+void summarize_scalar(const double* values, std::size_t count, ColumnSummary& summary) {
+    for (std::size_t i = 0; i < count; ++i) {
+        const auto value = values[i];
+        if (value != value) {
+            continue;
+        }
+        ++summary.count;
+        summary.sum += value;
+        summary.min = std::min(summary.min, value);
+        summary.max = std::max(summary.max, value);
+    }
+}
+
+#ifdef SDS_REDUCE_X86
+
+ColumnSummary summarize_sse2(const double* values, std::size_t count) {
+    const auto infinity = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    const auto negative_infinity = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+    const auto one = _mm_set1_pd(1.0);
+
+    // Two independent accumulators per statistic hide the add latency.
+    __m128d sum[2] = {_mm_setzero_pd(), _mm_setzero_pd()};
+    __m128d counts[2] = {_mm_setzero_pd(), _mm_setzero_pd()};
+    __m128d min[2] = {infinity, infinity};
+    __m128d max[2] = {negative_infinity, negative_infinity};
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        for (int lane = 0; lane < 2; ++lane) {
+            const auto v = _mm_loadu_pd(values + i + 2 * lane);
+            const auto present = _mm_cmpord_pd(v, v);
+            sum[lane] = _mm_add_pd(sum[lane], _mm_and_pd(present, v));
+            counts[lane] = _mm_add_pd(counts[lane], _mm_and_pd(present, one));
+            min[lane] = _mm_min_pd(
+                min[lane], _mm_or_pd(_mm_and_pd(present, v), _mm_andnot_pd(present, infinity)));
+            max[lane] = _mm_max_pd(max[lane], _mm_or_pd(_mm_and_pd(present, v),
+                                                        _mm_andnot_pd(present, negative_infinity)));
+        }
+    }
+
+    double lanes[2][4][2];
+    for (int lane = 0; lane < 2; ++lane) {
+        _mm_storeu_pd(lanes[lane][0], sum[lane]);
+        _mm_storeu_pd(lanes[lane][1], counts[lane]);
+        _mm_storeu_pd(lanes[lane][2], min[lane]);
+        _mm_storeu_pd(lanes[lane][3], max[lane]);
+    }
+
+    ColumnSummary summary;
+    double present_count = 0;
+    for (int lane = 0; lane < 2; ++lane) {
+        for (int j = 0; j < 2; ++j) {
+            summary.sum += lanes[lane][0][j];
+            present_count += lanes[lane][1][j];
+            summary.min = std::min(summary.min, lanes[lane][2][j]);
+            summary.max = std::max(summary.max, lanes[lane][3][j]);
+        }
+    }
+    summary.count = static_cast<std::size_t>(present_count);
+    summarize_scalar(values + i, count - i, summary);
+    return summary;
+}
+
+__attribute__((target("avx2"))) ColumnSummary summarize_avx2(const double* values,
+                                                             std::size_t count) {
+    const auto infinity = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    const auto negative_infinity = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+    const auto one = _mm256_set1_pd(1.0);
+
+    __m256d sum[2] = {_mm256_setzero_pd(), _mm256_setzero_pd()};
+    __m256d counts[2] = {_mm256_setzero_pd(), _mm256_setzero_pd()};
+    __m256d min[2] = {infinity, infinity};
+    __m256d max[2] = {negative_infinity, negative_infinity};
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        for (int lane = 0; lane < 2; ++lane) {
+            const auto v = _mm256_loadu_pd(values + i + 4 * lane);
+            const auto present = _mm256_cmp_pd(v, v, _CMP_ORD_Q);
+            sum[lane] = _mm256_add_pd(sum[lane], _mm256_and_pd(present, v));
+            counts[lane] = _mm256_add_pd(counts[lane], _mm256_and_pd(present, one));
+            min[lane] = _mm256_min_pd(min[lane], _mm256_blendv_pd(infinity, v, present));
+            max[lane] = _mm256_max_pd(max[lane], _mm256_blendv_pd(negative_infinity, v, present));
+        }
+    }
+
+    double lanes[2][4][4];
+    for (int lane = 0; lane < 2; ++lane) {
+        _mm256_storeu_pd(lanes[lane][0], sum[lane]);
+        _mm256_storeu_pd(lanes[lane][1], counts[lane]);
+        _mm256_storeu_pd(lanes[lane][2], min[lane]);
+        _mm256_storeu_pd(lanes[lane][3], max[lane]);
+    }
+
+    ColumnSummary summary;
+    double present_count = 0;
+    for (int lane = 0; lane < 2; ++lane) {
+        for (int j = 0; j < 4; ++j) {
+            summary.sum += lanes[lane][0][j];
+            present_count += lanes[lane][1][j];
+            summary.min = std::min(summary.min, lanes[lane][2][j]);
+            summary.max = std::max(summary.max, lanes[lane][3][j]);
+        }
+    }
+    summary.count = static_cast<std::size_t>(present_count);
+    summarize_scalar(values + i, count - i, summary);
+    return summary;
+}
+
+#else
+
+ColumnSummary summarize_portable(const double* values, std::size_t count) {
+    ColumnSummary summary;
+    summarize_scalar(values, count, summary);
+    return summary;
+}
+
+#endif // SDS_REDUCE_X86
+
+using Summarizer = ColumnSummary (*)(const double*, std::size_t);
+
+Summarizer select_summarizer() {
+#ifdef SDS_REDUCE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return summarize_avx2;
+    }
+    return summarize_sse2;
+#else
+    return summarize_portable;
+#endif
+}
+
+} // namespace
+
+ColumnSummary summarize_column(std::span<const double> values) noexcept {
+    static const auto summarizer = select_summarizer();
+    return summarizer(values.data(), values.size());
+}
+
+} // namespace simple_data_server
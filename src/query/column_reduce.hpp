@@ -0,0 +1,34 @@
+#ifndef SIMPLE_DATA_SERVER_QUERY_COLUMN_REDUCE_HPP
+#define SIMPLE_DATA_SERVER_QUERY_COLUMN_REDUCE_HPP
+
+#include <cstddef>
+#include <limits>
+#include <span>
+
+namespace simple_data_server {
+
+/**
+ * @brief Count, sum, minimum and maximum of a column of numbers.
+ */
+struct ColumnSummary {
+    std::size_t count = 0;
+    double sum = 0;
+    double min = std::numeric_limits<double>::infinity();
+    double max = -std::numeric_limits<double>::infinity();
+};
+
+/**
+ * @brief Summarize a column in one pass, skipping NaN entries.
+ *
+ * Missing values are stored as NaN, which JSON numbers can never be. Uses
+ * AVX2 or SSE2 where available; the sum is accumulated in several lanes, so
+ * its rounding can differ from a sequential sum in the last bits.
+ *
+ * @param values The column.
+ * @return ColumnSummary The summary; count is zero if every entry is NaN.
+ */
+[[nodiscard]] ColumnSummary summarize_column(std::span<const double> values) noexcept;
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_QUERY_COLUMN_REDUCE_HPP
@@ -0,0 +1,285 @@
+#include "query/filter.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <utility>
+
+namespace simple_data_server {
+
+namespace {
+
+std::optional<FilterOp> parse_operator(std::string_view name) {
+    if (name == "$eq") {
+        return FilterOp::Equal;
+    }
+    if (name == "$gt") {
+        return FilterOp::Greater;
+    }
+    if (name == "$gte") {
+        return FilterOp::GreaterOrEqual;
+    }
+    if (name == "$lt") {
+        return FilterOp::Less;
+    }
+    if (name == "$lte") {
+        return FilterOp::LessOrEqual;
+    }
+    if (name == "$in") {
+        return FilterOp::In;
+    }
+    if (name == "$exists") {
+        return FilterOp::Exists;
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Count the members of an object whose names start with '$'.
+ */
+std::size_t count_operators(const nlohmann::json& value) {
+    std::size_t count = 0;
+    for (const auto& [name, member] : value.items()) {
+        if (name.starts_with('$')) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+bool compare_range(FilterOp op, const nlohmann::json& value, const nlohmann::json& operand) {
+    const bool comparable = (value.is_number() && operand.is_number()) ||
+                            (value.is_string() && operand.is_string());
+    if (!comparable) {
+        return false;
+    }
+    switch (op) {
+        case FilterOp::Greater:
+            return value > operand;
+        case FilterOp::GreaterOrEqual:
+            return value >= operand;
+        case FilterOp::Less:
+            return value < operand;
+        case FilterOp::LessOrEqual:
+            return value <= operand;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Get the bytes a stored document must contain to hold this value.
+ *
+ * Only strings and literals are spelled one way in unescaped JSON; numbers
+ * such as 1, 1.0 and 1e0 are equal, so they have no needle.
+ */
+std::optional<std::string> value_needle(const nlohmann::json& value) {
+    if (value.is_string() || value.is_boolean() || value.is_null()) {
+        return value.dump();
+    }
+    return std::nullopt;
+}
+
+/**
+ * @brief Get the needles of a condition, or an empty list if it has none.
+ */
+std::vector<std::string> condition_needles(const FilterCondition& condition) {
+    std::vector<std::string> needles;
+    switch (condition.op) {
+        case FilterOp::Equal:
+            if (auto needle = value_needle(condition.operand)) {
+                needles.push_back(std::move(needle.value()));
+            }
+            break;
+        case FilterOp::In:
+            for (const auto& candidate : condition.operand) {
+                auto needle = value_needle(candidate);
+                if (!needle) {
+                    return {};
+                }
+                needles.push_back(std::move(needle.value()));
+            }
+            break;
+        case FilterOp::Exists: {
+            // The member name appears quoted, unless the last step is an array index.
+            const auto& tokens = condition.path.tokens();
+            if (condition.operand.get<bool>() && !tokens.empty() && !tokens.back().empty() &&
+                !std::all_of(tokens.back().begin(), tokens.back().end(),
+                             [](char c) { return c >= '0' && c <= '9'; })) {
+                needles.push_back(nlohmann::json(tokens.back()).dump());
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    return needles;
+}
+
+std::expected<void, std::string> validate_operand(FilterOp op, std::string_view name,
+                                                  const nlohmann::json& operand) {
+    switch (op) {
+        case FilterOp::Greater:
+        case FilterOp::GreaterOrEqual:
+        case FilterOp::Less:
+        case FilterOp::LessOrEqual:
+            if (!operand.is_number() && !operand.is_string()) {
+                return std::unexpected("Operand of '" + std::string(name) +
+                                       "' must be a number or a string");
+            }
+            break;
+        case FilterOp::In:
+            if (!operand.is_array()) {
+                return std::unexpected("Operand of '$in' must be an array");
+            }
+            break;
+        case FilterOp::Exists:
+            if (!operand.is_boolean()) {
+                return std::unexpected("Operand of '$exists' must be a boolean");
+            }
+            break;
+        case FilterOp::Equal:
+            break;
+    }
+    return {};
+}
+
+} // namespace
+
+std::expected<Filter, std::string> Filter::parse(const nlohmann::json& filter) {
+    Filter result;
+    if (filter.is_null()) {
+        return result;
+    }
+    if (!filter.is_object()) {
+        return std::unexpected("'filter' must be an object");
+    }
+
+    for (const auto& [pointer, condition] : filter.items()) {
+        auto path = JsonPath::parse(pointer);
+        if (!path) {
+            return std::unexpected("Invalid JSON Pointer in filter: '" + pointer + "'");
+        }
+
+        const auto operators = condition.is_object() ? count_operators(condition) : 0;
+        if (operators == 0) {
+            result.conditions_.push_back({std::move(path.value()), FilterOp::Equal, condition});
+            continue;
+        }
+        if (operators != condition.size()) {
+            return std::unexpected("Filter on '" + pointer + "' mixes operators and fields");
+        }
+
+        for (const auto& [name, operand] : condition.items()) {
+            const auto op = parse_operator(name);
+            if (!op) {
+                return std::unexpected("Unknown filter operator '" + name + "'");
+            }
+            if (auto valid = validate_operand(op.value(), name, operand); !valid) {
+                return std::unexpected(std::move(valid.error()));
+            }
+            result.conditions_.push_back({path.value(), op.value(), operand});
+        }
+    }
+
+    for (const auto& condition : result.conditions_) {
+        auto needles = condition_needles(condition);
+        if (!needles.empty()) {
+            result.needle_groups_.push_back(std::move(needles));
+        }
+    }
+    return result;
+}
+
+bool Filter::matches(const nlohmann::json& document) const {
+    for (const auto& condition : conditions_) {
+        const auto* value = condition.path.resolve(document);
+
+        bool satisfied = false;
+        switch (condition.op) {
+            case FilterOp::Exists:
+                satisfied = (value != nullptr) == condition.operand.get<bool>();
+                break;
+            case FilterOp::Equal:
+                satisfied = value != nullptr && *value == condition.operand;
+                break;
+            case FilterOp::In:
+                satisfied = value != nullptr &&
+                            std::find(condition.operand.begin(), condition.operand.end(),
+                                      *value) != condition.operand.end();
+                break;
+            default:
+                satisfied = value != nullptr && compare_range(condition.op, *value,
+                                                              condition.operand);
+                break;
+        }
+        if (!satisfied) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Filter::may_match(std::string_view bytes) const noexcept {
+    if (needle_groups_.empty() || bytes.find('\\') != std::string_view::npos) {
+        return true;
+    }
+    for (const auto& group : needle_groups_) {
+        const bool found = std::any_of(group.begin(), group.end(), [bytes](const auto& needle) {
+            return bytes.find(needle) != std::string_view::npos;
+        });
+        if (!found) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::expected<Projection, std::string> Projection::parse(const nlohmann::json& fields) {
+    if (!fields.is_array()) {
+        return std::unexpected("'fields' must be an array of JSON Pointers");
+    }
+
+    Projection result;
+    for (const auto& field : fields) {
+        if (!field.is_string()) {
+            return std::unexpected("'fields' must be an array of JSON Pointers");
+        }
+        auto path = JsonPath::parse(field.get<std::string>());
+        if (!path) {
+            return std::unexpected("Invalid JSON Pointer in fields: '" +
+                                   field.get<std::string>() + "'");
+        }
+        result.fields_.push_back(std::move(path.value()));
+    }
+    return result;
+}
+
+nlohmann::json Projection::apply(const nlohmann::json& document) const {
+    auto projected = nlohmann::json::object();
+    for (const auto& field : fields_) {
+        const auto* value = field.resolve(document);
+        if (value == nullptr) {
+            continue;
+        }
+        const auto& tokens = field.tokens();
+        if (tokens.empty()) {
+            return *value;
+        }
+
+        auto* node = &projected;
+        for (std::size_t i = 0; i + 1 < tokens.size() && node != nullptr; ++i) {
+            auto& child = (*node)[tokens[i]];
+            if (child.is_null()) {
+                child = nlohmann::json::object();
+            }
+            node = child.is_object() ? &child : nullptr;
+        }
+        // A shorter field listed earlier already copied a non-object value here.
+        if (node != nullptr) {
+            (*node)[tokens.back()] = *value;
+        }
+    }
+    return projected;
+}
+
+} // namespace simple_data_server
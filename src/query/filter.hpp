@@ -0,0 +1,138 @@
+#ifndef SIMPLE_DATA_SERVER_QUERY_FILTER_HPP
+#define SIMPLE_DATA_SERVER_QUERY_FILTER_HPP
+
+#include <expected.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "query/json_path.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Comparison applied by one filter condition.
+ */
+enum class FilterOp {
+    Equal,
+    Greater,
+    GreaterOrEqual,
+    Less,
+    LessOrEqual,
+    In,
+    Exists
+};
+
+/**
+ * @brief One condition of a filter: the value at path compared with an operand.
+ */
+struct FilterCondition {
+    JsonPath path;
+    FilterOp op;
+    nlohmann::json operand;
+};
+
+/**
+ * @brief A conjunction of conditions on the fields of a document.
+ *
+ * The filter is a JSON object mapping JSON Pointers to conditions:
+ * @code
+ * {"/status": "open",
+ *  "/age": {"$gte": 18, "$lt": 65},
+ *  "/owner": {"$exists": true},
+ *  "/tag": {"$in": ["a", "b"]}}
+ * @endcode
+ * A plain value means equality; an object whose members all start with '$'
+ * holds operators ($eq, $gt, $gte, $lt, $lte, $in, $exists). Ranges compare
+ * numbers with numbers and strings with strings; any other pairing does not
+ * match.
+ */
+class Filter {
+public:
+    /**
+     * @brief Parse a filter object.
+     *
+     * @param filter The filter; null means match everything.
+     * @return std::expected<Filter, std::string> The filter, or an error message.
+     */
+    [[nodiscard]] static std::expected<Filter, std::string> parse(const nlohmann::json& filter);
+
+    /**
+     * @brief Check whether a document satisfies every condition.
+     *
+     * @param document The parsed document.
+     * @return bool true if it matches.
+     */
+    [[nodiscard]] bool matches(const nlohmann::json& document) const;
+
+    /**
+     * @brief Cheaply rule out documents before parsing them.
+     *
+     * Looks for the byte strings a matching document must contain, such as
+     * "open" for {"/status": "open"} or "owner" for an $exists test. Never
+     * rejects a matching document; documents containing escape sequences are
+     * always let through, since the same string can be escaped in many ways.
+     *
+     * @param bytes The stored document.
+     * @return bool false if the document cannot match.
+     */
+    [[nodiscard]] bool may_match(std::string_view bytes) const noexcept;
+
+    /**
+     * @brief Check whether the filter has no conditions.
+     *
+     * @return bool true if every document matches.
+     */
+    [[nodiscard]] bool empty() const noexcept {
+        return conditions_.empty();
+    }
+
+    /**
+     * @brief Get the conditions.
+     *
+     * @return const std::vector<FilterCondition>& The conditions.
+     */
+    [[nodiscard]] const std::vector<FilterCondition>& conditions() const noexcept {
+        return conditions_;
+    }
+
+private:
+    std::vector<FilterCondition> conditions_;
+
+    // One group per condition that has any; a document must contain at least
+    // one needle of every group.
+    std::vector<std::vector<std::string>> needle_groups_;
+};
+
+/**
+ * @brief A list of fields to copy out of matching documents.
+ */
+class Projection {
+public:
+    /**
+     * @brief Parse a list of JSON Pointers.
+     *
+     * @param fields An array of strings.
+     * @return std::expected<Projection, std::string> The projection, or an error message.
+     */
+    [[nodiscard]] static std::expected<Projection, std::string> parse(const nlohmann::json& fields);
+
+    /**
+     * @brief Build a document holding only the projected fields.
+     *
+     * Fields keep their nesting, so "/owner/id" becomes {"owner": {"id": ...}}.
+     * Fields missing from the document are left out.
+     *
+     * @param document The parsed document.
+     * @return nlohmann::json The projected document.
+     */
+    [[nodiscard]] nlohmann::json apply(const nlohmann::json& document) const;
+
+private:
+    std::vector<JsonPath> fields_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_QUERY_FILTER_HPP
@@ -0,0 +1,65 @@
+#include "query/json_path.hpp"
+
+#include <charconv>
+
+namespace simple_data_server {
+
+std::optional<JsonPath> JsonPath::parse(std::string_view text) {
+    JsonPath path;
+    path.text_ = text;
+    if (text.empty()) {
+        return path;
+    }
+    if (text.front() != '/') {
+        return std::nullopt;
+    }
+
+    std::string token;
+    for (std::size_t i = 1; i <= text.size(); ++i) {
+        if (i == text.size() || text[i] == '/') {
+            path.tokens_.push_back(std::move(token));
+            token.clear();
+            continue;
+        }
+        if (text[i] != '~') {
+            token.push_back(text[i]);
+            continue;
+        }
+        // "~0" is '~' and "~1" is '/'; any other use of '~' is invalid.
+        if (i + 1 >= text.size() || (text[i + 1] != '0' && text[i + 1] != '1')) {
+            return std::nullopt;
+        }
+        token.push_back(text[i + 1] == '0' ? '~' : '/');
+        ++i;
+    }
+    return path;
+}
+
+const nlohmann::json* JsonPath::resolve(const nlohmann::json& document) const {
+    const auto* current = &document;
+    for (const auto& token : tokens_) {
+        if (current->is_object()) {
+            const auto it = current->find(token);
+            if (it == current->end()) {
+                return nullptr;
+            }
+            current = &*it;
+        } else if (current->is_array()) {
+            if (token.empty() || (token.size() > 1 && token.front() == '0')) {
+                return nullptr;
+            }
+            std::size_t index = 0;
+            const auto* end = token.data() + token.size();
+            const auto [ptr, ec] = std::from_chars(token.data(), end, index);
+            if (ec != std::errc() || ptr != end || index >= current->size()) {
+                return nullptr;
+            }
+            current = &(*current)[index];
+        } else {
+            return nullptr;
+        }
+    }
+    return current;
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,61 @@
+#ifndef SIMPLE_DATA_SERVER_QUERY_JSON_PATH_HPP
+#define SIMPLE_DATA_SERVER_QUERY_JSON_PATH_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace simple_data_server {
+
+/**
+ * @brief A JSON Pointer (RFC 6901) such as "/owner/id", resolved without exceptions.
+ */
+class JsonPath {
+public:
+    /**
+     * @brief Parse a JSON Pointer.
+     *
+     * @param text The pointer; must be empty (the whole document) or start with '/'.
+     * @return std::optional<JsonPath> The path, or std::nullopt if text is not
+     *         a valid JSON Pointer.
+     */
+    [[nodiscard]] static std::optional<JsonPath> parse(std::string_view text);
+
+    /**
+     * @brief Find the value the path points to.
+     *
+     * Array elements are addressed by decimal index.
+     *
+     * @param document The document to look into.
+     * @return const nlohmann::json* The value, or nullptr if it does not exist.
+     */
+    [[nodiscard]] const nlohmann::json* resolve(const nlohmann::json& document) const;
+
+    /**
+     * @brief Get the unescaped reference tokens, e.g. {"owner", "id"}.
+     *
+     * @return const std::vector<std::string>& The tokens.
+     */
+    [[nodiscard]] const std::vector<std::string>& tokens() const noexcept {
+        return tokens_;
+    }
+
+    /**
+     * @brief Get the pointer as given to parse().
+     *
+     * @return const std::string& The pointer text.
+     */
+    [[nodiscard]] const std::string& text() const noexcept {
+        return text_;
+    }
+
+private:
+    std::string text_;
+    std::vector<std::string> tokens_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_QUERY_JSON_PATH_HPP
@@ -0,0 +1,156 @@
+#include "query/text_search.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::size_t MAX_QUERY_LENGTH = 256;
+constexpr std::size_t MAX_QUERY_TERMS = 8;
+
+/**
+ * @brief Call a visitor with the JSON Pointer and value of every string in a document.
+ */
+void for_each_string(const nlohmann::json& value, std::string& pointer,
+                     const std::function<void(const std::string&, const std::string&)>& visitor) {
+    const auto length = pointer.size();
+    if (value.is_string()) {
+        visitor(pointer, value.get_ref<const std::string&>());
+    } else if (value.is_object()) {
+        for (const auto& [name, member] : value.items()) {
+            pointer += '/';
+            for (const char c : name) {
+                if (c == '~') {
+                    pointer += "~0";
+                } else if (c == '/') {
+                    pointer += "~1";
+                } else {
+                    pointer += c;
+                }
+            }
+            for_each_string(member, pointer, visitor);
+            pointer.resize(length);
+        }
+    } else if (value.is_array()) {
+        for (std::size_t i = 0; i < value.size(); ++i) {
+            pointer += '/';
+            pointer += std::to_string(i);
+            for_each_string(value[i], pointer, visitor);
+            pointer.resize(length);
+        }
+    }
+}
+
+std::size_t count_occurrences(std::string_view text, std::string_view term) {
+    std::size_t count = 0;
+    for (auto at = text.find(term); at != std::string_view::npos;
+         at = text.find(term, at + term.size())) {
+        ++count;
+    }
+    return count;
+}
+
+} // namespace
+
+std::string fold_case(std::string_view text) {
+    std::string folded(text);
+    for (auto& c : folded) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+    return folded;
+}
+
+void append_trigrams(std::string_view folded, std::vector<Trigram>& out) {
+    for (std::size_t i = 0; i + 3 <= folded.size(); ++i) {
+        out.push_back(static_cast<Trigram>(static_cast<unsigned char>(folded[i])) << 16 |
+                      static_cast<Trigram>(static_cast<unsigned char>(folded[i + 1])) << 8 |
+                      static_cast<Trigram>(static_cast<unsigned char>(folded[i + 2])));
+    }
+}
+
+std::vector<Trigram> document_trigrams(const nlohmann::json& document) {
+    std::vector<Trigram> trigrams;
+    std::string pointer;
+    for_each_string(document, pointer, [&](const std::string&, const std::string& text) {
+        append_trigrams(fold_case(text), trigrams);
+    });
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+std::expected<TextQuery, std::string> TextQuery::parse(std::string_view text) {
+    if (text.size() > MAX_QUERY_LENGTH) {
+        return std::unexpected("Query too long (max " + std::to_string(MAX_QUERY_LENGTH) +
+                               " bytes)");
+    }
+
+    TextQuery query;
+    const auto folded = fold_case(text);
+    std::size_t begin = 0;
+    while (begin < folded.size()) {
+        if (std::isspace(static_cast<unsigned char>(folded[begin]))) {
+            ++begin;
+            continue;
+        }
+        auto end = begin;
+        while (end < folded.size() && !std::isspace(static_cast<unsigned char>(folded[end]))) {
+            ++end;
+        }
+        auto term = folded.substr(begin, end - begin);
+        if (std::find(query.terms_.begin(), query.terms_.end(), term) == query.terms_.end()) {
+            query.terms_.push_back(std::move(term));
+        }
+        begin = end;
+    }
+
+    if (query.terms_.empty()) {
+        return std::unexpected(std::string("Query has no terms"));
+    }
+    if (query.terms_.size() > MAX_QUERY_TERMS) {
+        return std::unexpected("Too many query terms (max " + std::to_string(MAX_QUERY_TERMS) +
+                               ")");
+    }
+    return query;
+}
+
+std::vector<Trigram> TextQuery::trigrams() const {
+    std::vector<Trigram> trigrams;
+    for (const auto& term : terms_) {
+        append_trigrams(term, trigrams);
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+    return trigrams;
+}
+
+TextMatch TextQuery::match(const nlohmann::json& document) const {
+    TextMatch result;
+    std::vector<bool> found(terms_.size(), false);
+    std::string pointer;
+    for_each_string(document, pointer, [&](const std::string& at, const std::string& text) {
+        const auto folded = fold_case(text);
+        std::size_t count = 0;
+        for (std::size_t i = 0; i < terms_.size(); ++i) {
+            const auto occurrences = count_occurrences(folded, terms_[i]);
+            found[i] = found[i] || occurrences > 0;
+            count += occurrences;
+        }
+        if (count > 0) {
+            result.score += count;
+            result.hits.push_back(TextHit{at, count});
+        }
+    });
+
+    if (std::find(found.begin(), found.end(), false) != found.end()) {
+        return {};
+    }
+    return result;
+}
+
+} // namespace simple_data_server
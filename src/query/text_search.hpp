@@ -0,0 +1,123 @@
+#ifndef SIMPLE_DATA_SERVER_QUERY_TEXT_SEARCH_HPP
+#define SIMPLE_DATA_SERVER_QUERY_TEXT_SEARCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <expected.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace simple_data_server {
+
+/**
+ * @brief Three consecutive bytes of case-folded text, packed into the low 24 bits.
+ */
+using Trigram = std::uint32_t;
+
+/**
+ * @brief Fold ASCII letters to lower case; other bytes, including UTF-8, are kept.
+ *
+ * @param text The text.
+ * @return std::string The folded text.
+ */
+[[nodiscard]] std::string fold_case(std::string_view text);
+
+/**
+ * @brief Append the trigrams of already folded text.
+ *
+ * @param folded Text as returned by fold_case(); shorter than three bytes yields nothing.
+ * @param out Receives the trigrams, possibly with duplicates.
+ */
+void append_trigrams(std::string_view folded, std::vector<Trigram>& out);
+
+/**
+ * @brief Collect the trigrams of every string value in a document.
+ *
+ * Object member names are not searched and contribute nothing.
+ *
+ * @param document The parsed document.
+ * @return std::vector<Trigram> The distinct trigrams, sorted.
+ */
+[[nodiscard]] std::vector<Trigram> document_trigrams(const nlohmann::json& document);
+
+/**
+ * @brief The occurrences of search terms in one string value.
+ */
+struct TextHit {
+    /**
+     * @brief JSON Pointer of the string value.
+     */
+    std::string pointer;
+
+    /**
+     * @brief Number of term occurrences in the value.
+     */
+    std::size_t count = 0;
+};
+
+/**
+ * @brief The result of matching a query against one document.
+ */
+struct TextMatch {
+    /**
+     * @brief Total occurrences of all terms; the document's rank.
+     */
+    std::size_t score = 0;
+
+    /**
+     * @brief Values containing at least one term, in document order.
+     */
+    std::vector<TextHit> hits;
+};
+
+/**
+ * @brief A parsed /api/search query: whitespace-separated terms that must all occur.
+ *
+ * Terms are matched as case-insensitive substrings of string values, so
+ * "inv" finds "Invoice". Each term may occur in a different value.
+ */
+class TextQuery {
+public:
+    /**
+     * @brief Split and fold a query string.
+     *
+     * @param text The query.
+     * @return std::expected<TextQuery, std::string> The query, or an error message
+     *         if it is empty, too long or has too many terms.
+     */
+    [[nodiscard]] static std::expected<TextQuery, std::string> parse(std::string_view text);
+
+    /**
+     * @brief Get the folded, distinct terms.
+     *
+     * @return const std::vector<std::string>& The terms.
+     */
+    [[nodiscard]] const std::vector<std::string>& terms() const noexcept {
+        return terms_;
+    }
+
+    /**
+     * @brief Get the trigrams every matching document must contain.
+     *
+     * @return std::vector<Trigram> The distinct trigrams of all terms, sorted;
+     *         empty if every term is shorter than three bytes.
+     */
+    [[nodiscard]] std::vector<Trigram> trigrams() const;
+
+    /**
+     * @brief Match a document.
+     *
+     * @param document The parsed document.
+     * @return TextMatch The hits; score is zero if some term does not occur.
+     */
+    [[nodiscard]] TextMatch match(const nlohmann::json& document) const;
+
+private:
+    std::vector<std::string> terms_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_QUERY_TEXT_SEARCH_HPP
@@ -0,0 +1,104 @@
+#include "replication/change_log.hpp"
+
+#include <random>
+
+namespace simple_data_server {
+
+namespace {
+
+// Rough per-record bookkeeping cost on top of the strings themselves.
+constexpr std::size_t RECORD_OVERHEAD_BYTES = 64;
+
+std::size_t record_size(const ChangeRecord& record) {
+    return record.key.size() + record.filename.size() + record.bytes.size() +
+           RECORD_OVERHEAD_BYTES;
+}
+
+std::uint64_t random_epoch() {
+    std::random_device device;
+    std::uint64_t epoch = 0;
+    while (epoch == 0) {
+        epoch = (static_cast<std::uint64_t>(device()) << 32) | device();
+    }
+    return epoch;
+}
+
+} // namespace
+
+ChangeLog::ChangeLog(std::size_t max_bytes)
+    : epoch_(random_epoch()), max_bytes_(max_bytes) {
+}
+
+std::uint64_t ChangeLog::append(const DocumentChange& change) {
+    ChangeRecord record{0, change.type, std::string(change.key), std::string(change.filename),
+                        std::string(change.bytes)};
+    const auto size = record_size(record);
+
+    std::uint64_t sequence;
+    {
+        std::lock_guard lock(mutex_);
+        sequence = ++last_sequence_;
+        record.sequence = sequence;
+        records_.push_back(std::move(record));
+        retained_bytes_ += size;
+
+        // Always keep the newest record so a live replica never misses it.
+        while (retained_bytes_ > max_bytes_ && records_.size() > 1) {
+            retained_bytes_ -= record_size(records_.front());
+            records_.pop_front();
+        }
+    }
+    changed_.notify_all();
+    return sequence;
+}
+
+std::optional<std::vector<ChangeRecord>> ChangeLog::read_from(std::uint64_t from,
+                                                              std::size_t max_bytes) const {
+    std::lock_guard lock(mutex_);
+    if (from < first_retained_sequence()) {
+        return std::nullopt;
+    }
+
+    std::vector<ChangeRecord> result;
+    if (records_.empty() || from > last_sequence_) {
+        return result;
+    }
+
+    std::size_t bytes = 0;
+    for (auto i = static_cast<std::size_t>(from - records_.front().sequence);
+         i < records_.size() && (result.empty() || bytes < max_bytes); ++i) {
+        bytes += record_size(records_[i]);
+        result.push_back(records_[i]);
+    }
+    return result;
+}
+
+bool ChangeLog::wait_for(std::uint64_t sequence, std::chrono::milliseconds timeout) const {
+    std::unique_lock lock(mutex_);
+    changed_.wait_for(lock, timeout, [&] { return closed_ || last_sequence_ >= sequence; });
+    return !closed_ && last_sequence_ >= sequence;
+}
+
+void ChangeLog::close() {
+    {
+        std::lock_guard lock(mutex_);
+        closed_ = true;
+    }
+    changed_.notify_all();
+}
+
+bool ChangeLog::can_resume_from(std::uint64_t sequence) const {
+    std::lock_guard lock(mutex_);
+    return sequence >= first_retained_sequence() && sequence <= last_sequence_ + 1;
+}
+
+std::uint64_t ChangeLog::last_sequence() const {
+    std::lock_guard lock(mutex_);
+    return last_sequence_;
+}
+
+std::uint64_t ChangeLog::first_retained_sequence() const {
+    return records_.empty() ? last_sequence_ + 1 : records_.front().sequence;
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,128 @@
+#ifndef SIMPLE_DATA_SERVER_REPLICATION_CHANGE_LOG_HPP
+#define SIMPLE_DATA_SERVER_REPLICATION_CHANGE_LOG_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "storage/file_manager.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief One entry of the replication change log.
+ */
+struct ChangeRecord {
+    std::uint64_t sequence = 0;
+    ChangeType type = ChangeType::Put;
+    std::string key;
+    std::string filename;
+    std::string bytes;
+};
+
+/**
+ * @brief The primary's ordered, in-memory log of recent document changes.
+ *
+ * Every change gets the next sequence number, starting at 1. The log keeps
+ * the most recent changes up to a byte budget (the backlog) so a replica
+ * that reconnects can catch up from the sequence number it last applied.
+ * Replicas that fall further behind, or that last followed another run of
+ * the primary (a different epoch), must resynchronize from a snapshot.
+ *
+ * All methods are thread-safe.
+ */
+class ChangeLog {
+public:
+    /**
+     * @brief Construct an empty ChangeLog with a new random epoch.
+     *
+     * @param max_bytes Approximate memory budget for retained changes.
+     */
+    explicit ChangeLog(std::size_t max_bytes);
+
+    ChangeLog(const ChangeLog&) = delete;
+    ChangeLog& operator=(const ChangeLog&) = delete;
+
+    /**
+     * @brief Append a change and wake waiting readers.
+     *
+     * @param change The change.
+     * @return std::uint64_t The change's sequence number.
+     */
+    std::uint64_t append(const DocumentChange& change);
+
+    /**
+     * @brief Copy retained changes starting at a sequence number.
+     *
+     * @param from First sequence number to return.
+     * @param max_bytes Stop after roughly this many bytes (at least one change is returned).
+     * @return std::optional<std::vector<ChangeRecord>> The changes (empty if
+     *         none after from yet), or std::nullopt if changes at from have
+     *         already been discarded.
+     */
+    [[nodiscard]] std::optional<std::vector<ChangeRecord>> read_from(std::uint64_t from,
+                                                                     std::size_t max_bytes) const;
+
+    /**
+     * @brief Wait until a change with the given sequence number exists.
+     *
+     * @param sequence The sequence number to wait for.
+     * @param timeout Maximum time to wait.
+     * @return true if the change exists, false on timeout or after close().
+     */
+    bool wait_for(std::uint64_t sequence, std::chrono::milliseconds timeout) const;
+
+    /**
+     * @brief Wake all waiting readers permanently, e.g. on shutdown.
+     */
+    void close();
+
+    /**
+     * @brief Check whether catching up from a sequence number is possible.
+     *
+     * @param sequence The next sequence number a replica needs.
+     * @return true if no change at or after sequence has been discarded.
+     */
+    [[nodiscard]] bool can_resume_from(std::uint64_t sequence) const;
+
+    /**
+     * @brief Get the sequence number of the latest change; zero if none yet.
+     *
+     * @return std::uint64_t The sequence number.
+     */
+    [[nodiscard]] std::uint64_t last_sequence() const;
+
+    /**
+     * @brief Get the random identifier of this log.
+     *
+     * Sequence numbers are only meaningful together with the epoch they were
+     * issued in, since the log does not survive restarts.
+     *
+     * @return std::uint64_t The epoch.
+     */
+    [[nodiscard]] std::uint64_t epoch() const noexcept {
+        return epoch_;
+    }
+
+private:
+    [[nodiscard]] std::uint64_t first_retained_sequence() const;
+
+    const std::uint64_t epoch_;
+    const std::size_t max_bytes_;
+    mutable std::mutex mutex_;
+    mutable std::condition_variable changed_;
+    std::deque<ChangeRecord> records_;
+    std::size_t retained_bytes_ = 0;
+    std::uint64_t last_sequence_ = 0;
+    bool closed_ = false;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_REPLICATION_CHANGE_LOG_HPP
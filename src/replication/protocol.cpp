@@ -0,0 +1,95 @@
+#include "replication/protocol.hpp"
+
+#include <cerrno>
+#include <sys/socket.h>
+
+namespace simple_data_server {
+
+namespace {
+
+void put_u32(std::string& out, std::uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+void put_u64(std::string& out, std::uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+std::uint64_t get_le(const unsigned char* data, int size) {
+    std::uint64_t value = 0;
+    for (int i = size; i-- > 0;) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+} // namespace
+
+void encode_frame(const ReplicationFrame& frame, std::string& out) {
+    out.reserve(out.size() + FRAME_HEADER_SIZE + frame.key.size() + frame.filename.size() +
+                frame.bytes.size());
+    out.push_back(static_cast<char>(frame.type));
+    put_u64(out, frame.sequence);
+    put_u32(out, static_cast<std::uint32_t>(frame.key.size()));
+    put_u32(out, static_cast<std::uint32_t>(frame.filename.size()));
+    put_u32(out, static_cast<std::uint32_t>(frame.bytes.size()));
+    out += frame.key;
+    out += frame.filename;
+    out += frame.bytes;
+}
+
+std::optional<ReplicationFrame> receive_frame(int fd) {
+    unsigned char header[FRAME_HEADER_SIZE];
+    if (!receive_all(fd, reinterpret_cast<char*>(header), sizeof(header))) {
+        return std::nullopt;
+    }
+
+    const auto type = header[0];
+    if (type < static_cast<std::uint8_t>(FrameType::Hello) ||
+        type > static_cast<std::uint8_t>(FrameType::Ack)) {
+        return std::nullopt;
+    }
+
+    const auto key_size = get_le(header + 9, 4);
+    const auto filename_size = get_le(header + 13, 4);
+    const auto bytes_size = get_le(header + 17, 4);
+    if (key_size + filename_size + bytes_size > MAX_FRAME_PAYLOAD_SIZE) {
+        return std::nullopt;
+    }
+
+    ReplicationFrame frame;
+    frame.type = static_cast<FrameType>(type);
+    frame.sequence = get_le(header + 1, 8);
+    frame.key.resize(key_size);
+    frame.filename.resize(filename_size);
+    frame.bytes.resize(bytes_size);
+    if (!receive_all(fd, frame.key.data(), key_size) ||
+        !receive_all(fd, frame.filename.data(), filename_size) ||
+        !receive_all(fd, frame.bytes.data(), bytes_size)) {
+        return std::nullopt;
+    }
+    return frame;
+}
+
+std::optional<ReplicationFrame> try_receive_frame(int fd, bool& closed) {
+    char header[FRAME_HEADER_SIZE];
+    const auto available = ::recv(fd, header, sizeof(header), MSG_PEEK | MSG_DONTWAIT);
+    if (available == 0 || (available < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+                           errno != EINTR)) {
+        closed = true;
+        return std::nullopt;
+    }
+    if (available < static_cast<ssize_t>(sizeof(header))) {
+        return std::nullopt;
+    }
+
+    auto frame = receive_frame(fd);
+    closed = !frame.has_value();
+    return frame;
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,97 @@
+#ifndef SIMPLE_DATA_SERVER_REPLICATION_PROTOCOL_HPP
+#define SIMPLE_DATA_SERVER_REPLICATION_PROTOCOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "util/tcp_socket.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Frame types of the replication stream.
+ *
+ * A replica opens the connection with Hello (sequence: the next change it
+ * needs; text: its epoch in hex, or empty; filename: the shared replication
+ * secret, or empty). A primary with a secret closes the connection without
+ * sending anything unless the Hello carries it. Otherwise it answers with either
+ * Resume (sequence: the first change it will send) or SnapshotBegin, the full
+ * document set as Put frames with sequence zero, and SnapshotEnd (sequence:
+ * the last change the snapshot covers). Put and Delete frames with their
+ * sequence numbers follow, interleaved with Heartbeat frames carrying the
+ * primary's latest sequence number while idle. The replica periodically
+ * reports the last sequence number it applied with Ack.
+ */
+enum class FrameType : std::uint8_t {
+    Hello = 1,
+    Resume = 2,
+    SnapshotBegin = 3,
+    SnapshotEnd = 4,
+    Put = 5,
+    Delete = 6,
+    Heartbeat = 7,
+    Ack = 8
+};
+
+/**
+ * @brief One message of the replication stream.
+ *
+ * On the wire a frame is a 21-byte little-endian header (type, sequence and
+ * the three field lengths) followed by the fields' bytes.
+ */
+struct ReplicationFrame {
+    FrameType type = FrameType::Heartbeat;
+    std::uint64_t sequence = 0;
+
+    /**
+     * @brief The document key, or for Hello, Resume and SnapshotBegin the
+     *        epoch formatted with format_content_hash().
+     */
+    std::string key;
+
+    std::string filename;
+    std::string bytes;
+};
+
+/**
+ * @brief Size of the fixed frame header in bytes.
+ */
+inline constexpr std::size_t FRAME_HEADER_SIZE = 21;
+
+/**
+ * @brief Largest accepted frame payload; documents are at most 1MB.
+ */
+inline constexpr std::size_t MAX_FRAME_PAYLOAD_SIZE = 2 * 1024 * 1024;
+
+/**
+ * @brief Serialize a frame, appending it to a buffer.
+ *
+ * @param frame The frame.
+ * @param out The buffer.
+ */
+void encode_frame(const ReplicationFrame& frame, std::string& out);
+
+/**
+ * @brief Read one frame from a socket.
+ *
+ * @param fd The socket.
+ * @return std::optional<ReplicationFrame> The frame, or std::nullopt if the
+ *         connection closed, timed out or sent a malformed frame.
+ */
+[[nodiscard]] std::optional<ReplicationFrame> receive_frame(int fd);
+
+/**
+ * @brief Read one frame if a complete header is already available, without blocking.
+ *
+ * @param fd The socket.
+ * @param closed Set to true if the connection closed or failed.
+ * @return std::optional<ReplicationFrame> The frame, if one was available.
+ */
+[[nodiscard]] std::optional<ReplicationFrame> try_receive_frame(int fd, bool& closed);
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_REPLICATION_PROTOCOL_HPP
@@ -0,0 +1,309 @@
+#include "replication/replica_client.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "storage/file_io.hpp"
+#include "storage/file_manager.hpp"
+#include "util/stop_sleep.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::string_view STATE_FILENAME = ".replica-state";
+constexpr std::size_t MAX_STATE_SIZE_BYTES = 4096;
+constexpr std::chrono::milliseconds SOCKET_TIMEOUT{5000};
+constexpr std::chrono::milliseconds RETRY_INTERVAL{1000};
+constexpr std::chrono::milliseconds ACK_INTERVAL{1000};
+
+} // namespace
+
+ReplicaClient::ReplicaClient(FileManager& file_manager,
+                             std::string host,
+                             std::uint16_t port,
+                             std::string secret)
+    : file_manager_(file_manager),
+      host_(std::move(host)),
+      port_(port),
+      secret_(std::move(secret)),
+      state_path_(file_manager.get_data_directory() + "/" + std::string(STATE_FILENAME)),
+      caught_up_at_(std::chrono::steady_clock::now()) {
+}
+
+ReplicaClient::~ReplicaClient() {
+    stop();
+}
+
+void ReplicaClient::start() {
+    load_position();
+    thread_ = std::jthread([this](std::stop_token stop_token) { run(stop_token); });
+}
+
+void ReplicaClient::stop() noexcept {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    thread_.request_stop();
+    {
+        std::lock_guard lock(mutex_);
+        if (fd_ >= 0) {
+            ::shutdown(fd_, SHUT_RDWR);
+        }
+    }
+    thread_.join();
+    save_position();
+}
+
+nlohmann::json ReplicaClient::status() const {
+    std::lock_guard lock(mutex_);
+    const auto lag_changes = primary_sequence_ - std::min(applied_sequence_, primary_sequence_);
+    const auto lag_seconds =
+        lag_changes == 0 ? 0.0
+                         : std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                         caught_up_at_)
+                               .count();
+
+    return {{"role", "replica"},
+            {"primary", host_ + ":" + std::to_string(port_)},
+            {"connected", connected_},
+            {"epoch", epoch_},
+            {"applied_sequence", applied_sequence_},
+            {"primary_sequence", primary_sequence_},
+            {"lag_changes", lag_changes},
+            {"lag_seconds", lag_seconds},
+            {"receiving_snapshot", in_snapshot_}};
+}
+
+void ReplicaClient::run(std::stop_token stop_token) {
+    while (!stop_token.stop_requested()) {
+        const int fd = connect_tcp(host_, port_, SOCKET_TIMEOUT);
+        if (fd >= 0) {
+            {
+                std::lock_guard lock(mutex_);
+                fd_ = fd;
+                connected_ = true;
+            }
+            std::cout << "Connected to primary " << host_ << ":" << port_ << std::endl;
+
+            follow(fd, stop_token);
+
+            {
+                std::lock_guard lock(mutex_);
+                ::close(fd_);
+                fd_ = -1;
+                connected_ = false;
+                in_snapshot_ = false;
+            }
+            save_position();
+            if (!stop_token.stop_requested()) {
+                std::cerr << "Lost connection to primary " << host_ << ":" << port_ << std::endl;
+            }
+        }
+
+        sleep_for(stop_token, RETRY_INTERVAL);
+    }
+}
+
+void ReplicaClient::follow(int fd, std::stop_token stop_token) {
+    ReplicationFrame hello;
+    hello.type = FrameType::Hello;
+    hello.filename = secret_;
+    {
+        std::lock_guard lock(mutex_);
+        hello.sequence = applied_sequence_ + 1;
+        hello.key = epoch_;
+    }
+
+    std::string buffer;
+    encode_frame(hello, buffer);
+    if (!send_all(fd, buffer)) {
+        return;
+    }
+
+    auto last_ack = std::chrono::steady_clock::now();
+    while (!stop_token.stop_requested()) {
+        const auto frame = receive_frame(fd);
+        if (!frame) {
+            return;
+        }
+        if (!apply(frame.value())) {
+            std::cerr << "Unexpected or failed frame from primary, reconnecting" << std::endl;
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now - last_ack >= ACK_INTERVAL) {
+            last_ack = now;
+            ReplicationFrame ack;
+            ack.type = FrameType::Ack;
+            {
+                std::lock_guard lock(mutex_);
+                ack.sequence = applied_sequence_;
+            }
+            buffer.clear();
+            encode_frame(ack, buffer);
+            if (!send_all(fd, buffer)) {
+                return;
+            }
+            save_position();
+        }
+    }
+}
+
+bool ReplicaClient::apply(const ReplicationFrame& frame) {
+    bool in_snapshot;
+    {
+        std::lock_guard lock(mutex_);
+        in_snapshot = in_snapshot_;
+    }
+
+    std::uint64_t applied = 0;
+    switch (frame.type) {
+        case FrameType::Resume: {
+            std::lock_guard lock(mutex_);
+            if (frame.sequence != applied_sequence_ + 1) {
+                return false;
+            }
+            epoch_ = frame.key;
+            return true;
+        }
+        case FrameType::SnapshotBegin: {
+            std::cout << "Receiving snapshot from primary at sequence " << frame.sequence
+                      << std::endl;
+            {
+                // Until the snapshot completes, the old position no longer
+                // describes the local documents.
+                std::lock_guard lock(mutex_);
+                epoch_.clear();
+                applied_sequence_ = 0;
+            }
+            save_position();
+
+            std::lock_guard lock(mutex_);
+            epoch_ = frame.key;
+            primary_sequence_ = std::max(primary_sequence_, frame.sequence);
+            in_snapshot_ = true;
+            snapshot_documents_.clear();
+            return true;
+        }
+        case FrameType::SnapshotEnd: {
+            if (!in_snapshot) {
+                return false;
+            }
+            remove_documents_missing_from_snapshot();
+            std::cout << "Applied snapshot of " << snapshot_documents_.size() << " documents"
+                      << std::endl;
+            snapshot_documents_.clear();
+            {
+                std::lock_guard lock(mutex_);
+                in_snapshot_ = false;
+            }
+            applied = frame.sequence;
+            break;
+        }
+        case FrameType::Put: {
+            const auto stored =
+                file_manager_.apply_replicated_put(frame.key, frame.filename, frame.bytes);
+            if (!stored) {
+                // Reconnect without advancing, so the primary sends the put
+                // again. A snapshot cannot be resumed midway: start over.
+                std::cerr << "Failed to apply replicated put of " << frame.key << "/"
+                          << frame.filename << std::endl;
+                if (frame.sequence == 0) {
+                    std::lock_guard lock(mutex_);
+                    epoch_.clear();
+                }
+                return false;
+            }
+            if (frame.sequence == 0) {
+                if (!in_snapshot) {
+                    return false;
+                }
+                snapshot_documents_.emplace(frame.key, frame.filename);
+                return true;
+            }
+            applied = frame.sequence;
+            break;
+        }
+        case FrameType::Delete:
+            file_manager_.apply_replicated_delete(frame.key, frame.filename);
+            applied = frame.sequence;
+            break;
+        case FrameType::Heartbeat: {
+            std::lock_guard lock(mutex_);
+            primary_sequence_ = std::max(primary_sequence_, frame.sequence);
+            if (applied_sequence_ >= primary_sequence_) {
+                caught_up_at_ = std::chrono::steady_clock::now();
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+
+    std::lock_guard lock(mutex_);
+    applied_sequence_ = std::max(applied_sequence_, applied);
+    primary_sequence_ = std::max(primary_sequence_, applied_sequence_);
+    if (applied_sequence_ >= primary_sequence_) {
+        caught_up_at_ = std::chrono::steady_clock::now();
+    }
+    return true;
+}
+
+void ReplicaClient::remove_documents_missing_from_snapshot() {
+    std::size_t removed = 0;
+    for (const auto& key : file_manager_.list_keys()) {
+        const auto files = file_manager_.list_files(key);
+        if (!files) {
+            continue;
+        }
+        for (const auto& filename : files.value()) {
+            if (!snapshot_documents_.contains({key, filename})) {
+                file_manager_.apply_replicated_delete(key, filename);
+                ++removed;
+            }
+        }
+    }
+    if (removed > 0) {
+        std::cout << "Removed " << removed << " documents not in the snapshot" << std::endl;
+    }
+}
+
+void ReplicaClient::load_position() {
+    const auto content = read_file(state_path_, MAX_STATE_SIZE_BYTES);
+    if (!content) {
+        return;
+    }
+
+    try {
+        const auto state = nlohmann::json::parse(content.value());
+        std::lock_guard lock(mutex_);
+        epoch_ = state.at("epoch").get<std::string>();
+        applied_sequence_ = state.at("sequence").get<std::uint64_t>();
+        primary_sequence_ = applied_sequence_;
+    } catch (const std::exception& e) {
+        std::cerr << "Ignoring invalid " << state_path_ << ": " << e.what() << std::endl;
+    }
+}
+
+void ReplicaClient::save_position() const {
+    nlohmann::json state;
+    {
+        std::lock_guard lock(mutex_);
+        if (in_snapshot_) {
+            return;
+        }
+        state["epoch"] = epoch_;
+        state["sequence"] = applied_sequence_;
+    }
+
+    if (!write_file_atomically(state_path_, state.dump(), true)) {
+        std::cerr << "Failed to save replication position to " << state_path_ << std::endl;
+    }
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,116 @@
+#ifndef SIMPLE_DATA_SERVER_REPLICATION_REPLICA_CLIENT_HPP
+#define SIMPLE_DATA_SERVER_REPLICATION_REPLICA_CLIENT_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "replication/protocol.hpp"
+#include "replication/replication_node.hpp"
+
+namespace simple_data_server {
+
+class FileManager;
+
+/**
+ * @brief The replica side of replication: follows a primary's change log.
+ *
+ * A background thread connects to the primary, asks to resume after the
+ * last change it applied and applies every received put and delete through
+ * the FileManager. If the primary cannot resume (it restarted, or the
+ * replica fell out of its backlog) it sends a snapshot instead, after which
+ * local documents the snapshot did not contain are deleted. The position
+ * (epoch and sequence number) is persisted in data/.replica-state so a
+ * restarted replica catches up instead of taking a new snapshot. Lost
+ * connections are retried every second.
+ */
+class ReplicaClient : public ReplicationNode {
+public:
+    /**
+     * @brief Construct a ReplicaClient.
+     *
+     * @param file_manager The storage to apply changes to; must outlive this object.
+     * @param host The primary's host name or address.
+     * @param port The primary's replication port.
+     * @param secret The primary's replication secret, or empty if it has none.
+     */
+    ReplicaClient(FileManager& file_manager,
+                  std::string host,
+                  std::uint16_t port,
+                  std::string secret);
+
+    /**
+     * @brief Stops following the primary and saves the position.
+     */
+    ~ReplicaClient() override;
+
+    ReplicaClient(const ReplicaClient&) = delete;
+    ReplicaClient& operator=(const ReplicaClient&) = delete;
+
+    /**
+     * @brief Load the saved position and start following the primary.
+     */
+    void start();
+
+    /**
+     * @brief Disconnect from the primary and save the position.
+     */
+    void stop() noexcept;
+
+    [[nodiscard]] nlohmann::json status() const override;
+
+    [[nodiscard]] bool is_read_only() const noexcept override {
+        return true;
+    }
+
+private:
+    void run(std::stop_token stop_token);
+
+    /**
+     * @brief Follow the primary over one connection until it fails.
+     */
+    void follow(int fd, std::stop_token stop_token);
+
+    /**
+     * @brief Apply one frame received from the primary.
+     *
+     * @return false if the frame violates the protocol or could not be
+     *         applied; the position is then not advanced past it.
+     */
+    bool apply(const ReplicationFrame& frame);
+
+    /**
+     * @brief Delete local documents that the snapshot just received did not contain.
+     */
+    void remove_documents_missing_from_snapshot();
+
+    void load_position();
+    void save_position() const;
+
+    FileManager& file_manager_;
+    std::string host_;
+    std::uint16_t port_;
+    std::string secret_;
+    std::string state_path_;
+    std::jthread thread_;
+
+    mutable std::mutex mutex_;
+    int fd_ = -1;
+    std::string epoch_;
+    std::uint64_t applied_sequence_ = 0;
+    std::uint64_t primary_sequence_ = 0;
+    bool connected_ = false;
+    bool in_snapshot_ = false;
+    std::chrono::steady_clock::time_point caught_up_at_;
+
+    // Only touched by the replication thread.
+    std::set<std::pair<std::string, std::string>> snapshot_documents_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_REPLICATION_REPLICA_CLIENT_HPP
@@ -0,0 +1,32 @@
+#ifndef SIMPLE_DATA_SERVER_REPLICATION_REPLICATION_NODE_HPP
+#define SIMPLE_DATA_SERVER_REPLICATION_REPLICATION_NODE_HPP
+
+#include <nlohmann/json.hpp>
+
+namespace simple_data_server {
+
+/**
+ * @brief This server's role in replication, as seen by the API layer.
+ */
+class ReplicationNode {
+public:
+    virtual ~ReplicationNode() = default;
+
+    /**
+     * @brief Describe the replication state for /api/replication.
+     *
+     * @return nlohmann::json The role, sequence numbers and lag.
+     */
+    [[nodiscard]] virtual nlohmann::json status() const = 0;
+
+    /**
+     * @brief Whether writes through the API must be rejected.
+     *
+     * @return true on a replica.
+     */
+    [[nodiscard]] virtual bool is_read_only() const noexcept = 0;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_REPLICATION_REPLICATION_NODE_HPP
@@ -0,0 +1,355 @@
+#include "replication/replication_source.hpp"
+
+#include <arpa/inet.h>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "replication/protocol.hpp"
+#include "storage/content_hash.hpp"
+#include "storage/file_manager.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr int ACCEPT_POLL_INTERVAL_MS = 200;
+constexpr std::chrono::milliseconds SOCKET_TIMEOUT{10000};
+constexpr std::chrono::milliseconds HEARTBEAT_INTERVAL{1000};
+constexpr std::size_t SEND_BATCH_BYTES = 1024 * 1024; // 1MB
+constexpr std::size_t SNAPSHOT_FLUSH_BYTES = 256 * 1024;
+
+std::string format_peer_address(const sockaddr_storage& address) {
+    char text[INET6_ADDRSTRLEN] = {};
+    std::uint16_t port = 0;
+    if (address.ss_family == AF_INET6) {
+        const auto& ipv6 = reinterpret_cast<const sockaddr_in6&>(address);
+        ::inet_ntop(AF_INET6, &ipv6.sin6_addr, text, sizeof(text));
+        port = ntohs(ipv6.sin6_port);
+    } else if (address.ss_family == AF_INET) {
+        const auto& ipv4 = reinterpret_cast<const sockaddr_in&>(address);
+        ::inet_ntop(AF_INET, &ipv4.sin_addr, text, sizeof(text));
+        port = ntohs(ipv4.sin_port);
+    }
+    return std::string(text) + ":" + std::to_string(port);
+}
+
+bool is_loopback(const sockaddr_storage& address) {
+    if (address.ss_family == AF_INET6) {
+        const auto& ipv6 = reinterpret_cast<const sockaddr_in6&>(address);
+        return IN6_IS_ADDR_LOOPBACK(&ipv6.sin6_addr) ||
+               (IN6_IS_ADDR_V4MAPPED(&ipv6.sin6_addr) && ipv6.sin6_addr.s6_addr[12] == 127);
+    }
+    if (address.ss_family == AF_INET) {
+        const auto& ipv4 = reinterpret_cast<const sockaddr_in&>(address);
+        return (ntohl(ipv4.sin_addr.s_addr) >> 24) == 127;
+    }
+    return false;
+}
+
+/**
+ * @brief Compare a presented secret with the expected one in time independent
+ *        of where they differ.
+ *
+ * @param expected The configured secret; must not be empty.
+ */
+bool secrets_match(std::string_view presented, std::string_view expected) {
+    unsigned char difference = presented.size() == expected.size() ? 0 : 1;
+    for (std::size_t i = 0; i < presented.size(); ++i) {
+        difference |= static_cast<unsigned char>(presented[i] ^ expected[i % expected.size()]);
+    }
+    return difference == 0;
+}
+
+ReplicationFrame make_control_frame(FrameType type,
+                                    std::uint64_t sequence,
+                                    std::string text = {}) {
+    ReplicationFrame frame;
+    frame.type = type;
+    frame.sequence = sequence;
+    frame.key = std::move(text);
+    return frame;
+}
+
+} // namespace
+
+ReplicationSource::ReplicationSource(FileManager& file_manager,
+                                     std::shared_ptr<ChangeLog> change_log,
+                                     std::string bind_address,
+                                     std::uint16_t port,
+                                     std::string secret)
+    : file_manager_(file_manager),
+      change_log_(std::move(change_log)),
+      bind_address_(std::move(bind_address)),
+      port_(port),
+      secret_(std::move(secret)) {
+}
+
+ReplicationSource::~ReplicationSource() {
+    stop();
+}
+
+bool ReplicationSource::start() {
+    listen_fd_ = listen_tcp(bind_address_, port_);
+    if (listen_fd_ < 0) {
+        std::cerr << "Failed to listen for replicas on " << bind_address_ << " port " << port_
+                  << std::endl;
+        return false;
+    }
+
+    sockaddr_storage address{};
+    socklen_t address_size = sizeof(address);
+    const bool bound = ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address),
+                                     &address_size) == 0;
+    if (secret_.empty() && (!bound || !is_loopback(address))) {
+        std::cerr << "Replication on " << bind_address_
+                  << " is reachable from other hosts and needs --replication-secret-file"
+                  << std::endl;
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+        return false;
+    }
+
+    std::cout << "Replication listening on " << format_peer_address(address) << " (epoch "
+              << format_content_hash(change_log_->epoch()) << ")" << std::endl;
+    accept_thread_ = std::jthread([this](std::stop_token stop_token) { accept_loop(stop_token); });
+    return true;
+}
+
+void ReplicationSource::stop() noexcept {
+    if (accept_thread_.joinable()) {
+        accept_thread_.request_stop();
+        accept_thread_.join();
+    }
+
+    std::list<std::unique_ptr<Connection>> connections;
+    {
+        std::lock_guard lock(connections_mutex_);
+        connections.swap(connections_);
+    }
+    for (auto& connection : connections) {
+        connection->thread.request_stop();
+    }
+    change_log_->close();
+    for (auto& connection : connections) {
+        ::shutdown(connection->fd, SHUT_RDWR);
+    }
+    for (auto& connection : connections) {
+        if (connection->thread.joinable()) {
+            connection->thread.join();
+        }
+        ::close(connection->fd);
+    }
+
+    if (listen_fd_ >= 0) {
+        ::close(listen_fd_);
+        listen_fd_ = -1;
+    }
+}
+
+nlohmann::json ReplicationSource::status() const {
+    const auto last_sequence = change_log_->last_sequence();
+
+    auto replicas = nlohmann::json::array();
+    {
+        std::lock_guard lock(connections_mutex_);
+        for (const auto& connection : connections_) {
+            if (connection->finished) {
+                continue;
+            }
+            const auto acknowledged = connection->acknowledged.load();
+            replicas.push_back({{"address", connection->address},
+                                {"acknowledged_sequence", acknowledged},
+                                {"lag_changes", last_sequence - std::min(acknowledged,
+                                                                         last_sequence)}});
+        }
+    }
+
+    return {{"role", "primary"},
+            {"epoch", format_content_hash(change_log_->epoch())},
+            {"sequence", last_sequence},
+            {"replicas", std::move(replicas)}};
+}
+
+void ReplicationSource::accept_loop(std::stop_token stop_token) {
+    while (!stop_token.stop_requested()) {
+        pollfd listener{listen_fd_, POLLIN, 0};
+        if (::poll(&listener, 1, ACCEPT_POLL_INTERVAL_MS) <= 0) {
+            continue;
+        }
+
+        sockaddr_storage address{};
+        socklen_t address_size = sizeof(address);
+        const int fd = ::accept4(listen_fd_, reinterpret_cast<sockaddr*>(&address), &address_size,
+                                 SOCK_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        set_socket_timeout(fd, SOCKET_TIMEOUT);
+
+        std::lock_guard lock(connections_mutex_);
+        for (auto it = connections_.begin(); it != connections_.end();) {
+            if ((*it)->finished) {
+                (*it)->thread.join();
+                ::close((*it)->fd);
+                it = connections_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        connection->address = format_peer_address(address);
+        auto& connection_ref = *connection;
+        connection->thread = std::jthread([this, &connection_ref](std::stop_token token) {
+            serve(connection_ref, token);
+            connection_ref.finished = true;
+        });
+        connections_.push_back(std::move(connection));
+    }
+}
+
+void ReplicationSource::serve(Connection& connection, std::stop_token stop_token) {
+    const auto hello = receive_frame(connection.fd);
+    if (!hello || hello->type != FrameType::Hello) {
+        std::cerr << "Replica " << connection.address << " sent no valid hello" << std::endl;
+        ::shutdown(connection.fd, SHUT_RDWR);
+        return;
+    }
+    if (!secret_.empty() && !secrets_match(hello->filename, secret_)) {
+        std::cerr << "Replica " << connection.address << " sent a wrong replication secret"
+                  << std::endl;
+        ::shutdown(connection.fd, SHUT_RDWR);
+        return;
+    }
+
+    const auto epoch = format_content_hash(change_log_->epoch());
+    auto next_sequence = hello->sequence;
+    std::string buffer;
+    if (hello->key == epoch && change_log_->can_resume_from(next_sequence)) {
+        std::cout << "Replica " << connection.address << " resuming at sequence " << next_sequence
+                  << std::endl;
+        connection.acknowledged = next_sequence - 1;
+        encode_frame(make_control_frame(FrameType::Resume, next_sequence, epoch), buffer);
+        if (!send_all(connection.fd, buffer)) {
+            ::shutdown(connection.fd, SHUT_RDWR);
+            return;
+        }
+    } else {
+        std::cout << "Replica " << connection.address << " needs a snapshot" << std::endl;
+        const auto snapshot_sequence = change_log_->last_sequence();
+        if (!send_snapshot(connection, snapshot_sequence, stop_token)) {
+            ::shutdown(connection.fd, SHUT_RDWR);
+            return;
+        }
+        next_sequence = snapshot_sequence + 1;
+    }
+
+    while (!stop_token.stop_requested()) {
+        if (!read_acks(connection)) {
+            break;
+        }
+
+        const auto records = change_log_->read_from(next_sequence, SEND_BATCH_BYTES);
+        if (!records) {
+            std::cerr << "Replica " << connection.address << " fell behind the replication "
+                      << "backlog at sequence " << next_sequence << ", disconnecting" << std::endl;
+            break;
+        }
+
+        buffer.clear();
+        if (records->empty()) {
+            if (change_log_->wait_for(next_sequence, HEARTBEAT_INTERVAL)) {
+                continue;
+            }
+            encode_frame(make_control_frame(FrameType::Heartbeat, change_log_->last_sequence()),
+                         buffer);
+        } else {
+            for (const auto& record : records.value()) {
+                encode_frame(ReplicationFrame{record.type == ChangeType::Put ? FrameType::Put
+                                                                             : FrameType::Delete,
+                                              record.sequence, record.key, record.filename,
+                                              record.bytes},
+                             buffer);
+            }
+            next_sequence = records->back().sequence + 1;
+        }
+
+        if (!send_all(connection.fd, buffer)) {
+            break;
+        }
+    }
+
+    std::cout << "Replica " << connection.address << " disconnected" << std::endl;
+    ::shutdown(connection.fd, SHUT_RDWR);
+}
+
+bool ReplicationSource::send_snapshot(Connection& connection,
+                                      std::uint64_t snapshot_sequence,
+                                      std::stop_token stop_token) {
+    // Documents read below may already include changes after snapshot_sequence;
+    // replaying those changes afterwards is harmless since puts carry the
+    // whole document and deletes of missing documents are no-ops.
+    const auto epoch = format_content_hash(change_log_->epoch());
+
+    std::string buffer;
+    encode_frame(make_control_frame(FrameType::SnapshotBegin, snapshot_sequence, epoch), buffer);
+
+    std::size_t documents = 0;
+    for (const auto& key : file_manager_.list_keys()) {
+        if (stop_token.stop_requested()) {
+            return false;
+        }
+
+        const auto files = file_manager_.list_files(key);
+        if (!files) {
+            continue;
+        }
+        for (const auto& filename : files.value()) {
+            auto bytes = file_manager_.get_json_bytes(key, filename);
+            if (!bytes) {
+                continue;
+            }
+            encode_frame(ReplicationFrame{FrameType::Put, 0, key, filename,
+                                          std::move(bytes.value())},
+                         buffer);
+            ++documents;
+
+            if (buffer.size() >= SNAPSHOT_FLUSH_BYTES) {
+                if (!send_all(connection.fd, buffer)) {
+                    return false;
+                }
+                buffer.clear();
+            }
+        }
+    }
+
+    encode_frame(make_control_frame(FrameType::SnapshotEnd, snapshot_sequence), buffer);
+    if (!send_all(connection.fd, buffer)) {
+        return false;
+    }
+    std::cout << "Sent snapshot of " << documents << " documents at sequence " << snapshot_sequence
+              << " to replica " << connection.address << std::endl;
+    return true;
+}
+
+bool ReplicationSource::read_acks(Connection& connection) {
+    while (true) {
+        bool closed = false;
+        const auto frame = try_receive_frame(connection.fd, closed);
+        if (closed) {
+            return false;
+        }
+        if (!frame) {
+            return true;
+        }
+        if (frame->type == FrameType::Ack) {
+            connection.acknowledged = frame->sequence;
+        }
+    }
+}
+
+} // namespace simple_data_server
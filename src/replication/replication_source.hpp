@@ -0,0 +1,124 @@
+#ifndef SIMPLE_DATA_SERVER_REPLICATION_REPLICATION_SOURCE_HPP
+#define SIMPLE_DATA_SERVER_REPLICATION_REPLICATION_SOURCE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "replication/change_log.hpp"
+#include "replication/replication_node.hpp"
+
+namespace simple_data_server {
+
+class FileManager;
+
+/**
+ * @brief The primary side of replication: serves the change log to replicas.
+ *
+ * Accepts replica connections on a TCP port, by default of the loopback
+ * address only, and serves them the ChangeLog
+ * that the FileManager's change listener (StorageOptions::change_listener)
+ * appends every put and delete to. Each replica is served by its own thread,
+ * which either resumes from the sequence number the replica asks for or
+ * sends a full snapshot first, and then streams new changes as they are
+ * appended. A replica must present the shared secret in its Hello before it
+ * is sent anything; listening beyond the loopback address requires one.
+ */
+class ReplicationSource : public ReplicationNode {
+public:
+    /**
+     * @brief Construct a ReplicationSource.
+     *
+     * @param file_manager The storage to replicate; must outlive this object.
+     * @param change_log The log the FileManager's change listener appends to.
+     * @param bind_address Local address to listen on, e.g. "127.0.0.1" or "::".
+     * @param port TCP port replicas connect to.
+     * @param secret Secret replicas must send in their Hello; empty to accept
+     *        any replica, which is only allowed on a loopback address.
+     */
+    ReplicationSource(FileManager& file_manager,
+                      std::shared_ptr<ChangeLog> change_log,
+                      std::string bind_address,
+                      std::uint16_t port,
+                      std::string secret);
+
+    /**
+     * @brief Disconnects all replicas.
+     */
+    ~ReplicationSource() override;
+
+    ReplicationSource(const ReplicationSource&) = delete;
+    ReplicationSource& operator=(const ReplicationSource&) = delete;
+
+    /**
+     * @brief Start listening for replicas.
+     *
+     * @return true if the port could be bound, false also if the address is
+     *         not a loopback address and there is no secret.
+     */
+    [[nodiscard]] bool start();
+
+    /**
+     * @brief Stop accepting replicas and close all replica connections.
+     */
+    void stop() noexcept;
+
+    [[nodiscard]] nlohmann::json status() const override;
+
+    [[nodiscard]] bool is_read_only() const noexcept override {
+        return false;
+    }
+
+private:
+    /**
+     * @brief State of one connected replica.
+     */
+    struct Connection {
+        int fd = -1;
+        std::string address;
+        std::atomic<std::uint64_t> acknowledged{0};
+        std::atomic<bool> finished{false};
+        std::jthread thread;
+    };
+
+    void accept_loop(std::stop_token stop_token);
+    void serve(Connection& connection, std::stop_token stop_token);
+
+    /**
+     * @brief Send every stored document as Put frames.
+     *
+     * @param connection The replica.
+     * @param snapshot_sequence The last change the snapshot is known to include.
+     * @param stop_token Aborts the snapshot.
+     * @return true if the whole snapshot was sent.
+     */
+    bool send_snapshot(Connection& connection,
+                       std::uint64_t snapshot_sequence,
+                       std::stop_token stop_token);
+
+    /**
+     * @brief Read Ack frames the replica has sent, without blocking.
+     *
+     * @return false if the connection closed.
+     */
+    bool read_acks(Connection& connection);
+
+    FileManager& file_manager_;
+    std::shared_ptr<ChangeLog> change_log_;
+    std::string bind_address_;
+    std::uint16_t port_;
+    std::string secret_;
+    int listen_fd_ = -1;
+    std::jthread accept_thread_;
+    mutable std::mutex connections_mutex_;
+    std::list<std::unique_ptr<Connection>> connections_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_REPLICATION_REPLICATION_SOURCE_HPP
@@ -0,0 +1,321 @@
+#include "router/backend_client.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <optional>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "util/tcp_socket.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::size_t RECEIVE_BUFFER_SIZE = 16 * 1024;
+constexpr std::size_t MAX_HEADER_SIZE = 16 * 1024;
+constexpr std::size_t MAX_RESPONSE_BODY_SIZE = 64 * 1024 * 1024; // 64MB
+
+bool equals_ignore_case(std::string_view a, std::string_view b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+               return std::tolower(static_cast<unsigned char>(x)) ==
+                      std::tolower(static_cast<unsigned char>(y));
+           });
+}
+
+std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+/**
+ * @brief Buffered reader over a blocking socket.
+ */
+class SocketReader {
+public:
+    explicit SocketReader(int fd) : fd_(fd) {
+    }
+
+    /**
+     * @brief Read more bytes into the buffer.
+     *
+     * @return false on EOF, error or timeout.
+     */
+    bool fill() {
+        char chunk[RECEIVE_BUFFER_SIZE];
+        while (true) {
+            const auto received = ::recv(fd_, chunk, sizeof(chunk), 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                return false;
+            }
+            buffer_.append(chunk, static_cast<std::size_t>(received));
+            return true;
+        }
+    }
+
+    /**
+     * @brief Read up to and including the next CRLF.
+     */
+    bool read_line(std::string& line, std::size_t max_size) {
+        while (true) {
+            const auto end = buffer_.find("\r\n", offset_);
+            if (end != std::string::npos) {
+                line.assign(buffer_, offset_, end - offset_);
+                offset_ = end + 2;
+                return true;
+            }
+            if (buffer_.size() - offset_ > max_size || !fill()) {
+                return false;
+            }
+        }
+    }
+
+    bool read_exact(std::string& out, std::size_t size) {
+        while (buffer_.size() - offset_ < size) {
+            if (!fill()) {
+                return false;
+            }
+        }
+        out.append(buffer_, offset_, size);
+        offset_ += size;
+        compact();
+        return true;
+    }
+
+    void read_to_end(std::string& out, std::size_t max_size) {
+        while (buffer_.size() - offset_ <= max_size && fill()) {
+        }
+        out.append(buffer_, offset_, std::string::npos);
+        offset_ = buffer_.size();
+    }
+
+    [[nodiscard]] bool received_anything() const noexcept {
+        return !buffer_.empty();
+    }
+
+    [[nodiscard]] bool has_unread_bytes() const noexcept {
+        return offset_ < buffer_.size();
+    }
+
+private:
+    void compact() {
+        if (offset_ > RECEIVE_BUFFER_SIZE) {
+            buffer_.erase(0, offset_);
+            offset_ = 0;
+        }
+    }
+
+    int fd_;
+    std::string buffer_;
+    std::size_t offset_ = 0;
+};
+
+std::optional<std::size_t> parse_size(std::string_view text, int base) {
+    std::size_t value = 0;
+    const auto* end = text.data() + text.size();
+    const auto [ptr, ec] = std::from_chars(text.data(), end, value, base);
+    if (ec != std::errc() || ptr == text.data()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+} // namespace
+
+BackendClient::BackendClient(std::string host,
+                             std::uint16_t port,
+                             std::size_t max_idle_connections,
+                             std::chrono::milliseconds timeout)
+    : host_(std::move(host)),
+      port_(port),
+      address_(host_ + ":" + std::to_string(port_)),
+      max_idle_connections_(max_idle_connections),
+      timeout_(timeout) {
+}
+
+BackendClient::~BackendClient() {
+    for (const int fd : idle_connections_) {
+        ::close(fd);
+    }
+}
+
+std::expected<BackendResponse, std::string> BackendClient::post(std::string_view path,
+                                                                std::string_view body,
+                                                                bool repeatable) {
+    std::string request;
+    request.reserve(path.size() + host_.size() + body.size() + 128);
+    request += "POST ";
+    request += path;
+    request += " HTTP/1.1\r\nHost: ";
+    request += address_;
+    request += "\r\nContent-Type: application/json\r\nContent-Length: ";
+    request += std::to_string(body.size());
+    request += "\r\n\r\n";
+    request += body;
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool reused = false;
+        const int fd = acquire_connection(reused);
+        if (fd < 0) {
+            return std::unexpected("cannot connect to " + address_);
+        }
+
+        BackendResponse response;
+        switch (exchange(fd, request, response)) {
+            case Attempt::Complete:
+                release_connection(fd);
+                return response;
+            case Attempt::CompleteAndClose:
+                ::close(fd);
+                return response;
+            case Attempt::FailedToSend:
+                ::close(fd);
+                if (reused) {
+                    continue; // A stale keep-alive connection; retry on a fresh one.
+                }
+                return std::unexpected("cannot send to " + address_);
+            case Attempt::FailedBeforeResponse:
+                ::close(fd);
+                // Most likely also a stale connection, but the backend may
+                // have applied the request before closing it.
+                if (reused && repeatable) {
+                    continue;
+                }
+                return std::unexpected("no response from " + address_);
+            case Attempt::Failed:
+                ::close(fd);
+                return std::unexpected("invalid response from " + address_);
+        }
+    }
+    return std::unexpected("no response from " + address_);
+}
+
+BackendClient::Attempt BackendClient::exchange(int fd,
+                                               std::string_view request,
+                                               BackendResponse& response) {
+    if (!send_all(fd, request)) {
+        return Attempt::FailedToSend;
+    }
+
+    SocketReader reader(fd);
+    std::string line;
+    if (!reader.read_line(line, MAX_HEADER_SIZE)) {
+        return reader.received_anything() ? Attempt::Failed : Attempt::FailedBeforeResponse;
+    }
+
+    // Status line: "HTTP/1.1 200 OK".
+    const auto space = line.find(' ');
+    if (!line.starts_with("HTTP/1.") || space == std::string::npos) {
+        return Attempt::Failed;
+    }
+    response.status = line.substr(space + 1);
+
+    std::optional<std::size_t> content_length;
+    bool chunked = false;
+    bool close_connection = line.starts_with("HTTP/1.0");
+    std::size_t header_bytes = line.size();
+    while (true) {
+        if (!reader.read_line(line, MAX_HEADER_SIZE)) {
+            return Attempt::Failed;
+        }
+        if (line.empty()) {
+            break;
+        }
+        header_bytes += line.size();
+        if (header_bytes > MAX_HEADER_SIZE) {
+            return Attempt::Failed;
+        }
+
+        const auto colon = line.find(':');
+        if (colon == std::string::npos) {
+            return Attempt::Failed;
+        }
+        const auto name = std::string_view(line).substr(0, colon);
+        const auto value = trim(std::string_view(line).substr(colon + 1));
+        if (equals_ignore_case(name, "Content-Length")) {
+            content_length = parse_size(value, 10);
+            if (!content_length || content_length.value() > MAX_RESPONSE_BODY_SIZE) {
+                return Attempt::Failed;
+            }
+        } else if (equals_ignore_case(name, "Transfer-Encoding")) {
+            chunked = equals_ignore_case(value, "chunked");
+        } else if (equals_ignore_case(name, "Content-Type")) {
+            response.content_type = value;
+        } else if (equals_ignore_case(name, "Connection")) {
+            close_connection = equals_ignore_case(value, "close");
+        }
+    }
+
+    if (chunked) {
+        while (true) {
+            if (!reader.read_line(line, MAX_HEADER_SIZE)) {
+                return Attempt::Failed;
+            }
+            const auto size = parse_size(trim(std::string_view(line).substr(0, line.find(';'))), 16);
+            if (!size || response.body.size() + size.value() > MAX_RESPONSE_BODY_SIZE) {
+                return Attempt::Failed;
+            }
+            if (size.value() == 0) {
+                // Skip trailers up to the final empty line.
+                do {
+                    if (!reader.read_line(line, MAX_HEADER_SIZE)) {
+                        return Attempt::Failed;
+                    }
+                } while (!line.empty());
+                break;
+            }
+            if (!reader.read_exact(response.body, size.value()) ||
+                !reader.read_line(line, MAX_HEADER_SIZE) || !line.empty()) {
+                return Attempt::Failed;
+            }
+        }
+    } else if (content_length) {
+        if (!reader.read_exact(response.body, content_length.value())) {
+            return Attempt::Failed;
+        }
+    } else {
+        reader.read_to_end(response.body, MAX_RESPONSE_BODY_SIZE);
+        return Attempt::CompleteAndClose;
+    }
+
+    // Requests are not pipelined, so extra bytes mean the stream is out of sync.
+    return close_connection || reader.has_unread_bytes() ? Attempt::CompleteAndClose
+                                                         : Attempt::Complete;
+}
+
+int BackendClient::acquire_connection(bool& reused) {
+    {
+        std::lock_guard lock(mutex_);
+        if (!idle_connections_.empty()) {
+            const int fd = idle_connections_.back();
+            idle_connections_.pop_back();
+            reused = true;
+            return fd;
+        }
+    }
+    reused = false;
+    return connect_tcp(host_, port_, timeout_);
+}
+
+void BackendClient::release_connection(int fd) {
+    {
+        std::lock_guard lock(mutex_);
+        if (idle_connections_.size() < max_idle_connections_) {
+            idle_connections_.push_back(fd);
+            return;
+        }
+    }
+    ::close(fd);
+}
+
+} // namespace simple_data_server
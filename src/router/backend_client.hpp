@@ -0,0 +1,116 @@
+#ifndef SIMPLE_DATA_SERVER_ROUTER_BACKEND_CLIENT_HPP
+#define SIMPLE_DATA_SERVER_ROUTER_BACKEND_CLIENT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected.hpp>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simple_data_server {
+
+/**
+ * @brief A backend's reply to a forwarded request.
+ */
+struct BackendResponse {
+    /**
+     * @brief The status as sent by the backend, e.g. "200 OK".
+     */
+    std::string status;
+
+    std::string content_type;
+    std::string body;
+};
+
+/**
+ * @brief Forwards HTTP requests to one backend over pooled keep-alive connections.
+ *
+ * A blocking client intended to be called from worker threads. Idle
+ * connections are kept for reuse; a request that fails on a reused
+ * connection before any response byte arrives (the backend may have closed
+ * it) is retried once on a new connection.
+ */
+class BackendClient {
+public:
+    /**
+     * @brief Construct a BackendClient.
+     *
+     * @param host The backend's host name or address.
+     * @param port The backend's HTTP port.
+     * @param max_idle_connections Idle connections kept open for reuse.
+     * @param timeout Connect, send and receive timeout.
+     */
+    BackendClient(std::string host,
+                  std::uint16_t port,
+                  std::size_t max_idle_connections,
+                  std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Closes all idle connections.
+     */
+    ~BackendClient();
+
+    BackendClient(const BackendClient&) = delete;
+    BackendClient& operator=(const BackendClient&) = delete;
+
+    /**
+     * @brief Send a POST request and wait for the response.
+     *
+     * Thread-safe. A request that cannot be sent on a reused keep-alive
+     * connection is retried once on a fresh one. A request that was sent but
+     * got no response may already have been applied, so it is retried only
+     * if it is repeatable.
+     *
+     * @param path The request path, e.g. "/api/get".
+     * @param body The request body, forwarded unchanged.
+     * @param repeatable Applying the request twice has the same effect as once.
+     * @return std::expected<BackendResponse, std::string> The response, or a
+     *         description of the failure.
+     */
+    [[nodiscard]] std::expected<BackendResponse, std::string> post(std::string_view path,
+                                                                   std::string_view body,
+                                                                   bool repeatable = true);
+
+    /**
+     * @brief Get the backend's address as "host:port".
+     *
+     * @return const std::string& The address.
+     */
+    [[nodiscard]] const std::string& address() const noexcept {
+        return address_;
+    }
+
+private:
+    /**
+     * @brief Outcome of one attempt on one connection.
+     */
+    enum class Attempt {
+        Complete,
+        CompleteAndClose,
+        /** The request could not be sent; the backend has not seen it. */
+        FailedToSend,
+        /** The request was sent, but the connection closed before any response byte. */
+        FailedBeforeResponse,
+        Failed
+    };
+
+    Attempt exchange(int fd, std::string_view request, BackendResponse& response);
+    [[nodiscard]] int acquire_connection(bool& reused);
+    void release_connection(int fd);
+
+    std::string host_;
+    std::uint16_t port_;
+    std::string address_;
+    std::size_t max_idle_connections_;
+    std::chrono::milliseconds timeout_;
+
+    std::mutex mutex_;
+    std::vector<int> idle_connections_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_ROUTER_BACKEND_CLIENT_HPP
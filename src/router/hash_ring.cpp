@@ -0,0 +1,64 @@
+#include "router/hash_ring.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+#include "storage/content_hash.hpp"
+
+namespace simple_data_server {
+
+HashRing::HashRing(unsigned virtual_nodes) : virtual_nodes_(std::max(virtual_nodes, 1U)) {
+}
+
+void HashRing::add_node(std::string_view name) {
+    if (std::find(nodes_.begin(), nodes_.end(), name) != nodes_.end()) {
+        return;
+    }
+    nodes_.emplace_back(name);
+    rebuild();
+}
+
+bool HashRing::remove_node(std::string_view name) {
+    const auto it = std::find(nodes_.begin(), nodes_.end(), name);
+    if (it == nodes_.end()) {
+        return false;
+    }
+    nodes_.erase(it);
+    rebuild();
+    return true;
+}
+
+const std::string& HashRing::node_for(std::string_view key) const {
+    const auto hash = content_hash(key);
+    auto it = std::lower_bound(points_.begin(), points_.end(), hash,
+                               [](const Point& point, std::uint64_t value) {
+                                   return point.hash < value;
+                               });
+    if (it == points_.end()) {
+        it = points_.begin();
+    }
+    return nodes_[it->node];
+}
+
+void HashRing::rebuild() {
+    points_.clear();
+    points_.reserve(nodes_.size() * virtual_nodes_);
+
+    std::string point_name;
+    for (std::size_t node = 0; node < nodes_.size(); ++node) {
+        for (unsigned i = 0; i < virtual_nodes_; ++i) {
+            point_name = nodes_[node];
+            point_name += '#';
+            point_name += std::to_string(i);
+            points_.push_back(Point{content_hash(point_name), node});
+        }
+    }
+
+    // Break (unlikely) hash ties by name so the layout does not depend on the
+    // order nodes were added in.
+    std::sort(points_.begin(), points_.end(), [this](const Point& a, const Point& b) {
+        return std::tie(a.hash, nodes_[a.node]) < std::tie(b.hash, nodes_[b.node]);
+    });
+}
+
+} // namespace simple_data_server
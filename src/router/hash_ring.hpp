@@ -0,0 +1,83 @@
+#ifndef SIMPLE_DATA_SERVER_ROUTER_HASH_RING_HPP
+#define SIMPLE_DATA_SERVER_ROUTER_HASH_RING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simple_data_server {
+
+/**
+ * @brief A consistent-hash ring mapping keys to named nodes.
+ *
+ * Each node is placed on the ring at virtual_nodes points, hashed from its
+ * name, and a key belongs to the first point at or after the key's hash.
+ * Adding a node therefore only moves the keys that now fall on its points,
+ * about 1/N of them, and removing one only moves that node's keys. The
+ * layout depends only on the set of node names, so every router configured
+ * with the same nodes routes identically.
+ */
+class HashRing {
+public:
+    /**
+     * @brief Construct an empty ring.
+     *
+     * @param virtual_nodes Points per node; more points spread keys more evenly.
+     */
+    explicit HashRing(unsigned virtual_nodes);
+
+    /**
+     * @brief Add a node; adding an existing node has no effect.
+     *
+     * @param name The node name, e.g. "host:port".
+     */
+    void add_node(std::string_view name);
+
+    /**
+     * @brief Remove a node.
+     *
+     * @param name The node name.
+     * @return true if the node was on the ring.
+     */
+    bool remove_node(std::string_view name);
+
+    /**
+     * @brief Find the node owning a key.
+     *
+     * @param key The key.
+     * @return const std::string& The node name.
+     * @pre The ring must not be empty.
+     */
+    [[nodiscard]] const std::string& node_for(std::string_view key) const;
+
+    /**
+     * @brief Get the names of all nodes, in the order they were added.
+     *
+     * @return const std::vector<std::string>& The node names.
+     */
+    [[nodiscard]] const std::vector<std::string>& nodes() const noexcept {
+        return nodes_;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return nodes_.empty();
+    }
+
+private:
+    struct Point {
+        std::uint64_t hash;
+        std::size_t node;
+    };
+
+    void rebuild();
+
+    unsigned virtual_nodes_;
+    std::vector<std::string> nodes_;
+    std::vector<Point> points_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_ROUTER_HASH_RING_HPP
@@ -0,0 +1,195 @@
+#include "router/key_scanner.hpp"
+
+#include <cstddef>
+
+#include "json/json_validator.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::size_t MAX_NESTING_DEPTH = 512;
+
+bool is_whitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+class Scanner {
+public:
+    explicit Scanner(std::string_view text) : text_(text) {
+    }
+
+    void skip_whitespace() {
+        while (pos_ < text_.size() && is_whitespace(text_[pos_])) {
+            ++pos_;
+        }
+    }
+
+    bool consume(char c) {
+        skip_whitespace();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            ++pos_;
+            return true;
+        }
+        return false;
+    }
+
+    [[nodiscard]] bool peek(char c) {
+        skip_whitespace();
+        return pos_ < text_.size() && text_[pos_] == c;
+    }
+
+    /**
+     * @brief Scan a string starting at its opening quote.
+     *
+     * @param raw Set to the characters between the quotes, still escaped.
+     * @param escaped Set to whether raw contains escape sequences.
+     */
+    bool scan_string(std::string_view& raw, bool& escaped) {
+        if (!consume('"')) {
+            return false;
+        }
+        const auto start = pos_;
+        escaped = false;
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_];
+            if (c == '"') {
+                raw = text_.substr(start, pos_ - start);
+                ++pos_;
+                return true;
+            }
+            if (c == '\\') {
+                escaped = true;
+                pos_ += 2;
+                continue;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return false;
+            }
+            ++pos_;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Skip one value of any type.
+     */
+    bool skip_value() {
+        skip_whitespace();
+        if (pos_ >= text_.size()) {
+            return false;
+        }
+
+        const char c = text_[pos_];
+        if (c == '"') {
+            std::string_view raw;
+            bool escaped;
+            return scan_string(raw, escaped);
+        }
+        if (c == '{' || c == '[') {
+            return skip_container();
+        }
+
+        // Number or literal: everything up to the next delimiter.
+        const auto start = pos_;
+        while (pos_ < text_.size() && !is_whitespace(text_[pos_]) && text_[pos_] != ',' &&
+               text_[pos_] != '}' && text_[pos_] != ']') {
+            ++pos_;
+        }
+        return pos_ > start;
+    }
+
+    [[nodiscard]] bool at_end() {
+        skip_whitespace();
+        return pos_ == text_.size();
+    }
+
+private:
+    bool skip_container() {
+        std::size_t depth = 0;
+        while (pos_ < text_.size()) {
+            const char c = text_[pos_];
+            if (c == '"') {
+                std::string_view raw;
+                bool escaped;
+                if (!scan_string(raw, escaped)) {
+                    return false;
+                }
+                continue;
+            }
+            ++pos_;
+            if (c == '{' || c == '[') {
+                if (++depth > MAX_NESTING_DEPTH) {
+                    return false;
+                }
+            } else if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    std::string_view text_;
+    std::size_t pos_ = 0;
+};
+
+} // namespace
+
+std::optional<std::string> scan_string_member(std::string_view json, std::string_view name) {
+    Scanner scanner(json);
+    if (!scanner.consume('{')) {
+        return std::nullopt;
+    }
+
+    std::optional<std::string> result;
+    bool found_non_string = false;
+    if (!scanner.consume('}')) {
+        do {
+            std::string_view member;
+            bool member_escaped;
+            if (!scanner.peek('"') || !scanner.scan_string(member, member_escaped) ||
+                !scanner.consume(':')) {
+                return std::nullopt;
+            }
+
+            bool matches = !member_escaped && member == name;
+            if (member_escaped) {
+                const auto unescaped = unescape_json_string(member);
+                matches = unescaped && unescaped.value() == name;
+            }
+
+            if (matches && scanner.peek('"')) {
+                std::string_view value;
+                bool value_escaped;
+                if (!scanner.scan_string(value, value_escaped)) {
+                    return std::nullopt;
+                }
+                result = value_escaped ? unescape_json_string(value) : std::string(value);
+                if (!result) {
+                    return std::nullopt;
+                }
+                found_non_string = false;
+            } else {
+                if (!scanner.skip_value()) {
+                    return std::nullopt;
+                }
+                if (matches) {
+                    found_non_string = true;
+                }
+            }
+        } while (scanner.consume(','));
+
+        if (!scanner.consume('}')) {
+            return std::nullopt;
+        }
+    }
+
+    if (!scanner.at_end() || found_non_string) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,30 @@
+#ifndef SIMPLE_DATA_SERVER_ROUTER_KEY_SCANNER_HPP
+#define SIMPLE_DATA_SERVER_ROUTER_KEY_SCANNER_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace simple_data_server {
+
+/**
+ * @brief Extract a top-level string member from a JSON object without building a DOM.
+ *
+ * Scans the object's members once, skipping over the values of other
+ * members (including nested objects, arrays and strings) without copying or
+ * allocating, and unescapes only the requested member's value. As with a
+ * full parse, the last occurrence of a duplicated member wins. Input that is
+ * not a well-formed object up to the end of its top level is rejected, but
+ * skipped values are only checked for balanced nesting and string syntax.
+ *
+ * @param json The JSON text.
+ * @param name The member name, e.g. "key".
+ * @return std::optional<std::string> The unescaped value, or std::nullopt if
+ *         the member is missing, is not a string, or the input is malformed.
+ */
+[[nodiscard]] std::optional<std::string> scan_string_member(std::string_view json,
+                                                            std::string_view name);
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_ROUTER_KEY_SCANNER_HPP
@@ -0,0 +1,211 @@
+#include "router/router_server.hpp"
+
+#include <App.h>
+
+#include "router/key_scanner.hpp"
+#include "server/data_server.hpp"
+#include "util/thread_pool.hpp"
+
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr int SHUTDOWN_POLL_INTERVAL_MS = 200;
+constexpr std::chrono::milliseconds BACKEND_TIMEOUT{10000};
+constexpr std::string_view MISSING_KEY_MESSAGE = "Missing or invalid 'key' field";
+
+volatile std::sig_atomic_t shutdown_signal = 0;
+
+void handle_shutdown_signal(int signal) {
+    shutdown_signal = signal;
+}
+
+/**
+ * @brief State reachable from the shutdown timer's C callback.
+ */
+struct ShutdownContext {
+    RouterServer* server;
+    uWS::App* app;
+};
+
+void poll_shutdown(us_timer_t* timer) {
+    if (shutdown_signal == 0) {
+        return;
+    }
+
+    ShutdownContext context;
+    std::memcpy(&context, us_timer_ext(timer), sizeof(context));
+
+    std::cout << "Received signal " << shutdown_signal << ", shutting down" << std::endl;
+    context.server->stop();
+    context.app->close();
+    us_timer_close(timer);
+}
+
+template <typename Response>
+void send_status(Response* res, std::string_view status, const nlohmann::json& body) {
+    res->writeStatus(status)->writeHeader("Content-Type", "application/json")->end(body.dump());
+}
+
+/**
+ * @brief Register a POST route that buffers the body and hands it to a handler.
+ *
+ * @param app The uWS application.
+ * @param pattern The URL pattern.
+ * @param handle Callable taking the response, the abort flag and the body.
+ */
+template <typename Handle>
+void register_buffered_route(uWS::App& app, std::string pattern, Handle handle) {
+    app.post(std::move(pattern), [handle](auto* res, auto* /*req*/) {
+        auto body_buffer = std::make_shared<std::string>();
+        auto aborted = std::make_shared<bool>(false);
+
+        res->onData([res, body_buffer, aborted, handle](std::string_view chunk, bool is_last) {
+            if (body_buffer->size() > MAX_REQUEST_SIZE) {
+                return;
+            }
+
+            body_buffer->append(chunk.data(), chunk.length());
+
+            if (body_buffer->size() > MAX_REQUEST_SIZE) {
+                send_status(res, "413 Payload Too Large", {{"error", "Request body too large"}});
+                return;
+            }
+
+            if (is_last) {
+                handle(res, aborted, std::move(*body_buffer));
+            }
+        });
+
+        res->onAborted([aborted] {
+            *aborted = true;
+            std::cerr << "Request aborted" << std::endl;
+        });
+    });
+}
+
+} // namespace
+
+RouterServer::RouterServer(std::uint16_t port, const RouterOptions& options)
+    : port_(port),
+      threads_(options.threads),
+      ring_(options.virtual_nodes),
+      listen_socket_(nullptr) {
+    for (const auto& backend : options.backends) {
+        auto client = std::make_unique<BackendClient>(backend.host, backend.port, threads_,
+                                                      BACKEND_TIMEOUT);
+        const auto address = client->address();
+        ring_.add_node(address);
+        backends_.try_emplace(address, std::move(client));
+    }
+}
+
+BackendClient& RouterServer::backend_for(std::string_view key) {
+    return *backends_.at(ring_.node_for(key));
+}
+
+bool RouterServer::start() noexcept {
+    uWS::App app;
+    ThreadPool forward_pool(threads_);
+
+    const auto forward = [this, &forward_pool](std::string path) {
+        return [this, &forward_pool, path = std::move(path)](auto* res,
+                                                             std::shared_ptr<bool> aborted,
+                                                             std::string body) {
+            const auto key = scan_string_member(body, "key");
+            if (!key) {
+                send_status(res, "400 Bad Request", {{"status", MISSING_KEY_MESSAGE}});
+                return;
+            }
+
+            // A conditional put applied before a lost response would fail
+            // its version check if sent again.
+            const bool repeatable =
+                path != "/api/put" || !scan_string_member(body, "if_version").has_value();
+            auto* backend = &backend_for(key.value());
+            auto* loop = uWS::Loop::get();
+            forward_pool.submit([res, aborted, backend, loop, path, repeatable,
+                                 body = std::move(body)] {
+                auto response = backend->post(path, body, repeatable);
+                loop->defer([res, aborted, response = std::move(response)] {
+                    if (*aborted) {
+                        return;
+                    }
+                    if (!response) {
+                        std::cerr << "Forwarding failed: " << response.error() << std::endl;
+                        send_status(res, "502 Bad Gateway", {{"status", response.error()}});
+                        return;
+                    }
+                    res->cork([&] {
+                        res->writeStatus(response->status);
+                        if (!response->content_type.empty()) {
+                            res->writeHeader("Content-Type", response->content_type);
+                        }
+                        res->end(response->body);
+                    });
+                });
+            });
+        };
+    };
+
+    for (const auto* path : {"/api/put", "/api/get", "/api/list", "/api/stats", "/api/index",
+                             "/api/aggregate", "/api/search"}) {
+        register_buffered_route(app, path, forward(path));
+    }
+
+    register_buffered_route(app, "/api/route", [this](auto* res, auto /*aborted*/,
+                                                      std::string body) {
+        const auto key = scan_string_member(body, "key");
+        if (!key) {
+            send_status(res, "400 Bad Request", {{"status", MISSING_KEY_MESSAGE}});
+            return;
+        }
+        send_status(res, "200 OK",
+                    {{"status", "success"}, {"backend", backend_for(key.value()).address()}});
+    });
+
+    app.get("/*", [](auto* res, auto* /*req*/) {
+        send_status(res, "404 Not Found", {{"error", "Not found"}});
+    });
+
+    bool success = false;
+    app.listen(port_, [this, &success](auto* listen_socket) {
+        if (listen_socket) {
+            listen_socket_ = listen_socket;
+            success = true;
+            std::cout << "Router listening on port " << port_ << std::endl;
+        } else {
+            std::cerr << "Failed to listen on port " << port_ << std::endl;
+        }
+    });
+
+    if (!success) {
+        return false;
+    }
+
+    std::signal(SIGINT, handle_shutdown_signal);
+    std::signal(SIGTERM, handle_shutdown_signal);
+    auto* loop = reinterpret_cast<us_loop_t*>(uWS::Loop::get());
+    auto* shutdown_timer = us_create_timer(loop, 0, sizeof(ShutdownContext));
+    const ShutdownContext context{this, &app};
+    std::memcpy(us_timer_ext(shutdown_timer), &context, sizeof(context));
+    us_timer_set(shutdown_timer, poll_shutdown, SHUTDOWN_POLL_INTERVAL_MS,
+                 SHUTDOWN_POLL_INTERVAL_MS);
+
+    app.run();
+    return true;
+}
+
+void RouterServer::stop() noexcept {
+    if (listen_socket_) {
+        us_listen_socket_close(0, static_cast<us_listen_socket_t*>(listen_socket_));
+        listen_socket_ = nullptr;
+    }
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,98 @@
+#ifndef SIMPLE_DATA_SERVER_ROUTER_ROUTER_SERVER_HPP
+#define SIMPLE_DATA_SERVER_ROUTER_ROUTER_SERVER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "router/backend_client.hpp"
+#include "router/hash_ring.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Address of one backend server.
+ */
+struct BackendAddress {
+    std::string host;
+    std::uint16_t port = 0;
+};
+
+/**
+ * @brief Configuration of router mode.
+ */
+struct RouterOptions {
+    /**
+     * @brief The backends to shard keys across.
+     */
+    std::vector<BackendAddress> backends;
+
+    /**
+     * @brief Points per backend on the hash ring.
+     */
+    unsigned virtual_nodes = 160;
+
+    /**
+     * @brief Worker threads forwarding requests; also the idle connections kept per backend.
+     */
+    unsigned threads = 32;
+};
+
+/**
+ * @brief HTTP front end that shards keys across several SimpleDataServer instances.
+ *
+ * Accepts the same /api/put, /api/get, /api/list, /api/stats, /api/index,
+ * /api/aggregate and /api/search requests as a DataServer, extracts "key"
+ * with a scanner instead of parsing the body, and forwards the unmodified
+ * body to the backend owning the key on a consistent-hash ring. Forwarding
+ * runs on a worker pool over pooled keep-alive connections and the
+ * backend's status and body are relayed unchanged. /api/route reports the
+ * owning backend, so that streaming export, import and query can be sent
+ * to it directly.
+ */
+class RouterServer {
+public:
+    /**
+     * @brief Construct a RouterServer.
+     *
+     * @param port The port number to listen on.
+     * @param options The backends and ring configuration.
+     * @pre options.backends must not be empty.
+     */
+    RouterServer(std::uint16_t port, const RouterOptions& options);
+
+    /**
+     * @brief Start the router and begin listening for connections.
+     *
+     * Blocks running the event loop until SIGINT or SIGTERM is received.
+     *
+     * @return true if the router started and shut down cleanly, false otherwise.
+     */
+    [[nodiscard]] bool start() noexcept;
+
+    /**
+     * @brief Stop accepting connections.
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief Find the backend owning a key.
+     *
+     * @param key The key.
+     * @return BackendClient& The backend's client.
+     */
+    [[nodiscard]] BackendClient& backend_for(std::string_view key);
+
+private:
+    std::uint16_t port_;
+    unsigned threads_;
+    HashRing ring_;
+    std::unordered_map<std::string, std::unique_ptr<BackendClient>> backends_;
+    void* listen_socket_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_ROUTER_ROUTER_SERVER_HPP
@@ -0,0 +1,345 @@
+#include "server/access_log.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace simple_data_server {
+
+namespace {
+
+static_assert((AccessLog::RING_CAPACITY & (AccessLog::RING_CAPACITY - 1)) == 0,
+              "RING_CAPACITY must be a power of two");
+
+constexpr std::size_t RING_MASK = AccessLog::RING_CAPACITY - 1;
+constexpr std::size_t CACHE_LINE = 64;
+constexpr std::size_t MAX_ROUTE_LENGTH = 39;
+constexpr std::uint8_t ABORTED = 1;
+constexpr std::uint8_t HAS_ERROR = 2;
+
+#ifdef IOV_MAX
+constexpr std::size_t MAX_IOVECS = IOV_MAX;
+#else
+constexpr std::size_t MAX_IOVECS = 1024;
+#endif
+
+std::uint32_t saturate(std::uint64_t value) {
+    return static_cast<std::uint32_t>(std::min<std::uint64_t>(value, UINT32_MAX));
+}
+
+std::int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+template <typename Integer>
+void append_integer(std::string& out, Integer value) {
+    char buffer[24];
+    const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, error == std::errc() ? end : buffer);
+}
+
+/**
+ * @brief Write every byte of the buffers, retrying after partial writes.
+ *
+ * A failed write only loses the rest of the batch.
+ */
+void write_all(int fd, std::vector<iovec>& buffers) {
+    std::size_t first = 0;
+    while (first < buffers.size()) {
+        const auto count = std::min(buffers.size() - first, MAX_IOVECS);
+        const auto written = ::writev(fd, buffers.data() + first, static_cast<int>(count));
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        auto remaining = static_cast<std::size_t>(written);
+        while (first < buffers.size() && remaining >= buffers[first].iov_len) {
+            remaining -= buffers[first].iov_len;
+            ++first;
+        }
+        if (remaining > 0) {
+            buffers[first].iov_base = static_cast<char*>(buffers[first].iov_base) + remaining;
+            buffers[first].iov_len -= remaining;
+        }
+    }
+}
+
+} // namespace
+
+/**
+ * @brief One request as queued for the writer; a cache line, so a push touches one.
+ */
+struct AccessLog::Record {
+    std::int64_t timestamp_ms;
+    std::uint32_t duration_us;
+    std::uint32_t bytes_in;
+    std::uint32_t bytes_out;
+    std::uint16_t status;
+    std::uint8_t flags;
+    std::uint8_t file_error;
+    std::uint8_t route_length;
+    /** Route labels are the server's own patterns, so they need no JSON escaping. */
+    char route[MAX_ROUTE_LENGTH];
+};
+
+/**
+ * @brief Single-producer, single-consumer ring of records.
+ *
+ * head and tail count records ever pushed and popped; they sit on separate
+ * cache lines so the producer and the writer do not contend for one.
+ */
+struct AccessLog::Ring {
+    /** Written by the producing thread only. */
+    alignas(CACHE_LINE) std::atomic<std::size_t> head{0};
+    /** The producer's last view of tail; refreshed only when the ring looks full. */
+    std::size_t cached_tail = 0;
+    /** Records dropped because the ring was full; written by the producer only. */
+    std::atomic<std::uint64_t> dropped{0};
+
+    /** Written by the writer thread only. */
+    alignas(CACHE_LINE) std::atomic<std::size_t> tail{0};
+
+    alignas(CACHE_LINE) std::array<Record, RING_CAPACITY> records;
+
+    static_assert(sizeof(Record) == CACHE_LINE);
+};
+
+/**
+ * @brief Every ring handed out, and those whose threads have exited.
+ *
+ * Rings are never freed before the log, so the writer can drain a ring
+ * whose thread is gone and the next new thread can take it over.
+ */
+struct AccessLog::Rings {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Ring>> all;
+    std::vector<Ring*> free;
+};
+
+/**
+ * @brief Holds the calling thread's ring and returns it when the thread exits.
+ *
+ * The lease keeps the ring set alive, so a thread outliving the log still
+ * returns its ring safely.
+ */
+class AccessLog::RingLease {
+public:
+    RingLease() = default;
+
+    ~RingLease() {
+        release();
+    }
+
+    RingLease(const RingLease&) = delete;
+    RingLease& operator=(const RingLease&) = delete;
+
+    /**
+     * @brief Get this thread's ring in the given set, taking one on first use.
+     *
+     * @throws std::bad_alloc if a new ring cannot be allocated.
+     */
+    Ring& ring(const std::shared_ptr<Rings>& rings) {
+        if (rings_ != rings) {
+            release();
+            std::lock_guard lock(rings->mutex);
+            if (!rings->free.empty()) {
+                ring_ = rings->free.back();
+                rings->free.pop_back();
+            } else {
+                ring_ = rings->all.emplace_back(std::make_unique<Ring>()).get();
+            }
+            rings_ = rings;
+        }
+        return *ring_;
+    }
+
+private:
+    void release() noexcept {
+        if (rings_) {
+            std::lock_guard lock(rings_->mutex);
+            rings_->free.push_back(ring_);
+        }
+        rings_.reset();
+        ring_ = nullptr;
+    }
+
+    std::shared_ptr<Rings> rings_;
+    Ring* ring_ = nullptr;
+};
+
+AccessLog::AccessLog(const std::string& path)
+    : fd_(STDERR_FILENO), owns_fd_(false), rings_(std::make_shared<Rings>()) {
+    if (path != "-") {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(),
+                                    "Cannot open access log " + path);
+        }
+        owns_fd_ = true;
+    }
+    writer_ = std::thread([this] { run(); });
+}
+
+AccessLog::~AccessLog() {
+    {
+        std::lock_guard lock(stop_mutex_);
+        stopping_ = true;
+    }
+    stop_condition_.notify_one();
+    writer_.join();
+    if (owns_fd_) {
+        ::close(fd_);
+    }
+}
+
+void AccessLog::record(std::string_view route,
+                       const RequestSample& sample,
+                       std::chrono::nanoseconds duration) noexcept {
+    Record record{};
+    record.timestamp_ms = now_ms();
+    record.duration_us = saturate(static_cast<std::uint64_t>(std::max<std::int64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), 0)));
+    record.bytes_in = saturate(sample.bytes_in);
+    record.bytes_out = saturate(sample.bytes_out);
+    record.status = static_cast<std::uint16_t>(sample.status);
+    record.flags = sample.file_error ? HAS_ERROR : 0;
+    record.file_error = static_cast<std::uint8_t>(sample.file_error.value_or(FileError{}));
+    record.route_length = static_cast<std::uint8_t>(std::min(route.size(), MAX_ROUTE_LENGTH));
+    std::memcpy(record.route, route.data(), record.route_length);
+    push(record);
+}
+
+void AccessLog::record_aborted(std::string_view route) noexcept {
+    Record record{};
+    record.timestamp_ms = now_ms();
+    record.flags = ABORTED;
+    record.route_length = static_cast<std::uint8_t>(std::min(route.size(), MAX_ROUTE_LENGTH));
+    std::memcpy(record.route, route.data(), record.route_length);
+    push(record);
+}
+
+void AccessLog::push(const Record& record) noexcept {
+    Ring* ring;
+    try {
+        thread_local RingLease lease;
+        ring = &lease.ring(rings_);
+    } catch (const std::exception&) {
+        // Without a ring there is nowhere to count the drop either.
+        return;
+    }
+
+    const auto head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->cached_tail == RING_CAPACITY) {
+        ring->cached_tail = ring->tail.load(std::memory_order_acquire);
+        if (head - ring->cached_tail == RING_CAPACITY) {
+            ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_relaxed);
+            return;
+        }
+    }
+    ring->records[head & RING_MASK] = record;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void AccessLog::run() {
+    for (;;) {
+        bool stopping;
+        {
+            std::unique_lock lock(stop_mutex_);
+            stop_condition_.wait_for(lock, FLUSH_INTERVAL, [this] { return stopping_; });
+            stopping = stopping_;
+        }
+        try {
+            flush();
+        } catch (const std::exception&) {
+            // The records stay in their rings for the next flush.
+        }
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void AccessLog::flush() {
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard lock(rings_->mutex);
+        rings.reserve(rings_->all.size());
+        for (const auto& ring : rings_->all) {
+            rings.push_back(ring.get());
+        }
+    }
+    buffers_.resize(rings.size() + 1);
+
+    std::uint64_t dropped = 0;
+    for (std::size_t i = 0; i < rings.size(); ++i) {
+        auto& ring = *rings[i];
+        auto& out = buffers_[i];
+        out.clear();
+        const auto head = ring.head.load(std::memory_order_acquire);
+        auto tail = ring.tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail) {
+            const auto& record = ring.records[tail & RING_MASK];
+            out += "{\"timestamp_ms\":";
+            append_integer(out, record.timestamp_ms);
+            out += ",\"route\":\"";
+            out.append(record.route, record.route_length);
+            if ((record.flags & ABORTED) != 0) {
+                out += "\",\"aborted\":true}\n";
+                continue;
+            }
+            out += "\",\"status\":";
+            append_integer(out, record.status);
+            out += ",\"duration_us\":";
+            append_integer(out, record.duration_us);
+            out += ",\"bytes_in\":";
+            append_integer(out, record.bytes_in);
+            out += ",\"bytes_out\":";
+            append_integer(out, record.bytes_out);
+            if ((record.flags & HAS_ERROR) != 0) {
+                out += ",\"error\":\"";
+                out += file_error_name(static_cast<FileError>(record.file_error));
+                out += '"';
+            }
+            out += "}\n";
+        }
+        // The records are copied out, so the producer may reuse their slots.
+        ring.tail.store(tail, std::memory_order_release);
+        dropped += ring.dropped.load(std::memory_order_relaxed);
+    }
+
+    auto& notice = buffers_.back();
+    notice.clear();
+    if (dropped > reported_drops_) {
+        const auto newly_dropped = dropped - reported_drops_;
+        reported_drops_ = dropped;
+        Metrics::instance().access_log_dropped(newly_dropped);
+        notice += "{\"timestamp_ms\":";
+        append_integer(notice, now_ms());
+        notice += ",\"dropped\":";
+        append_integer(notice, newly_dropped);
+        notice += "}\n";
+    }
+
+    std::vector<iovec> iovecs;
+    for (auto& buffer : buffers_) {
+        if (!buffer.empty()) {
+            iovecs.push_back(iovec{buffer.data(), buffer.size()});
+        }
+    }
+    write_all(fd_, iovecs);
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,111 @@
+#ifndef SIMPLE_DATA_SERVER_SERVER_ACCESS_LOG_HPP
+#define SIMPLE_DATA_SERVER_SERVER_ACCESS_LOG_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "server/metrics.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Writes every request as one JSON line, without ever blocking the request.
+ *
+ * Each thread that logs gets its own single-producer, single-consumer ring
+ * of fixed-size records, taken under a lock on the thread's first record.
+ * From then on logging a request is a copy into the next slot and a release
+ * store; nothing is locked, allocated or written on the request's thread.
+ * A background thread drains the rings every few milliseconds, formats the
+ * records and writes each batch with one writev(). A record that finds its
+ * ring full is dropped and counted; the writer reports drops in the log and
+ * in sds_access_log_dropped_total.
+ *
+ * Lines from different threads are written in batches per thread, so they
+ * are ordered by timestamp only within a thread.
+ */
+class AccessLog {
+public:
+    /**
+     * @brief Records each thread can buffer before records are dropped.
+     */
+    static constexpr std::size_t RING_CAPACITY = 16384;
+
+    /**
+     * @brief How often the writer drains the rings.
+     */
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{20};
+
+    /**
+     * @brief Open the log and start its writer thread.
+     *
+     * @param path File to append to, or "-" for standard error.
+     * @throws std::system_error if the file cannot be opened.
+     */
+    explicit AccessLog(const std::string& path);
+
+    /**
+     * @brief Write what is still buffered and stop the writer thread.
+     */
+    ~AccessLog();
+
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+    /**
+     * @brief Log a finished request.
+     *
+     * @param route The route label.
+     * @param sample Status, sizes and storage error of the request.
+     * @param duration Time from the request's arrival to its last byte being sent.
+     */
+    void record(std::string_view route,
+                const RequestSample& sample,
+                std::chrono::nanoseconds duration) noexcept;
+
+    /**
+     * @brief Log a request the client abandoned before the response was complete.
+     *
+     * @param route The route label.
+     */
+    void record_aborted(std::string_view route) noexcept;
+
+private:
+    struct Record;
+    struct Ring;
+    struct Rings;
+    class RingLease;
+
+    void push(const Record& record) noexcept;
+    void run();
+    void flush();
+
+    int fd_;
+    bool owns_fd_;
+
+    /**
+     * @brief Every ring ever handed out; shared with the threads' leases,
+     *        which may outlive the log.
+     */
+    std::shared_ptr<Rings> rings_;
+
+    /** Formatted lines per ring, reused between flushes; only the writer touches these. */
+    std::vector<std::string> buffers_;
+    std::uint64_t reported_drops_ = 0;
+
+    std::mutex stop_mutex_;
+    std::condition_variable stop_condition_;
+    bool stopping_ = false;
+    std::thread writer_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_SERVER_ACCESS_LOG_HPP
@@ -2,9 +2,27 @@
 
 #include <App.h>
 
+#include "handlers/import_session.hpp"
+#include "server/access_log.hpp"
+#include "server/export_stream.hpp"
+#include "server/metrics.hpp"
+#include "server/response_body.hpp"
+#include "server/slow_log.hpp"
+#include "util/capture_file.hpp"
+#include "util/request_trace.hpp"
+#include "util/thread_pool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 
 namespace simple_data_server {
 
@@ -12,155 +30,624 @@ namespace {
 
 constexpr int HTTP_OK = 200;
 constexpr int HTTP_BAD_REQUEST = 400;
+constexpr int HTTP_FORBIDDEN = 403;
 constexpr int HTTP_NOT_FOUND = 404;
+constexpr int HTTP_CONFLICT = 409;
 constexpr int HTTP_PAYLOAD_TOO_LARGE = 413;
 constexpr int HTTP_INTERNAL_SERVER_ERROR = 500;
+constexpr int HTTP_INSUFFICIENT_STORAGE = 507;
 
-std::string status_to_string(HttpStatus status) {
-    switch (static_cast<int>(status)) {
-        case 200:
-            return "200 OK";
-        case 400:
-            return "400 Bad Request";
-        case 404:
-            return "404 Not Found";
-        case 413:
-            return "413 Payload Too Large";
-        case 500:
-            return "500 Internal Server Error";
+constexpr int SHUTDOWN_POLL_INTERVAL_MS = 200;
+constexpr int MAINTENANCE_INTERVAL_MS = 1000;
+constexpr unsigned STREAM_READER_THREADS = 2;
+constexpr unsigned SCAN_REQUEST_THREADS = 2;
+
+volatile std::sig_atomic_t shutdown_signal = 0;
+
+void handle_shutdown_signal(int signal) {
+    shutdown_signal = signal;
+}
+
+/**
+ * @brief State reachable from the shutdown timer's C callback.
+ */
+struct ShutdownContext {
+    DataServer* server;
+    uWS::App* app;
+    us_timer_t* maintenance_timer;
+};
+
+void run_maintenance(us_timer_t* timer) {
+    ApiHandler* handler;
+    std::memcpy(&handler, us_timer_ext(timer), sizeof(handler));
+    handler->tick();
+}
+
+void poll_shutdown(us_timer_t* timer) {
+    if (shutdown_signal == 0) {
+        return;
     }
-    return "500 Internal Server Error";
+
+    ShutdownContext context;
+    std::memcpy(&context, us_timer_ext(timer), sizeof(context));
+
+    std::cout << "Received signal " << shutdown_signal << ", shutting down" << std::endl;
+    context.server->stop();
+    context.app->close();
+    us_timer_close(context.maintenance_timer);
+    us_timer_close(timer);
 }
 
-int status_to_int(HttpStatus status) {
-    return static_cast<int>(status);
+/**
+ * @brief Write body fragments from a body offset on, stopping at backpressure.
+ *
+ * tryEnd() with the total size sends Content-Length once and never copies
+ * fragments into a retry buffer; if the socket fills up, onWritable resumes
+ * from the offset uWS reports.
+ *
+ * @return bool false if the socket is backed up.
+ */
+template <typename Response>
+bool write_body(Response* res, const std::shared_ptr<ResponseBody>& body, std::uintmax_t offset) {
+    std::uintmax_t fragment_start = 0;
+    for (const auto fragment : body->fragments()) {
+        const auto fragment_end = fragment_start + fragment.size();
+        if (offset < fragment_end) {
+            const auto [ok, done] = res->tryEnd(fragment.substr(offset - fragment_start),
+                                                body->size());
+            if (done) {
+                return true;
+            }
+            if (!ok) {
+                res->onWritable([res, body](std::uintmax_t written) {
+                    return write_body(res, body, written);
+                });
+                return false;
+            }
+            offset = fragment_end;
+        }
+        fragment_start = fragment_end;
+    }
+    return true;
+}
+
+/**
+ * @brief A registered route and where its finished requests are reported.
+ */
+struct Route {
+    /** URL pattern, also the metrics and slow log label. */
+    std::string pattern;
+    RouteId id;
+    /** Null if the slow log is disabled. */
+    const SlowLog* slow_log;
+    bool server_timing;
+    /** Null if capture is disabled. */
+    CaptureWriter* capture;
+    /** Null if the access log is disabled. */
+    AccessLog* access_log;
+};
+
+/**
+ * @brief A request whose body is buffered before the handler runs.
+ */
+struct PendingRequest {
+    explicit PendingRequest(const Route& route) {
+        if (route.capture != nullptr) {
+            trace.want_target();
+        }
+    }
+
+    std::string body;
+    RequestTrace trace;
+};
+
+/**
+ * @brief Format the stages up to Serialize as a Server-Timing header value.
+ *
+ * Sending is left out because the header goes out before the body.
+ */
+std::string server_timing_header(const RequestTrace& trace) {
+    std::string header;
+    char duration[32];
+    for (std::size_t i = 0; i <= static_cast<std::size_t>(TraceStage::Serialize); ++i) {
+        const auto stage = static_cast<TraceStage>(i);
+        const auto ms = std::chrono::duration<double, std::milli>(trace.duration(stage)).count();
+        const auto [end, ec] = std::to_chars(duration, duration + sizeof(duration), ms,
+                                             std::chars_format::fixed, 3);
+        if (!header.empty()) {
+            header += ", ";
+        }
+        header += trace_stage_name(stage);
+        header += ";dur=";
+        header.append(duration, ec == std::errc{} ? end : duration);
+    }
+    return header;
 }
 
-void send_response(auto* res, const ApiResult& result) {
-    const auto status_code = status_to_int(result.status);
+/**
+ * @brief Append a finished request to the capture.
+ *
+ * The arrival time is worked back from the trace, which started when the
+ * request arrived.
+ */
+void capture_request(CaptureWriter& capture,
+                     const Route& route,
+                     const RequestTrace& trace,
+                     const RequestSample& sample,
+                     std::optional<std::string_view> body) {
+    const auto latency = trace.total();
+    CaptureRecord record;
+    record.arrival = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - latency - capture.start());
+    record.route = route.pattern;
+    record.status = static_cast<std::uint16_t>(sample.status);
+    record.key_hash = trace.key_hash();
+    record.filename_hash = trace.filename_hash();
+    record.bytes_in = static_cast<std::uint32_t>(sample.bytes_in);
+    record.bytes_out = static_cast<std::uint32_t>(std::min<std::size_t>(sample.bytes_out,
+                                                                        UINT32_MAX));
+    record.latency = std::chrono::duration_cast<std::chrono::microseconds>(latency);
+    record.body = body;
+    capture.append(record);
+}
 
-    nlohmann::json response_json;
-    response_json["status"] = result.message;
+/**
+ * @brief Record a finished request in the metrics and the access log.
+ *
+ * The part of finish_request() that also applies to rejected and unmatched requests.
+ */
+void record_request(const Route& route, const RequestTrace& trace, const RequestSample& sample) {
+    Metrics::instance().record(route.id, sample);
+    if (route.access_log != nullptr) {
+        route.access_log->record(route.pattern, sample, trace.total());
+    }
+}
 
-    if (result.data.has_value()) {
-        response_json.merge_patch(result.data.value());
+/**
+ * @brief Record a finished request in the metrics, the access log, the capture and, if it
+ *        was slow, the slow log.
+ *
+ * @param route The route.
+ * @param trace The request's trace.
+ * @param sample The request's sample.
+ * @param body The request body, for the capture; std::nullopt if it was not buffered.
+ */
+void finish_request(const Route& route,
+                    const RequestTrace& trace,
+                    RequestSample& sample,
+                    std::optional<std::string_view> body = std::nullopt) {
+    fill_phases(trace, sample);
+    record_request(route, trace, sample);
+    if (route.capture != nullptr) {
+        capture_request(*route.capture, route, trace, sample, body);
+    }
+    if (route.slow_log != nullptr) {
+        route.slow_log->record(route.pattern, trace, sample);
     }
+}
 
-    const auto response_str = response_json.dump();
+/**
+ * @brief Run a handler with the request's trace current on this thread.
+ *
+ * A handler that returns before marking the parse or lookup stage stopped
+ * at validation, so its time counts as parsing.
+ *
+ * @return The handler's result.
+ */
+template <typename Handle>
+auto run_handler(const Handle& handle, PendingRequest& request) {
+    RequestTrace::Scope scope(request.trace);
+    auto result = handle(request.body);
+    const bool reached_storage = request.trace.marked(TraceStage::Parse) ||
+                                 request.trace.marked(TraceStage::Lookup);
+    request.trace.mark(reached_storage ? TraceStage::Storage : TraceStage::Parse);
+    return result;
+}
 
-    res->writeStatus(status_to_string(result.status))
-        ->writeHeader("Content-Type", "application/json")
-        ->writeHeader("Content-Length", std::to_string(response_str.length()))
-        ->end(response_str);
+/**
+ * @brief Send an API result as the JSON response.
+ *
+ * @return std::size_t The body size.
+ */
+template <typename Response>
+std::size_t send_response(Response* res, const Route& route, RequestTrace& trace,
+                          ApiResult result) {
+    auto body = std::make_shared<ResponseBody>(std::move(result));
+    trace.mark(TraceStage::Serialize);
+    res->cork([&] {
+        res->writeStatus(body->status())->writeHeader("Content-Type", "application/json");
+        if (route.server_timing) {
+            res->writeHeader("Server-Timing", server_timing_header(trace));
+        }
+        write_body(res, body, 0);
+    });
+    trace.mark(TraceStage::Send);
+    return body->size();
 }
 
-} // namespace
+/**
+ * @brief Send a handler's result and record the request.
+ *
+ * @param res The response.
+ * @param route The route.
+ * @param trace The request's trace, marked up to the end of the handler.
+ * @param sample The request's sample so far.
+ * @param result The handler's result.
+ * @param body The request body, for the capture; std::nullopt if it was not buffered.
+ */
+template <typename Response>
+void send_recorded_response(Response* res,
+                            const Route& route,
+                            RequestTrace& trace,
+                            RequestSample& sample,
+                            ApiResult result,
+                            std::optional<std::string_view> body = std::nullopt) {
+    sample.status = result.status;
+    sample.file_error = result.file_error;
+    sample.bytes_out = send_response(res, route, trace, std::move(result));
+    finish_request(route, trace, sample, body);
+}
 
-DataServer::DataServer(std::uint16_t port, std::shared_ptr<ApiHandler> api_handler)
-    : port_(port), api_handler_(std::move(api_handler)), listen_socket_(nullptr) {
+/**
+ * @brief Run a handler on a received request and send its result, recording the request.
+ *
+ * @param res The response.
+ * @param route The route.
+ * @param handle Callable taking the request body and returning an ApiResult.
+ * @param request The request, traced up to the end of the body.
+ */
+template <typename Response, typename Handle>
+void respond(Response* res, const Route& route, const Handle& handle, PendingRequest& request) {
+    auto result = run_handler(handle, request);
+    RequestSample sample{result.status};
+    sample.bytes_in = request.body.size();
+    send_recorded_response(res, route, request.trace, sample, std::move(result), request.body);
 }
 
-bool DataServer::start() noexcept {
-    uWS::App app;
+template <typename Response>
+void send_error(Response* res, std::string_view status, std::string_view message) {
+    nlohmann::json error_response;
+    error_response["error"] = message;
+    const auto error_str = error_response.dump();
+    res->writeStatus(status)
+        ->writeHeader("Content-Type", "application/json")
+        ->end(error_str);
+}
 
-    auto* handler = api_handler_.get();
+/**
+ * @brief Reject a request body over MAX_REQUEST_SIZE and record it in the metrics and access log.
+ */
+template <typename Response>
+void send_too_large(Response* res, const Route& route, PendingRequest& request) {
+    request.trace.mark(TraceStage::Receive);
+    send_error(res, "413 Payload Too Large", "Request body too large");
+    request.trace.mark(TraceStage::Send);
+    RequestSample sample{HttpStatus::PayloadTooLarge};
+    sample.bytes_in = request.body.size();
+    record_request(route, request.trace, sample);
+}
 
-    app.post("/api/put", [handler]<auto res> {
-        auto* response = res;
-        auto body_buffer = std::make_shared<std::string>();
+/**
+ * @brief Record a request the client abandoned, in the access log if there is one.
+ */
+void record_aborted(const Route& route) {
+    Metrics::instance().request_aborted();
+    if (route.access_log != nullptr) {
+        route.access_log->record_aborted(route.pattern);
+    } else {
+        std::cerr << "Request aborted" << std::endl;
+    }
+}
+
+/**
+ * @brief Register a POST route that buffers the JSON body and hands it to a handler.
+ *
+ * @param app The uWS application.
+ * @param route The route; must outlive the application.
+ * @param handle Callable taking the request body and returning an ApiResult.
+ */
+template <typename Handle>
+void register_json_route(uWS::App& app, const Route& route, Handle handle) {
+    app.post(route.pattern, [route = &route, handle](auto* res, auto* /*req*/) {
+        Metrics::instance().request_started();
+        auto request = std::make_shared<PendingRequest>(*route);
+
+        res->onData([res, route, request, handle](std::string_view chunk, bool is_last) {
+            if (request->body.size() > MAX_REQUEST_SIZE) {
+                return;
+            }
 
-        response->onData([response, body_buffer, handler]<auto chunk, bool is_last> mutable {
-            body_buffer->append(chunk.data(), chunk.length());
+            request->body.append(chunk.data(), chunk.length());
 
-            if (body_buffer->size() > MAX_REQUEST_SIZE) {
-                nlohmann::json error_response;
-                error_response["error"] = "Request body too large";
-                const auto error_str = error_response.dump();
-                response->writeStatus("413 Payload Too Large")
-                    ->writeHeader("Content-Type", "application/json")
-                    ->end(error_str);
+            if (request->body.size() > MAX_REQUEST_SIZE) {
+                send_too_large(res, *route, *request);
                 return;
             }
 
             if (is_last) {
-                const auto result = handler->handle_put(*body_buffer);
-                send_response(response, result);
+                request->trace.mark(TraceStage::Receive);
+                respond(res, *route, handle, *request);
             }
         });
 
-        response->onAborted([]<auto> {
-            std::cerr << "Request aborted" << std::endl;
+        res->onAborted([route] {
+            record_aborted(*route);
         });
     });
+}
 
-    app.post("/api/get", [handler]<auto res> {
-        auto* response = res;
-        auto body_buffer = std::make_shared<std::string>();
+/**
+ * @brief Register a POST route whose handler runs on a thread pool instead of the event loop.
+ *
+ * For requests that scan many documents; the result is sent from the loop
+ * once the handler returns, unless the client went away.
+ *
+ * @param app The uWS application.
+ * @param route The route; must outlive the application and the pool.
+ * @param pool Thread pool to run the handler on.
+ * @param handle Callable taking the request body and returning an ApiResult.
+ */
+template <typename Handle>
+void register_pooled_json_route(uWS::App& app, const Route& route, ThreadPool& pool,
+                                Handle handle) {
+    app.post(route.pattern, [route = &route, &pool, handle](auto* res, auto* /*req*/) {
+        Metrics::instance().request_started();
+        auto request = std::make_shared<PendingRequest>(*route);
+        auto aborted = std::make_shared<bool>(false);
+
+        res->onData([res, route, request, aborted, &pool, handle](std::string_view chunk,
+                                                                   bool is_last) {
+            if (request->body.size() > MAX_REQUEST_SIZE) {
+                return;
+            }
 
-        response->onData([response, body_buffer, handler]<auto chunk, bool is_last> mutable {
-            body_buffer->append(chunk.data(), chunk.length());
+            request->body.append(chunk.data(), chunk.length());
 
-            if (body_buffer->size() > MAX_REQUEST_SIZE) {
-                nlohmann::json error_response;
-                error_response["error"] = "Request body too large";
-                const auto error_str = error_response.dump();
-                response->writeStatus("413 Payload Too Large")
-                    ->writeHeader("Content-Type", "application/json")
-                    ->end(error_str);
+            if (request->body.size() > MAX_REQUEST_SIZE) {
+                send_too_large(res, *route, *request);
                 return;
             }
 
             if (is_last) {
-                const auto result = handler->handle_get(*body_buffer);
-                send_response(response, result);
+                request->trace.mark(TraceStage::Receive);
+                auto* loop = uWS::Loop::get();
+                pool.submit([res, route, request, aborted, handle, loop] {
+                    request->trace.mark(TraceStage::Queue);
+                    auto result = std::make_shared<ApiResult>(run_handler(handle, *request));
+                    RequestSample sample{result->status};
+                    sample.bytes_in = request->body.size();
+                    loop->defer([res, route, request, aborted, result, sample]() mutable {
+                        if (!*aborted) {
+                            send_recorded_response(res, *route, request->trace, sample,
+                                                   std::move(*result), request->body);
+                        }
+                    });
+                });
             }
         });
 
-        response->onAborted([]<auto> {
-            std::cerr << "Request aborted" << std::endl;
+        res->onAborted([route, aborted] {
+            *aborted = true;
+            record_aborted(*route);
         });
     });
+}
 
-    app.post("/api/list", [handler]<auto res> {
-        auto* response = res;
-        auto body_buffer = std::make_shared<std::string>();
+/**
+ * @brief Register a POST route that buffers the JSON body and streams JSON Lines back.
+ *
+ * @param app The uWS application.
+ * @param route The route; must outlive the application.
+ * @param pool Thread pool the response lines are read on.
+ * @param begin Callable taking the request body and returning
+ *        std::expected<std::unique_ptr<LineSource>, ApiResult>.
+ */
+template <typename Begin>
+void register_stream_route(uWS::App& app, const Route& route, ThreadPool& pool, Begin begin) {
+    app.post(route.pattern, [route = &route, &pool, begin](auto* res, auto* /*req*/) {
+        Metrics::instance().request_started();
+        auto request = std::make_shared<PendingRequest>(*route);
+
+        res->onData([res, route, request, &pool, begin](std::string_view chunk, bool is_last) {
+            if (request->body.size() > MAX_REQUEST_SIZE) {
+                return;
+            }
 
-        response->onData([response, body_buffer, handler]<auto chunk, bool is_last> mutable {
-            body_buffer->append(chunk.data(), chunk.length());
+            request->body.append(chunk.data(), chunk.length());
 
-            if (body_buffer->size() > MAX_REQUEST_SIZE) {
-                nlohmann::json error_response;
-                error_response["error"] = "Request body too large";
-                const auto error_str = error_response.dump();
-                response->writeStatus("413 Payload Too Large")
-                    ->writeHeader("Content-Type", "application/json")
-                    ->end(error_str);
+            if (request->body.size() > MAX_REQUEST_SIZE) {
+                send_too_large(res, *route, *request);
                 return;
             }
 
             if (is_last) {
-                const auto result = handler->handle_list(*body_buffer);
-                send_response(response, result);
+                request->trace.mark(TraceStage::Receive);
+                auto source = run_handler(begin, *request);
+                RequestSample sample{HttpStatus::Ok};
+                sample.bytes_in = request->body.size();
+                if (!source) {
+                    send_recorded_response(res, *route, request->trace, sample,
+                                           std::move(source.error()), request->body);
+                    return;
+                }
+                // Streaming the lines counts as serializing; the stream writes
+                // its own headers, so there is no Server-Timing header.
+                ExportStream::start(res, std::move(source.value()), pool,
+                                    [route, request,
+                                     sample](std::size_t bytes_sent, bool completed) mutable {
+                                        if (!completed) {
+                                            record_aborted(*route);
+                                            return;
+                                        }
+                                        sample.bytes_out = bytes_sent;
+                                        request->trace.mark(TraceStage::Serialize);
+                                        finish_request(*route, request->trace, sample,
+                                                       request->body);
+                                    });
             }
         });
 
-        response->onAborted([]<auto> {
-            std::cerr << "Request aborted" << std::endl;
+        res->onAborted([route] {
+            record_aborted(*route);
         });
     });
+}
+
+} // namespace
+
+DataServer::DataServer(std::uint16_t port,
+                       std::shared_ptr<ApiHandler> api_handler,
+                       TracingOptions tracing)
+    : port_(port),
+      api_handler_(std::move(api_handler)),
+      tracing_(std::move(tracing)),
+      listen_socket_(nullptr) {
+}
+
+bool DataServer::start() noexcept {
+    std::unique_ptr<SlowLog> slow_log;
+    if (!tracing_.slow_log_path.empty()) {
+        try {
+            slow_log = std::make_unique<SlowLog>(tracing_.slow_log_path, tracing_.slow_threshold);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+    }
+    std::unique_ptr<CaptureWriter> capture;
+    if (!tracing_.capture_path.empty()) {
+        try {
+            capture = std::make_unique<CaptureWriter>(tracing_.capture_path, tracing_.capture_size,
+                                                      tracing_.capture_bodies);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+        std::cout << "Capturing requests to " << tracing_.capture_path << std::endl;
+    }
+    std::unique_ptr<AccessLog> access_log;
+    if (!tracing_.access_log_path.empty()) {
+        try {
+            access_log = std::make_unique<AccessLog>(tracing_.access_log_path);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return false;
+        }
+    }
+    // Measure the trace clock now rather than while the first request waits.
+    TraceClock::calibrate();
+
+    // A deque never moves its elements, so the handlers can hold pointers.
+    std::deque<Route> routes;
+    const auto add_route = [&](std::string pattern) -> const Route& {
+        const auto id = Metrics::instance().add_route(pattern);
+        return routes.emplace_back(Route{std::move(pattern), id, slow_log.get(),
+                                         tracing_.server_timing, capture.get(),
+                                         access_log.get()});
+    };
+
+    uWS::App app;
 
-    app.get("/*", []<auto res> {
-        nlohmann::json error_response;
-        error_response["error"] = "Not found";
-        const auto error_str = error_response.dump();
-        res->writeStatus("404 Not Found")
-            ->writeHeader("Content-Type", "application/json")
-            ->end(error_str);
+    auto* handler = api_handler_.get();
+
+    register_json_route(app, add_route("/api/put"), [handler](std::string_view body) {
+        return handler->handle_put(body);
+    });
+    register_json_route(app, add_route("/api/get"), [handler](std::string_view body) {
+        return handler->handle_get(body);
+    });
+    register_json_route(app, add_route("/api/list"), [handler](std::string_view body) {
+        return handler->handle_list(body);
+    });
+    register_json_route(app, add_route("/api/stats"), [handler](std::string_view body) {
+        return handler->handle_stats(body);
+    });
+    register_json_route(app, add_route("/api/replication"), [handler](std::string_view body) {
+        return handler->handle_replication(body);
+    });
+
+    ThreadPool stream_pool(STREAM_READER_THREADS);
+    ThreadPool scan_pool(SCAN_REQUEST_THREADS);
+
+    // Creating an index reads every document of the key.
+    register_pooled_json_route(app, add_route("/api/index"), scan_pool,
+                               [handler](std::string_view body) {
+                                   return handler->handle_index(body);
+                               });
+    register_pooled_json_route(app, add_route("/api/aggregate"), scan_pool,
+                               [handler](std::string_view body) {
+                                   return handler->handle_aggregate(body);
+                               });
+    register_pooled_json_route(app, add_route("/api/search"), scan_pool,
+                               [handler](std::string_view body) {
+                                   return handler->handle_search(body);
+                               });
+
+    register_stream_route(app, add_route("/api/export"), stream_pool,
+                          [handler](std::string_view body) {
+                              return handler->begin_export(body);
+                          });
+    register_stream_route(app, add_route("/api/query"), stream_pool,
+                          [handler](std::string_view body) {
+                              return handler->begin_query(body);
+                          });
+
+    const auto& import_route = add_route("/api/import");
+    app.post(import_route.pattern, [handler, &import_route](auto* res, auto* /*req*/) {
+        Metrics::instance().request_started();
+        // The body is imported as it arrives, so all of it counts as storage time.
+        auto trace = std::make_shared<RequestTrace>();
+        trace->mark(TraceStage::Parse);
+        auto session = std::make_shared<ImportSession>(handler->begin_import());
+        auto bytes_in = std::make_shared<std::size_t>(0);
+
+        res->onData([res, &import_route, session, trace, bytes_in](std::string_view chunk,
+                                                                   bool is_last) {
+            *bytes_in += chunk.size();
+            session->feed(chunk);
+            if (is_last) {
+                auto result = session->finish();
+                trace->mark(TraceStage::Storage);
+                RequestSample sample{result.status};
+                sample.bytes_in = *bytes_in;
+                send_recorded_response(res, import_route, *trace, sample, std::move(result));
+            }
+        });
+
+        res->onAborted([&import_route] {
+            record_aborted(import_route);
+        });
+    });
+
+    const auto& metrics_route = add_route("/metrics");
+    app.get(metrics_route.pattern, [&metrics_route](auto* res, auto* /*req*/) {
+        Metrics::instance().request_started();
+        RequestTrace trace;
+        RequestSample sample{HttpStatus::Ok};
+        const auto exposition = Metrics::instance().render();
+        trace.mark(TraceStage::Serialize);
+        res->writeStatus("200 OK")
+            ->writeHeader("Content-Type", "text/plain; version=0.0.4")
+            ->end(exposition);
+        trace.mark(TraceStage::Send);
+        sample.bytes_out = exposition.size();
+        finish_request(metrics_route, trace, sample);
     });
 
-    const bool success = app.listen(port_, [this]<auto listen_socket> {
+    const auto& unmatched_route = add_route("unmatched");
+    app.get("/*", [&unmatched_route](auto* res, auto* /*req*/) {
+        Metrics::instance().request_started();
+        RequestTrace trace;
+        send_error(res, "404 Not Found", "Not found");
+        trace.mark(TraceStage::Send);
+        record_request(unmatched_route, trace, RequestSample{HttpStatus::NotFound});
+    });
+
+    bool success = false;
+    app.listen(port_, [this, &success](auto* listen_socket) {
         if (listen_socket) {
             listen_socket_ = listen_socket;
+            success = true;
             std::cout << "Server listening on port " << port_ << std::endl;
         } else {
             std::cerr << "Failed to listen on port " << port_ << std::endl;
@@ -171,13 +658,30 @@ bool DataServer::start() noexcept {
         return false;
     }
 
+    auto* loop = reinterpret_cast<us_loop_t*>(uWS::Loop::get());
+
+    auto* maintenance_timer = us_create_timer(loop, 0, sizeof(ApiHandler*));
+    std::memcpy(us_timer_ext(maintenance_timer), &handler, sizeof(handler));
+    us_timer_set(maintenance_timer, run_maintenance, MAINTENANCE_INTERVAL_MS,
+                 MAINTENANCE_INTERVAL_MS);
+
+    // Closing the listen socket and all connections lets app.run() return, so
+    // main() can unwind and the storage layer can write its snapshots.
+    std::signal(SIGINT, handle_shutdown_signal);
+    std::signal(SIGTERM, handle_shutdown_signal);
+    auto* shutdown_timer = us_create_timer(loop, 0, sizeof(ShutdownContext));
+    const ShutdownContext context{this, &app, maintenance_timer};
+    std::memcpy(us_timer_ext(shutdown_timer), &context, sizeof(context));
+    us_timer_set(shutdown_timer, poll_shutdown, SHUTDOWN_POLL_INTERVAL_MS,
+                 SHUTDOWN_POLL_INTERVAL_MS);
+
     app.run();
     return true;
 }
 
 void DataServer::stop() noexcept {
     if (listen_socket_) {
-        us_listen_socket_close(0, listen_socket_);
+        us_listen_socket_close(0, static_cast<us_listen_socket_t*>(listen_socket_));
         listen_socket_ = nullptr;
     }
 }
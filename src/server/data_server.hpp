@@ -1,8 +1,10 @@
 #ifndef SIMPLE_DATA_SERVER_SERVER_DATA_SERVER_HPP
 #define SIMPLE_DATA_SERVER_SERVER_DATA_SERVER_HPP
 
+#include <chrono>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include "handlers/api_handler.hpp"
 
 /**
@@ -12,6 +14,47 @@ constexpr std::size_t MAX_REQUEST_SIZE = 1024 * 1024;
 
 namespace simple_data_server {
 
+/**
+ * @brief Request tracing, capture and access log settings.
+ */
+struct TracingOptions {
+    /**
+     * @brief Add a Server-Timing header with the stage durations to JSON responses.
+     */
+    bool server_timing = false;
+
+    /**
+     * @brief File slow requests are appended to, "-" for standard error; empty disables it.
+     */
+    std::string slow_log_path;
+
+    /**
+     * @brief Requests taking at least this long are written to the slow log.
+     */
+    std::chrono::milliseconds slow_threshold{500};
+
+    /**
+     * @brief Ring file every request is captured to, for sds-replay; empty disables capture.
+     */
+    std::string capture_path;
+
+    /**
+     * @brief Bytes the capture ring holds before the oldest requests are overwritten.
+     */
+    std::size_t capture_size = 64 * 1024 * 1024;
+
+    /**
+     * @brief Also capture request bodies, so they can be replayed exactly.
+     */
+    bool capture_bodies = false;
+
+    /**
+     * @brief File every request is logged to as a JSON line, "-" for standard error;
+     *        empty disables it.
+     */
+    std::string access_log_path;
+};
+
 /**
  * @brief The main data server class using uWebSockets.
  *
@@ -25,15 +68,21 @@ public:
      *
      * @param port The port number to listen on.
      * @param api_handler Shared pointer to the ApiHandler instance.
+     * @param tracing Slow log, Server-Timing, capture and access log settings.
      * @pre api_handler must not be nullptr.
      * @post Server is configured but not yet running.
      */
-    DataServer(std::uint16_t port, std::shared_ptr<ApiHandler> api_handler);
+    DataServer(std::uint16_t port,
+               std::shared_ptr<ApiHandler> api_handler,
+               TracingOptions tracing = {});
 
     /**
      * @brief Start the server and begin listening for connections.
      *
-     * @return true if the server started successfully, false otherwise.
+     * Blocks running the event loop until SIGINT or SIGTERM is received, at
+     * which point all connections are closed and the call returns.
+     *
+     * @return true if the server started and shut down cleanly, false otherwise.
      * @post Server is running and accepting connections.
      */
     [[nodiscard]] bool start() noexcept;
@@ -71,6 +120,7 @@ private:
 
     std::uint16_t port_;
     std::shared_ptr<ApiHandler> api_handler_;
+    TracingOptions tracing_;
     void* listen_socket_;
 };
 
@@ -0,0 +1,152 @@
+#include "server/export_stream.hpp"
+
+#include <App.h>
+
+#include <cstdint>
+
+#include "util/thread_pool.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+constexpr std::size_t HIGH_WATER_BYTES = 1024 * 1024;
+constexpr std::size_t LOW_WATER_BYTES = 256 * 1024;
+
+} // namespace
+
+void ExportStream::start(Response* res,
+                         std::unique_ptr<LineSource> source,
+                         ThreadPool& pool,
+                         Finished finished) {
+    auto stream =
+        std::make_shared<ExportStream>(res, std::move(source), pool, std::move(finished));
+
+    res->onWritable([stream](std::uintmax_t) {
+        stream->socket_blocked_ = false;
+        stream->pump();
+        return true;
+    });
+
+    res->onAborted([stream] {
+        stream->aborted_ = true;
+        {
+            std::lock_guard lock(stream->mutex_);
+            stream->cancelled_ = true;
+            stream->chunks_.clear();
+            stream->queued_bytes_ = 0;
+        }
+        stream->finish(false);
+    });
+
+    res->cork([res] {
+        res->writeStatus("200 OK")->writeHeader("Content-Type", "application/x-ndjson");
+    });
+
+    stream->schedule_read();
+}
+
+ExportStream::ExportStream(Response* res,
+                           std::unique_ptr<LineSource> source,
+                           ThreadPool& pool,
+                           Finished finished)
+    : res_(res),
+      loop_(uWS::Loop::get()),
+      source_(std::move(source)),
+      pool_(pool),
+      finished_callback_(std::move(finished)) {
+}
+
+void ExportStream::schedule_read() {
+    reading_ = true;
+    pool_.submit([self = shared_from_this()] { self->read_batch(); });
+}
+
+void ExportStream::read_batch() {
+    std::size_t batch_bytes = 0;
+    bool more = true;
+
+    while (more && batch_bytes < HIGH_WATER_BYTES) {
+        {
+            std::lock_guard lock(mutex_);
+            if (cancelled_) {
+                return;
+            }
+        }
+
+        std::string chunk;
+        more = source_->read(chunk, CHUNK_SIZE);
+
+        std::lock_guard lock(mutex_);
+        if (!chunk.empty()) {
+            batch_bytes += chunk.size();
+            queued_bytes_ += chunk.size();
+            chunks_.push_back(std::move(chunk));
+        }
+        reading_done_ = !more;
+    }
+
+    loop_->defer([self = shared_from_this()] {
+        self->reading_ = false;
+        self->pump();
+    });
+}
+
+void ExportStream::pump() {
+    if (aborted_ || finished_) {
+        return;
+    }
+
+    res_->cork([this] {
+        while (!socket_blocked_) {
+            std::string chunk;
+            {
+                std::lock_guard lock(mutex_);
+                if (chunks_.empty()) {
+                    break;
+                }
+                chunk = std::move(chunks_.front());
+                chunks_.pop_front();
+                queued_bytes_ -= chunk.size();
+            }
+            bytes_sent_ += chunk.size();
+            if (!res_->write(chunk)) {
+                socket_blocked_ = true;
+            }
+        }
+
+        std::lock_guard lock(mutex_);
+        if (reading_done_ && chunks_.empty() && !socket_blocked_) {
+            finished_ = true;
+            res_->end();
+        }
+    });
+
+    if (finished_) {
+        finish(true);
+        return;
+    }
+    if (reading_) {
+        return;
+    }
+
+    bool needs_read = false;
+    {
+        std::lock_guard lock(mutex_);
+        needs_read = !reading_done_ && queued_bytes_ < LOW_WATER_BYTES;
+    }
+    if (needs_read) {
+        schedule_read();
+    }
+}
+
+void ExportStream::finish(bool completed) {
+    if (finished_callback_) {
+        const auto callback = std::move(finished_callback_);
+        finished_callback_ = nullptr;
+        callback(bytes_sent_, completed);
+    }
+}
+
+} // namespace simple_data_server
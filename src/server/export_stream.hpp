@@ -0,0 +1,92 @@
+#ifndef SIMPLE_DATA_SERVER_SERVER_EXPORT_STREAM_HPP
+#define SIMPLE_DATA_SERVER_SERVER_EXPORT_STREAM_HPP
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "handlers/line_source.hpp"
+
+namespace uWS {
+template <bool SSL>
+struct HttpResponse;
+struct Loop;
+} // namespace uWS
+
+namespace simple_data_server {
+
+class ThreadPool;
+
+/**
+ * @brief Streams a JSON Lines response, such as an export or query result.
+ *
+ * Lines are read from a LineSource on a background thread pool in batches
+ * and handed to the event loop as chunks. The loop writes chunks until the socket reports
+ * backpressure and resumes from onWritable, and the reader is only
+ * rescheduled once the queued chunks drop below a low-water mark. Memory
+ * per stream therefore stays bounded no matter how slow the client is.
+ */
+class ExportStream : public std::enable_shared_from_this<ExportStream> {
+public:
+    using Response = uWS::HttpResponse<false>;
+
+    /**
+     * @brief Called on the event loop once the stream ends.
+     *
+     * Receives the body bytes handed to the socket and whether the response
+     * was completed rather than aborted by the client.
+     */
+    using Finished = std::function<void(std::size_t bytes_sent, bool completed)>;
+
+    /**
+     * @brief Begin streaming a response.
+     *
+     * Must be called on the event loop thread.
+     *
+     * @param res The response to stream into.
+     * @param source The lines to send.
+     * @param pool Thread pool for reading from the source.
+     * @param finished Called once the stream ends, if given.
+     */
+    static void start(Response* res,
+                      std::unique_ptr<LineSource> source,
+                      ThreadPool& pool,
+                      Finished finished = {});
+
+    ExportStream(Response* res,
+                 std::unique_ptr<LineSource> source,
+                 ThreadPool& pool,
+                 Finished finished);
+
+private:
+    void schedule_read();
+    void read_batch();
+    void pump();
+    void finish(bool completed);
+
+    Response* res_;
+    uWS::Loop* loop_;
+    std::unique_ptr<LineSource> source_;
+    ThreadPool& pool_;
+
+    // Only touched on the event loop thread.
+    Finished finished_callback_;
+    std::size_t bytes_sent_ = 0;
+    bool aborted_ = false;
+    bool socket_blocked_ = false;
+    bool reading_ = false;
+    bool finished_ = false;
+
+    std::mutex mutex_;
+    std::deque<std::string> chunks_;
+    std::size_t queued_bytes_ = 0;
+    bool reading_done_ = false;
+    bool cancelled_ = false;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_SERVER_EXPORT_STREAM_HPP
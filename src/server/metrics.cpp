@@ -0,0 +1,421 @@
+#include "server/metrics.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::array STATUSES{HttpStatus::Ok,
+                              HttpStatus::BadRequest,
+                              HttpStatus::Forbidden,
+                              HttpStatus::NotFound,
+                              HttpStatus::Conflict,
+                              HttpStatus::PayloadTooLarge,
+                              HttpStatus::InternalServerError,
+                              HttpStatus::InsufficientStorage};
+
+constexpr std::array FILE_ERRORS{
+    std::pair{FileError::KeyDirectoryNotFound, std::string_view("KeyDirectoryNotFound")},
+    std::pair{FileError::FileNotFound, std::string_view("FileNotFound")},
+    std::pair{FileError::InvalidJson, std::string_view("InvalidJson")},
+    std::pair{FileError::FileTooLarge, std::string_view("FileTooLarge")},
+    std::pair{FileError::InvalidFilename, std::string_view("InvalidFilename")},
+    std::pair{FileError::IoError, std::string_view("IoError")},
+    std::pair{FileError::JsonEncodingError, std::string_view("JsonEncodingError")},
+    std::pair{FileError::VersionMismatch, std::string_view("VersionMismatch")},
+    std::pair{FileError::QuotaExceeded, std::string_view("QuotaExceeded")}};
+
+constexpr std::array<std::string_view, 3> PHASE_NAMES{"parse", "storage", "serialize"};
+
+/**
+ * @brief Upper bounds of the latency buckets in nanoseconds: 1-9 us, 10-90 us, ..., 10 s.
+ */
+constexpr auto LATENCY_BOUNDS_NS = [] {
+    std::array<std::int64_t, Metrics::LATENCY_BUCKETS> bounds{};
+    std::int64_t decade = 1'000;
+    for (std::size_t i = 0; i + 1 < bounds.size(); ++i) {
+        bounds[i] = static_cast<std::int64_t>(i % 9 + 1) * decade;
+        if (i % 9 == 8) {
+            decade *= 10;
+        }
+    }
+    bounds.back() = decade;
+    return bounds;
+}();
+
+std::size_t status_index(HttpStatus status) {
+    return static_cast<std::size_t>(std::find(STATUSES.begin(), STATUSES.end(), status) -
+                                    STATUSES.begin());
+}
+
+std::size_t file_error_index(FileError error) {
+    return static_cast<std::size_t>(
+        std::find_if(FILE_ERRORS.begin(), FILE_ERRORS.end(),
+                     [error](const auto& entry) { return entry.first == error; }) -
+        FILE_ERRORS.begin());
+}
+
+/**
+ * @brief A counter written by one thread and read by scrapes.
+ *
+ * A plain load and store instead of fetch_add: only the owning thread
+ * writes, so no locked instruction is needed.
+ */
+class Counter {
+public:
+    void add(std::uint64_t n) noexcept {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t get() const noexcept {
+        return value_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::uint64_t> value_{0};
+};
+
+struct Histogram {
+    /** Per-bucket counts, the last one for +Inf; cumulated when rendered. */
+    std::array<Counter, Metrics::LATENCY_BUCKETS + 1> buckets;
+    Counter sum_ns;
+
+    void observe(std::chrono::nanoseconds duration) noexcept {
+        const auto ns = std::max<std::int64_t>(duration.count(), 0);
+        const auto bucket = std::lower_bound(LATENCY_BOUNDS_NS.begin(), LATENCY_BOUNDS_NS.end(),
+                                             ns) -
+                            LATENCY_BOUNDS_NS.begin();
+        buckets[static_cast<std::size_t>(bucket)].add(1);
+        sum_ns.add(static_cast<std::uint64_t>(ns));
+    }
+};
+
+struct RouteCounters {
+    std::array<Counter, STATUSES.size()> by_status;
+    std::array<Histogram, PHASE_NAMES.size()> phases;
+    Counter bytes_in;
+    Counter bytes_out;
+};
+
+void append_number(std::string& out, double value) {
+    char buffer[32];
+    const auto [end, error] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, error == std::errc() ? end : buffer);
+}
+
+void append_labels(std::string& out,
+                   std::string_view route,
+                   std::string_view name = {},
+                   std::string_view value = {}) {
+    out += "{route=\"";
+    out += route;
+    out += '"';
+    if (!name.empty()) {
+        out += ',';
+        out += name;
+        out += "=\"";
+        out += value;
+        out += '"';
+    }
+}
+
+void append_header(std::string& out,
+                   std::string_view name,
+                   std::string_view type,
+                   std::string_view help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+} // namespace
+
+struct Metrics::Shard {
+    std::array<RouteCounters, MAX_ROUTES> routes;
+    std::array<Counter, FILE_ERRORS.size()> file_errors;
+    Counter started;
+    Counter finished;
+    Counter aborted;
+    Counter access_log_dropped;
+};
+
+/**
+ * @brief Holds the calling thread's shard and returns it to the pool when the thread exits.
+ */
+class Metrics::ShardLease {
+public:
+    explicit ShardLease(Metrics& metrics) : metrics_(metrics) {
+        std::lock_guard lock(metrics.mutex_);
+        if (!metrics.free_shards_.empty()) {
+            shard_ = metrics.free_shards_.back();
+            metrics.free_shards_.pop_back();
+        } else {
+            shard_ = metrics.shards_.emplace_back(std::make_unique<Shard>()).get();
+        }
+    }
+
+    ~ShardLease() {
+        metrics_.release(shard_);
+    }
+
+    ShardLease(const ShardLease&) = delete;
+    ShardLease& operator=(const ShardLease&) = delete;
+
+    [[nodiscard]] Shard& shard() const noexcept {
+        return *shard_;
+    }
+
+private:
+    Metrics& metrics_;
+    Shard* shard_;
+};
+
+std::string_view file_error_name(FileError error) noexcept {
+    const auto index = file_error_index(error);
+    return index < FILE_ERRORS.size() ? FILE_ERRORS[index].second : std::string_view("Unknown");
+}
+
+void fill_phases(const RequestTrace& trace, RequestSample& sample) noexcept {
+    sample.parse = trace.duration(TraceStage::Parse);
+    sample.storage = trace.duration(TraceStage::Lookup) + trace.duration(TraceStage::Storage);
+    sample.serialize = trace.duration(TraceStage::Serialize) + trace.duration(TraceStage::Send);
+}
+
+Metrics& Metrics::instance() noexcept {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics() = default;
+
+Metrics::~Metrics() = default;
+
+RouteId Metrics::add_route(std::string_view route) {
+    std::lock_guard lock(mutex_);
+    const auto it = std::find(routes_.begin(), routes_.end(), route);
+    if (it != routes_.end()) {
+        return static_cast<RouteId>(it - routes_.begin());
+    }
+    if (routes_.size() == MAX_ROUTES) {
+        throw std::length_error("Too many metrics routes");
+    }
+    routes_.emplace_back(route);
+    return routes_.size() - 1;
+}
+
+void Metrics::request_started() noexcept {
+    local_shard().started.add(1);
+}
+
+void Metrics::record(RouteId route, const RequestSample& sample) noexcept {
+    auto& shard = local_shard();
+    shard.finished.add(1);
+    if (route >= MAX_ROUTES) {
+        return;
+    }
+    auto& counters = shard.routes[route];
+    if (const auto status = status_index(sample.status); status < STATUSES.size()) {
+        counters.by_status[status].add(1);
+    }
+    counters.phases[static_cast<std::size_t>(RequestPhase::Parse)].observe(sample.parse);
+    counters.phases[static_cast<std::size_t>(RequestPhase::Storage)].observe(sample.storage);
+    counters.phases[static_cast<std::size_t>(RequestPhase::Serialize)].observe(sample.serialize);
+    counters.bytes_in.add(sample.bytes_in);
+    counters.bytes_out.add(sample.bytes_out);
+    if (sample.file_error) {
+        if (const auto error = file_error_index(*sample.file_error); error < FILE_ERRORS.size()) {
+            shard.file_errors[error].add(1);
+        }
+    }
+}
+
+void Metrics::request_aborted() noexcept {
+    auto& shard = local_shard();
+    shard.finished.add(1);
+    shard.aborted.add(1);
+}
+
+void Metrics::access_log_dropped(std::uint64_t count) noexcept {
+    local_shard().access_log_dropped.add(count);
+}
+
+std::string Metrics::render() const {
+    std::lock_guard lock(mutex_);
+
+    // Sum the shards once; totals[route] is laid out like RouteCounters.
+    struct RouteTotals {
+        std::array<std::uint64_t, STATUSES.size()> by_status{};
+        std::array<std::array<std::uint64_t, LATENCY_BUCKETS + 1>, PHASE_NAMES.size()> buckets{};
+        std::array<std::uint64_t, PHASE_NAMES.size()> sum_ns{};
+        std::uint64_t bytes_in = 0;
+        std::uint64_t bytes_out = 0;
+        std::uint64_t requests = 0;
+    };
+    std::vector<RouteTotals> totals(routes_.size());
+    std::array<std::uint64_t, FILE_ERRORS.size()> file_errors{};
+    std::uint64_t started = 0;
+    std::uint64_t finished = 0;
+    std::uint64_t aborted = 0;
+    std::uint64_t access_log_dropped = 0;
+
+    for (const auto& shard : shards_) {
+        for (std::size_t route = 0; route < routes_.size(); ++route) {
+            const auto& counters = shard->routes[route];
+            auto& total = totals[route];
+            for (std::size_t i = 0; i < STATUSES.size(); ++i) {
+                total.by_status[i] += counters.by_status[i].get();
+            }
+            for (std::size_t phase = 0; phase < PHASE_NAMES.size(); ++phase) {
+                for (std::size_t i = 0; i <= LATENCY_BUCKETS; ++i) {
+                    total.buckets[phase][i] += counters.phases[phase].buckets[i].get();
+                }
+                total.sum_ns[phase] += counters.phases[phase].sum_ns.get();
+            }
+            total.bytes_in += counters.bytes_in.get();
+            total.bytes_out += counters.bytes_out.get();
+        }
+        for (std::size_t i = 0; i < FILE_ERRORS.size(); ++i) {
+            file_errors[i] += shard->file_errors[i].get();
+        }
+        started += shard->started.get();
+        finished += shard->finished.get();
+        aborted += shard->aborted.get();
+        access_log_dropped += shard->access_log_dropped.get();
+    }
+    for (auto& total : totals) {
+        for (const auto count : total.by_status) {
+            total.requests += count;
+        }
+    }
+
+    std::string out;
+    append_header(out, "sds_requests_total", "counter", "Requests answered, by route and status.");
+    for (std::size_t route = 0; route < routes_.size(); ++route) {
+        for (std::size_t i = 0; i < STATUSES.size(); ++i) {
+            if (totals[route].by_status[i] == 0) {
+                continue;
+            }
+            out += "sds_requests_total";
+            append_labels(out, routes_[route], "status",
+                          std::to_string(static_cast<int>(STATUSES[i])));
+            out += "} ";
+            out += std::to_string(totals[route].by_status[i]);
+            out += '\n';
+        }
+    }
+
+    append_header(out, "sds_request_duration_seconds", "histogram",
+                  "Request latency by route and phase (parse, storage, serialize).");
+    for (std::size_t route = 0; route < routes_.size(); ++route) {
+        const auto& total = totals[route];
+        if (total.requests == 0) {
+            continue;
+        }
+        for (std::size_t phase = 0; phase < PHASE_NAMES.size(); ++phase) {
+            std::uint64_t cumulative = 0;
+            for (std::size_t i = 0; i <= LATENCY_BUCKETS; ++i) {
+                cumulative += total.buckets[phase][i];
+                out += "sds_request_duration_seconds_bucket";
+                append_labels(out, routes_[route], "phase", PHASE_NAMES[phase]);
+                out += ",le=\"";
+                if (i == LATENCY_BUCKETS) {
+                    out += "+Inf";
+                } else {
+                    append_number(out, static_cast<double>(LATENCY_BOUNDS_NS[i]) / 1e9);
+                }
+                out += "\"} ";
+                out += std::to_string(cumulative);
+                out += '\n';
+            }
+            out += "sds_request_duration_seconds_sum";
+            append_labels(out, routes_[route], "phase", PHASE_NAMES[phase]);
+            out += "} ";
+            append_number(out, static_cast<double>(total.sum_ns[phase]) / 1e9);
+            out += "\nsds_request_duration_seconds_count";
+            append_labels(out, routes_[route], "phase", PHASE_NAMES[phase]);
+            out += "} ";
+            out += std::to_string(cumulative);
+            out += '\n';
+        }
+    }
+
+    append_header(out, "sds_request_bytes_total", "counter",
+                  "Request body bytes received, by route.");
+    for (std::size_t route = 0; route < routes_.size(); ++route) {
+        if (totals[route].requests > 0) {
+            out += "sds_request_bytes_total";
+            append_labels(out, routes_[route]);
+            out += "} ";
+            out += std::to_string(totals[route].bytes_in);
+            out += '\n';
+        }
+    }
+
+    append_header(out, "sds_response_bytes_total", "counter",
+                  "Response body bytes sent, by route.");
+    for (std::size_t route = 0; route < routes_.size(); ++route) {
+        if (totals[route].requests > 0) {
+            out += "sds_response_bytes_total";
+            append_labels(out, routes_[route]);
+            out += "} ";
+            out += std::to_string(totals[route].bytes_out);
+            out += '\n';
+        }
+    }
+
+    append_header(out, "sds_requests_in_flight", "gauge",
+                  "Requests received but not yet answered.");
+    out += "sds_requests_in_flight ";
+    // Shards are read one after another, so a request finishing mid-scrape
+    // could be counted as finished but not as started.
+    out += std::to_string(started > finished ? started - finished : 0);
+    out += '\n';
+
+    append_header(out, "sds_requests_aborted_total", "counter",
+                  "Requests the client abandoned before the response was complete.");
+    out += "sds_requests_aborted_total ";
+    out += std::to_string(aborted);
+    out += '\n';
+
+    append_header(out, "sds_access_log_dropped_total", "counter",
+                  "Access log records dropped because the writer fell behind.");
+    out += "sds_access_log_dropped_total ";
+    out += std::to_string(access_log_dropped);
+    out += '\n';
+
+    append_header(out, "sds_file_errors_total", "counter",
+                  "Storage errors behind API responses, by FileError.");
+    for (std::size_t i = 0; i < FILE_ERRORS.size(); ++i) {
+        out += "sds_file_errors_total{error=\"";
+        out += FILE_ERRORS[i].second;
+        out += "\"} ";
+        out += std::to_string(file_errors[i]);
+        out += '\n';
+    }
+    return out;
+}
+
+Metrics::Shard& Metrics::local_shard() noexcept {
+    // There is one Metrics per process, so one lease per thread suffices.
+    thread_local ShardLease lease(*this);
+    return lease.shard();
+}
+
+void Metrics::release(Shard* shard) noexcept {
+    std::lock_guard lock(mutex_);
+    free_shards_.push_back(shard);
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,163 @@
+#ifndef SIMPLE_DATA_SERVER_SERVER_METRICS_HPP
+#define SIMPLE_DATA_SERVER_SERVER_METRICS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "handlers/api_handler.hpp"
+#include "util/request_trace.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Index of a route registered with Metrics::add_route().
+ */
+using RouteId = std::size_t;
+
+/**
+ * @brief Phases a request's latency is split into.
+ */
+enum class RequestPhase : std::size_t {
+    /** Parsing and validating the request body. */
+    Parse,
+    /** Everything the handler does after parsing, mostly storage access. */
+    Storage,
+    /** Building the response body and writing it to the socket. */
+    Serialize
+};
+
+/**
+ * @brief What one finished request contributes to the metrics.
+ */
+struct RequestSample {
+    HttpStatus status;
+    std::chrono::nanoseconds parse{0};
+    std::chrono::nanoseconds storage{0};
+    std::chrono::nanoseconds serialize{0};
+    std::size_t bytes_in = 0;
+    std::size_t bytes_out = 0;
+    std::optional<FileError> file_error{};
+};
+
+/**
+ * @brief Get a storage error's name as used in metric labels, e.g. "FileNotFound".
+ *
+ * @param error The error.
+ * @return std::string_view The name.
+ */
+[[nodiscard]] std::string_view file_error_name(FileError error) noexcept;
+
+/**
+ * @brief Fill a sample's phase durations from the request's trace.
+ *
+ * Parse is TraceStage::Parse; storage is Lookup plus Storage; serialize is
+ * Serialize plus Send. Receiving the body and waiting for a worker thread
+ * are not part of any phase.
+ *
+ * @param trace The finished request's trace.
+ * @param sample Receives the parse, storage and serialize durations.
+ */
+void fill_phases(const RequestTrace& trace, RequestSample& sample) noexcept;
+
+/**
+ * @brief Request counters and latency histograms, exported in Prometheus text format.
+ *
+ * Every thread that records gets its own shard of counters, which only that
+ * thread writes, with relaxed loads and stores rather than locked
+ * read-modify-write instructions; nothing is shared on the hot path. A
+ * scrape sums the shards. A shard outlives its thread and is handed to the
+ * next new thread, so totals never go backwards.
+ *
+ * Latency histograms use log-linear buckets: 1 to 9 times each power of ten
+ * from one microsecond to ten seconds.
+ */
+class Metrics {
+public:
+    /**
+     * @brief Most routes that can be registered.
+     */
+    static constexpr std::size_t MAX_ROUTES = 24;
+
+    /**
+     * @brief Number of latency buckets, not counting +Inf.
+     */
+    static constexpr std::size_t LATENCY_BUCKETS = 9 * 7 + 1;
+
+    /**
+     * @brief Get the process-wide metrics.
+     *
+     * @return Metrics& The instance.
+     */
+    [[nodiscard]] static Metrics& instance() noexcept;
+
+    ~Metrics();
+
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    /**
+     * @brief Register a route label; call before requests are served.
+     *
+     * @param route The label, e.g. "/api/get".
+     * @return RouteId The route's index; the same label returns the same index.
+     * @throws std::length_error if more than MAX_ROUTES routes are registered.
+     */
+    RouteId add_route(std::string_view route);
+
+    /**
+     * @brief Count a request as started, for the in-flight gauge.
+     */
+    void request_started() noexcept;
+
+    /**
+     * @brief Record a finished request.
+     *
+     * @param route The route.
+     * @param sample Status, phase durations, sizes and storage error.
+     */
+    void record(RouteId route, const RequestSample& sample) noexcept;
+
+    /**
+     * @brief Count a request that was aborted by the client before a response was sent.
+     */
+    void request_aborted() noexcept;
+
+    /**
+     * @brief Count access log records dropped because their thread's ring was full.
+     *
+     * @param count Records dropped since the last call.
+     */
+    void access_log_dropped(std::uint64_t count) noexcept;
+
+    /**
+     * @brief Render all metrics in the Prometheus text exposition format.
+     *
+     * @return std::string The exposition.
+     */
+    [[nodiscard]] std::string render() const;
+
+private:
+    struct Shard;
+    class ShardLease;
+
+    Metrics();
+
+    [[nodiscard]] Shard& local_shard() noexcept;
+    void release(Shard* shard) noexcept;
+
+    mutable std::mutex mutex_;
+    std::vector<std::string> routes_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::vector<Shard*> free_shards_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_SERVER_METRICS_HPP
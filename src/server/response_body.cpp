@@ -0,0 +1,90 @@
+#include "server/response_body.hpp"
+
+#include <utility>
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::string_view SUCCESS_OPENING = "{\"status\":\"success\"";
+constexpr std::string_view STATUS_OPENING = "{\"status\":";
+constexpr std::string_view CLOSING = "}";
+
+void append_quoted(std::string& out, std::string_view text) {
+    out += nlohmann::json(text).dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+}
+
+} // namespace
+
+ResponseBody::ResponseBody(ApiResult result)
+    : status_(status_text(result.status)), raw_data_(std::move(result.raw_data)) {
+    // text_ holds everything except the raw values: the envelope with the
+    // members of data, then one ,"name": prefix per raw member. Offsets are
+    // turned into views once text_ stops growing.
+    std::vector<std::pair<std::size_t, std::size_t>> spans;
+
+    if (result.message != "success") {
+        text_ += STATUS_OPENING;
+        append_quoted(text_, result.message);
+    }
+    if (result.data.has_value() && result.data->is_object()) {
+        for (const auto& [name, value] : result.data->items()) {
+            text_ += ',';
+            append_quoted(text_, name);
+            text_ += ':';
+            text_ += value.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+        }
+    }
+    spans.emplace_back(0, text_.size());
+
+    for (const auto& member : raw_data_) {
+        const auto start = text_.size();
+        text_ += ',';
+        append_quoted(text_, member.name);
+        text_ += ':';
+        spans.emplace_back(start, text_.size() - start);
+    }
+
+    fragments_.reserve(2 * raw_data_.size() + 3);
+    if (result.message == "success") {
+        fragments_.push_back(SUCCESS_OPENING);
+    }
+    const std::string_view text(text_);
+    for (std::size_t i = 0; i < spans.size(); ++i) {
+        if (spans[i].second > 0) {
+            fragments_.push_back(text.substr(spans[i].first, spans[i].second));
+        }
+        if (i > 0) {
+            fragments_.push_back(raw_data_[i - 1].json);
+        }
+    }
+    fragments_.push_back(CLOSING);
+
+    for (const auto fragment : fragments_) {
+        size_ += fragment.size();
+    }
+}
+
+std::string_view status_text(HttpStatus status) noexcept {
+    switch (status) {
+        case HttpStatus::Ok:
+            return "200 OK";
+        case HttpStatus::BadRequest:
+            return "400 Bad Request";
+        case HttpStatus::Forbidden:
+            return "403 Forbidden";
+        case HttpStatus::NotFound:
+            return "404 Not Found";
+        case HttpStatus::Conflict:
+            return "409 Conflict";
+        case HttpStatus::PayloadTooLarge:
+            return "413 Payload Too Large";
+        case HttpStatus::InternalServerError:
+            return "500 Internal Server Error";
+        case HttpStatus::InsufficientStorage:
+            return "507 Insufficient Storage";
+    }
+    return "500 Internal Server Error";
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,83 @@
+#ifndef SIMPLE_DATA_SERVER_SERVER_RESPONSE_BODY_HPP
+#define SIMPLE_DATA_SERVER_SERVER_RESPONSE_BODY_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "handlers/api_handler.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief The JSON body of an API response, as a list of fragments to write in order.
+ *
+ * Produces {"status": message, <members of data>..., <raw_data>...}. The
+ * members of data are serialized one by one into a single buffer instead of
+ * being copied into an envelope object first, the common envelope openings
+ * are constants, and raw_data members are referenced in place, so a stored
+ * document is written to the socket without being copied or parsed. The
+ * total size is known up front for the Content-Length header.
+ *
+ * The fragments point into the object itself, so it can be neither copied
+ * nor moved.
+ */
+class ResponseBody {
+public:
+    /**
+     * @brief Serialize an API result.
+     *
+     * @param result The result; its raw_data is taken over.
+     */
+    explicit ResponseBody(ApiResult result);
+
+    ResponseBody(const ResponseBody&) = delete;
+    ResponseBody& operator=(const ResponseBody&) = delete;
+
+    /**
+     * @brief Get the HTTP status line text, e.g. "200 OK".
+     *
+     * @return std::string_view The status.
+     */
+    [[nodiscard]] std::string_view status() const noexcept {
+        return status_;
+    }
+
+    /**
+     * @brief Get the body fragments, to be written in order.
+     *
+     * @return const std::vector<std::string_view>& The fragments.
+     */
+    [[nodiscard]] const std::vector<std::string_view>& fragments() const noexcept {
+        return fragments_;
+    }
+
+    /**
+     * @brief Get the total body size in bytes.
+     *
+     * @return std::size_t The sum of the fragment sizes.
+     */
+    [[nodiscard]] std::size_t size() const noexcept {
+        return size_;
+    }
+
+private:
+    std::string_view status_;
+    std::vector<RawJsonMember> raw_data_;
+    std::string text_;
+    std::vector<std::string_view> fragments_;
+    std::size_t size_ = 0;
+};
+
+/**
+ * @brief Get the HTTP status line text for a status code.
+ *
+ * @param status The status.
+ * @return std::string_view E.g. "404 Not Found".
+ */
+[[nodiscard]] std::string_view status_text(HttpStatus status) noexcept;
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_SERVER_RESPONSE_BODY_HPP
@@ -0,0 +1,77 @@
+#include "server/slow_log.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <system_error>
+#include <unistd.h>
+
+#include <nlohmann/json.hpp>
+
+namespace simple_data_server {
+
+namespace {
+
+std::int64_t microseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+
+} // namespace
+
+SlowLog::SlowLog(const std::string& path, std::chrono::microseconds threshold)
+    : fd_(STDERR_FILENO), owns_fd_(false), threshold_(threshold) {
+    if (path == "-") {
+        return;
+    }
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open slow log " + path);
+    }
+    owns_fd_ = true;
+}
+
+SlowLog::~SlowLog() {
+    if (owns_fd_) {
+        ::close(fd_);
+    }
+}
+
+void SlowLog::record(std::string_view route,
+                     const RequestTrace& trace,
+                     const RequestSample& sample) const noexcept {
+    try {
+        const auto total = trace.total();
+        if (total < threshold_) {
+            return;
+        }
+
+        nlohmann::ordered_json entry;
+        entry["timestamp_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                    std::chrono::system_clock::now().time_since_epoch())
+                                    .count();
+        entry["route"] = route;
+        entry["status"] = static_cast<int>(sample.status);
+        entry["total_us"] = microseconds(total);
+        auto& stages = entry["stages_us"];
+        for (std::size_t i = 0; i < TRACE_STAGE_COUNT; ++i) {
+            const auto stage = static_cast<TraceStage>(i);
+            stages[std::string(trace_stage_name(stage))] = microseconds(trace.duration(stage));
+        }
+        entry["bytes_in"] = sample.bytes_in;
+        entry["bytes_out"] = sample.bytes_out;
+        if (sample.file_error) {
+            entry["error"] = file_error_name(*sample.file_error);
+        }
+
+        auto line = entry.dump();
+        line += '\n';
+        // One append per line keeps lines whole; a failed write only loses the line.
+        ssize_t written;
+        do {
+            written = ::write(fd_, line.data(), line.size());
+        } while (written < 0 && errno == EINTR);
+    } catch (const std::exception&) {
+        // Logging must never fail a request.
+    }
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,56 @@
+#ifndef SIMPLE_DATA_SERVER_SERVER_SLOW_LOG_HPP
+#define SIMPLE_DATA_SERVER_SERVER_SLOW_LOG_HPP
+
+#include <chrono>
+#include <string>
+#include <string_view>
+
+#include "server/metrics.hpp"
+#include "util/request_trace.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Writes requests that took longer than a threshold, one JSON object per line.
+ *
+ * Each line holds the route, status, sizes, storage error and the duration
+ * of every TraceStage, so a latency spike can be pinned on body receipt,
+ * parsing, the key directory lookup, file I/O or building the response.
+ * A line is written with a single append, so lines never interleave.
+ */
+class SlowLog {
+public:
+    /**
+     * @brief Open the log.
+     *
+     * @param path File to append to, or "-" for standard error.
+     * @param threshold Requests taking at least this long are logged.
+     * @throws std::system_error if the file cannot be opened.
+     */
+    SlowLog(const std::string& path, std::chrono::microseconds threshold);
+
+    ~SlowLog();
+
+    SlowLog(const SlowLog&) = delete;
+    SlowLog& operator=(const SlowLog&) = delete;
+
+    /**
+     * @brief Log a finished request if it was slow.
+     *
+     * @param route The route label.
+     * @param trace The request's trace.
+     * @param sample Status, sizes and storage error of the request.
+     */
+    void record(std::string_view route,
+                const RequestTrace& trace,
+                const RequestSample& sample) const noexcept;
+
+private:
+    int fd_;
+    bool owns_fd_;
+    std::chrono::microseconds threshold_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_SERVER_SLOW_LOG_HPP
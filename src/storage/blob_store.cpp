@@ -0,0 +1,137 @@
+#include "storage/blob_store.hpp"
+
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "storage/content_hash.hpp"
+#include "storage/file_io.hpp"
+#include "util/stop_sleep.hpp"
+
+namespace simple_data_server {
+
+BlobStore::BlobStore(std::string root_directory)
+    : root_directory_(std::move(root_directory)) {
+    std::filesystem::create_directories(root_directory_);
+}
+
+BlobStore::~BlobStore() {
+    stop_garbage_collector();
+}
+
+std::expected<void, FileError>
+BlobStore::store_and_link(std::string_view bytes,
+                          std::uint64_t hash,
+                          int directory_fd,
+                          std::string_view filename) noexcept {
+    try {
+        const EntryName name(filename);
+        const auto link_name = EntryName::temporary_for(filename);
+        if (!name.valid() || !link_name.valid()) {
+            return std::unexpected(FileError::InvalidFilename);
+        }
+        const auto blob_path = get_blob_path(hash);
+
+        std::lock_guard lock(mutex_);
+
+        std::error_code ec;
+        bool reuse = std::filesystem::exists(blob_path, ec);
+        if (reuse) {
+            // Guard against hash collisions: only share a blob whose bytes match.
+            const auto existing = read_file(blob_path, MAX_DOCUMENT_SIZE);
+            reuse = existing.has_value() && existing.value() == bytes;
+            if (!reuse) {
+                return write_file_atomically_at(directory_fd, filename, bytes, false);
+            }
+        } else {
+            std::filesystem::create_directories(std::filesystem::path(blob_path).parent_path(), ec);
+            const auto written = write_file_atomically(blob_path, bytes, false);
+            if (!written) {
+                return written;
+            }
+        }
+
+        if (::linkat(AT_FDCWD, blob_path.c_str(), directory_fd, link_name.c_str(), 0) != 0) {
+            // Link limits or cross-device data directories: fall back to a private copy.
+            return write_file_atomically_at(directory_fd, filename, bytes, false);
+        }
+
+        if (::renameat(directory_fd, link_name.c_str(), directory_fd, name.c_str()) != 0) {
+            ::unlinkat(directory_fd, link_name.c_str(), 0);
+            return std::unexpected(FileError::IoError);
+        }
+        return {};
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+bool BlobStore::is_linked_to(std::uint64_t hash,
+                             int directory_fd,
+                             std::string_view filename) const noexcept {
+    try {
+        const EntryName name(filename);
+        struct stat document{};
+        struct stat blob{};
+        return name.valid() && ::fstatat(directory_fd, name.c_str(), &document, 0) == 0 &&
+               ::stat(get_blob_path(hash).c_str(), &blob) == 0 &&
+               document.st_dev == blob.st_dev && document.st_ino == blob.st_ino;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+std::size_t BlobStore::collect_garbage() noexcept {
+    std::size_t removed = 0;
+
+    try {
+        std::error_code ec;
+        for (const auto& shard : std::filesystem::directory_iterator(root_directory_, ec)) {
+            if (!shard.is_directory(ec)) {
+                continue;
+            }
+
+            for (const auto& entry : std::filesystem::directory_iterator(shard.path(), ec)) {
+                if (entry.path().extension() != JSON_EXTENSION) {
+                    continue;
+                }
+
+                std::lock_guard lock(mutex_);
+                if (std::filesystem::hard_link_count(entry.path(), ec) == 1 && !ec) {
+                    if (std::filesystem::remove(entry.path(), ec)) {
+                        ++removed;
+                    }
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Blob garbage collection failed: " << e.what() << std::endl;
+    }
+
+    return removed;
+}
+
+void BlobStore::start_garbage_collector(std::chrono::seconds interval) {
+    gc_thread_ = std::jthread([this, interval](std::stop_token stop_token) {
+        while (sleep_for(stop_token, interval)) {
+            collect_garbage();
+        }
+    });
+}
+
+void BlobStore::stop_garbage_collector() noexcept {
+    if (gc_thread_.joinable()) {
+        gc_thread_.request_stop();
+        gc_thread_.join();
+    }
+}
+
+std::string BlobStore::get_blob_path(std::uint64_t hash) const {
+    const auto name = format_content_hash(hash);
+    return root_directory_ + "/" + name.substr(0, 2) + "/" + name + std::string(JSON_EXTENSION);
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,116 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_BLOB_STORE_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_BLOB_STORE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <expected.hpp>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "storage/file_manager.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Content-addressed store for document bytes.
+ *
+ * Each distinct document is stored once under .blobs/{hh}/{hash}.json, where
+ * hash is its content hash. Key documents are hard links to their blob, so
+ * identical documents under different keys or filenames share one inode (and
+ * therefore one copy on disk and in the page cache). The file system link count
+ * is the reference count: a blob whose only remaining link is its own entry in
+ * the store is garbage and is removed by collect_garbage().
+ *
+ * Blobs are never modified in place; documents are replaced by renaming a new
+ * link over the old one.
+ */
+class BlobStore {
+public:
+    /**
+     * @brief Construct a BlobStore rooted at the given directory.
+     *
+     * @param root_directory Path to the blob directory (e.g., "data/.blobs").
+     * @post Creates the blob directory if it doesn't exist.
+     */
+    explicit BlobStore(std::string root_directory);
+
+    /**
+     * @brief Stops the background garbage collector, if running.
+     */
+    ~BlobStore();
+
+    BlobStore(const BlobStore&) = delete;
+    BlobStore& operator=(const BlobStore&) = delete;
+
+    /**
+     * @brief Store bytes in the blob store and atomically link them as a document.
+     *
+     * If a blob with the same content already exists it is reused. Any existing
+     * document with that name is replaced atomically.
+     *
+     * @param bytes The document bytes.
+     * @param hash The content hash of bytes.
+     * @param directory_fd The open key directory of the document.
+     * @param filename The document's name within that directory.
+     * @return std::expected<void, FileError> Success or error.
+     * @post On success, the document and the blob for hash are the same inode.
+     */
+    [[nodiscard]] std::expected<void, FileError>
+    store_and_link(std::string_view bytes,
+                   std::uint64_t hash,
+                   int directory_fd,
+                   std::string_view filename) noexcept;
+
+    /**
+     * @brief Check whether a document is a link to the blob with the given hash.
+     *
+     * This answers "does the document have this content" with two stat() calls
+     * instead of reading and hashing the file.
+     *
+     * @param hash The content hash.
+     * @param directory_fd The open key directory of the document.
+     * @param filename The document's name within that directory.
+     * @return true if the document and the blob are the same inode.
+     */
+    [[nodiscard]] bool
+    is_linked_to(std::uint64_t hash, int directory_fd, std::string_view filename) const noexcept;
+
+    /**
+     * @brief Remove all blobs that are no longer referenced by any document.
+     *
+     * @return std::size_t The number of blobs removed.
+     */
+    std::size_t collect_garbage() noexcept;
+
+    /**
+     * @brief Run collect_garbage() periodically on a background thread.
+     *
+     * @param interval Time between collections.
+     */
+    void start_garbage_collector(std::chrono::seconds interval);
+
+    /**
+     * @brief Stop the background garbage collector and wait for it to exit.
+     */
+    void stop_garbage_collector() noexcept;
+
+private:
+    /**
+     * @brief Get the full path for a blob.
+     *
+     * @param hash The content hash.
+     * @return std::string The full path to the blob file.
+     */
+    [[nodiscard]] std::string get_blob_path(std::uint64_t hash) const;
+
+    std::string root_directory_;
+    mutable std::mutex mutex_;
+
+    std::jthread gc_thread_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_BLOB_STORE_HPP
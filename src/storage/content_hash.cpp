@@ -0,0 +1,133 @@
+#include "storage/content_hash.hpp"
+
+#include <cstring>
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::uint64_t PRIME_1 = 11400714785074694791ULL;
+constexpr std::uint64_t PRIME_2 = 14029467366897019727ULL;
+constexpr std::uint64_t PRIME_3 = 1609587929392839161ULL;
+constexpr std::uint64_t PRIME_4 = 9650029242287828579ULL;
+constexpr std::uint64_t PRIME_5 = 2870177450012600261ULL;
+
+constexpr std::size_t HASH_HEX_LENGTH = 16;
+
+constexpr std::uint64_t rotl(std::uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+std::uint64_t read_u64(const char* p) {
+    std::uint64_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+std::uint32_t read_u32(const char* p) {
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+constexpr std::uint64_t round(std::uint64_t acc, std::uint64_t input) {
+    acc += input * PRIME_2;
+    acc = rotl(acc, 31);
+    return acc * PRIME_1;
+}
+
+constexpr std::uint64_t merge_round(std::uint64_t acc, std::uint64_t value) {
+    acc ^= round(0, value);
+    return acc * PRIME_1 + PRIME_4;
+}
+
+} // namespace
+
+std::uint64_t content_hash(std::string_view bytes, std::uint64_t seed) noexcept {
+    const char* p = bytes.data();
+    const char* const end = p + bytes.size();
+    std::uint64_t h64;
+
+    if (bytes.size() >= 32) {
+        std::uint64_t v1 = seed + PRIME_1 + PRIME_2;
+        std::uint64_t v2 = seed + PRIME_2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - PRIME_1;
+
+        const char* const limit = end - 32;
+        do {
+            v1 = round(v1, read_u64(p));
+            v2 = round(v2, read_u64(p + 8));
+            v3 = round(v3, read_u64(p + 16));
+            v4 = round(v4, read_u64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h64 = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        h64 = merge_round(h64, v1);
+        h64 = merge_round(h64, v2);
+        h64 = merge_round(h64, v3);
+        h64 = merge_round(h64, v4);
+    } else {
+        h64 = seed + PRIME_5;
+    }
+
+    h64 += static_cast<std::uint64_t>(bytes.size());
+
+    while (p + 8 <= end) {
+        h64 ^= round(0, read_u64(p));
+        h64 = rotl(h64, 27) * PRIME_1 + PRIME_4;
+        p += 8;
+    }
+
+    if (p + 4 <= end) {
+        h64 ^= static_cast<std::uint64_t>(read_u32(p)) * PRIME_1;
+        h64 = rotl(h64, 23) * PRIME_2 + PRIME_3;
+        p += 4;
+    }
+
+    while (p < end) {
+        h64 ^= static_cast<std::uint64_t>(static_cast<unsigned char>(*p)) * PRIME_5;
+        h64 = rotl(h64, 11) * PRIME_1;
+        ++p;
+    }
+
+    h64 ^= h64 >> 33;
+    h64 *= PRIME_2;
+    h64 ^= h64 >> 29;
+    h64 *= PRIME_3;
+    h64 ^= h64 >> 32;
+    return h64;
+}
+
+std::string format_content_hash(std::uint64_t hash) {
+    static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+    std::string result(HASH_HEX_LENGTH, '0');
+    for (std::size_t i = HASH_HEX_LENGTH; i-- > 0;) {
+        result[i] = HEX_DIGITS[hash & 0xF];
+        hash >>= 4;
+    }
+    return result;
+}
+
+std::optional<std::uint64_t> parse_content_hash(std::string_view text) noexcept {
+    if (text.size() != HASH_HEX_LENGTH) {
+        return std::nullopt;
+    }
+
+    std::uint64_t hash = 0;
+    for (char c : text) {
+        std::uint64_t digit;
+        if (c >= '0' && c <= '9') {
+            digit = static_cast<std::uint64_t>(c - '0');
+        } else if (c >= 'a' && c <= 'f') {
+            digit = static_cast<std::uint64_t>(c - 'a' + 10);
+        } else {
+            return std::nullopt;
+        }
+        hash = (hash << 4) | digit;
+    }
+    return hash;
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,41 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_CONTENT_HASH_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_CONTENT_HASH_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace simple_data_server {
+
+/**
+ * @brief Compute a 64-bit content hash (XXH64) of a byte sequence.
+ *
+ * The result is stable across platforms and process restarts, so it can be
+ * persisted and compared later.
+ *
+ * @param bytes The bytes to hash.
+ * @param seed Optional seed value.
+ * @return std::uint64_t The hash value.
+ */
+[[nodiscard]] std::uint64_t content_hash(std::string_view bytes, std::uint64_t seed = 0) noexcept;
+
+/**
+ * @brief Format a content hash as a fixed-width, lowercase hexadecimal string.
+ *
+ * @param hash The hash value.
+ * @return std::string A 16-character hex string.
+ */
+[[nodiscard]] std::string format_content_hash(std::uint64_t hash);
+
+/**
+ * @brief Parse a hash previously produced by format_content_hash().
+ *
+ * @param text The hex string.
+ * @return std::optional<std::uint64_t> The hash, or std::nullopt if malformed.
+ */
+[[nodiscard]] std::optional<std::uint64_t> parse_content_hash(std::string_view text) noexcept;
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_CONTENT_HASH_HPP
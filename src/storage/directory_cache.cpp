@@ -0,0 +1,96 @@
+#include "storage/directory_cache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+#include "storage/file_io.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::chrono::seconds REVALIDATE_INTERVAL{1};
+
+} // namespace
+
+DirectoryHandle::~DirectoryHandle() {
+    ::close(fd_);
+}
+
+DirectoryCache::DirectoryCache(const std::string& data_directory, std::size_t capacity)
+    : data_fd_(::open(data_directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)),
+      capacity_(std::max<std::size_t>(capacity, 1)) {
+    if (data_fd_ < 0) {
+        throw std::system_error(errno, std::generic_category(),
+                                "Cannot open data directory " + data_directory);
+    }
+}
+
+DirectoryCache::~DirectoryCache() {
+    ::close(data_fd_);
+}
+
+std::shared_ptr<const DirectoryHandle> DirectoryCache::open(std::string_view key, bool create) {
+    const EntryName name(key);
+    if (!name.valid()) {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        const auto it = by_key_.find(key);
+        if (it != by_key_.end()) {
+            auto& entry = *it->second;
+            const auto now = std::chrono::steady_clock::now();
+            if (now - entry.validated < REVALIDATE_INTERVAL || still_current(entry)) {
+                entry.validated = now;
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return entry.handle;
+            }
+            entries_.erase(it->second);
+            by_key_.erase(it);
+        }
+    }
+
+    // Open outside the lock so a slow directory lookup does not stall other keys.
+    if (create && ::mkdirat(data_fd_, name.c_str(), 0755) != 0 && errno != EEXIST) {
+        return nullptr;
+    }
+    const int fd = ::openat(data_fd_, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    auto handle = std::make_shared<const DirectoryHandle>(fd);
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        return nullptr;
+    }
+
+    std::lock_guard lock(mutex_);
+    if (const auto it = by_key_.find(key); it != by_key_.end()) {
+        // Another thread opened it meanwhile; keep one descriptor per key.
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return it->second->handle;
+    }
+    entries_.push_front(
+        Entry{std::string(key), handle, st.st_dev, st.st_ino, std::chrono::steady_clock::now()});
+    by_key_.emplace(entries_.front().key, entries_.begin());
+    while (entries_.size() > capacity_) {
+        by_key_.erase(entries_.back().key);
+        entries_.pop_back();
+    }
+    return handle;
+}
+
+bool DirectoryCache::still_current(const Entry& entry) const noexcept {
+    const EntryName name(entry.key);
+    struct stat st{};
+    return ::fstatat(data_fd_, name.c_str(), &st, 0) == 0 && S_ISDIR(st.st_mode) &&
+           st.st_dev == entry.device && st.st_ino == entry.inode;
+}
+
+} // namespace simple_data_server
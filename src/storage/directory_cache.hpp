@@ -0,0 +1,118 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_DIRECTORY_CACHE_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_DIRECTORY_CACHE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/types.h>
+#include <unordered_map>
+
+namespace simple_data_server {
+
+/**
+ * @brief An open directory file descriptor, closed with the last reference.
+ */
+class DirectoryHandle {
+public:
+    /**
+     * @brief Take ownership of a file descriptor.
+     *
+     * @param fd An open directory.
+     */
+    explicit DirectoryHandle(int fd) noexcept : fd_(fd) {
+    }
+
+    ~DirectoryHandle();
+
+    DirectoryHandle(const DirectoryHandle&) = delete;
+    DirectoryHandle& operator=(const DirectoryHandle&) = delete;
+
+    /**
+     * @brief Get the file descriptor, for use with openat() and friends.
+     *
+     * @return int The descriptor.
+     */
+    [[nodiscard]] int fd() const noexcept {
+        return fd_;
+    }
+
+private:
+    int fd_;
+};
+
+/**
+ * @brief Least recently used cache of open key directories.
+ *
+ * Lets FileManager resolve a document with openat() relative to its key
+ * directory instead of building "data/key/file" and having the kernel walk
+ * it from the start on every request. Handles are reference counted, so an
+ * evicted directory stays open until requests using it finish.
+ *
+ * Key directories are created and removed by hand, so a cached entry is
+ * checked against the directory entry (device and inode) again when it is
+ * more than a second old; a directory that was removed or replaced is then
+ * reopened or reported missing. Missing directories are never cached.
+ */
+class DirectoryCache {
+public:
+    /**
+     * @brief Open the data directory and create an empty cache.
+     *
+     * @param data_directory Path to the data directory; must exist.
+     * @param capacity Number of key directories kept open; at least one.
+     * @throws std::system_error if the data directory cannot be opened.
+     */
+    DirectoryCache(const std::string& data_directory, std::size_t capacity);
+
+    ~DirectoryCache();
+
+    DirectoryCache(const DirectoryCache&) = delete;
+    DirectoryCache& operator=(const DirectoryCache&) = delete;
+
+    /**
+     * @brief Get the open directory of a key.
+     *
+     * @param key A key accepted by is_valid_key().
+     * @param create Create the directory if it does not exist.
+     * @return std::shared_ptr<const DirectoryHandle> The directory, or nullptr
+     *         if it does not exist (and could not be created).
+     */
+    [[nodiscard]] std::shared_ptr<const DirectoryHandle> open(std::string_view key,
+                                                              bool create = false);
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const DirectoryHandle> handle;
+        dev_t device;
+        ino_t inode;
+        std::chrono::steady_clock::time_point validated;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    [[nodiscard]] bool still_current(const Entry& entry) const noexcept;
+
+    int data_fd_;
+    std::size_t capacity_;
+
+    std::mutex mutex_;
+
+    /**
+     * @brief Entries, most recently used first.
+     */
+    EntryList entries_;
+
+    /**
+     * @brief Entries by key; the views refer to Entry::key, which list nodes never move.
+     */
+    std::unordered_map<std::string_view, EntryList::iterator> by_key_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_DIRECTORY_CACHE_HPP
@@ -0,0 +1,280 @@
+#include "storage/document_index.hpp"
+
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <sys/stat.h>
+
+#include "storage/file_io.hpp"
+#include "storage/snapshot_codec.hpp"
+#include "util/thread_pool.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::string_view SNAPSHOT_FILENAME = ".index";
+constexpr std::string_view SNAPSHOT_MAGIC = "SDSIDX01";
+
+} // namespace
+
+DocumentIndex::DocumentIndex(std::string data_directory)
+    : data_directory_(std::move(data_directory)) {
+}
+
+DocumentIndex::LoadStats DocumentIndex::load(ThreadPool& pool) {
+    LoadStats stats;
+    auto snapshot = read_snapshot();
+
+    KeyMap keys;
+    std::vector<std::string> stale_keys;
+
+    DIR* dir = ::opendir(data_directory_.c_str());
+    if (dir != nullptr) {
+        while (const auto* entry = ::readdir(dir)) {
+            const std::string_view name(entry->d_name);
+            if (name.empty() || name.front() == '.') {
+                continue;
+            }
+
+            const auto mtime = directory_mtime_ns(data_directory_ + "/" + std::string(name));
+            if (!mtime) {
+                continue;
+            }
+
+            const auto cached = snapshot.find(name);
+            if (cached != snapshot.end() && cached->second.directory_mtime_ns == mtime.value()) {
+                keys.emplace(std::string(name), std::move(cached->second));
+                ++stats.keys_from_snapshot;
+            } else {
+                stale_keys.emplace_back(name);
+            }
+        }
+        ::closedir(dir);
+    }
+
+    std::vector<KeyEntry> scanned(stale_keys.size());
+    pool.parallel_for(stale_keys.size(), [&](std::size_t i) {
+        const auto key_dir = data_directory_ + "/" + stale_keys[i];
+        auto& entry = scanned[i];
+        entry.directory_mtime_ns = directory_mtime_ns(key_dir).value_or(0);
+
+        DIR* key_handle = ::opendir(key_dir.c_str());
+        if (key_handle == nullptr) {
+            return;
+        }
+
+        const int dir_fd = ::dirfd(key_handle);
+        while (const auto* file = ::readdir(key_handle)) {
+            const std::string_view name(file->d_name);
+            if (!is_document_entry(name)) {
+                continue;
+            }
+
+            struct stat st{};
+            if (::fstatat(dir_fd, file->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0 ||
+                !S_ISREG(st.st_mode)) {
+                continue;
+            }
+            entry.documents.emplace(std::string(name),
+                                    DocumentInfo{static_cast<std::uint64_t>(st.st_size),
+                                                 mtime_ns(st), 0, false});
+        }
+        ::closedir(key_handle);
+    });
+
+    for (std::size_t i = 0; i < stale_keys.size(); ++i) {
+        keys.insert_or_assign(std::move(stale_keys[i]), std::move(scanned[i]));
+    }
+    stats.keys_scanned = stale_keys.size();
+
+    for (const auto& [key, entry] : keys) {
+        stats.documents += entry.documents.size();
+    }
+
+    std::unique_lock lock(mutex_);
+    keys_ = std::move(keys);
+    return stats;
+}
+
+bool DocumentIndex::save_snapshot() const noexcept {
+    try {
+        SnapshotWriter writer;
+        writer.put_bytes(SNAPSHOT_MAGIC);
+
+        std::shared_lock lock(mutex_);
+        writer.put(static_cast<std::uint64_t>(keys_.size()));
+        for (const auto& [key, entry] : keys_) {
+            const auto mtime = directory_mtime_ns(data_directory_ + "/" + key);
+
+            writer.put_string(key);
+            writer.put(mtime.value_or(MISSING_DIRECTORY_MTIME));
+            writer.put(static_cast<std::uint64_t>(entry.documents.size()));
+            for (const auto& [filename, info] : entry.documents) {
+                writer.put_string(filename);
+                writer.put(info.size);
+                writer.put(info.mtime_ns);
+                writer.put(info.hash);
+                writer.put(static_cast<std::uint8_t>(info.has_hash ? 1 : 0));
+            }
+        }
+        lock.unlock();
+
+        const auto path = data_directory_ + "/" + std::string(SNAPSHOT_FILENAME);
+        return write_file_atomically(path, writer.finish(), true).has_value();
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to write index snapshot: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void DocumentIndex::update(std::string_view key, std::string_view filename, const DocumentInfo& info) {
+    std::unique_lock lock(mutex_);
+    auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        it = keys_.emplace(std::string(key), KeyEntry{}).first;
+    }
+    auto& documents = it->second.documents;
+    const auto doc = documents.find(filename);
+    if (doc == documents.end()) {
+        documents.emplace(std::string(filename), info);
+    } else {
+        doc->second = info;
+    }
+}
+
+bool DocumentIndex::set_hash_if_unchanged(std::string_view key,
+                                          std::string_view filename,
+                                          std::int64_t mtime_ns,
+                                          std::uint64_t size,
+                                          std::uint64_t hash) {
+    std::unique_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return false;
+    }
+    const auto doc = it->second.documents.find(filename);
+    if (doc == it->second.documents.end() || doc->second.mtime_ns != mtime_ns ||
+        doc->second.size != size) {
+        return false;
+    }
+    doc->second.hash = hash;
+    doc->second.has_hash = true;
+    return true;
+}
+
+void DocumentIndex::remove(std::string_view key, std::string_view filename) {
+    std::unique_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return;
+    }
+    const auto doc = it->second.documents.find(filename);
+    if (doc != it->second.documents.end()) {
+        it->second.documents.erase(doc);
+    }
+}
+
+std::optional<DocumentInfo> DocumentIndex::find(std::string_view key,
+                                                std::string_view filename) const {
+    std::shared_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return std::nullopt;
+    }
+    const auto doc = it->second.documents.find(filename);
+    if (doc == it->second.documents.end()) {
+        return std::nullopt;
+    }
+    return doc->second;
+}
+
+std::vector<std::pair<std::string, KeyUsage>> DocumentIndex::usage_by_key() const {
+    std::vector<std::pair<std::string, KeyUsage>> result;
+
+    std::shared_lock lock(mutex_);
+    result.reserve(keys_.size());
+    for (const auto& [key, entry] : keys_) {
+        KeyUsage usage;
+        for (const auto& [filename, info] : entry.documents) {
+            usage.bytes += static_cast<std::int64_t>(info.size);
+            ++usage.files;
+        }
+        result.emplace_back(key, usage);
+    }
+    return result;
+}
+
+std::vector<std::string> DocumentIndex::keys() const {
+    std::vector<std::string> result;
+
+    std::shared_lock lock(mutex_);
+    result.reserve(keys_.size());
+    for (const auto& [key, entry] : keys_) {
+        result.push_back(key);
+    }
+    return result;
+}
+
+void DocumentIndex::for_each_document(
+    std::string_view key,
+    const std::function<void(const std::string&, const DocumentInfo&)>& visitor) const {
+    std::shared_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return;
+    }
+    for (const auto& [filename, info] : it->second.documents) {
+        visitor(filename, info);
+    }
+}
+
+DocumentIndex::KeyMap DocumentIndex::read_snapshot() const {
+    KeyMap keys;
+
+    const auto path = data_directory_ + "/" + std::string(SNAPSHOT_FILENAME);
+    const auto content = read_file(path, std::numeric_limits<std::size_t>::max());
+    if (!content) {
+        return keys;
+    }
+
+    const auto body = open_snapshot(content.value(), SNAPSHOT_MAGIC);
+    if (!body) {
+        std::cerr << "Ignoring corrupt index snapshot " << path << std::endl;
+        return keys;
+    }
+
+    SnapshotReader reader(body.value());
+    std::uint64_t key_count = 0;
+    if (!reader.get(key_count)) {
+        return {};
+    }
+
+    for (std::uint64_t k = 0; k < key_count; ++k) {
+        std::string key;
+        KeyEntry entry;
+        std::uint64_t document_count = 0;
+        if (!reader.get_string(key) || !reader.get(entry.directory_mtime_ns) ||
+            !reader.get(document_count)) {
+            return {};
+        }
+
+        for (std::uint64_t d = 0; d < document_count; ++d) {
+            std::string filename;
+            DocumentInfo info;
+            std::uint8_t has_hash = 0;
+            if (!reader.get_string(filename) || !reader.get(info.size) ||
+                !reader.get(info.mtime_ns) || !reader.get(info.hash) || !reader.get(has_hash)) {
+                return {};
+            }
+            info.has_hash = has_hash != 0;
+            entry.documents.emplace_hint(entry.documents.end(), std::move(filename), info);
+        }
+        keys.emplace(std::move(key), std::move(entry));
+    }
+    return keys;
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,181 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_DOCUMENT_INDEX_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_DOCUMENT_INDEX_HPP
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "storage/usage_tracker.hpp"
+
+namespace simple_data_server {
+
+class ThreadPool;
+
+/**
+ * @brief Metadata about one stored document.
+ */
+struct DocumentInfo {
+    std::uint64_t size = 0;
+    std::int64_t mtime_ns = 0;
+
+    /**
+     * @brief Content hash; only meaningful when has_hash is set.
+     *
+     * The startup scan does not read documents, so hashes are only known for
+     * documents written (or verified) since the index was created.
+     */
+    std::uint64_t hash = 0;
+    bool has_hash = false;
+};
+
+/**
+ * @brief In-memory metadata for every document in the data directory.
+ *
+ * The index is built at startup from a binary snapshot written on clean
+ * shutdown (data/.index). Each key's snapshot entry is reused only if the key
+ * directory's mtime still matches the one recorded in the snapshot; all other
+ * key directories are rescanned in parallel. Since the server always creates
+ * or replaces documents by renaming into the key directory, any change made
+ * through the server also changes the directory mtime.
+ */
+class DocumentIndex {
+public:
+    /**
+     * @brief Counters describing how the index was loaded.
+     */
+    struct LoadStats {
+        std::size_t keys_from_snapshot = 0;
+        std::size_t keys_scanned = 0;
+        std::size_t documents = 0;
+    };
+
+    /**
+     * @brief Construct an empty DocumentIndex for the given data directory.
+     *
+     * @param data_directory Path to the data directory.
+     */
+    explicit DocumentIndex(std::string data_directory);
+
+    /**
+     * @brief Populate the index from the snapshot and a parallel scan.
+     *
+     * @param pool Thread pool used to scan stale or unknown key directories.
+     * @return LoadStats How many keys were reused and rescanned.
+     */
+    LoadStats load(ThreadPool& pool);
+
+    /**
+     * @brief Write the binary snapshot to data/.index.
+     *
+     * Must only be called when no writes are in flight, e.g. on clean shutdown.
+     *
+     * @return true on success.
+     */
+    bool save_snapshot() const noexcept;
+
+    /**
+     * @brief Record a document that was created or replaced.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename (with extension).
+     * @param info The document metadata.
+     */
+    void update(std::string_view key, std::string_view filename, const DocumentInfo& info);
+
+    /**
+     * @brief Record a document's content hash if its entry still describes
+     *        the version that was hashed.
+     *
+     * Does nothing if the document is no longer indexed or has been replaced,
+     * i.e. its mtime or size no longer match.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename (with extension).
+     * @param mtime_ns The modification time of the version that was hashed.
+     * @param size The size of the version that was hashed.
+     * @param hash Its content hash.
+     * @return true if the hash was recorded.
+     */
+    bool set_hash_if_unchanged(std::string_view key,
+                               std::string_view filename,
+                               std::int64_t mtime_ns,
+                               std::uint64_t size,
+                               std::uint64_t hash);
+
+    /**
+     * @brief Forget a document that was removed.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename (with extension).
+     */
+    void remove(std::string_view key, std::string_view filename);
+
+    /**
+     * @brief Look up one document.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename (with extension).
+     * @return std::optional<DocumentInfo> The metadata, if known.
+     */
+    [[nodiscard]] std::optional<DocumentInfo> find(std::string_view key,
+                                                   std::string_view filename) const;
+
+    /**
+     * @brief Compute the total usage of every key.
+     *
+     * @return std::vector<std::pair<std::string, KeyUsage>> Usage per key.
+     */
+    [[nodiscard]] std::vector<std::pair<std::string, KeyUsage>> usage_by_key() const;
+
+    /**
+     * @brief Get the names of all indexed keys.
+     *
+     * @return std::vector<std::string> The keys.
+     */
+    [[nodiscard]] std::vector<std::string> keys() const;
+
+    /**
+     * @brief Visit every document of a key under a shared lock.
+     *
+     * The visitor must not call back into the index.
+     *
+     * @param key The user's shared key.
+     * @param visitor Called with (filename, info) for each document, in filename order.
+     */
+    void for_each_document(
+        std::string_view key,
+        const std::function<void(const std::string&, const DocumentInfo&)>& visitor) const;
+
+private:
+    struct KeyEntry {
+        std::int64_t directory_mtime_ns = 0;
+        std::map<std::string, DocumentInfo, std::less<>> documents;
+    };
+
+    struct StringHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view value) const noexcept {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    using KeyMap = std::unordered_map<std::string, KeyEntry, StringHash, std::equal_to<>>;
+
+    [[nodiscard]] KeyMap read_snapshot() const;
+
+    std::string data_directory_;
+
+    mutable std::shared_mutex mutex_;
+    KeyMap keys_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_DOCUMENT_INDEX_HPP
@@ -0,0 +1,299 @@
+#include "storage/expiry_manager.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+#include <nlohmann/json.hpp>
+
+#include "storage/file_io.hpp"
+#include "util/stop_sleep.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::string_view LOG_FILENAME = ".ttl.log";
+constexpr std::size_t DELETE_BATCH_SIZE = 128;
+constexpr std::chrono::milliseconds DELETE_BATCH_PAUSE{10};
+constexpr std::chrono::seconds LOG_FLUSH_INTERVAL{1};
+constexpr std::size_t LOG_COMPACTION_FACTOR = 4;
+constexpr std::size_t MIN_LOG_LINES_TO_COMPACT = 4096;
+
+std::string log_line(std::string_view key, std::string_view filename, std::int64_t expires_at) {
+    nlohmann::json entry;
+    entry["k"] = key;
+    entry["f"] = filename;
+    entry["e"] = expires_at;
+    return entry.dump() + "\n";
+}
+
+} // namespace
+
+ExpiryManager::ExpiryManager(std::string data_directory, ExpireHandler on_expire)
+    : data_directory_(std::move(data_directory)),
+      log_path_(data_directory_ + "/" + std::string(LOG_FILENAME)),
+      on_expire_(std::move(on_expire)),
+      wheel_(static_cast<std::uint64_t>(now_seconds())) {
+}
+
+ExpiryManager::~ExpiryManager() {
+    stop();
+}
+
+void ExpiryManager::start() {
+    load_log();
+    deleter_thread_ = std::jthread([this](std::stop_token stop_token) { deleter_loop(stop_token); });
+}
+
+void ExpiryManager::stop() noexcept {
+    if (deleter_thread_.joinable()) {
+        deleter_thread_.request_stop();
+        deleter_thread_.join();
+    }
+    try {
+        flush_log();
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to flush " << log_path_ << ": " << e.what() << std::endl;
+    }
+}
+
+std::optional<std::int64_t> ExpiryManager::set_expiry(std::string_view key,
+                                                      std::string_view filename,
+                                                      std::optional<std::chrono::seconds> ttl) {
+    if (!ttl) {
+        return assign_expiry(key, filename, std::nullopt);
+    }
+    const auto now = now_seconds();
+    const auto expires_at = ttl->count() > std::numeric_limits<std::int64_t>::max() - now
+                                ? std::numeric_limits<std::int64_t>::max()
+                                : now + ttl->count();
+    return assign_expiry(key, filename, expires_at);
+}
+
+void ExpiryManager::restore_expiry(std::string_view key,
+                                   std::string_view filename,
+                                   std::optional<std::int64_t> expires_at) {
+    assign_expiry(key, filename, expires_at);
+}
+
+std::optional<std::int64_t> ExpiryManager::assign_expiry(std::string_view key,
+                                                         std::string_view filename,
+                                                         std::optional<std::int64_t> expires_at) {
+    if (!expires_at && expiration_count_.load(std::memory_order_relaxed) == 0) {
+        return std::nullopt;
+    }
+
+    DocumentName name{std::string(key), std::string(filename)};
+    std::optional<std::int64_t> previous;
+
+    std::unique_lock lock(mutex_);
+    const auto it = expirations_.find(name);
+    if (it != expirations_.end()) {
+        previous = it->second;
+    }
+    if (expires_at) {
+        wheel_.schedule(static_cast<std::uint64_t>(expires_at.value()), name);
+        append_log(name, expires_at.value());
+        expirations_.insert_or_assign(std::move(name), expires_at.value());
+    } else if (it != expirations_.end()) {
+        expirations_.erase(it);
+        append_log(name, 0);
+    }
+    expiration_count_.store(expirations_.size(), std::memory_order_relaxed);
+    return previous;
+}
+
+bool ExpiryManager::is_expired(std::string_view key, std::string_view filename) const {
+    if (expiration_count_.load(std::memory_order_relaxed) == 0) {
+        return false;
+    }
+
+    std::shared_lock lock(mutex_);
+    const auto it = expirations_.find(DocumentNameView(key, filename));
+    return it != expirations_.end() && it->second <= now_seconds();
+}
+
+void ExpiryManager::tick() {
+    const auto now = now_seconds();
+    std::deque<DocumentName> due;
+
+    {
+        std::unique_lock lock(mutex_);
+        wheel_.advance(static_cast<std::uint64_t>(now), [&](std::uint64_t, DocumentName&& name) {
+            const auto it = expirations_.find(name);
+            if (it != expirations_.end() && it->second <= now) {
+                due.push_back(std::move(name));
+            }
+        });
+    }
+
+    if (due.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(queue_mutex_);
+        for (auto& name : due) {
+            due_.push_back(std::move(name));
+        }
+    }
+    queue_condition_.notify_one();
+}
+
+std::size_t ExpiryManager::size() const {
+    return expiration_count_.load(std::memory_order_relaxed);
+}
+
+std::int64_t ExpiryManager::now_seconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+void ExpiryManager::append_log(const DocumentName& name, std::int64_t expires_at) {
+    if (!log_.is_open()) {
+        return;
+    }
+    const auto line = log_line(name.first, name.second, expires_at);
+    log_ << line;
+    log_unflushed_ = true;
+    ++log_lines_;
+    if (compaction_tail_) {
+        *compaction_tail_ += line;
+    }
+}
+
+void ExpiryManager::flush_log() {
+    std::unique_lock lock(mutex_);
+    if (log_unflushed_) {
+        log_.flush();
+        log_unflushed_ = false;
+    }
+}
+
+void ExpiryManager::compact_log() {
+    std::string compacted;
+    std::size_t compacted_lines = 0;
+    {
+        std::unique_lock lock(mutex_);
+        if (!log_.is_open() ||
+            log_lines_ <= LOG_COMPACTION_FACTOR *
+                              std::max(expirations_.size(), MIN_LOG_LINES_TO_COMPACT)) {
+            return;
+        }
+        for (const auto& [name, expires_at] : expirations_) {
+            compacted += log_line(name.first, name.second, expires_at);
+        }
+        compacted_lines = expirations_.size();
+        compaction_tail_.emplace();
+    }
+
+    // Written without the lock; lines appended meanwhile are kept in
+    // compaction_tail_ and carried over once the new file is in place.
+    const auto written = write_file_atomically(log_path_, compacted, true);
+
+    std::unique_lock lock(mutex_);
+    const auto tail = std::move(compaction_tail_.value());
+    compaction_tail_.reset();
+    if (!written) {
+        // The old log is still in place and complete; try again later.
+        log_lines_ = 0;
+        std::cerr << "Failed to compact " << log_path_ << std::endl;
+        return;
+    }
+
+    log_.close();
+    log_.clear();
+    log_.open(log_path_, std::ios::binary | std::ios::app);
+    if (!log_.is_open()) {
+        std::cerr << "Failed to reopen " << log_path_ << "; expirations will not survive a restart"
+                  << std::endl;
+        return;
+    }
+    log_ << tail;
+    log_.flush();
+    log_unflushed_ = false;
+    log_lines_ =
+        compacted_lines + static_cast<std::size_t>(std::count(tail.begin(), tail.end(), '\n'));
+}
+
+void ExpiryManager::load_log() {
+    std::unique_lock lock(mutex_);
+
+    {
+        std::ifstream input(log_path_);
+        std::string line;
+        while (std::getline(input, line)) {
+            try {
+                const auto entry = nlohmann::json::parse(line);
+                DocumentName name{entry.at("k").get<std::string>(), entry.at("f").get<std::string>()};
+                const auto expires_at = entry.at("e").get<std::int64_t>();
+                if (expires_at == 0) {
+                    expirations_.erase(name);
+                } else {
+                    expirations_.insert_or_assign(std::move(name), expires_at);
+                }
+            } catch (const nlohmann::json::exception&) {
+                // A torn final line after a crash; everything before it is intact.
+                break;
+            }
+        }
+    }
+
+    std::string compacted;
+    for (const auto& [name, expires_at] : expirations_) {
+        compacted += log_line(name.first, name.second, expires_at);
+        wheel_.schedule(static_cast<std::uint64_t>(expires_at), name);
+    }
+    if (!write_file_atomically(log_path_, compacted, true)) {
+        std::cerr << "Failed to compact " << log_path_ << std::endl;
+    }
+
+    log_.open(log_path_, std::ios::binary | std::ios::app);
+    if (!log_.is_open()) {
+        std::cerr << "Failed to open " << log_path_ << "; expirations will not survive a restart"
+                  << std::endl;
+    }
+    log_lines_ = expirations_.size();
+    expiration_count_.store(expirations_.size(), std::memory_order_relaxed);
+}
+
+void ExpiryManager::deleter_loop(std::stop_token stop_token) {
+    while (!stop_token.stop_requested()) {
+        std::deque<DocumentName> batch;
+        {
+            std::unique_lock lock(queue_mutex_);
+            queue_condition_.wait_for(lock, stop_token, LOG_FLUSH_INTERVAL,
+                                      [this] { return !due_.empty(); });
+            if (stop_token.stop_requested()) {
+                return;
+            }
+            while (!due_.empty() && batch.size() < DELETE_BATCH_SIZE) {
+                batch.push_back(std::move(due_.front()));
+                due_.pop_front();
+            }
+        }
+
+        for (const auto& name : batch) {
+            std::unique_lock lock(mutex_);
+            const auto it = expirations_.find(name);
+            if (it == expirations_.end() || it->second > now_seconds()) {
+                continue;
+            }
+            on_expire_(name.first, name.second);
+            expirations_.erase(it);
+            append_log(name, 0);
+            expiration_count_.store(expirations_.size(), std::memory_order_relaxed);
+        }
+
+        flush_log();
+        compact_log();
+
+        if (!batch.empty()) {
+            sleep_for(stop_token, DELETE_BATCH_PAUSE);
+        }
+    }
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,194 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_EXPIRY_MANAGER_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_EXPIRY_MANAGER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "util/timing_wheel.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Tracks per-document expiry times and deletes expired documents.
+ *
+ * Expiry times are held in a map (the source of truth) and in a hierarchical
+ * timing wheel with one-second ticks. tick() advances the wheel, normally once
+ * per second from the event loop, and queues due documents; a background
+ * thread then deletes them in small batches. A wheel entry whose document
+ * has since been re-put with another TTL, or without one, no longer matches
+ * the map and is ignored.
+ *
+ * Every change is appended to data/.ttl.log so expirations survive restarts.
+ * The background thread flushes the log about once a second, and rewrites it
+ * from the map once it holds several times more lines than there are
+ * expirations; it is also compacted on load.
+ */
+class ExpiryManager {
+public:
+    /**
+     * @brief Callback that deletes one expired document, given (key, filename).
+     *
+     * Called on the background thread while no expiry can be set concurrently.
+     */
+    using ExpireHandler = std::function<void(std::string_view, std::string_view)>;
+
+    /**
+     * @brief Longest time to live a put may ask for (about ten years).
+     *
+     * Well inside the timing wheel's range, which is 2^32 one-second ticks.
+     */
+    static constexpr std::chrono::seconds MAX_TTL{10LL * 365 * 24 * 60 * 60};
+
+    /**
+     * @brief Construct an ExpiryManager.
+     *
+     * @param data_directory Path to the data directory.
+     * @param on_expire Deletes an expired document.
+     */
+    ExpiryManager(std::string data_directory, ExpireHandler on_expire);
+
+    /**
+     * @brief Stops the background deleter.
+     */
+    ~ExpiryManager();
+
+    ExpiryManager(const ExpiryManager&) = delete;
+    ExpiryManager& operator=(const ExpiryManager&) = delete;
+
+    /**
+     * @brief Restore expirations from the log, compact it, and start the deleter thread.
+     */
+    void start();
+
+    /**
+     * @brief Stop the deleter thread, wait for it to exit and flush the log.
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief Set or clear a document's expiry.
+     *
+     * Must be called before the document is written, so that a concurrent
+     * expiry of the previous version cannot delete the new one. If the write
+     * then fails, pass the returned expiry to restore_expiry().
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename (with extension).
+     * @param ttl Time to live, or std::nullopt to make the document permanent.
+     *            An expiry time past the end of std::int64_t saturates to it.
+     * @return std::optional<std::int64_t> The previous expiry time in seconds
+     *         since the epoch, or std::nullopt if the document had none.
+     */
+    std::optional<std::int64_t> set_expiry(std::string_view key,
+                                           std::string_view filename,
+                                           std::optional<std::chrono::seconds> ttl);
+
+    /**
+     * @brief Put back the expiry a document had before a failed write.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename (with extension).
+     * @param expires_at The expiry time returned by set_expiry().
+     */
+    void restore_expiry(std::string_view key,
+                        std::string_view filename,
+                        std::optional<std::int64_t> expires_at);
+
+    /**
+     * @brief Check whether a document has expired but may not be deleted yet.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename (with extension).
+     * @return true if the document's expiry time has passed.
+     */
+    [[nodiscard]] bool is_expired(std::string_view key, std::string_view filename) const;
+
+    /**
+     * @brief Advance the timing wheel to the current time and queue due documents.
+     */
+    void tick();
+
+    /**
+     * @brief Get the number of documents with an expiry time.
+     *
+     * @return std::size_t The count.
+     */
+    [[nodiscard]] std::size_t size() const;
+
+private:
+    using DocumentName = std::pair<std::string, std::string>;
+
+    /**
+     * @brief A (key, filename) pair to look up without copying it.
+     */
+    using DocumentNameView = std::pair<std::string_view, std::string_view>;
+
+    struct DocumentNameHash {
+        using is_transparent = void;
+        std::size_t operator()(const DocumentNameView& name) const noexcept {
+            const auto first = std::hash<std::string_view>{}(name.first);
+            return first ^ (std::hash<std::string_view>{}(name.second) + 0x9e3779b97f4a7c15 +
+                            (first << 6) + (first >> 2));
+        }
+        std::size_t operator()(const DocumentName& name) const noexcept {
+            return (*this)(DocumentNameView(name.first, name.second));
+        }
+    };
+
+    struct DocumentNameEqual {
+        using is_transparent = void;
+        template <typename Left, typename Right>
+        bool operator()(const Left& left, const Right& right) const noexcept {
+            return left.first == right.first && left.second == right.second;
+        }
+    };
+
+    [[nodiscard]] static std::int64_t now_seconds();
+
+    std::optional<std::int64_t> assign_expiry(std::string_view key,
+                                              std::string_view filename,
+                                              std::optional<std::int64_t> expires_at);
+    void append_log(const DocumentName& name, std::int64_t expires_at);
+    void load_log();
+    void flush_log();
+    void compact_log();
+    void deleter_loop(std::stop_token stop_token);
+
+    std::string data_directory_;
+    std::string log_path_;
+    ExpireHandler on_expire_;
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<DocumentName, std::int64_t, DocumentNameHash, DocumentNameEqual>
+        expirations_;
+    TimingWheel<DocumentName> wheel_;
+    std::ofstream log_;
+    /** Lines in the log file, to decide when to compact it. */
+    std::size_t log_lines_ = 0;
+    bool log_unflushed_ = false;
+    /** Lines appended while the log is being compacted, to carry over to the new file. */
+    std::optional<std::string> compaction_tail_;
+    std::atomic<std::size_t> expiration_count_{0};
+
+    std::mutex queue_mutex_;
+    std::condition_variable_any queue_condition_;
+    std::deque<DocumentName> due_;
+    std::jthread deleter_thread_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_EXPIRY_MANAGER_HPP
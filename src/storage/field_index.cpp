@@ -0,0 +1,448 @@
+#include "storage/field_index.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <limits>
+
+#include "storage/file_io.hpp"
+#include "util/thread_pool.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::string_view INDEX_DIRECTORY = ".sds-indexes";
+constexpr std::size_t MAX_INDEX_FILE_SIZE = 1024 * 1024 * 1024;
+
+/**
+ * @brief The smallest key of a kind, below every value of that kind.
+ */
+IndexKey kind_floor(IndexKey::Kind kind) {
+    return IndexKey{kind, -std::numeric_limits<double>::infinity(), {}};
+}
+
+} // namespace
+
+std::optional<IndexKey> IndexKey::from_json(const nlohmann::json& value) {
+    if (value.is_null()) {
+        return IndexKey{Kind::Null, 0, {}};
+    }
+    if (value.is_boolean()) {
+        return IndexKey{Kind::Boolean, value.get<bool>() ? 1.0 : 0.0, {}};
+    }
+    if (value.is_number()) {
+        return IndexKey{Kind::Number, value.get<double>(), {}};
+    }
+    if (value.is_string()) {
+        return IndexKey{Kind::String, 0, value.get<std::string>()};
+    }
+    return std::nullopt;
+}
+
+nlohmann::json IndexKey::to_json() const {
+    switch (kind) {
+        case Kind::Boolean:
+            return number != 0;
+        case Kind::Number:
+            return number;
+        case Kind::String:
+            return text;
+        case Kind::Null:
+            break;
+    }
+    return nullptr;
+}
+
+FieldIndex::FieldIndex(JsonPath path) : path_(std::move(path)) {
+}
+
+void FieldIndex::update(const std::string& filename, const nlohmann::json* document) {
+    const auto* value = document != nullptr ? path_.resolve(*document) : nullptr;
+    auto key = value != nullptr ? IndexKey::from_json(*value) : std::nullopt;
+    if (key) {
+        insert(filename, std::move(key.value()));
+    } else {
+        remove(filename);
+    }
+}
+
+void FieldIndex::insert(const std::string& filename, IndexKey key) {
+    remove(filename);
+    entries_.emplace(key, filename);
+    keys_by_file_.emplace(filename, std::move(key));
+}
+
+void FieldIndex::remove(const std::string& filename) {
+    const auto it = keys_by_file_.find(filename);
+    if (it == keys_by_file_.end()) {
+        return;
+    }
+    entries_.erase(Entry{it->second, filename});
+    keys_by_file_.erase(it);
+}
+
+bool FieldIndex::lookup(const FilterCondition& condition, std::vector<std::string>& out) const {
+    const auto equal_range = [this](const IndexKey& key) {
+        auto last = entries_.lower_bound(Entry{key, {}});
+        const auto first = last;
+        while (last != entries_.end() && last->first == key) {
+            ++last;
+        }
+        return std::pair{first, last};
+    };
+
+    switch (condition.op) {
+        case FilterOp::Equal: {
+            const auto key = IndexKey::from_json(condition.operand);
+            if (!key) {
+                return false;
+            }
+            const auto [first, last] = equal_range(key.value());
+            collect(first, last, out);
+            return true;
+        }
+        case FilterOp::In: {
+            std::vector<IndexKey> keys;
+            for (const auto& operand : condition.operand) {
+                auto key = IndexKey::from_json(operand);
+                if (!key) {
+                    return false;
+                }
+                keys.push_back(std::move(key.value()));
+            }
+            for (const auto& key : keys) {
+                const auto [first, last] = equal_range(key);
+                collect(first, last, out);
+            }
+            return true;
+        }
+        case FilterOp::Greater:
+        case FilterOp::GreaterOrEqual:
+        case FilterOp::Less:
+        case FilterOp::LessOrEqual: {
+            const auto key = IndexKey::from_json(condition.operand);
+            if (!key) {
+                return false;
+            }
+            // Ranges stay within the operand's kind: numbers or strings.
+            const auto kind_begin = entries_.lower_bound(Entry{kind_floor(key->kind), {}});
+            const auto kind_end =
+                key->kind == IndexKey::Kind::String
+                    ? entries_.end()
+                    : entries_.lower_bound(Entry{
+                          kind_floor(static_cast<IndexKey::Kind>(
+                              static_cast<std::uint8_t>(key->kind) + 1)),
+                          {}});
+            const auto [first, last] = equal_range(key.value());
+            if (condition.op == FilterOp::Greater || condition.op == FilterOp::GreaterOrEqual) {
+                collect(first, kind_end, out);
+            } else {
+                collect(kind_begin, last, out);
+            }
+            return true;
+        }
+        case FilterOp::Exists:
+            break;
+    }
+    return false;
+}
+
+void FieldIndex::for_each(
+    const std::function<void(const std::string&, const IndexKey&)>& visitor) const {
+    for (const auto& [key, filename] : entries_) {
+        visitor(filename, key);
+    }
+}
+
+void FieldIndex::collect(std::set<Entry>::const_iterator first,
+                         std::set<Entry>::const_iterator last,
+                         std::vector<std::string>& out) const {
+    for (; first != last; ++first) {
+        out.push_back(first->second);
+    }
+}
+
+FieldIndexes::FieldIndexes(std::string data_directory, DocumentSource documents)
+    : data_directory_(std::move(data_directory)), documents_(std::move(documents)) {
+}
+
+std::size_t FieldIndexes::load(ThreadPool& pool) {
+    std::vector<std::string> keys;
+    std::error_code ec;
+    const auto index_dir = data_directory_ + "/" + std::string(INDEX_DIRECTORY);
+    for (const auto& entry : std::filesystem::directory_iterator(index_dir, ec)) {
+        const auto name = entry.path().filename().string();
+        if (entry.is_regular_file() && !name.starts_with('.')) {
+            keys.push_back(name);
+        }
+    }
+
+    std::vector<std::optional<LoadedKey>> loaded(keys.size());
+    pool.parallel_for(keys.size(), [&](std::size_t i) {
+        loaded[i] = load_key(keys[i]);
+    });
+
+    std::size_t rebuilt = 0;
+    std::unique_lock lock(mutex_);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if (loaded[i]) {
+            rebuilt += loaded[i]->rebuilt ? 1 : 0;
+            keys_.insert_or_assign(std::move(keys[i]), std::move(loaded[i]->indexes));
+        }
+    }
+    return rebuilt;
+}
+
+bool FieldIndexes::save() const noexcept {
+    try {
+        bool success = true;
+        std::shared_lock lock(mutex_);
+        for (const auto& [key, indexes] : keys_) {
+            success = write_key_file(key, indexes) && success;
+        }
+        return success;
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to write field indexes: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool FieldIndexes::create(std::string_view key, const JsonPath& path) {
+    BuildJournal::Build build;
+    {
+        std::unique_lock lock(mutex_);
+        const auto it = keys_.find(key);
+        if (it != keys_.end() && it->second.contains(path.text())) {
+            return true;
+        }
+        build = journal_.begin(key);
+    }
+
+    KeyIndexes created;
+    try {
+        created.emplace(path.text(), FieldIndex(path));
+        fill_from_documents(key, created);
+    } catch (...) {
+        std::unique_lock lock(mutex_);
+        journal_.finish(build);
+        throw;
+    }
+
+    {
+        std::unique_lock lock(mutex_);
+        for (const auto& [filename, bytes] : journal_.finish(build)) {
+            const auto document = bytes ? nlohmann::json::parse(bytes.value(), nullptr, false)
+                                        : nlohmann::json(nlohmann::json::value_t::discarded);
+            const auto* parsed = document.is_discarded() ? nullptr : &document;
+            for (auto& [indexed_path, index] : created) {
+                index.update(filename, parsed);
+            }
+        }
+
+        auto it = keys_.find(key);
+        if (it == keys_.end()) {
+            it = keys_.emplace(std::string(key), KeyIndexes{}).first;
+        }
+        it->second.merge(created);
+    }
+
+    // Writing the file only reads the indexes; a drop in between removed the file already.
+    std::shared_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    return it == keys_.end() || write_key_file(key, it->second);
+}
+
+bool FieldIndexes::drop(std::string_view key, std::string_view path) {
+    std::unique_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return true;
+    }
+    const auto index = it->second.find(path);
+    if (index == it->second.end()) {
+        return true;
+    }
+    it->second.erase(index);
+
+    if (!it->second.empty()) {
+        return write_key_file(key, it->second);
+    }
+    keys_.erase(it);
+    std::error_code ec;
+    std::filesystem::remove(key_file_path(key), ec);
+    return !ec;
+}
+
+std::vector<std::string> FieldIndexes::paths(std::string_view key) const {
+    std::vector<std::string> result;
+    std::shared_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    if (it != keys_.end()) {
+        for (const auto& [path, index] : it->second) {
+            result.push_back(path);
+        }
+    }
+    return result;
+}
+
+void FieldIndexes::update(std::string_view key, std::string_view filename, std::string_view bytes) {
+    {
+        std::shared_lock lock(mutex_);
+        if (!keys_.contains(key) && !journal_.recording(key)) {
+            return;
+        }
+    }
+
+    const auto document = nlohmann::json::parse(bytes, nullptr, false);
+    const auto* parsed = document.is_discarded() ? nullptr : &document;
+    const std::string name(filename);
+
+    std::unique_lock lock(mutex_);
+    journal_.record(key, filename, bytes);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return;
+    }
+    for (auto& [path, index] : it->second) {
+        index.update(name, parsed);
+    }
+}
+
+void FieldIndexes::remove(std::string_view key, std::string_view filename) {
+    const std::string name(filename);
+    std::unique_lock lock(mutex_);
+    journal_.record(key, filename, std::nullopt);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return;
+    }
+    for (auto& [path, index] : it->second) {
+        index.remove(name);
+    }
+}
+
+std::optional<std::vector<std::string>>
+FieldIndexes::candidates(std::string_view key, const Filter& filter) const {
+    std::optional<std::vector<std::string>> result;
+
+    std::shared_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return result;
+    }
+
+    for (const auto& condition : filter.conditions()) {
+        const auto index = std::find_if(it->second.begin(), it->second.end(), [&](const auto& entry) {
+            return entry.second.path().tokens() == condition.path.tokens();
+        });
+        std::vector<std::string> found;
+        if (index == it->second.end() || !index->second.lookup(condition, found)) {
+            continue;
+        }
+        std::sort(found.begin(), found.end());
+        found.erase(std::unique(found.begin(), found.end()), found.end());
+
+        if (!result) {
+            result = std::move(found);
+            continue;
+        }
+        std::vector<std::string> both;
+        std::set_intersection(result->begin(), result->end(), found.begin(), found.end(),
+                              std::back_inserter(both));
+        result = std::move(both);
+    }
+    return result;
+}
+
+std::string FieldIndexes::key_file_path(std::string_view key) const {
+    return data_directory_ + "/" + std::string(INDEX_DIRECTORY) + "/" + std::string(key);
+}
+
+std::string FieldIndexes::key_directory(std::string_view key) const {
+    return data_directory_ + "/" + std::string(key);
+}
+
+void FieldIndexes::fill_from_documents(std::string_view key, KeyIndexes& indexes) const {
+    for (const auto& filename : documents_.list(key)) {
+        const auto content = documents_.read(key, filename);
+        if (!content) {
+            continue;
+        }
+        const auto document = nlohmann::json::parse(content.value(), nullptr, false);
+        const auto* parsed = document.is_discarded() ? nullptr : &document;
+        for (auto& [path, index] : indexes) {
+            index.update(filename, parsed);
+        }
+    }
+}
+
+std::optional<FieldIndexes::LoadedKey> FieldIndexes::load_key(const std::string& key) const {
+    const auto mtime = directory_mtime_ns(key_directory(key));
+    if (!mtime) {
+        return std::nullopt;
+    }
+
+    const auto content = read_file(key_file_path(key), MAX_INDEX_FILE_SIZE);
+    const auto stored = content ? nlohmann::json::parse(content.value(), nullptr, false)
+                                : nlohmann::json(nlohmann::json::value_t::discarded);
+    if (stored.is_discarded() || !stored.contains("indexes") || !stored["indexes"].is_object()) {
+        std::cerr << "Ignoring corrupt field index file " << key_file_path(key) << std::endl;
+        return std::nullopt;
+    }
+
+    LoadedKey loaded;
+    for (const auto& [text, values] : stored["indexes"].items()) {
+        auto path = JsonPath::parse(text);
+        if (!path) {
+            continue;
+        }
+        loaded.indexes.emplace(text, FieldIndex(std::move(path.value())));
+    }
+
+    const auto saved_mtime = stored.value("directory_mtime_ns", std::int64_t{0});
+    if (saved_mtime != mtime.value()) {
+        fill_from_documents(key, loaded.indexes);
+        loaded.rebuilt = true;
+        return loaded;
+    }
+
+    for (auto& [text, index] : loaded.indexes) {
+        const auto& values = stored["indexes"][text];
+        if (!values.is_object()) {
+            continue;
+        }
+        for (const auto& [filename, value] : values.items()) {
+            if (auto index_key = IndexKey::from_json(value)) {
+                index.insert(filename, std::move(index_key.value()));
+            }
+        }
+    }
+    return loaded;
+}
+
+bool FieldIndexes::write_key_file(std::string_view key, const KeyIndexes& indexes) const {
+    nlohmann::json stored;
+    stored["directory_mtime_ns"] =
+        directory_mtime_ns(key_directory(key)).value_or(MISSING_DIRECTORY_MTIME);
+    auto& values = stored["indexes"] = nlohmann::json::object();
+    for (const auto& [path, index] : indexes) {
+        auto& entries = values[path] = nlohmann::json::object();
+        index.for_each([&entries](const std::string& filename, const IndexKey& index_key) {
+            entries[filename] = index_key.to_json();
+        });
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(data_directory_ + "/" + std::string(INDEX_DIRECTORY), ec);
+    const auto written = write_file_atomically(
+        key_file_path(key), stored.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace),
+        true);
+    if (!written) {
+        std::cerr << "Failed to write field indexes of key " << key << std::endl;
+    }
+    return written.has_value();
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,275 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_FIELD_INDEX_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_FIELD_INDEX_HPP
+
+#include <compare>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "query/filter.hpp"
+#include "query/json_path.hpp"
+#include "storage/index_build.hpp"
+
+namespace simple_data_server {
+
+class ThreadPool;
+
+/**
+ * @brief A scalar JSON value in the sort order of a FieldIndex.
+ *
+ * Values sort by type first (null, booleans, numbers, strings). Numbers
+ * compare as doubles, so 1 and 1.0 are the same key.
+ */
+struct IndexKey {
+    enum class Kind : std::uint8_t {
+        Null,
+        Boolean,
+        Number,
+        String
+    };
+
+    Kind kind = Kind::Null;
+    double number = 0;
+    std::string text;
+
+    auto operator<=>(const IndexKey&) const = default;
+
+    /**
+     * @brief Build the key of a JSON value.
+     *
+     * @param value The value.
+     * @return std::optional<IndexKey> The key, or std::nullopt for objects and arrays,
+     *         which are not indexed.
+     */
+    [[nodiscard]] static std::optional<IndexKey> from_json(const nlohmann::json& value);
+
+    /**
+     * @brief Convert the key back to JSON, e.g. for persisting it.
+     *
+     * @return nlohmann::json The value.
+     */
+    [[nodiscard]] nlohmann::json to_json() const;
+};
+
+/**
+ * @brief The values of one JSON Pointer across the documents of one key, sorted.
+ *
+ * Only scalar values are indexed; documents where the path is missing or
+ * holds an object or array have no entry.
+ */
+class FieldIndex {
+public:
+    /**
+     * @brief Construct an empty index.
+     *
+     * @param path The indexed path.
+     */
+    explicit FieldIndex(JsonPath path);
+
+    /**
+     * @brief Record a document's current value, replacing any previous one.
+     *
+     * @param filename The stored filename.
+     * @param document The parsed document, or nullptr if it is not valid JSON.
+     */
+    void update(const std::string& filename, const nlohmann::json* document);
+
+    /**
+     * @brief Record a value directly, e.g. one read back from disk.
+     *
+     * @param filename The stored filename.
+     * @param key The value.
+     */
+    void insert(const std::string& filename, IndexKey key);
+
+    /**
+     * @brief Forget a document.
+     *
+     * @param filename The stored filename.
+     */
+    void remove(const std::string& filename);
+
+    /**
+     * @brief Collect the documents whose value may satisfy a condition.
+     *
+     * Equality, $in and range conditions with scalar operands can use the
+     * index. Range bounds are always inclusive, since two numbers that differ
+     * can convert to the same double; the filter itself removes the extra
+     * matches.
+     *
+     * @param condition A condition on this index's path.
+     * @param out Receives the filenames, unsorted.
+     * @return bool false if the condition cannot be answered from the index.
+     */
+    bool lookup(const FilterCondition& condition, std::vector<std::string>& out) const;
+
+    /**
+     * @brief Get the indexed path.
+     *
+     * @return const JsonPath& The path.
+     */
+    [[nodiscard]] const JsonPath& path() const noexcept {
+        return path_;
+    }
+
+    /**
+     * @brief Visit every entry.
+     *
+     * @param visitor Called with (filename, key) for each indexed document.
+     */
+    void for_each(const std::function<void(const std::string&, const IndexKey&)>& visitor) const;
+
+private:
+    using Entry = std::pair<IndexKey, std::string>;
+
+    void collect(std::set<Entry>::const_iterator first, std::set<Entry>::const_iterator last,
+                 std::vector<std::string>& out) const;
+
+    JsonPath path_;
+    std::set<Entry> entries_;
+    std::unordered_map<std::string, IndexKey> keys_by_file_;
+};
+
+/**
+ * @brief The secondary indexes of every key, maintained as documents change.
+ *
+ * Each key with indexes is persisted to data/.sds-indexes/{key}: the indexed
+ * paths, every indexed value, and the key directory's mtime at the time of
+ * writing. Files are rewritten when an index is created or dropped and on
+ * clean shutdown; at startup the values are reused if the key directory's
+ * mtime still matches and rebuilt from the documents otherwise, like the
+ * document index snapshot.
+ */
+class FieldIndexes {
+public:
+    /**
+     * @brief Construct an empty set of indexes for the given data directory.
+     *
+     * @param data_directory Path to the data directory.
+     * @param documents Where to read documents from when an index is filled.
+     */
+    FieldIndexes(std::string data_directory, DocumentSource documents);
+
+    /**
+     * @brief Load the persisted indexes, rebuilding stale ones.
+     *
+     * @param pool Thread pool used to load keys in parallel.
+     * @return std::size_t Number of keys whose indexes had to be rebuilt.
+     */
+    std::size_t load(ThreadPool& pool);
+
+    /**
+     * @brief Persist the indexes of every key.
+     *
+     * Must only be called when no writes are in flight, e.g. on clean shutdown.
+     *
+     * @return bool true on success.
+     */
+    bool save() const noexcept;
+
+    /**
+     * @brief Create an index and fill it from the key's documents.
+     *
+     * The documents are read without holding the lock, so queries and writes
+     * go on meanwhile; writes to the key made during the build are replayed
+     * onto the new index before it is swapped in. Reads every document of
+     * the key, so it should not run on the event loop. Creating an index
+     * that exists already does nothing.
+     *
+     * @param key The user's shared key.
+     * @param path The path to index.
+     * @return bool false if the index could not be persisted.
+     */
+    bool create(std::string_view key, const JsonPath& path);
+
+    /**
+     * @brief Drop an index.
+     *
+     * @param key The user's shared key.
+     * @param path The indexed path, as given to create().
+     * @return bool false if the change could not be persisted.
+     */
+    bool drop(std::string_view key, std::string_view path);
+
+    /**
+     * @brief List the indexed paths of a key.
+     *
+     * @param key The user's shared key.
+     * @return std::vector<std::string> The paths, sorted.
+     */
+    [[nodiscard]] std::vector<std::string> paths(std::string_view key) const;
+
+    /**
+     * @brief Update the indexes of a key for a created or replaced document.
+     *
+     * The document is only parsed if the key has indexes.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename.
+     * @param bytes The stored document.
+     */
+    void update(std::string_view key, std::string_view filename, std::string_view bytes);
+
+    /**
+     * @brief Remove a document from the indexes of its key.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename.
+     */
+    void remove(std::string_view key, std::string_view filename);
+
+    /**
+     * @brief Narrow a query down to the documents the indexes say may match.
+     *
+     * Intersects the lookups of every condition that has an index. The result
+     * can contain documents that do not match, but never misses one that does.
+     *
+     * @param key The user's shared key.
+     * @param filter The query filter.
+     * @return std::optional<std::vector<std::string>> Candidate filenames in
+     *         sorted order, or std::nullopt if no condition can use an index.
+     */
+    [[nodiscard]] std::optional<std::vector<std::string>>
+    candidates(std::string_view key, const Filter& filter) const;
+
+private:
+    struct StringHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view value) const noexcept {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    using KeyIndexes = std::map<std::string, FieldIndex, std::less<>>;
+
+    struct LoadedKey {
+        KeyIndexes indexes;
+        bool rebuilt = false;
+    };
+
+    [[nodiscard]] std::string key_file_path(std::string_view key) const;
+    [[nodiscard]] std::string key_directory(std::string_view key) const;
+    void fill_from_documents(std::string_view key, KeyIndexes& indexes) const;
+    [[nodiscard]] std::optional<LoadedKey> load_key(const std::string& key) const;
+    bool write_key_file(std::string_view key, const KeyIndexes& indexes) const;
+
+    std::string data_directory_;
+    DocumentSource documents_;
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, KeyIndexes, StringHash, std::equal_to<>> keys_;
+    BuildJournal journal_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_FIELD_INDEX_HPP
@@ -0,0 +1,185 @@
+#include "storage/file_handle_cache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "storage/file_io.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::chrono::seconds REVALIDATE_INTERVAL{1};
+
+/**
+ * @brief Read a whole document and one byte more with a single pread().
+ *
+ * @return ssize_t Bytes read, or -1 on error; more than handle.size() means
+ *         the file grew since it was opened.
+ */
+ssize_t read_with_overrun(const FileHandle& handle, std::string& content) {
+    content.resize(handle.size() + 1);
+    ssize_t got;
+    do {
+        got = ::pread(handle.fd(), content.data(), content.size(), 0);
+    } while (got < 0 && errno == EINTR);
+    return got;
+}
+
+bool same_file(const struct stat& st,
+               dev_t device,
+               ino_t inode,
+               std::size_t size,
+               const timespec& mtime) {
+    return st.st_dev == device && st.st_ino == inode &&
+           static_cast<std::size_t>(st.st_size) == size && st.st_mtim.tv_sec == mtime.tv_sec &&
+           st.st_mtim.tv_nsec == mtime.tv_nsec;
+}
+
+} // namespace
+
+FileHandle::~FileHandle() {
+    ::close(fd_);
+}
+
+FileHandleCache::CacheName::CacheName(std::string_view key, std::string_view filename) noexcept {
+    if (key.size() + 1 + filename.size() > sizeof(buffer_)) {
+        return;
+    }
+    std::memcpy(buffer_, key.data(), key.size());
+    buffer_[key.size()] = '/';
+    std::memcpy(buffer_ + key.size() + 1, filename.data(), filename.size());
+    length_ = key.size() + 1 + filename.size();
+}
+
+FileHandleCache::FileHandleCache(std::size_t capacity) : capacity_(capacity) {
+}
+
+std::expected<std::string, FileError> FileHandleCache::read(int directory_fd,
+                                                            std::string_view key,
+                                                            std::string_view filename,
+                                                            std::size_t max_size,
+                                                            bool admit) {
+    const CacheName name(key, filename);
+    if (capacity_ == 0 || name.view().empty()) {
+        return read_file_at(directory_fd, filename, max_size);
+    }
+
+    std::string content;
+    if (const auto handle = find(directory_fd, filename, name)) {
+        const auto got = read_with_overrun(*handle, content);
+        if (got >= 0 && static_cast<std::size_t>(got) == handle->size()) {
+            content.resize(handle->size());
+            return content;
+        }
+        // Changed in place since it was opened; open it again.
+        erase(name, handle.get());
+    }
+
+    std::uint64_t generation;
+    {
+        std::lock_guard lock(mutex_);
+        generation = generation_;
+    }
+
+    const EntryName entry_name(filename);
+    if (!entry_name.valid()) {
+        return std::unexpected(FileError::InvalidFilename);
+    }
+    const int fd = ::openat(directory_fd, entry_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return std::unexpected(errno == ENOENT ? FileError::FileNotFound : FileError::IoError);
+    }
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return std::unexpected(FileError::IoError);
+    }
+    if (static_cast<std::size_t>(st.st_size) > max_size) {
+        ::close(fd);
+        return std::unexpected(FileError::FileTooLarge);
+    }
+
+    auto handle = std::make_shared<const FileHandle>(fd, static_cast<std::size_t>(st.st_size));
+    const auto got = read_with_overrun(*handle, content);
+    if (got < 0) {
+        return std::unexpected(FileError::IoError);
+    }
+    // Like read_file_at(), return at most the size fstat() reported.
+    content.resize(std::min(static_cast<std::size_t>(got), handle->size()));
+    if (admit && static_cast<std::size_t>(got) == handle->size()) {
+        insert(name, std::move(handle), st, generation);
+    }
+    return content;
+}
+
+void FileHandleCache::invalidate(std::string_view key, std::string_view filename) {
+    const CacheName name(key, filename);
+    std::lock_guard lock(mutex_);
+    ++generation_;
+    if (const auto it = by_name_.find(name.view()); it != by_name_.end()) {
+        entries_.erase(it->second);
+        by_name_.erase(it);
+    }
+}
+
+std::shared_ptr<const FileHandle>
+FileHandleCache::find(int directory_fd, std::string_view filename, const CacheName& name) {
+    std::lock_guard lock(mutex_);
+    const auto it = by_name_.find(name.view());
+    if (it == by_name_.end()) {
+        return nullptr;
+    }
+    auto& entry = *it->second;
+    const auto now = std::chrono::steady_clock::now();
+    if (now - entry.validated >= REVALIDATE_INTERVAL) {
+        const EntryName entry_name(filename);
+        struct stat st{};
+        if (!entry_name.valid() || ::fstatat(directory_fd, entry_name.c_str(), &st, 0) != 0 ||
+            !same_file(st, entry.device, entry.inode, entry.handle->size(), entry.mtime)) {
+            entries_.erase(it->second);
+            by_name_.erase(it);
+            return nullptr;
+        }
+        entry.validated = now;
+    }
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return entry.handle;
+}
+
+void FileHandleCache::insert(const CacheName& name,
+                             std::shared_ptr<const FileHandle> handle,
+                             const struct stat& st,
+                             std::uint64_t generation) {
+    std::lock_guard lock(mutex_);
+    if (generation != generation_) {
+        // A write or removal happened since the file was opened; it may be stale.
+        return;
+    }
+    if (const auto it = by_name_.find(name.view()); it != by_name_.end()) {
+        entries_.erase(it->second);
+        by_name_.erase(it);
+    }
+    entries_.push_front(Entry{std::string(name.view()), std::move(handle), st.st_dev, st.st_ino,
+                              st.st_mtim, std::chrono::steady_clock::now()});
+    by_name_.emplace(entries_.front().name, entries_.begin());
+    while (entries_.size() > capacity_) {
+        by_name_.erase(entries_.back().name);
+        entries_.pop_back();
+    }
+}
+
+void FileHandleCache::erase(const CacheName& name, const FileHandle* handle) {
+    std::lock_guard lock(mutex_);
+    const auto it = by_name_.find(name.view());
+    if (it != by_name_.end() && it->second->handle.get() == handle) {
+        entries_.erase(it->second);
+        by_name_.erase(it);
+    }
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,165 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_FILE_HANDLE_CACHE_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_FILE_HANDLE_CACHE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unordered_map>
+#include <expected.hpp>
+
+#include "storage/file_manager.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief An open document with the size it had when it was opened.
+ */
+class FileHandle {
+public:
+    /**
+     * @brief Take ownership of a file descriptor.
+     *
+     * @param fd An open regular file.
+     * @param size Its size.
+     */
+    FileHandle(int fd, std::size_t size) noexcept : fd_(fd), size_(size) {
+    }
+
+    ~FileHandle();
+
+    FileHandle(const FileHandle&) = delete;
+    FileHandle& operator=(const FileHandle&) = delete;
+
+    [[nodiscard]] int fd() const noexcept {
+        return fd_;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept {
+        return size_;
+    }
+
+private:
+    int fd_;
+    std::size_t size_;
+};
+
+/**
+ * @brief Least recently used cache of open documents, read with a single pread().
+ *
+ * Documents are only ever replaced by renaming a new file over them, so an
+ * open descriptor keeps referring to exactly the bytes it was opened with.
+ * A cached read is therefore one pread() of the remembered size plus one
+ * byte, the extra byte showing that a file edited in place grew; the
+ * directory entry is checked again (device, inode, size, mtime) once the
+ * entry is a second old, so a file replaced by hand is noticed within a
+ * second. FileManager drops an entry whenever it writes or removes that
+ * document.
+ */
+class FileHandleCache {
+public:
+    /**
+     * @brief Create an empty cache.
+     *
+     * @param capacity Number of documents kept open; zero disables caching.
+     */
+    explicit FileHandleCache(std::size_t capacity);
+
+    FileHandleCache(const FileHandleCache&) = delete;
+    FileHandleCache& operator=(const FileHandleCache&) = delete;
+
+    /**
+     * @brief Read a document, through the cache.
+     *
+     * @param directory_fd The open key directory.
+     * @param key The key, used with filename as the cache key.
+     * @param filename The stored filename.
+     * @param max_size Largest document accepted.
+     * @param admit Keep the document open after a miss; scans pass false so
+     *        that reading every document of a key does not evict the hot ones.
+     * @return std::expected<std::string, FileError> The document bytes or error.
+     */
+    [[nodiscard]] std::expected<std::string, FileError> read(int directory_fd,
+                                                           std::string_view key,
+                                                           std::string_view filename,
+                                                           std::size_t max_size,
+                                                           bool admit);
+
+    /**
+     * @brief Forget a document, e.g. after it was replaced or removed.
+     *
+     * @param key The key.
+     * @param filename The stored filename.
+     */
+    void invalidate(std::string_view key, std::string_view filename);
+
+private:
+    struct Entry {
+        std::string name;
+        std::shared_ptr<const FileHandle> handle;
+        dev_t device;
+        ino_t inode;
+        timespec mtime;
+        std::chrono::steady_clock::time_point validated;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    /**
+     * @brief "key/filename" in a stack buffer; keys never contain a slash.
+     */
+    class CacheName {
+    public:
+        CacheName(std::string_view key, std::string_view filename) noexcept;
+
+        [[nodiscard]] std::string_view view() const noexcept {
+            return {buffer_, length_};
+        }
+
+    private:
+        char buffer_[512];
+        std::size_t length_ = 0;
+    };
+
+    [[nodiscard]] std::shared_ptr<const FileHandle> find(int directory_fd,
+                                                         std::string_view filename,
+                                                         const CacheName& name);
+
+    void insert(const CacheName& name,
+                std::shared_ptr<const FileHandle> handle,
+                const struct stat& st,
+                std::uint64_t generation);
+
+    void erase(const CacheName& name, const FileHandle* handle);
+
+    std::size_t capacity_;
+
+    std::mutex mutex_;
+
+    /**
+     * @brief Bumped by every invalidation, so a miss that raced with a write
+     *        does not cache the descriptor of the replaced file.
+     */
+    std::uint64_t generation_ = 0;
+
+    /**
+     * @brief Entries, most recently used first.
+     */
+    EntryList entries_;
+
+    /**
+     * @brief Entries by "key/filename"; the views refer to Entry::name.
+     */
+    std::unordered_map<std::string_view, EntryList::iterator> by_name_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_FILE_HANDLE_CACHE_HPP
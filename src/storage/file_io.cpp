@@ -0,0 +1,207 @@
+#include "storage/file_io.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace simple_data_server {
+
+namespace {
+
+std::atomic<std::uint64_t> temporary_counter{0};
+
+bool write_all(int fd, std::string_view contents) {
+    while (!contents.empty()) {
+        const auto written = ::write(fd, contents.data(), contents.size());
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        contents.remove_prefix(static_cast<std::size_t>(written));
+    }
+    return true;
+}
+
+} // namespace
+
+bool is_document_entry(std::string_view name) noexcept {
+    return name.size() > JSON_EXTENSION.size() && name.front() != '.' &&
+           name.ends_with(JSON_EXTENSION);
+}
+
+std::int64_t mtime_ns(const struct stat& st) noexcept {
+    return static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec;
+}
+
+std::optional<std::int64_t> directory_mtime_ns(const std::string& path) noexcept {
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        return std::nullopt;
+    }
+    return mtime_ns(st);
+}
+
+EntryName::EntryName(std::string_view name) noexcept {
+    if (name.empty() || name.size() > MAX_ENTRY_NAME_LENGTH ||
+        name.find_first_of(std::string_view("/\0", 2)) != std::string_view::npos) {
+        return;
+    }
+    name.copy(buffer_, name.size());
+    buffer_[name.size()] = '\0';
+    valid_ = true;
+}
+
+EntryName EntryName::temporary_for(std::string_view name) noexcept {
+    EntryName temporary;
+    const auto length = std::snprintf(
+        temporary.buffer_, sizeof(temporary.buffer_), ".%.*s.%ld.%llu.tmp",
+        static_cast<int>(name.size()), name.data(), static_cast<long>(::getpid()),
+        static_cast<unsigned long long>(
+            temporary_counter.fetch_add(1, std::memory_order_relaxed)));
+    temporary.valid_ = length > 0 && static_cast<std::size_t>(length) < sizeof(temporary.buffer_);
+    return temporary;
+}
+
+std::expected<std::string, FileError>
+read_file(const std::string& file_path, std::size_t max_size) noexcept {
+    try {
+        std::ifstream file(file_path, std::ios::binary);
+        if (!file.is_open()) {
+            return std::unexpected(FileError::IoError);
+        }
+
+        std::string content((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+
+        if (content.size() > max_size) {
+            return std::unexpected(FileError::FileTooLarge);
+        }
+        return content;
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+std::expected<std::string, FileError>
+read_file_at(int directory_fd, std::string_view filename, std::size_t max_size) noexcept {
+    try {
+        const EntryName name(filename);
+        if (!name.valid()) {
+            return std::unexpected(FileError::InvalidFilename);
+        }
+
+        const int fd = ::openat(directory_fd, name.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return std::unexpected(errno == ENOENT ? FileError::FileNotFound : FileError::IoError);
+        }
+
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return std::unexpected(FileError::IoError);
+        }
+        if (static_cast<std::size_t>(st.st_size) > max_size) {
+            ::close(fd);
+            return std::unexpected(FileError::FileTooLarge);
+        }
+
+        std::string content(static_cast<std::size_t>(st.st_size), '\0');
+        std::size_t filled = 0;
+        while (filled < content.size()) {
+            const auto got = ::read(fd, content.data() + filled, content.size() - filled);
+            if (got < 0 && errno == EINTR) {
+                continue;
+            }
+            if (got <= 0) {
+                break;
+            }
+            filled += static_cast<std::size_t>(got);
+        }
+        ::close(fd);
+        // A concurrent truncation leaves fewer bytes; replacements are renames,
+        // so the open file itself never changes otherwise.
+        content.resize(filled);
+        return content;
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+std::string make_temporary_path(const std::string& file_path) {
+    const auto slash = file_path.rfind('/');
+    const auto directory_end = slash == std::string::npos ? 0 : slash + 1;
+
+    std::string result = file_path.substr(0, directory_end);
+    result += '.';
+    result += file_path.substr(directory_end);
+    result += '.';
+    result += std::to_string(::getpid());
+    result += '.';
+    result += std::to_string(temporary_counter.fetch_add(1, std::memory_order_relaxed));
+    result += ".tmp";
+    return result;
+}
+
+std::expected<void, FileError>
+write_file_atomically(const std::string& file_path, std::string_view contents, bool sync) noexcept {
+    try {
+        const auto temporary_path = make_temporary_path(file_path);
+
+        const int fd = ::open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            return std::unexpected(FileError::IoError);
+        }
+
+        const bool ok = write_all(fd, contents) && (!sync || ::fsync(fd) == 0);
+        if (::close(fd) != 0 || !ok) {
+            ::unlink(temporary_path.c_str());
+            return std::unexpected(FileError::IoError);
+        }
+
+        if (std::rename(temporary_path.c_str(), file_path.c_str()) != 0) {
+            ::unlink(temporary_path.c_str());
+            return std::unexpected(FileError::IoError);
+        }
+        return {};
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+std::expected<void, FileError>
+write_file_atomically_at(int directory_fd,
+                         std::string_view filename,
+                         std::string_view contents,
+                         bool sync) noexcept {
+    const EntryName name(filename);
+    if (!name.valid()) {
+        return std::unexpected(FileError::InvalidFilename);
+    }
+    const auto temporary = EntryName::temporary_for(filename);
+    if (!temporary.valid()) {
+        return std::unexpected(FileError::IoError);
+    }
+
+    const int fd = ::openat(directory_fd, temporary.c_str(),
+                            O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return std::unexpected(FileError::IoError);
+    }
+
+    const bool ok = write_all(fd, contents) && (!sync || ::fsync(fd) == 0);
+    if (::close(fd) != 0 || !ok ||
+        ::renameat(directory_fd, temporary.c_str(), directory_fd, name.c_str()) != 0) {
+        ::unlinkat(directory_fd, temporary.c_str(), 0);
+        return std::unexpected(FileError::IoError);
+    }
+    return {};
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,174 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_FILE_IO_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_FILE_IO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <expected.hpp>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+
+#include "storage/file_manager.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Longest directory entry name, as on common Linux file systems.
+ */
+constexpr std::size_t MAX_ENTRY_NAME_LENGTH = 255;
+
+/**
+ * @brief Extension of every stored document's file name.
+ */
+constexpr std::string_view JSON_EXTENSION = ".json";
+
+/**
+ * @brief Largest document that is stored, or read back from disk.
+ */
+constexpr std::size_t MAX_DOCUMENT_SIZE = 1024 * 1024; // 1MB
+
+/**
+ * @brief Directory mtime written into an index snapshot for a key whose
+ *        directory is gone.
+ *
+ * No directory has this mtime, so the next load never trusts the snapshot's
+ * entries for the key and rescans it instead.
+ */
+constexpr std::int64_t MISSING_DIRECTORY_MTIME = std::numeric_limits<std::int64_t>::min();
+
+/**
+ * @brief Whether a directory entry is a stored document: not hidden, and
+ *        ending in ".json".
+ *
+ * Enough for names read from a key directory. Names taken from requests must
+ * also be checked for path separators before they are used.
+ */
+[[nodiscard]] bool is_document_entry(std::string_view name) noexcept;
+
+/**
+ * @brief A file's modification time in nanoseconds.
+ */
+[[nodiscard]] std::int64_t mtime_ns(const struct stat& st) noexcept;
+
+/**
+ * @brief Modification time of a directory in nanoseconds.
+ *
+ * @param path The directory's full path.
+ * @return std::optional<std::int64_t> The mtime, or std::nullopt if there is
+ *         no directory at the path.
+ */
+[[nodiscard]] std::optional<std::int64_t> directory_mtime_ns(const std::string& path) noexcept;
+
+/**
+ * @brief A NUL-terminated copy of one directory entry name, kept on the stack.
+ *
+ * Lets names held as string views be passed to the *at() system calls
+ * without allocating.
+ */
+class EntryName {
+public:
+    /**
+     * @brief Copy a name.
+     *
+     * @param name The name; longer names or names containing '/' or NUL are invalid.
+     */
+    explicit EntryName(std::string_view name) noexcept;
+
+    /**
+     * @brief Build the name of a temporary file next to an entry.
+     *
+     * Like make_temporary_path(), the name starts with a dot and ends in ".tmp".
+     *
+     * @param name The final name.
+     * @return EntryName The temporary name; invalid if it would be too long.
+     */
+    [[nodiscard]] static EntryName temporary_for(std::string_view name) noexcept;
+
+    [[nodiscard]] bool valid() const noexcept {
+        return valid_;
+    }
+
+    [[nodiscard]] const char* c_str() const noexcept {
+        return buffer_;
+    }
+
+private:
+    EntryName() noexcept = default;
+
+    char buffer_[MAX_ENTRY_NAME_LENGTH + 1] = {};
+    bool valid_ = false;
+};
+
+/**
+ * @brief Read a whole file into memory.
+ *
+ * @param file_path The full path to the file.
+ * @param max_size Files larger than this are rejected with FileError::FileTooLarge.
+ * @return std::expected<std::string, FileError> The file contents or error.
+ */
+[[nodiscard]] std::expected<std::string, FileError>
+read_file(const std::string& file_path, std::size_t max_size) noexcept;
+
+/**
+ * @brief Read a whole file in an open directory into memory.
+ *
+ * The size is checked with fstat() before reading, and the contents are read
+ * into a buffer of exactly that size.
+ *
+ * @param directory_fd The directory.
+ * @param filename The file's name within the directory.
+ * @param max_size Files larger than this are rejected with FileError::FileTooLarge.
+ * @return std::expected<std::string, FileError> The file contents, or
+ *         FileError::FileNotFound if there is no such file, or another error.
+ */
+[[nodiscard]] std::expected<std::string, FileError>
+read_file_at(int directory_fd, std::string_view filename, std::size_t max_size) noexcept;
+
+/**
+ * @brief Build a unique temporary path next to the given path.
+ *
+ * The temporary name starts with a dot and ends in ".tmp", so it is never
+ * reported by FileManager::list_files().
+ *
+ * @param file_path The final path.
+ * @return std::string A temporary path in the same directory.
+ */
+[[nodiscard]] std::string make_temporary_path(const std::string& file_path);
+
+/**
+ * @brief Atomically replace a file with the given contents.
+ *
+ * The data is written to a temporary file in the same directory which is then
+ * renamed over the target, so readers never observe a partially written file.
+ *
+ * @param file_path The full path to the file.
+ * @param contents The bytes to write.
+ * @param sync Whether to fsync the file before renaming it.
+ * @return std::expected<void, FileError> Success or error.
+ */
+[[nodiscard]] std::expected<void, FileError>
+write_file_atomically(const std::string& file_path, std::string_view contents, bool sync) noexcept;
+
+/**
+ * @brief Atomically replace a file in an open directory with the given contents.
+ *
+ * Same as write_file_atomically(), with the temporary file created and
+ * renamed relative to directory_fd.
+ *
+ * @param directory_fd The directory.
+ * @param filename The file's name within the directory.
+ * @param contents The bytes to write.
+ * @param sync Whether to fsync the file before renaming it.
+ * @return std::expected<void, FileError> Success or error.
+ */
+[[nodiscard]] std::expected<void, FileError>
+write_file_atomically_at(int directory_fd,
+                         std::string_view filename,
+                         std::string_view contents,
+                         bool sync) noexcept;
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_FILE_IO_HPP
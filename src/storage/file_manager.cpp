@@ -1,107 +1,356 @@
 #include "storage/file_manager.hpp"
 
+#include "json/json_validator.hpp"
+#include "storage/blob_store.hpp"
+#include "storage/content_hash.hpp"
+#include "storage/directory_cache.hpp"
+#include "storage/document_index.hpp"
+#include "storage/expiry_manager.hpp"
+#include "storage/field_index.hpp"
+#include "storage/file_handle_cache.hpp"
+#include "storage/file_io.hpp"
+#include "storage/index_build.hpp"
+#include "storage/name_validation.hpp"
+#include "storage/text_index.hpp"
+#include "util/request_trace.hpp"
+#include "util/thread_pool.hpp"
+
 #include <algorithm>
-#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <dirent.h>
+#include <fcntl.h>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
 #include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace simple_data_server {
 
 namespace {
 
-constexpr std::string_view JSON_EXTENSION = ".json";
-constexpr size_t MAX_JSON_SIZE_BYTES = 1024 * 1024; // 1MB
+constexpr std::string_view BLOB_DIRECTORY = ".blobs";
+constexpr std::string_view QUARANTINE_DIRECTORY = ".quarantine";
+
+/**
+ * @brief Whether a file name from a request names a stored document.
+ */
+bool is_valid_document_name(std::string_view filename) {
+    return is_document_entry(filename) &&
+           filename.find_first_of(std::string_view("/\\\0", 3)) == std::string_view::npos;
+}
 
-bool is_valid_json_character(char c) {
-    return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-';
+/**
+ * @brief Limit the file cache to a quarter of the open file limit, leaving
+ *        the rest for connections, key directories and index files.
+ */
+std::size_t file_cache_capacity(std::size_t requested) {
+    struct rlimit limit{};
+    if (requested == 0 || ::getrlimit(RLIMIT_NOFILE, &limit) != 0 ||
+        limit.rlim_cur == RLIM_INFINITY) {
+        return requested;
+    }
+    const auto allowed = static_cast<std::size_t>(limit.rlim_cur / 4);
+    if (requested > allowed) {
+        std::cerr << "File cache limited to " << allowed << " documents by the open file limit of "
+                  << limit.rlim_cur << std::endl;
+        return allowed;
+    }
+    return requested;
 }
 
 } // namespace
 
-FileManager::FileManager(std::string data_directory)
-    : data_directory_(std::move(data_directory)) {
+FileManager::FileManager(std::string data_directory, StorageOptions options)
+    : data_directory_(std::move(data_directory)),
+      usage_tracker_(std::make_unique<UsageTracker>(data_directory_, options.quota)),
+      document_index_(std::make_unique<DocumentIndex>(data_directory_)),
+      field_indexes_(std::make_unique<FieldIndexes>(data_directory_, index_document_source())),
+      text_indexes_(std::make_unique<TextIndexes>(data_directory_, index_document_source())),
+      change_listener_(std::move(options.change_listener)) {
     std::filesystem::create_directories(data_directory_);
+    directories_ = std::make_unique<DirectoryCache>(data_directory_, options.directory_cache_size);
+    open_files_ = std::make_unique<FileHandleCache>(file_cache_capacity(options.file_cache_size));
+    // Indexes rebuilt on load read through read_document(), which asks the expiry manager.
+    expiry_manager_ = std::make_unique<ExpiryManager>(
+        data_directory_, [this](std::string_view key, std::string_view filename) {
+            remove_document(key, filename);
+        });
+
+    const auto load_start = std::chrono::steady_clock::now();
+    DocumentIndex::LoadStats stats;
+    std::size_t rebuilt_indexes = 0;
+    std::size_t rebuilt_text_indexes = 0;
+    {
+        ThreadPool pool(options.scan_threads);
+        stats = document_index_->load(pool);
+        rebuilt_indexes = field_indexes_->load(pool);
+        rebuilt_text_indexes = text_indexes_->load(pool);
+    }
+    const auto load_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - load_start);
+    std::cout << "Indexed " << stats.documents << " documents in "
+              << stats.keys_from_snapshot + stats.keys_scanned << " keys ("
+              << stats.keys_from_snapshot << " from snapshot, " << stats.keys_scanned
+              << " scanned) in " << load_ms.count() << " ms" << std::endl;
+    if (rebuilt_indexes > 0) {
+        std::cout << "Rebuilt field indexes of " << rebuilt_indexes << " keys" << std::endl;
+    }
+    if (rebuilt_text_indexes > 0) {
+        std::cout << "Rebuilt text indexes of " << rebuilt_text_indexes << " keys" << std::endl;
+    }
+
+    for (const auto& [key, usage] : document_index_->usage_by_key()) {
+        usage_tracker_->set(key, usage);
+    }
+    usage_tracker_->start_persister(options.usage_persist_interval);
+    expiry_manager_->start();
+
+    if (options.scrub.enabled) {
+        scrubber_ = std::make_unique<Scrubber>(
+            data_directory_, *document_index_, options.scrub,
+            [this](std::string_view key,
+                   std::string_view filename,
+                   std::string_view,
+                   const struct stat& checked) { quarantine_document(key, filename, checked); });
+        scrubber_->start();
+    }
+
+    if (options.deduplicate) {
+        blob_store_ = std::make_unique<BlobStore>(data_directory_ + "/" + std::string(BLOB_DIRECTORY));
+        blob_store_->collect_garbage();
+        blob_store_->start_garbage_collector(options.blob_gc_interval);
+    }
 }
 
-std::expected<void, FileError>
+FileManager::~FileManager() {
+    expiry_manager_->stop();
+    if (scrubber_) {
+        scrubber_->stop();
+    }
+    if (blob_store_) {
+        blob_store_->stop_garbage_collector();
+    }
+    document_index_->save_snapshot();
+    field_indexes_->save();
+    text_indexes_->save();
+}
+
+std::expected<std::string, FileError>
 FileManager::put_json(std::string_view key,
                      std::string_view filename,
-                     const nlohmann::json& data) noexcept {
+                     const nlohmann::json& data,
+                     const PutOptions& options) noexcept {
+    try {
+        return put_raw(key, filename, data.dump(), options);
+    } catch (const nlohmann::json::exception&) {
+        return std::unexpected(FileError::JsonEncodingError);
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+std::expected<std::string, FileError>
+FileManager::put_raw(std::string_view key,
+                     std::string_view filename,
+                     std::string_view bytes,
+                     const PutOptions& options) noexcept {
     if (key.empty()) {
         return std::unexpected(FileError::InvalidFilename);
     }
 
-    if (!key_directory_exists(key)) {
+    const auto directory = open_key_directory(key);
+    if (!directory) {
         return std::unexpected(FileError::KeyDirectoryNotFound);
     }
 
-    const auto sanitized_filename = sanitize_filename(filename);
-    if (sanitized_filename.empty()) {
+    const auto filename_with_ext = stored_filename(filename);
+    if (filename_with_ext.empty()) {
         return std::unexpected(FileError::InvalidFilename);
     }
 
-    const auto filename_with_ext = ensure_json_extension(sanitized_filename);
-    const auto file_path = get_file_path(key, filename_with_ext);
+    if (bytes.size() > MAX_DOCUMENT_SIZE) {
+        return std::unexpected(FileError::FileTooLarge);
+    }
 
     try {
-        const auto json_string = data.dump();
-        if (json_string.size() > MAX_JSON_SIZE_BYTES) {
-            return std::unexpected(FileError::FileTooLarge);
+        if (options.if_version.has_value()) {
+            const auto matches =
+                has_version(directory->fd(), filename_with_ext, options.if_version.value());
+            if (!matches) {
+                return std::unexpected(matches.error());
+            }
+            if (!matches.value()) {
+                return std::unexpected(FileError::VersionMismatch);
+            }
         }
 
-        std::ofstream file(file_path, std::ios::binary);
-        if (!file.is_open()) {
-            return std::unexpected(FileError::IoError);
+        const auto delta =
+            replacement_delta(directory->fd(), key, filename_with_ext, bytes.size());
+        if (!usage_tracker_->allows(key, delta)) {
+            return std::unexpected(FileError::QuotaExceeded);
         }
 
-        file << json_string;
-        if (file.fail()) {
-            return std::unexpected(FileError::IoError);
+        const auto previous_expiry =
+            expiry_manager_->set_expiry(key, filename_with_ext, options.ttl);
+
+        const auto hash = write_document(directory->fd(), key, filename_with_ext, bytes, delta);
+        if (!hash) {
+            // The old document is still in place; it keeps its old expiry.
+            expiry_manager_->restore_expiry(key, filename_with_ext, previous_expiry);
+            return std::unexpected(hash.error());
         }
+        notify_change(DocumentChange{ChangeType::Put, key, filename_with_ext, bytes});
 
-        return {};
-    } catch (const nlohmann::json::exception&) {
-        return std::unexpected(FileError::JsonEncodingError);
+        return format_content_hash(hash.value());
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
     }
 }
 
-std::expected<nlohmann::json, FileError>
+std::expected<JsonDocument, FileError>
 FileManager::get_json(std::string_view key, std::string_view filename) const noexcept {
     if (key.empty() || filename.empty()) {
         return std::unexpected(FileError::InvalidFilename);
     }
 
-    if (!key_directory_exists(key)) {
-        return std::unexpected(FileError::KeyDirectoryNotFound);
+    try {
+        const auto filename_with_ext = stored_filename(filename);
+        if (filename_with_ext.empty()) {
+            return std::unexpected(FileError::FileNotFound);
+        }
+
+        const auto content = read_document(key, filename_with_ext, true);
+        if (!content) {
+            return std::unexpected(content.error());
+        }
+
+        auto data = nlohmann::json::parse(content.value());
+        return JsonDocument{std::move(data), format_content_hash(content_hash(content.value()))};
+    } catch (const nlohmann::json::parse_error&) {
+        return std::unexpected(FileError::InvalidJson);
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
     }
+}
 
-    const auto sanitized_filename = sanitize_filename(filename);
-    const auto filename_with_ext = ensure_json_extension(sanitized_filename);
-    const auto file_path = get_file_path(key, filename_with_ext);
+std::expected<RawDocument, FileError>
+FileManager::get_raw(std::string_view key, std::string_view filename) const noexcept {
+    if (key.empty() || filename.empty()) {
+        return std::unexpected(FileError::InvalidFilename);
+    }
 
-    if (!std::filesystem::exists(file_path)) {
-        return std::unexpected(FileError::FileNotFound);
+    try {
+        const auto filename_with_ext = stored_filename(filename);
+        if (filename_with_ext.empty()) {
+            return std::unexpected(FileError::FileNotFound);
+        }
+
+        auto content = read_document(key, filename_with_ext, true);
+        if (!content) {
+            return std::unexpected(content.error());
+        }
+        if (!validate_json(content.value())) {
+            return std::unexpected(FileError::InvalidJson);
+        }
+
+        auto version = format_content_hash(content_hash(content.value()));
+        return RawDocument{std::move(content.value()), std::move(version)};
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+std::expected<void, FileError>
+FileManager::apply_replicated_put(std::string_view key,
+                                  std::string_view filename,
+                                  std::string_view bytes) noexcept {
+    if (!is_valid_key(key)) {
+        return std::unexpected(FileError::InvalidFilename);
+    }
+
+    if (!is_valid_document_name(filename)) {
+        return std::unexpected(FileError::InvalidFilename);
+    }
+
+    if (bytes.size() > MAX_DOCUMENT_SIZE) {
+        return std::unexpected(FileError::FileTooLarge);
     }
 
     try {
-        std::ifstream file(file_path, std::ios::binary);
-        if (!file.is_open()) {
+        const auto directory = directories_->open(key, true);
+        if (!directory) {
             return std::unexpected(FileError::IoError);
         }
 
-        std::string content((std::istreambuf_iterator<char>(file)),
-                            std::istreambuf_iterator<char>());
+        const auto delta = replacement_delta(directory->fd(), key, filename, bytes.size());
+        const auto previous_expiry = expiry_manager_->set_expiry(key, filename, std::nullopt);
 
-        if (content.size() > MAX_JSON_SIZE_BYTES) {
-            return std::unexpected(FileError::FileTooLarge);
+        const auto hash = write_document(directory->fd(), key, filename, bytes, delta);
+        if (!hash) {
+            expiry_manager_->restore_expiry(key, filename, previous_expiry);
+            return std::unexpected(hash.error());
         }
+        notify_change(DocumentChange{ChangeType::Put, key, filename, bytes});
+        return {};
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
 
-        auto data = nlohmann::json::parse(content);
-        return data;
-    } catch (const nlohmann::json::parse_error&) {
-        return std::unexpected(FileError::InvalidJson);
+void FileManager::apply_replicated_delete(std::string_view key,
+                                          std::string_view filename) noexcept {
+    if (!key_directory_exists(key) || !is_valid_document_name(filename)) {
+        return;
+    }
+    remove_document(key, filename);
+}
+
+std::expected<std::string, FileError>
+FileManager::get_json_bytes(std::string_view key, std::string_view filename) const noexcept {
+    // Scans read every document of a key; leave the file cache to point reads.
+    return read_document(key, filename, false);
+}
+
+DocumentSource FileManager::index_document_source() const {
+    return DocumentSource{
+        [this](std::string_view key) {
+            return list_files(key).value_or(std::vector<std::string>{});
+        },
+        [this](std::string_view key, std::string_view filename) -> std::optional<std::string> {
+            auto content = get_json_bytes(key, filename);
+            if (!content) {
+                return std::nullopt;
+            }
+            return std::move(content.value());
+        }};
+}
+
+std::expected<std::string, FileError>
+FileManager::read_document(std::string_view key,
+                           std::string_view filename,
+                           bool admit) const noexcept {
+    if (key.empty() || filename.empty()) {
+        return std::unexpected(FileError::InvalidFilename);
+    }
+
+    const auto directory = open_key_directory(key);
+    if (!directory) {
+        return std::unexpected(FileError::KeyDirectoryNotFound);
+    }
+
+    if (!is_valid_document_name(filename)) {
+        return std::unexpected(FileError::InvalidFilename);
+    }
+
+    try {
+        if (expiry_manager_->is_expired(key, filename)) {
+            return std::unexpected(FileError::FileNotFound);
+        }
+
+        return open_files_->read(directory->fd(), key, filename, MAX_DOCUMENT_SIZE, admit);
     } catch (const std::exception&) {
         return std::unexpected(FileError::IoError);
     }
@@ -113,80 +362,367 @@ FileManager::list_files(std::string_view key) const noexcept {
         return std::unexpected(FileError::InvalidFilename);
     }
 
-    if (!key_directory_exists(key)) {
+    const auto directory = open_key_directory(key);
+    if (!directory) {
         return std::unexpected(FileError::KeyDirectoryNotFound);
     }
 
-    const auto key_dir = get_key_directory(key);
-    std::vector<std::string> files;
+    // fdopendir() takes ownership of its descriptor, so give it a fresh one.
+    const int fd = ::openat(directory->fd(), ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR* const stream = fd >= 0 ? ::fdopendir(fd) : nullptr;
+    if (stream == nullptr) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return std::unexpected(FileError::IoError);
+    }
 
+    std::vector<std::string> files;
     try {
-        for (const auto& entry : std::filesystem::directory_iterator(key_dir)) {
-            if (entry.is_regular_file()) {
-                const auto filename = entry.path().filename().string();
-                if (filename.size() >= JSON_EXTENSION.size() &&
-                    filename.substr(filename.size() - JSON_EXTENSION.size()) == JSON_EXTENSION) {
-                    files.push_back(filename);
-                }
+        while (const auto* entry = ::readdir(stream)) {
+            const std::string_view filename(entry->d_name);
+            if (!is_document_entry(filename)) {
+                continue;
+            }
+            bool regular = entry->d_type == DT_REG;
+            if (entry->d_type == DT_UNKNOWN) {
+                struct stat st{};
+                regular = ::fstatat(directory->fd(), entry->d_name, &st, 0) == 0 &&
+                          S_ISREG(st.st_mode);
+            }
+            if (regular) {
+                files.emplace_back(filename);
             }
         }
-    } catch (const std::filesystem::filesystem_error&) {
+    } catch (const std::exception&) {
+        ::closedir(stream);
         return std::unexpected(FileError::IoError);
     }
+    ::closedir(stream);
 
     std::sort(files.begin(), files.end());
     return files;
 }
 
-bool FileManager::key_directory_exists(std::string_view key) const noexcept {
-    const auto key_dir = get_key_directory(key);
-    return std::filesystem::exists(key_dir) && std::filesystem::is_directory(key_dir);
+std::vector<std::string> FileManager::list_keys() const {
+    return document_index_->keys();
 }
 
-std::string FileManager::sanitize_filename(std::string_view filename) const noexcept {
-    std::string result;
-    result.reserve(filename.size());
+std::expected<void, FileError>
+FileManager::create_index(std::string_view key, const JsonPath& path) noexcept {
+    if (!key_directory_exists(key)) {
+        return std::unexpected(FileError::KeyDirectoryNotFound);
+    }
+    try {
+        if (!field_indexes_->create(key, path)) {
+            return std::unexpected(FileError::IoError);
+        }
+        return {};
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
 
-    for (char c : filename) {
-        if (c == '/' || c == '\\' || c == '\0') {
-            continue;
+std::expected<void, FileError>
+FileManager::drop_index(std::string_view key, std::string_view path) noexcept {
+    if (!key_directory_exists(key)) {
+        return std::unexpected(FileError::KeyDirectoryNotFound);
+    }
+    try {
+        if (!field_indexes_->drop(key, path)) {
+            return std::unexpected(FileError::IoError);
         }
-        if (c == '.' && !result.empty() && result.back() == '.') {
-            continue;
+        return {};
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+std::expected<std::vector<std::string>, FileError>
+FileManager::list_indexes(std::string_view key) const noexcept {
+    if (!key_directory_exists(key)) {
+        return std::unexpected(FileError::KeyDirectoryNotFound);
+    }
+    try {
+        return field_indexes_->paths(key);
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+std::optional<std::vector<std::string>>
+FileManager::find_candidates(std::string_view key, const Filter& filter) const noexcept {
+    try {
+        return field_indexes_->candidates(key, filter);
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+std::expected<void, FileError> FileManager::create_text_index(std::string_view key) noexcept {
+    if (!key_directory_exists(key)) {
+        return std::unexpected(FileError::KeyDirectoryNotFound);
+    }
+    try {
+        if (!text_indexes_->create(key)) {
+            return std::unexpected(FileError::IoError);
         }
-        if (c == '.') {
-            result.push_back('_');
-            continue;
+        return {};
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+std::expected<void, FileError> FileManager::drop_text_index(std::string_view key) noexcept {
+    if (!key_directory_exists(key)) {
+        return std::unexpected(FileError::KeyDirectoryNotFound);
+    }
+    try {
+        if (!text_indexes_->drop(key)) {
+            return std::unexpected(FileError::IoError);
         }
-        if (is_valid_json_character(c)) {
-            result.push_back(c);
+        return {};
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+std::optional<TextIndexStats>
+FileManager::get_text_index_stats(std::string_view key) const noexcept {
+    try {
+        return text_indexes_->stats(key);
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+std::optional<std::vector<std::string>>
+FileManager::find_text_candidates(std::string_view key, const TextQuery& query) const noexcept {
+    try {
+        return text_indexes_->candidates(key, query);
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+std::expected<KeyUsage, FileError> FileManager::get_usage(std::string_view key) const noexcept {
+    if (key.empty()) {
+        return std::unexpected(FileError::InvalidFilename);
+    }
+
+    if (!key_directory_exists(key)) {
+        return std::unexpected(FileError::KeyDirectoryNotFound);
+    }
+
+    try {
+        return usage_tracker_->get(key);
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
+}
+
+void FileManager::process_expirations() noexcept {
+    try {
+        expiry_manager_->tick();
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to process expirations: " << e.what() << std::endl;
+    }
+}
+
+std::expected<std::uint64_t, FileError>
+FileManager::write_document(int directory_fd,
+                            std::string_view key,
+                            std::string_view filename,
+                            std::string_view bytes,
+                            const KeyUsage& delta) {
+    const auto hash = content_hash(bytes);
+    const auto written =
+        blob_store_ ? blob_store_->store_and_link(bytes, hash, directory_fd, filename)
+                    : write_file_atomically_at(directory_fd, filename, bytes, false);
+    open_files_->invalidate(key, filename);
+    if (!written) {
+        return std::unexpected(written.error());
+    }
+    usage_tracker_->apply(key, delta);
+
+    const EntryName name(filename);
+    struct stat st{};
+    const auto mtime = ::fstatat(directory_fd, name.c_str(), &st, 0) == 0 ? mtime_ns(st) : 0;
+    document_index_->update(key, filename, DocumentInfo{bytes.size(), mtime, hash, true});
+    field_indexes_->update(key, filename, bytes);
+    text_indexes_->update(key, filename, bytes);
+    return hash;
+}
+
+KeyUsage FileManager::replacement_delta(int directory_fd,
+                                        std::string_view key,
+                                        std::string_view filename,
+                                        std::size_t new_size) const {
+    std::int64_t old_size = 0;
+    bool is_new_file = true;
+    if (const auto existing = document_index_->find(key, filename)) {
+        old_size = static_cast<std::int64_t>(existing->size);
+        is_new_file = false;
+    } else {
+        const EntryName name(filename);
+        struct stat st{};
+        if (name.valid() && ::fstatat(directory_fd, name.c_str(), &st, 0) == 0) {
+            old_size = static_cast<std::int64_t>(st.st_size);
+            is_new_file = false;
         }
     }
+    return KeyUsage{static_cast<std::int64_t>(new_size) - old_size, is_new_file ? 1 : 0};
+}
 
-    while (!result.empty() && (result.back() == '_' || result.back() == '-')) {
-        result.pop_back();
+void FileManager::notify_change(const DocumentChange& change) const noexcept {
+    if (!change_listener_) {
+        return;
+    }
+    try {
+        change_listener_(change);
+    } catch (const std::exception& e) {
+        std::cerr << "Change listener failed for " << change.key << "/" << change.filename << ": "
+                  << e.what() << std::endl;
     }
+}
 
-    return result;
+void FileManager::quarantine_document(std::string_view key,
+                                      std::string_view filename,
+                                      const struct stat& checked) noexcept {
+    try {
+        const auto quarantine_dir =
+            data_directory_ + "/" + std::string(QUARANTINE_DIRECTORY) + "/" + std::string(key);
+        std::filesystem::create_directories(quarantine_dir);
+
+        const auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+        const auto target =
+            quarantine_dir + "/" + std::string(filename) + "." + std::to_string(timestamp.count());
+
+        const auto directory = open_key_directory(key);
+        const EntryName name(filename);
+        if (!directory || !name.valid()) {
+            std::cerr << "Failed to quarantine " << key << "/" << filename << std::endl;
+            return;
+        }
+
+        // A put may have replaced the document since the scrubber checked it;
+        // the new version is checked on the next pass instead.
+        struct stat current{};
+        if (::fstatat(directory->fd(), name.c_str(), &current, AT_SYMLINK_NOFOLLOW) != 0 ||
+            current.st_dev != checked.st_dev || current.st_ino != checked.st_ino ||
+            current.st_size != checked.st_size || mtime_ns(current) != mtime_ns(checked)) {
+            return;
+        }
+
+        if (::renameat(directory->fd(), name.c_str(), AT_FDCWD, target.c_str()) != 0) {
+            std::cerr << "Failed to quarantine " << key << "/" << filename << std::endl;
+            return;
+        }
+        open_files_->invalidate(key, filename);
+        const auto info = document_index_->find(key, filename);
+        document_index_->remove(key, filename);
+        field_indexes_->remove(key, filename);
+        text_indexes_->remove(key, filename);
+        if (info) {
+            usage_tracker_->apply(key, KeyUsage{-static_cast<std::int64_t>(info->size), -1});
+        }
+        notify_change(DocumentChange{ChangeType::Delete, key, filename, {}});
+        std::cerr << "Quarantined " << key << "/" << filename << " to " << target << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to quarantine " << key << "/" << filename << ": " << e.what()
+                  << std::endl;
+    }
 }
 
-std::string FileManager::ensure_json_extension(std::string filename) const noexcept {
-    if (filename.size() >= JSON_EXTENSION.size()) {
-        const auto ext = filename.substr(filename.size() - JSON_EXTENSION.size());
-        if (ext == JSON_EXTENSION) {
-            return filename;
+void FileManager::remove_document(std::string_view key, std::string_view filename) noexcept {
+    try {
+        const auto directory = open_key_directory(key);
+        const EntryName name(filename);
+        if (!directory || !name.valid() || ::unlinkat(directory->fd(), name.c_str(), 0) != 0) {
+            return;
         }
+        open_files_->invalidate(key, filename);
+        const auto info = document_index_->find(key, filename);
+        document_index_->remove(key, filename);
+        field_indexes_->remove(key, filename);
+        text_indexes_->remove(key, filename);
+        if (info) {
+            usage_tracker_->apply(key, KeyUsage{-static_cast<std::int64_t>(info->size), -1});
+        }
+        notify_change(DocumentChange{ChangeType::Delete, key, filename, {}});
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to remove " << key << "/" << filename << ": " << e.what() << std::endl;
     }
-    return filename + JSON_EXTENSION.data();
 }
 
-std::string FileManager::get_key_directory(std::string_view key) const noexcept {
-    return std::string(data_directory_) + "/" + std::string(key);
+bool FileManager::key_directory_exists(std::string_view key) const noexcept {
+    return open_key_directory(key) != nullptr;
+}
+
+std::shared_ptr<const DirectoryHandle>
+FileManager::open_key_directory(std::string_view key) const noexcept {
+    if (!is_valid_key(key)) {
+        return nullptr;
+    }
+    try {
+        auto directory = directories_->open(key);
+        trace_stage(TraceStage::Lookup);
+        return directory;
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+std::string FileManager::stored_filename(std::string_view filename) const noexcept {
+    // One allocation holds the sanitized name and the extension appended to it.
+    std::string result(filename.size() + JSON_EXTENSION.size(), '\0');
+    const auto length = sanitize_filename(filename, result.data());
+    if (length == 0) {
+        return {};
+    }
+    result.resize(length);
+    result += JSON_EXTENSION;
+    return result;
 }
 
-std::string FileManager::get_file_path(std::string_view key,
-                                        std::string_view filename) const noexcept {
-    return get_key_directory(key) + "/" + std::string(filename);
+std::expected<bool, FileError>
+FileManager::has_version(int directory_fd,
+                         std::string_view filename,
+                         std::string_view version) const noexcept {
+    try {
+        const EntryName name(filename);
+        if (!name.valid()) {
+            return std::unexpected(FileError::InvalidFilename);
+        }
+        struct stat st{};
+        if (::fstatat(directory_fd, name.c_str(), &st, 0) != 0) {
+            if (errno != ENOENT) {
+                return std::unexpected(FileError::IoError);
+            }
+            return version.empty();
+        }
+        if (version.empty()) {
+            return false;
+        }
+
+        const auto expected_hash = parse_content_hash(version);
+        if (!expected_hash) {
+            return false;
+        }
+        if (blob_store_ &&
+            blob_store_->is_linked_to(expected_hash.value(), directory_fd, filename)) {
+            return true;
+        }
+
+        const auto content = read_file_at(directory_fd, filename, MAX_DOCUMENT_SIZE);
+        if (!content) {
+            return std::unexpected(content.error());
+        }
+        return content_hash(content.value()) == expected_hash.value();
+    } catch (const std::exception&) {
+        return std::unexpected(FileError::IoError);
+    }
 }
 
 } // namespace simple_data_server
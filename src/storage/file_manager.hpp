@@ -1,12 +1,20 @@
 #ifndef SIMPLE_DATA_SERVER_STORAGE_FILE_MANAGER_HPP
 #define SIMPLE_DATA_SERVER_STORAGE_FILE_MANAGER_HPP
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
 #include <expected.hpp>
 #include <nlohmann/json.hpp>
 
+#include "storage/scrubber.hpp"
+#include "storage/usage_tracker.hpp"
+
 namespace simple_data_server {
 
 /**
@@ -19,9 +27,149 @@ enum class FileError {
     FileTooLarge,
     InvalidFilename,
     IoError,
-    JsonEncodingError
+    JsonEncodingError,
+    VersionMismatch,
+    QuotaExceeded
+};
+
+/**
+ * @brief A stored JSON document together with its version.
+ *
+ * The version is the hex-encoded content hash of the stored bytes. It changes
+ * whenever the document content changes and can be passed back to put_json()
+ * as the expected version for an optimistic, conditional write.
+ */
+struct JsonDocument {
+    nlohmann::json data;
+    std::string version;
+};
+
+/**
+ * @brief A stored JSON document as its serialized bytes, with its version.
+ */
+struct RawDocument {
+    std::string bytes;
+    std::string version;
+};
+
+/**
+ * @brief The kind of change made to a stored document.
+ */
+enum class ChangeType : std::uint8_t {
+    Put = 1,
+    Delete = 2
 };
 
+/**
+ * @brief A successful change to a stored document, as reported to a ChangeListener.
+ *
+ * The views are only valid for the duration of the listener call.
+ */
+struct DocumentChange {
+    ChangeType type;
+    std::string_view key;
+
+    /**
+     * @brief The stored filename, including the .json extension.
+     */
+    std::string_view filename;
+
+    /**
+     * @brief The stored bytes for ChangeType::Put; empty for ChangeType::Delete.
+     */
+    std::string_view bytes;
+};
+
+/**
+ * @brief Callback invoked after every successful document change.
+ */
+using ChangeListener = std::function<void(const DocumentChange&)>;
+
+/**
+ * @brief Tunable options for a FileManager.
+ */
+struct StorageOptions {
+    /**
+     * @brief Store identical documents once in the content-addressed blob store.
+     */
+    bool deduplicate = true;
+
+    /**
+     * @brief Interval between background garbage collections of unreferenced blobs.
+     */
+    std::chrono::seconds blob_gc_interval{60};
+
+    /**
+     * @brief Per-key byte and file limits; zero means unlimited.
+     */
+    KeyQuota quota;
+
+    /**
+     * @brief Interval between writes of the usage counters to disk.
+     */
+    std::chrono::seconds usage_persist_interval{30};
+
+    /**
+     * @brief Threads used for the startup index scan; zero means one per hardware thread.
+     */
+    unsigned scan_threads = 0;
+
+    /**
+     * @brief Number of key directories kept open for openat()-relative file access.
+     */
+    std::size_t directory_cache_size = 256;
+
+    /**
+     * @brief Number of documents kept open for single-pread() reads; zero disables the cache.
+     */
+    std::size_t file_cache_size = 512;
+
+    /**
+     * @brief Background integrity scrubber settings.
+     */
+    ScrubOptions scrub;
+
+    /**
+     * @brief Callback told about every successful put and delete, e.g. to
+     *        feed replication.
+     *
+     * It runs synchronously on the thread making the change, which may be a
+     * background thread (expiry, scrubbing).
+     */
+    ChangeListener change_listener;
+};
+
+/**
+ * @brief Optional conditions and attributes for a put_json() call.
+ */
+struct PutOptions {
+    /**
+     * @brief Expected current version for a conditional write; empty means
+     *        the document must not exist yet.
+     */
+    std::optional<std::string_view> if_version;
+
+    /**
+     * @brief Time after which the document is deleted automatically. Without
+     *        a TTL the document is permanent, even if it previously had one.
+     */
+    std::optional<std::chrono::seconds> ttl;
+};
+
+class BlobStore;
+class DirectoryCache;
+class DirectoryHandle;
+class FileHandleCache;
+class DocumentIndex;
+struct DocumentSource;
+class ExpiryManager;
+class FieldIndexes;
+class Filter;
+class JsonPath;
+class TextIndexes;
+class TextQuery;
+struct TextIndexStats;
+
 /**
  * @brief Manages file storage operations for JSON data files.
  *
@@ -34,41 +182,142 @@ public:
      * @brief Construct a FileManager with the specified data directory.
      *
      * @param data_directory Path to the data directory (e.g., "data").
+     * @param options Storage options.
      * @pre data_directory must not be empty.
-     * @post Creates the data directory if it doesn't exist.
+     * @post Creates the data directory if it doesn't exist, loads the document
+     *       index (from the snapshot where still valid, otherwise by a parallel
+     *       scan) and seeds the usage counters from it, then loads the
+     *       secondary and text indexes. With deduplication
+     *       enabled, also creates the blob store and starts its garbage collector.
+     *       Starts the integrity scrubber unless disabled.
      */
-    explicit FileManager(std::string data_directory);
+    explicit FileManager(std::string data_directory, StorageOptions options = {});
+
+    /**
+     * @brief Stops background work owned by the FileManager and writes the
+     *        index snapshot, secondary and text indexes for the next start.
+     */
+    ~FileManager();
+
+    FileManager(const FileManager&) = delete;
+    FileManager& operator=(const FileManager&) = delete;
 
     /**
      * @brief Put JSON data to a file.
      *
+     * When options.if_version is given, the write only happens if the
+     * document's current version equals it; otherwise the write fails with
+     * FileError::VersionMismatch. When options.ttl is given, the document is
+     * deleted once it expires.
+     *
      * @param key The user's shared key (determines subdirectory).
      * @param filename The name of the file (will be sanitized, .json added if missing).
      * @param data The JSON data to store.
-     * @return std::expected<void, FileError> Success or error.
+     * @param options Conditional write and expiry options.
+     * @return std::expected<std::string, FileError> The new version or error.
+     *         Fails with FileError::QuotaExceeded if the write would take the
+     *         key over its byte or file quota.
      * @pre key must not be empty.
      * @pre filename must be a valid filename after sanitization.
      * @pre data must be valid JSON.
      * @post On success, file is written to data/{key}/{filename}.json
      */
-    [[nodiscard]] std::expected<void, FileError>
+    [[nodiscard]] std::expected<std::string, FileError>
     put_json(std::string_view key,
              std::string_view filename,
-             const nlohmann::json& data) noexcept;
+             const nlohmann::json& data,
+             const PutOptions& options = {}) noexcept;
+
+    /**
+     * @brief Put an already serialized JSON document to a file.
+     *
+     * Same as put_json(), but stores bytes exactly as given, so a request
+     * body that was validated without building a DOM can be written without
+     * re-serializing it. The version is the hash of these bytes.
+     *
+     * @param key The user's shared key (determines subdirectory).
+     * @param filename The name of the file (will be sanitized, .json added if missing).
+     * @param bytes The JSON text to store.
+     * @param options Conditional write and expiry options.
+     * @return std::expected<std::string, FileError> The new version or error.
+     * @pre bytes must be valid JSON; it is not checked again.
+     */
+    [[nodiscard]] std::expected<std::string, FileError>
+    put_raw(std::string_view key,
+            std::string_view filename,
+            std::string_view bytes,
+            const PutOptions& options = {}) noexcept;
 
     /**
      * @brief Get JSON data from a file.
      *
      * @param key The user's shared key (determines subdirectory).
      * @param filename The name of the file to read.
-     * @return std::expected<nlohmann::json, FileError> The JSON data or error.
+     * @return std::expected<JsonDocument, FileError> The JSON data and version or error.
      * @pre key must not be empty.
      * @pre filename must not be empty.
-     * @post On success, returns the parsed JSON data.
+     * @post On success, returns the parsed JSON data and its version. Expired
+     *       documents not yet deleted are reported as FileError::FileNotFound.
      */
-    [[nodiscard]] std::expected<nlohmann::json, FileError>
+    [[nodiscard]] std::expected<JsonDocument, FileError>
     get_json(std::string_view key, std::string_view filename) const noexcept;
 
+    /**
+     * @brief Get a document's stored bytes without parsing them.
+     *
+     * The bytes are checked to be valid JSON with validate_json(), which is
+     * much cheaper than building a DOM.
+     *
+     * @param key The user's shared key (determines subdirectory).
+     * @param filename The name of the file to read (will be sanitized like get_json()).
+     * @return std::expected<RawDocument, FileError> The bytes and version or error.
+     *         Fails with FileError::InvalidJson if the stored bytes are corrupt.
+     */
+    [[nodiscard]] std::expected<RawDocument, FileError>
+    get_raw(std::string_view key, std::string_view filename) const noexcept;
+
+    /**
+     * @brief Store bytes received from a replication primary.
+     *
+     * Unlike put_json(), the filename is not sanitized, the key directory is
+     * created if missing, quotas are not enforced and any TTL is cleared: the
+     * primary has already accepted the write and replicates expirations as
+     * deletes.
+     *
+     * @param key The user's shared key (determines subdirectory).
+     * @param filename A stored filename, including the .json extension.
+     * @param bytes The document exactly as stored on the primary.
+     * @return std::expected<void, FileError> Success or error.
+     */
+    [[nodiscard]] std::expected<void, FileError>
+    apply_replicated_put(std::string_view key,
+                         std::string_view filename,
+                         std::string_view bytes) noexcept;
+
+    /**
+     * @brief Delete a document as instructed by a replication primary.
+     *
+     * @param key The user's shared key.
+     * @param filename A stored filename, including the .json extension.
+     */
+    void apply_replicated_delete(std::string_view key, std::string_view filename) noexcept;
+
+    /**
+     * @brief Get the stored bytes of a JSON file without parsing them.
+     *
+     * Unlike get_json(), the filename is not sanitized: it must be a stored
+     * filename as returned by list_files().
+     *
+     * @param key The user's shared key (determines subdirectory).
+     * @param filename A stored filename, including the .json extension.
+     * @return std::expected<std::string, FileError> The file contents or error.
+     * @pre key must not be empty.
+     * @pre filename must not be empty.
+     * @post On success, returns the bytes exactly as stored.
+     */
+    [[nodiscard]] std::expected<std::string, FileError>
+    get_json_bytes(std::string_view key, std::string_view filename) const noexcept;
+
     /**
      * @brief List all JSON files for a key.
      *
@@ -80,9 +329,141 @@ public:
     [[nodiscard]] std::expected<std::vector<std::string>, FileError>
     list_files(std::string_view key) const noexcept;
 
+    /**
+     * @brief List the keys that have, or had, documents since startup.
+     *
+     * @return std::vector<std::string> The keys.
+     */
+    [[nodiscard]] std::vector<std::string> list_keys() const;
+
+    /**
+     * @brief Create a secondary index on a JSON Pointer within a key's documents.
+     *
+     * The index is filled from the existing documents, kept up to date on
+     * every write and delete, and persisted under data/.sds-indexes.
+     *
+     * @param key The user's shared key.
+     * @param path The path to index.
+     * @return std::expected<void, FileError> Success or error.
+     */
+    [[nodiscard]] std::expected<void, FileError>
+    create_index(std::string_view key, const JsonPath& path) noexcept;
+
+    /**
+     * @brief Drop a secondary index.
+     *
+     * @param key The user's shared key.
+     * @param path The indexed path, as given to create_index().
+     * @return std::expected<void, FileError> Success or error.
+     */
+    [[nodiscard]] std::expected<void, FileError>
+    drop_index(std::string_view key, std::string_view path) noexcept;
+
+    /**
+     * @brief List the secondary indexes of a key.
+     *
+     * @param key The user's shared key.
+     * @return std::expected<std::vector<std::string>, FileError> The indexed paths or error.
+     */
+    [[nodiscard]] std::expected<std::vector<std::string>, FileError>
+    list_indexes(std::string_view key) const noexcept;
+
+    /**
+     * @brief Use the key's secondary indexes to narrow down a query.
+     *
+     * @param key The user's shared key.
+     * @param filter The query filter.
+     * @return std::optional<std::vector<std::string>> Sorted stored filenames
+     *         that may match, or std::nullopt if no index applies.
+     */
+    [[nodiscard]] std::optional<std::vector<std::string>>
+    find_candidates(std::string_view key, const Filter& filter) const noexcept;
+
+    /**
+     * @brief Enable full-text search on a key's string values.
+     *
+     * The index is filled from the existing documents, kept up to date on
+     * every write and delete, and persisted under data/.sds-text.
+     *
+     * @param key The user's shared key.
+     * @return std::expected<void, FileError> Success or error.
+     */
+    [[nodiscard]] std::expected<void, FileError> create_text_index(std::string_view key) noexcept;
+
+    /**
+     * @brief Disable full-text search on a key.
+     *
+     * @param key The user's shared key.
+     * @return std::expected<void, FileError> Success or error.
+     */
+    [[nodiscard]] std::expected<void, FileError> drop_text_index(std::string_view key) noexcept;
+
+    /**
+     * @brief Get the size of a key's text index.
+     *
+     * @param key The user's shared key.
+     * @return std::optional<TextIndexStats> The counts, or std::nullopt if the
+     *         key has no text index.
+     */
+    [[nodiscard]] std::optional<TextIndexStats>
+    get_text_index_stats(std::string_view key) const noexcept;
+
+    /**
+     * @brief Use the key's text index to narrow down a search.
+     *
+     * @param key The user's shared key.
+     * @param query The search query.
+     * @return std::optional<std::vector<std::string>> Sorted stored filenames
+     *         that may match, or std::nullopt if the key has no text index.
+     */
+    [[nodiscard]] std::optional<std::vector<std::string>>
+    find_text_candidates(std::string_view key, const TextQuery& query) const noexcept;
+
+    /**
+     * @brief Get the storage used by a key.
+     *
+     * This reads in-memory counters and does not touch the key directory's files.
+     *
+     * @param key The user's shared key.
+     * @return std::expected<KeyUsage, FileError> The usage or error.
+     * @pre key must not be empty.
+     */
+    [[nodiscard]] std::expected<KeyUsage, FileError> get_usage(std::string_view key) const noexcept;
+
+    /**
+     * @brief Get the quota applied to every key.
+     *
+     * @return const KeyQuota& The quota.
+     */
+    [[nodiscard]] const KeyQuota& get_quota() const noexcept {
+        return usage_tracker_->get_quota();
+    }
+
+    /**
+     * @brief Delete documents whose TTL has passed.
+     *
+     * Advances the expiry timing wheel; the deletions themselves happen in
+     * batches on a background thread. Intended to be called once per second.
+     */
+    void process_expirations() noexcept;
+
+    /**
+     * @brief Get the integrity scrubber's counters.
+     *
+     * @return ScrubStats The counters; all zero if the scrubber is disabled.
+     */
+    [[nodiscard]] ScrubStats get_scrub_stats() const noexcept {
+        return scrubber_ ? scrubber_->stats() : ScrubStats{};
+    }
+
     /**
      * @brief Check if a key directory exists.
      *
+     * Keys rejected by is_valid_key() never exist: keys starting with a dot
+     * are reserved for internal directories such as the blob store, and keys
+     * with path separators or control bytes could name paths outside the data
+     * directory.
+     *
      * @param key The user's shared key to check.
      * @return true if the directory exists, false otherwise.
      */
@@ -97,43 +478,131 @@ public:
         return data_directory_;
     }
 
-private:
     /**
-     * @brief Sanitize a filename by removing path components.
+     * @brief Turn a client-supplied filename into its stored form.
+     *
+     * Different filenames can share a stored form, e.g. "a.json" and "a_json"
+     * are both stored as a_json.json; they name the same document.
      *
      * @param filename The original filename.
-     * @return std::string The sanitized filename.
-     * @post Removes all path separators, dots (except final extension), and path components.
+     * @return std::string The sanitized filename with the .json extension, or an
+     *         empty string if sanitizing leaves nothing; see sanitize_filename().
+     */
+    [[nodiscard]] std::string stored_filename(std::string_view filename) const noexcept;
+
+private:
+
+    /**
+     * @brief The listing and scan read path, for the field and text indexes to fill from.
+     */
+    [[nodiscard]] DocumentSource index_document_source() const;
+
+    /**
+     * @brief Read a stored document after checking its key and expiry.
+     *
+     * @param key The user's shared key.
+     * @param filename A stored filename, including the .json extension.
+     * @param admit Keep the document open in the file cache after a miss.
+     * @return std::expected<std::string, FileError> The file contents or error.
      */
-    [[nodiscard]] std::string sanitize_filename(std::string_view filename) const noexcept;
+    [[nodiscard]] std::expected<std::string, FileError>
+    read_document(std::string_view key, std::string_view filename, bool admit) const noexcept;
 
     /**
-     * @brief Ensure .json extension is present.
+     * @brief Get a key's open directory from the directory cache.
      *
-     * @param filename The filename to check.
-     * @return std::string The filename with .json extension.
+     * @param key The user's shared key.
+     * @return std::shared_ptr<const DirectoryHandle> The directory, or nullptr if
+     *         the key is invalid or has no directory.
      */
-    [[nodiscard]] std::string ensure_json_extension(std::string filename) const noexcept;
+    [[nodiscard]] std::shared_ptr<const DirectoryHandle>
+    open_key_directory(std::string_view key) const noexcept;
 
     /**
-     * @brief Get the full path for a key's directory.
+     * @brief Check whether a file currently has the given version.
+     *
+     * @param directory_fd The open key directory.
+     * @param filename The stored filename (with extension).
+     * @param version The expected version; empty means "does not exist".
+     * @return std::expected<bool, FileError> Whether the version matches, or error.
+     */
+    [[nodiscard]] std::expected<bool, FileError>
+    has_version(int directory_fd,
+                std::string_view filename,
+                std::string_view version) const noexcept;
+
+    /**
+     * @brief Write a document's bytes and update the usage counters and index.
+     *
+     * @param directory_fd The open key directory.
+     * @param key The user's shared key.
+     * @param filename The stored filename (with extension).
+     * @param bytes The serialized document.
+     * @param delta The usage change caused by the write.
+     * @return std::expected<std::uint64_t, FileError> The content hash or error.
+     */
+    [[nodiscard]] std::expected<std::uint64_t, FileError>
+    write_document(int directory_fd,
+                   std::string_view key,
+                   std::string_view filename,
+                   std::string_view bytes,
+                   const KeyUsage& delta);
+
+    /**
+     * @brief Compute the usage change of replacing a document with new_size bytes.
+     *
+     * @param directory_fd The open key directory.
+     * @param key The user's shared key.
+     * @param filename The stored filename (with extension).
+     * @param new_size Size of the new document.
+     * @return KeyUsage The byte and file count delta.
+     */
+    [[nodiscard]] KeyUsage replacement_delta(int directory_fd,
+                                             std::string_view key,
+                                             std::string_view filename,
+                                             std::size_t new_size) const;
+
+    /**
+     * @brief Tell the change listener, if any, about a change.
+     *
+     * @param change The change.
+     */
+    void notify_change(const DocumentChange& change) const noexcept;
+
+    /**
+     * @brief Move a corrupt document out of its key directory.
+     *
+     * The file is renamed to data/.quarantine/{key}/{filename}.{unix time} and
+     * removed from the index and usage counters. Nothing is moved if the file
+     * no longer matches the one the scrubber checked.
      *
      * @param key The user's shared key.
-     * @return std::string The full path to the key's directory.
+     * @param filename The stored filename (with extension).
+     * @param checked The stat of the file the scrubber found corrupt.
      */
-    [[nodiscard]] std::string get_key_directory(std::string_view key) const noexcept;
+    void quarantine_document(std::string_view key,
+                             std::string_view filename,
+                             const struct stat& checked) noexcept;
 
     /**
-     * @brief Get the full path for a file.
+     * @brief Delete a document and remove it from the index and usage counters.
      *
      * @param key The user's shared key.
-     * @param filename The filename.
-     * @return std::string The full path to the file.
+     * @param filename The stored filename (with extension).
      */
-    [[nodiscard]] std::string get_file_path(std::string_view key,
-                                            std::string_view filename) const noexcept;
+    void remove_document(std::string_view key, std::string_view filename) noexcept;
 
     std::string data_directory_;
+    std::unique_ptr<DirectoryCache> directories_;
+    std::unique_ptr<FileHandleCache> open_files_;
+    std::unique_ptr<BlobStore> blob_store_;
+    std::unique_ptr<UsageTracker> usage_tracker_;
+    std::unique_ptr<DocumentIndex> document_index_;
+    std::unique_ptr<FieldIndexes> field_indexes_;
+    std::unique_ptr<TextIndexes> text_indexes_;
+    std::unique_ptr<Scrubber> scrubber_;
+    std::unique_ptr<ExpiryManager> expiry_manager_;
+    ChangeListener change_listener_;
 };
 
 } // namespace simple_data_server
@@ -0,0 +1,40 @@
+#include "storage/index_build.hpp"
+
+#include <algorithm>
+
+namespace simple_data_server {
+
+BuildJournal::Build BuildJournal::begin(std::string_view key) {
+    return builds_.emplace(builds_.end(), std::string(key), Changes{});
+}
+
+BuildJournal::Changes BuildJournal::finish(Build build) {
+    auto changes = std::move(build->second);
+    builds_.erase(build);
+    return changes;
+}
+
+bool BuildJournal::recording(std::string_view key) const noexcept {
+    return std::any_of(builds_.begin(), builds_.end(),
+                       [key](const auto& build) { return build.first == key; });
+}
+
+void BuildJournal::record(std::string_view key,
+                          std::string_view filename,
+                          std::optional<std::string_view> bytes) {
+    for (auto& [build_key, changes] : builds_) {
+        if (build_key != key) {
+            continue;
+        }
+        auto change = bytes ? std::optional<std::string>(std::in_place, bytes.value())
+                            : std::nullopt;
+        const auto it = changes.find(filename);
+        if (it != changes.end()) {
+            it->second = std::move(change);
+        } else {
+            changes.emplace(std::string(filename), std::move(change));
+        }
+    }
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,93 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_INDEX_BUILD_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_INDEX_BUILD_HPP
+
+#include <functional>
+#include <list>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simple_data_server {
+
+/**
+ * @brief How the field and text indexes read a key's documents when they
+ *        fill an index.
+ *
+ * FileManager supplies its own listing and scan read path, so index builds
+ * go through the directory cache and never see expired documents.
+ */
+struct DocumentSource {
+    /** Stored names of a key's documents; empty if the key cannot be listed. */
+    std::function<std::vector<std::string>(std::string_view key)> list;
+
+    /** A document's stored bytes, or std::nullopt if it is gone, expired or unreadable. */
+    std::function<std::optional<std::string>(std::string_view key, std::string_view filename)>
+        read;
+};
+
+/**
+ * @brief Writes made to keys while one of their indexes is being built.
+ *
+ * A build reads the key's documents without holding its index lock. Every
+ * write to the key in the meantime is recorded here, and replayed onto the
+ * new index before it is swapped in, so the index never misses a write or
+ * keeps a value the build read just before it was replaced.
+ *
+ * Not synchronized: it is guarded by the lock of the indexes that own it.
+ */
+class BuildJournal {
+public:
+    /**
+     * @brief The latest write to each document, by stored filename;
+     *        std::nullopt for a removal.
+     */
+    using Changes = std::map<std::string, std::optional<std::string>, std::less<>>;
+
+    /**
+     * @brief Identifies one build for finish().
+     */
+    using Build = std::list<std::pair<std::string, Changes>>::iterator;
+
+    /**
+     * @brief Start recording the writes to a key.
+     *
+     * Must be called before the build lists the key's documents.
+     *
+     * @param key The user's shared key.
+     * @return Build The build, to be passed to finish() exactly once.
+     */
+    Build begin(std::string_view key);
+
+    /**
+     * @brief Stop recording for a build.
+     *
+     * @param build The build, as returned by begin().
+     * @return Changes The writes made since begin().
+     */
+    Changes finish(Build build);
+
+    /**
+     * @brief Whether any build of a key is in progress.
+     */
+    [[nodiscard]] bool recording(std::string_view key) const noexcept;
+
+    /**
+     * @brief Record a write for every build of its key.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename.
+     * @param bytes The stored document, or std::nullopt if it was removed.
+     */
+    void record(std::string_view key,
+                std::string_view filename,
+                std::optional<std::string_view> bytes);
+
+private:
+    std::list<std::pair<std::string, Changes>> builds_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_INDEX_BUILD_HPP
@@ -0,0 +1,208 @@
+#include "storage/name_validation.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define SDS_NAMES_X86 1
+#endif
+
+namespace simple_data_server {
+
+namespace {
+
+bool is_forbidden_key_byte(unsigned char c) {
+    return c < 0x20 || c == 0x7f || c == '/' || c == '\\';
+}
+
+bool is_kept_filename_byte(unsigned char c) {
+    const auto lower = static_cast<unsigned char>(c | 0x20);
+    return (c >= '0' && c <= '9') || (lower >= 'a' && lower <= 'z') || c == '_' || c == '-';
+}
+
+/**
+ * @brief Index of the first byte a key must not contain, or size if there is none.
+ */
+std::size_t scan_key_scalar(const char* data, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        if (is_forbidden_key_byte(static_cast<unsigned char>(data[i]))) {
+            return i;
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief Copy the kept bytes of a filename, dots as underscores; does not trim.
+ */
+std::size_t copy_filename_scalar(const char* data, std::size_t size, char* out) {
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+        const auto c = data[i];
+        if (c == '.') {
+            out[length++] = '_';
+        } else if (is_kept_filename_byte(static_cast<unsigned char>(c))) {
+            out[length++] = c;
+        }
+    }
+    return length;
+}
+
+std::size_t trim_filename(const char* out, std::size_t length) {
+    while (length > 0 && (out[length - 1] == '_' || out[length - 1] == '-')) {
+        --length;
+    }
+    return length;
+}
+
+#ifdef SDS_NAMES_X86
+
+constexpr int RANGE_MODE = _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT;
+
+__attribute__((target("sse4.2"))) std::size_t scan_key_sse42(const char* data, std::size_t size) {
+    // Ranges of forbidden bytes; the explicit length lets the set contain NUL.
+    // Tails shorter than a block are checked byte by byte.
+    const auto forbidden = _mm_setr_epi8(0x00, 0x1f, '/', '/', '\\', '\\', 0x7f, 0x7f, 0, 0, 0, 0,
+                                         0, 0, 0, 0);
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const auto at = _mm_cmpestri(forbidden, 8, block, 16, RANGE_MODE);
+        if (at < 16) {
+            return i + static_cast<std::size_t>(at);
+        }
+    }
+    return i + scan_key_scalar(data + i, size - i);
+}
+
+__attribute__((target("sse4.2"))) std::size_t copy_filename_sse42(const char* data,
+                                                                  std::size_t size, char* out) {
+    const auto kept = _mm_setr_epi8('0', '9', 'A', 'Z', 'a', 'z', '_', '_', '-', '-', '.', '.', 0,
+                                    0, 0, 0);
+    const auto dot = _mm_set1_epi8('.');
+    const auto underscore = _mm_set1_epi8('_');
+
+    std::size_t length = 0;
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        const auto block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const auto dropped =
+            _mm_cmpestri(kept, 12, block, 16, RANGE_MODE | _SIDD_NEGATIVE_POLARITY);
+        if (dropped < 16) {
+            length += copy_filename_scalar(data + i, 16, out + length);
+            continue;
+        }
+        // Every byte is kept; out + length never runs ahead of data + i.
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + length),
+                         _mm_blendv_epi8(block, underscore, _mm_cmpeq_epi8(block, dot)));
+        length += 16;
+    }
+    return length + copy_filename_scalar(data + i, size - i, out + length);
+}
+
+__attribute__((target("avx2"))) std::size_t scan_key_avx2(const char* data, std::size_t size) {
+    const auto control_max = _mm256_set1_epi8(0x1f);
+    const auto slash = _mm256_set1_epi8('/');
+    const auto backslash = _mm256_set1_epi8('\\');
+    const auto del = _mm256_set1_epi8(0x7f);
+
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const auto control = _mm256_cmpeq_epi8(_mm256_min_epu8(block, control_max), block);
+        const auto forbidden = _mm256_or_si256(
+            _mm256_or_si256(control, _mm256_cmpeq_epi8(block, del)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, slash), _mm256_cmpeq_epi8(block, backslash)));
+        const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(forbidden));
+        if (mask != 0) {
+            return i + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+    }
+    return i + scan_key_sse42(data + i, size - i);
+}
+
+__attribute__((target("avx2"))) std::size_t copy_filename_avx2(const char* data, std::size_t size,
+                                                               char* out) {
+    const auto case_bit = _mm256_set1_epi8(0x20);
+    const auto letter_a = _mm256_set1_epi8('a');
+    const auto digit_0 = _mm256_set1_epi8('0');
+    const auto letters = _mm256_set1_epi8(25);
+    const auto digits = _mm256_set1_epi8(9);
+    const auto underscore = _mm256_set1_epi8('_');
+    const auto hyphen = _mm256_set1_epi8('-');
+    const auto dot = _mm256_set1_epi8('.');
+
+    std::size_t length = 0;
+    std::size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        const auto block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        // Unsigned x - lo <= hi - lo tests lo <= x <= hi in one comparison.
+        const auto letter_offset =
+            _mm256_sub_epi8(_mm256_or_si256(block, case_bit), letter_a);
+        const auto digit_offset = _mm256_sub_epi8(block, digit_0);
+        const auto is_dot = _mm256_cmpeq_epi8(block, dot);
+        const auto kept = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(_mm256_min_epu8(letter_offset, letters), letter_offset),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(digit_offset, digits), digit_offset)),
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, underscore),
+                                            _mm256_cmpeq_epi8(block, hyphen)),
+                            is_dot));
+        if (_mm256_movemask_epi8(kept) != -1) {
+            length += copy_filename_scalar(data + i, 32, out + length);
+            continue;
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + length),
+                            _mm256_blendv_epi8(block, underscore, is_dot));
+        length += 32;
+    }
+    return length + copy_filename_sse42(data + i, size - i, out + length);
+}
+
+#endif // SDS_NAMES_X86
+
+struct NameKernels {
+    std::size_t (*scan_key)(const char*, std::size_t);
+    std::size_t (*copy_filename)(const char*, std::size_t, char*);
+};
+
+NameKernels select_kernels() {
+#ifdef SDS_NAMES_X86
+    if (__builtin_cpu_supports("avx2")) {
+        return {scan_key_avx2, copy_filename_avx2};
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return {scan_key_sse42, copy_filename_sse42};
+    }
+#endif
+    return {scan_key_scalar, copy_filename_scalar};
+}
+
+const NameKernels& kernels() {
+    static const auto selected = select_kernels();
+    return selected;
+}
+
+} // namespace
+
+bool is_valid_key(std::string_view key) noexcept {
+    if (key.empty() || key.size() > MAX_KEY_LENGTH || key.front() == '.') {
+        return false;
+    }
+    return kernels().scan_key(key.data(), key.size()) == key.size();
+}
+
+std::size_t sanitize_filename(std::string_view filename, char* out) noexcept {
+    return trim_filename(out, kernels().copy_filename(filename.data(), filename.size(), out));
+}
+
+bool is_valid_key_scalar(std::string_view key) noexcept {
+    if (key.empty() || key.size() > MAX_KEY_LENGTH || key.front() == '.') {
+        return false;
+    }
+    return scan_key_scalar(key.data(), key.size()) == key.size();
+}
+
+std::size_t sanitize_filename_scalar(std::string_view filename, char* out) noexcept {
+    return trim_filename(out, copy_filename_scalar(filename.data(), filename.size(), out));
+}
+
+} // namespace simple_data_server
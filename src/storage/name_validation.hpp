@@ -0,0 +1,60 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_NAME_VALIDATION_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_NAME_VALIDATION_HPP
+
+#include <cstddef>
+#include <string_view>
+
+namespace simple_data_server {
+
+/**
+ * @brief Longest key accepted, the usual file name limit of a directory entry.
+ */
+constexpr std::size_t MAX_KEY_LENGTH = 255;
+
+/**
+ * @brief Check that a key can safely name a directory below the data directory.
+ *
+ * A valid key is 1 to MAX_KEY_LENGTH bytes long, does not start with a dot
+ * (those names are reserved for internal directories) and contains no path
+ * separators, NUL or other control bytes, so it can never escape the data
+ * directory. Scans 16 or 32 bytes at a time with SSE4.2 or AVX2 where available.
+ *
+ * @param key The key.
+ * @return bool true if the key is valid.
+ */
+[[nodiscard]] bool is_valid_key(std::string_view key) noexcept;
+
+/**
+ * @brief Reduce a client-supplied filename to a safe stored name, without the extension.
+ *
+ * Dots become underscores, ASCII letters, digits, underscores and hyphens are
+ * kept, every other byte is dropped, and trailing underscores and hyphens
+ * are trimmed. Blocks of 16 or 32 bytes that need no dropping are copied
+ * with SSE4.2 or AVX2 where available.
+ *
+ * @param filename The filename.
+ * @param out Receives the result; must have room for filename.size() bytes.
+ * @return std::size_t Length of the result; zero if nothing is left.
+ */
+std::size_t sanitize_filename(std::string_view filename, char* out) noexcept;
+
+/**
+ * @brief Byte-at-a-time is_valid_key(), the reference for the vector kernels.
+ *
+ * @param key The key.
+ * @return bool true if the key is valid.
+ */
+[[nodiscard]] bool is_valid_key_scalar(std::string_view key) noexcept;
+
+/**
+ * @brief Byte-at-a-time sanitize_filename(), the reference for the vector kernels.
+ *
+ * @param filename The filename.
+ * @param out Receives the result; must have room for filename.size() bytes.
+ * @return std::size_t Length of the result.
+ */
+std::size_t sanitize_filename_scalar(std::string_view filename, char* out) noexcept;
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_NAME_VALIDATION_HPP
@@ -0,0 +1,187 @@
+#include "storage/scrubber.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "json/json_validator.hpp"
+#include "storage/content_hash.hpp"
+#include "storage/document_index.hpp"
+#include "storage/file_io.hpp"
+#include "util/rate_limiter.hpp"
+#include "util/stop_sleep.hpp"
+#include "util/thread_pool.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr double IOPS_BURST_SECONDS = 1.0;
+
+struct ScrubItem {
+    std::string key;
+    std::string filename;
+    DocumentInfo info;
+};
+
+bool read_fd(int fd, std::size_t size, std::string& content) {
+    content.resize(size);
+    std::size_t offset = 0;
+    while (offset < size) {
+        const auto n = ::pread(fd, content.data() + offset, size - offset, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (n == 0) {
+            break;
+        }
+        offset += static_cast<std::size_t>(n);
+    }
+    content.resize(offset);
+    return true;
+}
+
+} // namespace
+
+Scrubber::Scrubber(std::string data_directory,
+                   DocumentIndex& index,
+                   ScrubOptions options,
+                   CorruptionHandler on_corrupt)
+    : data_directory_(std::move(data_directory)),
+      index_(index),
+      options_(options),
+      on_corrupt_(std::move(on_corrupt)) {
+}
+
+Scrubber::~Scrubber() {
+    stop();
+}
+
+void Scrubber::start() {
+    thread_ = std::jthread([this](std::stop_token stop_token) {
+        auto delay = options_.initial_delay;
+        while (sleep_for(stop_token, delay)) {
+            run_pass(stop_token);
+            delay = options_.pass_interval;
+        }
+    });
+}
+
+void Scrubber::stop() noexcept {
+    if (thread_.joinable()) {
+        thread_.request_stop();
+        thread_.join();
+    }
+}
+
+void Scrubber::run_pass(std::stop_token stop_token) {
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<ScrubItem> items;
+    for (const auto& key : index_.keys()) {
+        index_.for_each_document(key, [&](const std::string& filename, const DocumentInfo& info) {
+            items.push_back({key, filename, info});
+        });
+    }
+
+    RateLimiter iops_limiter(options_.max_iops, options_.max_iops * IOPS_BURST_SECONDS);
+    RateLimiter bandwidth_limiter(options_.max_bytes_per_second, options_.max_bytes_per_second);
+    std::uint64_t corrupt_before = corrupt_documents_.load(std::memory_order_relaxed);
+
+    {
+        ThreadPool pool(std::max(1u, options_.threads));
+        pool.parallel_for(items.size(), [&](std::size_t i) {
+            const auto& item = items[i];
+            if (!iops_limiter.acquire(1, stop_token) ||
+                !bandwidth_limiter.acquire(static_cast<double>(item.info.size), stop_token)) {
+                return;
+            }
+            check_document(item.key, item.filename);
+        });
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    last_pass_ms_.store(static_cast<std::uint64_t>(elapsed.count()), std::memory_order_relaxed);
+    if (stop_token.stop_requested()) {
+        return;
+    }
+
+    passes_.fetch_add(1, std::memory_order_relaxed);
+    std::cout << "Scrub pass checked " << items.size() << " documents in " << elapsed.count()
+              << " ms, " << corrupt_documents_.load(std::memory_order_relaxed) - corrupt_before
+              << " corrupt" << std::endl;
+}
+
+ScrubStats Scrubber::stats() const noexcept {
+    return {passes_.load(std::memory_order_relaxed),
+            documents_checked_.load(std::memory_order_relaxed),
+            bytes_checked_.load(std::memory_order_relaxed),
+            corrupt_documents_.load(std::memory_order_relaxed),
+            last_pass_ms_.load(std::memory_order_relaxed)};
+}
+
+void Scrubber::check_document(const std::string& key, const std::string& filename) {
+    const auto path = data_directory_ + "/" + key + "/" + filename;
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return; // Removed since the pass started.
+    }
+
+    struct stat st{};
+    std::string content;
+    const bool read_ok = ::fstat(fd, &st) == 0 &&
+                         read_fd(fd, static_cast<std::size_t>(st.st_size), content);
+    ::close(fd);
+    if (!read_ok) {
+        std::cerr << "Scrubber failed to read " << path << std::endl;
+        return;
+    }
+
+    documents_checked_.fetch_add(1, std::memory_order_relaxed);
+    bytes_checked_.fetch_add(content.size(), std::memory_order_relaxed);
+
+    const bool valid = validate_json(content);
+    const auto hash = content_hash(content);
+
+    // The checksum is only comparable if the index still describes the inode we read;
+    // a put that replaced the document since the pass started is not corruption.
+    const auto current = index_.find(key, filename);
+    const bool unchanged = current.has_value() && current->mtime_ns == mtime_ns(st) &&
+                           current->size == static_cast<std::uint64_t>(st.st_size);
+
+    std::string_view reason;
+    if (!valid) {
+        struct stat path_st{};
+        if (::stat(path.c_str(), &path_st) != 0 || path_st.st_ino != st.st_ino) {
+            return; // Replaced since we opened it; the new version is checked next pass.
+        }
+        reason = "invalid JSON";
+    } else if (unchanged && current->has_hash && current->hash != hash) {
+        reason = "checksum mismatch";
+    } else {
+        if (unchanged && !current->has_hash) {
+            // A put or removal may have landed since find(); only record the
+            // hash if the entry still describes what we read.
+            index_.set_hash_if_unchanged(key, filename, mtime_ns(st),
+                                         static_cast<std::uint64_t>(st.st_size), hash);
+        }
+        return;
+    }
+
+    corrupt_documents_.fetch_add(1, std::memory_order_relaxed);
+    std::cerr << "Scrubber found corrupt document " << path << ": " << reason << std::endl;
+    if (on_corrupt_) {
+        on_corrupt_(key, filename, reason, st);
+    }
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,143 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_SCRUBBER_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_SCRUBBER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <sys/stat.h>
+#include <thread>
+
+namespace simple_data_server {
+
+class DocumentIndex;
+
+/**
+ * @brief Tunable options for the background integrity scrubber.
+ */
+struct ScrubOptions {
+    bool enabled = true;
+
+    /**
+     * @brief Number of threads reading and validating documents.
+     */
+    unsigned threads = 2;
+
+    /**
+     * @brief Maximum documents read per second; zero means unlimited.
+     */
+    double max_iops = 100;
+
+    /**
+     * @brief Maximum bytes read per second; zero means unlimited.
+     */
+    double max_bytes_per_second = 4.0 * 1024 * 1024;
+
+    /**
+     * @brief Delay before the first pass and between the end of one pass and the next.
+     */
+    std::chrono::seconds initial_delay{60};
+    std::chrono::seconds pass_interval{6 * 60 * 60};
+};
+
+/**
+ * @brief Counters describing scrubber activity since startup.
+ */
+struct ScrubStats {
+    std::uint64_t passes = 0;
+    std::uint64_t documents_checked = 0;
+    std::uint64_t bytes_checked = 0;
+    std::uint64_t corrupt_documents = 0;
+    std::uint64_t last_pass_ms = 0;
+};
+
+/**
+ * @brief Background integrity checker for stored documents.
+ *
+ * Each pass walks every document in the DocumentIndex on a small thread pool,
+ * throttled by an IOPS and a bandwidth budget so that it never competes with
+ * foreground requests. A document is corrupt if it is not valid JSON, or if
+ * its content hash no longer matches the checksum recorded in the index while
+ * its mtime is unchanged. Documents without a recorded checksum get one.
+ * Corrupt documents are reported and handed to a callback, which normally
+ * moves them to quarantine.
+ */
+class Scrubber {
+public:
+    /**
+     * @brief Callback invoked for each corrupt document with (key, filename,
+     *        reason, stat of the file that was checked).
+     *
+     * The document may have been replaced since it was checked; the handler
+     * compares the stat with the file's current one before acting on it.
+     */
+    using CorruptionHandler = std::function<void(
+        std::string_view, std::string_view, std::string_view, const struct stat&)>;
+
+    /**
+     * @brief Construct a Scrubber.
+     *
+     * @param data_directory Path to the data directory.
+     * @param index The document index to walk and record checksums in.
+     * @param options Scrubber options.
+     * @param on_corrupt Called for every corrupt document found.
+     */
+    Scrubber(std::string data_directory,
+             DocumentIndex& index,
+             ScrubOptions options,
+             CorruptionHandler on_corrupt);
+
+    /**
+     * @brief Stops the background thread, abandoning any pass in progress.
+     */
+    ~Scrubber();
+
+    Scrubber(const Scrubber&) = delete;
+    Scrubber& operator=(const Scrubber&) = delete;
+
+    /**
+     * @brief Start running passes on a background thread.
+     */
+    void start();
+
+    /**
+     * @brief Stop the background thread and wait for it to exit.
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief Run one full pass on the calling thread.
+     *
+     * @param stop_token Aborts the pass early when stop is requested.
+     */
+    void run_pass(std::stop_token stop_token);
+
+    /**
+     * @brief Get a snapshot of the scrubber counters.
+     *
+     * @return ScrubStats The counters.
+     */
+    [[nodiscard]] ScrubStats stats() const noexcept;
+
+private:
+    void check_document(const std::string& key, const std::string& filename);
+
+    std::string data_directory_;
+    DocumentIndex& index_;
+    ScrubOptions options_;
+    CorruptionHandler on_corrupt_;
+
+    std::atomic<std::uint64_t> passes_{0};
+    std::atomic<std::uint64_t> documents_checked_{0};
+    std::atomic<std::uint64_t> bytes_checked_{0};
+    std::atomic<std::uint64_t> corrupt_documents_{0};
+    std::atomic<std::uint64_t> last_pass_ms_{0};
+
+    std::jthread thread_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_SCRUBBER_HPP
@@ -0,0 +1,103 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_SNAPSHOT_CODEC_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_SNAPSHOT_CODEC_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "storage/content_hash.hpp"
+
+namespace simple_data_server {
+
+/**
+ * @brief Append fixed-size values and length-prefixed strings to a snapshot buffer.
+ *
+ * finish() appends a content hash of everything written, which
+ * open_snapshot() checks.
+ */
+class SnapshotWriter {
+public:
+    template <typename T>
+    void put(T value) {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        buffer_.append(bytes, sizeof(T));
+    }
+
+    void put_bytes(std::string_view value) {
+        buffer_.append(value);
+    }
+
+    void put_string(std::string_view value) {
+        put(static_cast<std::uint32_t>(value.size()));
+        buffer_.append(value);
+    }
+
+    std::string finish() {
+        put(content_hash(buffer_));
+        return std::move(buffer_);
+    }
+
+private:
+    std::string buffer_;
+};
+
+/**
+ * @brief Bounds-checked reader over a snapshot buffer.
+ */
+class SnapshotReader {
+public:
+    explicit SnapshotReader(std::string_view data) : data_(data) {
+    }
+
+    template <typename T>
+    bool get(T& value) {
+        if (data_.size() < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, data_.data(), sizeof(T));
+        data_.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    bool get_string(std::string& value) {
+        std::uint32_t length = 0;
+        if (!get(length) || data_.size() < length) {
+            return false;
+        }
+        value.assign(data_.data(), length);
+        data_.remove_prefix(length);
+        return true;
+    }
+
+private:
+    std::string_view data_;
+};
+
+/**
+ * @brief Check a snapshot's magic and trailing checksum.
+ *
+ * @param data The snapshot as written by SnapshotWriter::finish().
+ * @param magic The expected leading bytes.
+ * @return std::optional<std::string_view> The contents between the magic and
+ *         the checksum, or std::nullopt if the snapshot is corrupt.
+ */
+[[nodiscard]] inline std::optional<std::string_view> open_snapshot(std::string_view data,
+                                                                   std::string_view magic) {
+    if (data.size() < magic.size() + sizeof(std::uint64_t)) {
+        return std::nullopt;
+    }
+    const auto body = data.substr(0, data.size() - sizeof(std::uint64_t));
+    std::uint64_t checksum = 0;
+    std::memcpy(&checksum, data.data() + body.size(), sizeof(checksum));
+    if (!body.starts_with(magic) || content_hash(body) != checksum) {
+        return std::nullopt;
+    }
+    return body.substr(magic.size());
+}
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_SNAPSHOT_CODEC_HPP
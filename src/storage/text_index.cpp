@@ -0,0 +1,460 @@
+#include "storage/text_index.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <nlohmann/json.hpp>
+
+#include "storage/file_io.hpp"
+#include "storage/snapshot_codec.hpp"
+#include "util/thread_pool.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::string_view TEXT_INDEX_DIRECTORY = ".sds-text";
+constexpr std::string_view TEXT_INDEX_MAGIC = "SDSTXT01";
+constexpr std::size_t MAX_INDEX_FILE_SIZE = 1024 * 1024 * 1024;
+constexpr std::size_t MIN_TOMBSTONES_TO_COMPACT = 1024;
+
+std::vector<Trigram> trigrams_of_bytes(std::string_view bytes) {
+    const auto document = nlohmann::json::parse(bytes, nullptr, false);
+    return document.is_discarded() ? std::vector<Trigram>{} : document_trigrams(document);
+}
+
+} // namespace
+
+void PostingList::append(std::uint32_t id) {
+    auto delta = count_ == 0 ? id : id - last_;
+    while (delta >= 0x80) {
+        bytes_.push_back(static_cast<char>(delta | 0x80));
+        delta >>= 7;
+    }
+    bytes_.push_back(static_cast<char>(delta));
+    last_ = id;
+    ++count_;
+}
+
+std::vector<std::uint32_t> PostingList::decode() const {
+    std::vector<std::uint32_t> ids;
+    ids.reserve(count_);
+    std::uint32_t id = 0;
+    std::uint32_t delta = 0;
+    int shift = 0;
+    for (const char c : bytes_) {
+        const auto byte = static_cast<unsigned char>(c);
+        delta |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        id += delta;
+        ids.push_back(id);
+        delta = 0;
+        shift = 0;
+    }
+    return ids;
+}
+
+std::optional<PostingList> PostingList::from_bytes(std::string bytes) {
+    PostingList list;
+    std::uint64_t delta = 0;
+    int shift = 0;
+    for (const char c : bytes) {
+        const auto byte = static_cast<unsigned char>(c);
+        if (shift > 28) {
+            return std::nullopt;
+        }
+        delta |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+            continue;
+        }
+        const auto id = (list.count_ == 0 ? 0 : std::uint64_t{list.last_}) + delta;
+        if ((list.count_ > 0 && delta == 0) || id > std::numeric_limits<std::uint32_t>::max()) {
+            return std::nullopt;
+        }
+        list.last_ = static_cast<std::uint32_t>(id);
+        ++list.count_;
+        delta = 0;
+        shift = 0;
+    }
+    if (shift != 0) {
+        return std::nullopt;
+    }
+    list.bytes_ = std::move(bytes);
+    return list;
+}
+
+void TextIndex::update(const std::string& filename, const std::vector<Trigram>& trigrams) {
+    remove(filename);
+    if (documents_.size() >= NO_DOCUMENT) {
+        compact();
+    }
+
+    const auto id = static_cast<std::uint32_t>(documents_.size());
+    documents_.push_back(filename);
+    ids_.emplace(filename, id);
+    for (const auto trigram : trigrams) {
+        postings_[trigram].append(id);
+    }
+}
+
+void TextIndex::remove(const std::string& filename) {
+    const auto it = ids_.find(filename);
+    if (it == ids_.end()) {
+        return;
+    }
+    documents_[it->second].clear();
+    ids_.erase(it);
+    ++tombstones_;
+
+    if (tombstones_ >= MIN_TOMBSTONES_TO_COMPACT && tombstones_ > ids_.size()) {
+        compact();
+    }
+}
+
+std::vector<std::string> TextIndex::candidates(const std::vector<Trigram>& trigrams) const {
+    std::vector<std::string> result;
+    if (trigrams.empty()) {
+        result.reserve(ids_.size());
+        for (const auto& [filename, id] : ids_) {
+            result.push_back(filename);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    std::vector<const PostingList*> lists;
+    for (const auto trigram : trigrams) {
+        const auto it = postings_.find(trigram);
+        if (it == postings_.end()) {
+            return result;
+        }
+        lists.push_back(&it->second);
+    }
+    // Start from the shortest list so the intersection only ever shrinks it.
+    std::sort(lists.begin(), lists.end(), [](const PostingList* a, const PostingList* b) {
+        return a->size() < b->size();
+    });
+
+    auto ids = lists.front()->decode();
+    for (std::size_t i = 1; i < lists.size() && !ids.empty(); ++i) {
+        const auto other = lists[i]->decode();
+        std::vector<std::uint32_t> both;
+        std::set_intersection(ids.begin(), ids.end(), other.begin(), other.end(),
+                              std::back_inserter(both));
+        ids = std::move(both);
+    }
+
+    for (const auto id : ids) {
+        if (!documents_[id].empty()) {
+            result.push_back(documents_[id]);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+void TextIndex::compact() {
+    std::vector<std::uint32_t> renumbered(documents_.size(), NO_DOCUMENT);
+    std::vector<std::string> documents;
+    documents.reserve(ids_.size());
+    for (std::size_t id = 0; id < documents_.size(); ++id) {
+        if (!documents_[id].empty()) {
+            renumbered[id] = static_cast<std::uint32_t>(documents.size());
+            ids_[documents_[id]] = renumbered[id];
+            documents.push_back(std::move(documents_[id]));
+        }
+    }
+
+    std::unordered_map<Trigram, PostingList> postings;
+    for (const auto& [trigram, list] : postings_) {
+        PostingList live;
+        for (const auto id : list.decode()) {
+            if (renumbered[id] != NO_DOCUMENT) {
+                live.append(renumbered[id]);
+            }
+        }
+        if (live.size() > 0) {
+            postings.emplace(trigram, std::move(live));
+        }
+    }
+
+    documents_ = std::move(documents);
+    postings_ = std::move(postings);
+    tombstones_ = 0;
+}
+
+TextIndexStats TextIndex::stats() const noexcept {
+    TextIndexStats stats{ids_.size(), postings_.size(), 0};
+    for (const auto& [trigram, list] : postings_) {
+        stats.posting_bytes += list.bytes().size();
+    }
+    return stats;
+}
+
+void TextIndex::write(SnapshotWriter& writer) const {
+    writer.put(static_cast<std::uint32_t>(documents_.size()));
+    for (const auto& filename : documents_) {
+        writer.put_string(filename);
+    }
+    writer.put(static_cast<std::uint32_t>(postings_.size()));
+    for (const auto& [trigram, list] : postings_) {
+        writer.put(trigram);
+        writer.put_string(list.bytes());
+    }
+}
+
+std::optional<TextIndex> TextIndex::read(SnapshotReader& reader) {
+    TextIndex index;
+    std::uint32_t document_count = 0;
+    if (!reader.get(document_count)) {
+        return std::nullopt;
+    }
+    index.documents_.resize(document_count);
+    for (std::uint32_t id = 0; id < document_count; ++id) {
+        auto& filename = index.documents_[id];
+        if (!reader.get_string(filename)) {
+            return std::nullopt;
+        }
+        if (filename.empty()) {
+            ++index.tombstones_;
+        } else if (!index.ids_.emplace(filename, id).second) {
+            return std::nullopt;
+        }
+    }
+
+    std::uint32_t posting_count = 0;
+    if (!reader.get(posting_count)) {
+        return std::nullopt;
+    }
+    for (std::uint32_t i = 0; i < posting_count; ++i) {
+        Trigram trigram = 0;
+        std::string bytes;
+        if (!reader.get(trigram) || !reader.get_string(bytes)) {
+            return std::nullopt;
+        }
+        auto list = PostingList::from_bytes(std::move(bytes));
+        if (!list) {
+            return std::nullopt;
+        }
+        const auto ids = list->decode();
+        if (!ids.empty() && ids.back() >= document_count) {
+            return std::nullopt;
+        }
+        index.postings_.insert_or_assign(trigram, std::move(list.value()));
+    }
+    return index;
+}
+
+TextIndexes::TextIndexes(std::string data_directory, DocumentSource documents)
+    : data_directory_(std::move(data_directory)), documents_(std::move(documents)) {
+}
+
+std::size_t TextIndexes::load(ThreadPool& pool) {
+    std::vector<std::string> keys;
+    std::error_code ec;
+    const auto index_dir = data_directory_ + "/" + std::string(TEXT_INDEX_DIRECTORY);
+    for (const auto& entry : std::filesystem::directory_iterator(index_dir, ec)) {
+        const auto name = entry.path().filename().string();
+        if (entry.is_regular_file() && !name.starts_with('.')) {
+            keys.push_back(name);
+        }
+    }
+
+    std::vector<std::optional<LoadedKey>> loaded(keys.size());
+    pool.parallel_for(keys.size(), [&](std::size_t i) {
+        loaded[i] = load_key(keys[i]);
+    });
+
+    std::size_t rebuilt = 0;
+    std::unique_lock lock(mutex_);
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if (loaded[i]) {
+            rebuilt += loaded[i]->rebuilt ? 1 : 0;
+            keys_.insert_or_assign(std::move(keys[i]), std::move(loaded[i]->index));
+        }
+    }
+    return rebuilt;
+}
+
+bool TextIndexes::save() noexcept {
+    try {
+        bool success = true;
+        std::unique_lock lock(mutex_);
+        for (auto& [key, index] : keys_) {
+            index.compact();
+            success = write_key_file(key, index) && success;
+        }
+        return success;
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to write text indexes: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TextIndexes::create(std::string_view key) {
+    BuildJournal::Build build;
+    {
+        std::unique_lock lock(mutex_);
+        if (keys_.contains(key)) {
+            return true;
+        }
+        build = journal_.begin(key);
+    }
+
+    TextIndex index;
+    try {
+        fill_from_documents(key, index);
+    } catch (...) {
+        std::unique_lock lock(mutex_);
+        journal_.finish(build);
+        throw;
+    }
+
+    {
+        std::unique_lock lock(mutex_);
+        for (const auto& [filename, bytes] : journal_.finish(build)) {
+            if (bytes) {
+                index.update(filename, trigrams_of_bytes(bytes.value()));
+            } else {
+                index.remove(filename);
+            }
+        }
+        if (!keys_.emplace(std::string(key), std::move(index)).second) {
+            // Another build of the key finished first; its index is just as current.
+            return true;
+        }
+    }
+
+    // Writing the file only reads the index; a drop in between removed the file already.
+    std::shared_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    return it == keys_.end() || write_key_file(key, it->second);
+}
+
+bool TextIndexes::drop(std::string_view key) {
+    std::unique_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return true;
+    }
+    keys_.erase(it);
+    std::error_code ec;
+    std::filesystem::remove(key_file_path(key), ec);
+    return !ec;
+}
+
+std::optional<TextIndexStats> TextIndexes::stats(std::string_view key) const {
+    std::shared_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return std::nullopt;
+    }
+    return it->second.stats();
+}
+
+void TextIndexes::update(std::string_view key, std::string_view filename, std::string_view bytes) {
+    {
+        std::shared_lock lock(mutex_);
+        if (!keys_.contains(key) && !journal_.recording(key)) {
+            return;
+        }
+    }
+
+    const auto trigrams = trigrams_of_bytes(bytes);
+    const std::string name(filename);
+
+    std::unique_lock lock(mutex_);
+    journal_.record(key, filename, bytes);
+    const auto it = keys_.find(key);
+    if (it != keys_.end()) {
+        it->second.update(name, trigrams);
+    }
+}
+
+void TextIndexes::remove(std::string_view key, std::string_view filename) {
+    const std::string name(filename);
+    std::unique_lock lock(mutex_);
+    journal_.record(key, filename, std::nullopt);
+    const auto it = keys_.find(key);
+    if (it != keys_.end()) {
+        it->second.remove(name);
+    }
+}
+
+std::optional<std::vector<std::string>>
+TextIndexes::candidates(std::string_view key, const TextQuery& query) const {
+    const auto trigrams = query.trigrams();
+    std::shared_lock lock(mutex_);
+    const auto it = keys_.find(key);
+    if (it == keys_.end()) {
+        return std::nullopt;
+    }
+    return it->second.candidates(trigrams);
+}
+
+std::string TextIndexes::key_file_path(std::string_view key) const {
+    return data_directory_ + "/" + std::string(TEXT_INDEX_DIRECTORY) + "/" + std::string(key);
+}
+
+std::string TextIndexes::key_directory(std::string_view key) const {
+    return data_directory_ + "/" + std::string(key);
+}
+
+void TextIndexes::fill_from_documents(std::string_view key, TextIndex& index) const {
+    for (const auto& filename : documents_.list(key)) {
+        if (const auto content = documents_.read(key, filename)) {
+            index.update(filename, trigrams_of_bytes(content.value()));
+        }
+    }
+}
+
+std::optional<TextIndexes::LoadedKey> TextIndexes::load_key(const std::string& key) const {
+    const auto mtime = directory_mtime_ns(key_directory(key));
+    if (!mtime) {
+        return std::nullopt;
+    }
+
+    const auto content = read_file(key_file_path(key), MAX_INDEX_FILE_SIZE);
+    const auto body = content ? open_snapshot(content.value(), TEXT_INDEX_MAGIC) : std::nullopt;
+    if (body) {
+        SnapshotReader reader(body.value());
+        std::int64_t saved_mtime = 0;
+        if (reader.get(saved_mtime) && saved_mtime == mtime.value()) {
+            if (auto index = TextIndex::read(reader)) {
+                return LoadedKey{std::move(index.value()), false};
+            }
+        }
+    } else {
+        std::cerr << "Rebuilding corrupt text index " << key_file_path(key) << std::endl;
+    }
+
+    // The key still wants a text index even if the file is stale or corrupt.
+    LoadedKey loaded;
+    fill_from_documents(key, loaded.index);
+    loaded.rebuilt = true;
+    return loaded;
+}
+
+bool TextIndexes::write_key_file(std::string_view key, const TextIndex& index) const {
+    SnapshotWriter writer;
+    writer.put_bytes(TEXT_INDEX_MAGIC);
+    writer.put(directory_mtime_ns(key_directory(key)).value_or(MISSING_DIRECTORY_MTIME));
+    index.write(writer);
+
+    std::error_code ec;
+    std::filesystem::create_directories(data_directory_ + "/" + std::string(TEXT_INDEX_DIRECTORY),
+                                        ec);
+    const auto written = write_file_atomically(key_file_path(key), writer.finish(), true);
+    if (!written) {
+        std::cerr << "Failed to write text index of key " << key << std::endl;
+    }
+    return written.has_value();
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,284 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_TEXT_INDEX_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_TEXT_INDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "query/text_search.hpp"
+#include "storage/index_build.hpp"
+
+namespace simple_data_server {
+
+class SnapshotReader;
+class SnapshotWriter;
+class ThreadPool;
+
+/**
+ * @brief A sorted list of document ids, delta-encoded as LEB128 varints.
+ *
+ * Ids are only ever appended in increasing order, so the gaps are small and
+ * most entries take a single byte.
+ */
+class PostingList {
+public:
+    /**
+     * @brief Append an id.
+     *
+     * @param id The id; must be greater than every id already in the list.
+     */
+    void append(std::uint32_t id);
+
+    /**
+     * @brief Decode the ids.
+     *
+     * @return std::vector<std::uint32_t> The ids, ascending.
+     */
+    [[nodiscard]] std::vector<std::uint32_t> decode() const;
+
+    /**
+     * @brief Rebuild a list from its encoded bytes, e.g. read back from disk.
+     *
+     * @param bytes The encoding.
+     * @return std::optional<PostingList> The list, or std::nullopt if the bytes are malformed.
+     */
+    [[nodiscard]] static std::optional<PostingList> from_bytes(std::string bytes);
+
+    /**
+     * @brief Get the encoding.
+     *
+     * @return const std::string& The bytes.
+     */
+    [[nodiscard]] const std::string& bytes() const noexcept {
+        return bytes_;
+    }
+
+    /**
+     * @brief Get the number of ids.
+     *
+     * @return std::size_t The count.
+     */
+    [[nodiscard]] std::size_t size() const noexcept {
+        return count_;
+    }
+
+private:
+    std::string bytes_;
+    std::uint32_t last_ = 0;
+    std::size_t count_ = 0;
+};
+
+/**
+ * @brief Size of one key's text index, as reported by /api/index.
+ */
+struct TextIndexStats {
+    std::size_t documents = 0;
+    std::size_t trigrams = 0;
+    std::size_t posting_bytes = 0;
+};
+
+/**
+ * @brief Inverted index from trigrams to the documents of one key containing them.
+ *
+ * Documents get increasing ids. Replacing a document gives it a new id and
+ * leaves the old one as a tombstone in the posting lists, so lists only ever
+ * grow at the end; once tombstones outnumber live documents the lists are
+ * rewritten without them.
+ */
+class TextIndex {
+public:
+    /**
+     * @brief Record a document's trigrams, replacing any previous ones.
+     *
+     * @param filename The stored filename.
+     * @param trigrams The document's distinct trigrams, sorted.
+     */
+    void update(const std::string& filename, const std::vector<Trigram>& trigrams);
+
+    /**
+     * @brief Forget a document.
+     *
+     * @param filename The stored filename.
+     */
+    void remove(const std::string& filename);
+
+    /**
+     * @brief Find the documents containing every given trigram.
+     *
+     * @param trigrams The trigrams; empty selects every document.
+     * @return std::vector<std::string> The filenames, sorted.
+     */
+    [[nodiscard]] std::vector<std::string> candidates(const std::vector<Trigram>& trigrams) const;
+
+    /**
+     * @brief Drop tombstones and renumber the documents densely.
+     */
+    void compact();
+
+    /**
+     * @brief Get the index's size.
+     *
+     * @return TextIndexStats The counts.
+     */
+    [[nodiscard]] TextIndexStats stats() const noexcept;
+
+    /**
+     * @brief Serialize the documents and posting lists.
+     *
+     * @param writer The destination.
+     */
+    void write(SnapshotWriter& writer) const;
+
+    /**
+     * @brief Deserialize an index written by write().
+     *
+     * @param reader The source.
+     * @return std::optional<TextIndex> The index, or std::nullopt if the data is malformed.
+     */
+    [[nodiscard]] static std::optional<TextIndex> read(SnapshotReader& reader);
+
+private:
+    static constexpr std::uint32_t NO_DOCUMENT = UINT32_MAX;
+
+    /**
+     * @brief Filename of each id; empty for tombstones.
+     */
+    std::vector<std::string> documents_;
+    std::unordered_map<std::string, std::uint32_t> ids_;
+    std::unordered_map<Trigram, PostingList> postings_;
+    std::size_t tombstones_ = 0;
+};
+
+/**
+ * @brief The full-text indexes of the keys that enabled one.
+ *
+ * Each index is persisted to data/.sds-text/{key} together with the key
+ * directory's mtime. Like the secondary indexes, files are rewritten when an
+ * index is created and on clean shutdown, and an index whose key directory
+ * changed since is rebuilt from the documents at startup.
+ */
+class TextIndexes {
+public:
+    /**
+     * @brief Construct an empty set of indexes for the given data directory.
+     *
+     * @param data_directory Path to the data directory.
+     * @param documents Where to read documents from when an index is filled.
+     */
+    TextIndexes(std::string data_directory, DocumentSource documents);
+
+    /**
+     * @brief Load the persisted indexes, rebuilding stale ones.
+     *
+     * @param pool Thread pool used to load keys in parallel.
+     * @return std::size_t Number of keys whose index had to be rebuilt.
+     */
+    std::size_t load(ThreadPool& pool);
+
+    /**
+     * @brief Compact and persist the index of every key.
+     *
+     * Must only be called when no writes are in flight, e.g. on clean shutdown.
+     *
+     * @return bool true on success.
+     */
+    bool save() noexcept;
+
+    /**
+     * @brief Enable the text index of a key and fill it from the key's documents.
+     *
+     * Built like FieldIndexes::create(): the documents are read without the
+     * lock and writes made meanwhile are replayed before the index is swapped
+     * in. Creating an index that exists already does nothing.
+     *
+     * @param key The user's shared key.
+     * @return bool false if the index could not be persisted.
+     */
+    bool create(std::string_view key);
+
+    /**
+     * @brief Disable the text index of a key.
+     *
+     * @param key The user's shared key.
+     * @return bool false if the index file could not be removed.
+     */
+    bool drop(std::string_view key);
+
+    /**
+     * @brief Get the size of a key's text index.
+     *
+     * @param key The user's shared key.
+     * @return std::optional<TextIndexStats> The counts, or std::nullopt if the
+     *         key has no text index.
+     */
+    [[nodiscard]] std::optional<TextIndexStats> stats(std::string_view key) const;
+
+    /**
+     * @brief Update the index of a key for a created or replaced document.
+     *
+     * The document is only parsed if the key has a text index.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename.
+     * @param bytes The stored document.
+     */
+    void update(std::string_view key, std::string_view filename, std::string_view bytes);
+
+    /**
+     * @brief Remove a document from the index of its key.
+     *
+     * @param key The user's shared key.
+     * @param filename The stored filename.
+     */
+    void remove(std::string_view key, std::string_view filename);
+
+    /**
+     * @brief Find the documents that may match a query.
+     *
+     * Every document containing all terms is returned; some returned
+     * documents may contain the trigrams but not the terms.
+     *
+     * @param key The user's shared key.
+     * @param query The query.
+     * @return std::optional<std::vector<std::string>> Candidate filenames in
+     *         sorted order, or std::nullopt if the key has no text index.
+     */
+    [[nodiscard]] std::optional<std::vector<std::string>>
+    candidates(std::string_view key, const TextQuery& query) const;
+
+private:
+    struct StringHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view value) const noexcept {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    struct LoadedKey {
+        TextIndex index;
+        bool rebuilt = false;
+    };
+
+    [[nodiscard]] std::string key_file_path(std::string_view key) const;
+    [[nodiscard]] std::string key_directory(std::string_view key) const;
+    void fill_from_documents(std::string_view key, TextIndex& index) const;
+    [[nodiscard]] std::optional<LoadedKey> load_key(const std::string& key) const;
+    bool write_key_file(std::string_view key, const TextIndex& index) const;
+
+    std::string data_directory_;
+    DocumentSource documents_;
+
+    mutable std::shared_mutex mutex_;
+    std::unordered_map<std::string, TextIndex, StringHash, std::equal_to<>> keys_;
+    BuildJournal journal_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_TEXT_INDEX_HPP
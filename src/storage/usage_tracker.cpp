@@ -0,0 +1,92 @@
+#include "storage/usage_tracker.hpp"
+
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+
+#include "storage/file_io.hpp"
+#include "util/stop_sleep.hpp"
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::string_view USAGE_FILENAME = ".usage.json";
+
+} // namespace
+
+UsageTracker::UsageTracker(std::string data_directory, KeyQuota quota)
+    : data_directory_(std::move(data_directory)), quota_(quota) {
+}
+
+UsageTracker::~UsageTracker() {
+    if (persist_thread_.joinable()) {
+        persist_thread_.request_stop();
+        persist_thread_.join();
+    }
+    persist();
+}
+
+bool UsageTracker::allows(std::string_view key, KeyUsage delta) const {
+    if (quota_.max_bytes == 0 && quota_.max_files == 0) {
+        return true;
+    }
+
+    const auto usage = get(key);
+    if (quota_.max_bytes > 0 && delta.bytes > 0 && usage.bytes + delta.bytes > quota_.max_bytes) {
+        return false;
+    }
+    if (quota_.max_files > 0 && delta.files > 0 && usage.files + delta.files > quota_.max_files) {
+        return false;
+    }
+    return true;
+}
+
+void UsageTracker::apply(std::string_view key, KeyUsage delta) {
+    std::unique_lock lock(mutex_);
+    auto it = usage_.find(key);
+    if (it == usage_.end()) {
+        it = usage_.emplace(std::string(key), KeyUsage{}).first;
+    }
+    it->second.bytes += delta.bytes;
+    it->second.files += delta.files;
+}
+
+void UsageTracker::set(std::string_view key, KeyUsage usage) {
+    std::unique_lock lock(mutex_);
+    usage_.insert_or_assign(std::string(key), usage);
+}
+
+KeyUsage UsageTracker::get(std::string_view key) const {
+    std::shared_lock lock(mutex_);
+    const auto it = usage_.find(key);
+    return it == usage_.end() ? KeyUsage{} : it->second;
+}
+
+bool UsageTracker::persist() const noexcept {
+    try {
+        nlohmann::json snapshot = nlohmann::json::object();
+        {
+            std::shared_lock lock(mutex_);
+            for (const auto& [key, usage] : usage_) {
+                snapshot[key] = {{"bytes", usage.bytes}, {"files", usage.files}};
+            }
+        }
+
+        const auto path = data_directory_ + "/" + std::string(USAGE_FILENAME);
+        return write_file_atomically(path, snapshot.dump(), false).has_value();
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to persist usage counters: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+void UsageTracker::start_persister(std::chrono::seconds interval) {
+    persist_thread_ = std::jthread([this, interval](std::stop_token stop_token) {
+        while (sleep_for(stop_token, interval)) {
+            persist();
+        }
+    });
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,136 @@
+#ifndef SIMPLE_DATA_SERVER_STORAGE_USAGE_TRACKER_HPP
+#define SIMPLE_DATA_SERVER_STORAGE_USAGE_TRACKER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+namespace simple_data_server {
+
+/**
+ * @brief Storage used by one key.
+ */
+struct KeyUsage {
+    std::int64_t bytes = 0;
+    std::int64_t files = 0;
+};
+
+/**
+ * @brief Per-key limits; zero means unlimited.
+ */
+struct KeyQuota {
+    std::int64_t max_bytes = 0;
+    std::int64_t max_files = 0;
+};
+
+/**
+ * @brief Keeps per-key usage counters up to date incrementally.
+ *
+ * Counters are seeded once at startup from the DocumentIndex and then
+ * adjusted by every write, so quota checks and stats lookups never touch the
+ * file system. The counters are written to
+ * data/.usage.json periodically and on shutdown for external tooling.
+ */
+class UsageTracker {
+public:
+    /**
+     * @brief Construct a UsageTracker for the given data directory.
+     *
+     * @param data_directory Path to the data directory.
+     * @param quota Limits applied to every key.
+     */
+    UsageTracker(std::string data_directory, KeyQuota quota);
+
+    /**
+     * @brief Stops the background persister and writes the counters one last time.
+     */
+    ~UsageTracker();
+
+    UsageTracker(const UsageTracker&) = delete;
+    UsageTracker& operator=(const UsageTracker&) = delete;
+
+    /**
+     * @brief Check whether a change would keep a key within its quota.
+     *
+     * Shrinking changes are always allowed, even for keys already over quota.
+     *
+     * @param key The user's shared key.
+     * @param delta The change in bytes and files.
+     * @return true if the change is allowed.
+     */
+    [[nodiscard]] bool allows(std::string_view key, KeyUsage delta) const;
+
+    /**
+     * @brief Apply a change to a key's counters.
+     *
+     * @param key The user's shared key.
+     * @param delta The change in bytes and files.
+     */
+    void apply(std::string_view key, KeyUsage delta);
+
+    /**
+     * @brief Replace a key's counters.
+     *
+     * @param key The user's shared key.
+     * @param usage The new usage.
+     */
+    void set(std::string_view key, KeyUsage usage);
+
+    /**
+     * @brief Get a key's current usage.
+     *
+     * @param key The user's shared key.
+     * @return KeyUsage The usage; zero for unknown keys.
+     */
+    [[nodiscard]] KeyUsage get(std::string_view key) const;
+
+    /**
+     * @brief Get the quota applied to every key.
+     *
+     * @return const KeyQuota& The quota.
+     */
+    [[nodiscard]] const KeyQuota& get_quota() const noexcept {
+        return quota_;
+    }
+
+    /**
+     * @brief Write all counters to data/.usage.json.
+     *
+     * @return true on success.
+     */
+    bool persist() const noexcept;
+
+    /**
+     * @brief Call persist() periodically on a background thread.
+     *
+     * @param interval Time between writes.
+     */
+    void start_persister(std::chrono::seconds interval);
+
+private:
+    struct StringHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view value) const noexcept {
+            return std::hash<std::string_view>{}(value);
+        }
+    };
+
+    using UsageMap = std::unordered_map<std::string, KeyUsage, StringHash, std::equal_to<>>;
+
+    std::string data_directory_;
+    KeyQuota quota_;
+
+    mutable std::shared_mutex mutex_;
+    UsageMap usage_;
+
+    std::jthread persist_thread_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_STORAGE_USAGE_TRACKER_HPP
@@ -0,0 +1,315 @@
+#include "util/capture_file.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::array<char, 8> MAGIC{'S', 'D', 'S', 'C', 'A', 'P', '1', '\n'};
+
+/**
+ * @brief Records start this far into the file, so they are page aligned.
+ */
+constexpr std::size_t HEADER_SIZE = 4096;
+
+constexpr std::size_t RECORD_ALIGNMENT = 8;
+constexpr std::size_t MAX_ROUTE_LENGTH = 255;
+constexpr std::uint8_t HAS_BODY = 1;
+
+/**
+ * @brief Ring state at the start of the file.
+ *
+ * Live records are the used bytes from tail on, wrapping at the capacity.
+ * A record size of zero marks the unused space before the wrap.
+ */
+struct FileHeader {
+    std::array<char, 8> magic;
+    std::uint64_t capacity;
+    std::uint64_t head;
+    std::uint64_t tail;
+    std::uint64_t used;
+    std::uint64_t records;
+    std::uint64_t overwritten;
+    std::int64_t started_unix_ns;
+};
+
+/**
+ * @brief Start of every record; the route and then the body follow.
+ */
+struct RecordHeader {
+    /** Whole record, padded to RECORD_ALIGNMENT. */
+    std::uint32_t size;
+    std::uint16_t status;
+    std::uint8_t route_length;
+    std::uint8_t flags;
+    std::uint64_t arrival_ns;
+    std::uint64_t key_hash;
+    std::uint64_t filename_hash;
+    std::uint32_t bytes_in;
+    std::uint32_t bytes_out;
+    std::uint32_t latency_us;
+    std::uint32_t body_length;
+};
+
+static_assert(sizeof(FileHeader) <= HEADER_SIZE);
+static_assert(sizeof(RecordHeader) % RECORD_ALIGNMENT == 0);
+
+std::size_t record_size(std::size_t route_length, std::size_t body_length) {
+    const auto size = sizeof(RecordHeader) + route_length + body_length;
+    return (size + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+}
+
+std::uint32_t saturate(std::uint64_t value) {
+    return static_cast<std::uint32_t>(std::min<std::uint64_t>(value, UINT32_MAX));
+}
+
+FileHeader* header_of(void* mapping) {
+    return static_cast<FileHeader*>(mapping);
+}
+
+} // namespace
+
+CaptureWriter::CaptureWriter(const std::string& path, std::size_t capacity, bool bodies)
+    : capacity_(capacity / RECORD_ALIGNMENT * RECORD_ALIGNMENT),
+      bodies_(bodies),
+      start_(std::chrono::steady_clock::now()) {
+    if (capacity_ < MIN_CAPACITY) {
+        throw std::invalid_argument("Capture file capacity must be at least " +
+                                    std::to_string(MIN_CAPACITY) + " bytes");
+    }
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot create capture " + path);
+    }
+    mapping_size_ = HEADER_SIZE + capacity_;
+    // Allocating every block now keeps a full disk from turning a later
+    // store into the mapping into SIGBUS.
+    const int error = ::posix_fallocate(fd, 0, static_cast<off_t>(mapping_size_));
+    if (error != 0) {
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "Cannot allocate capture " + path);
+    }
+    mapping_ = ::mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int map_errno = errno;
+    ::close(fd);
+    if (mapping_ == MAP_FAILED) {
+        mapping_ = nullptr;
+        throw std::system_error(map_errno, std::generic_category(), "Cannot map capture " + path);
+    }
+
+    auto* header = header_of(mapping_);
+    *header = FileHeader{};
+    header->magic = MAGIC;
+    header->capacity = capacity_;
+    header->started_unix_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::system_clock::now().time_since_epoch())
+                                  .count();
+}
+
+CaptureWriter::~CaptureWriter() {
+    if (mapping_ != nullptr) {
+        ::msync(mapping_, mapping_size_, MS_ASYNC);
+        ::munmap(mapping_, mapping_size_);
+    }
+}
+
+void CaptureWriter::append(const CaptureRecord& record) noexcept {
+    const auto route = record.route.substr(0, MAX_ROUTE_LENGTH);
+    std::string_view body;
+    if (bodies_ && record.body) {
+        body = *record.body;
+    }
+    auto size = record_size(route.size(), body.size());
+    const bool has_body = bodies_ && record.body && size <= capacity_ / 4;
+    if (!has_body) {
+        body = {};
+        size = record_size(route.size(), 0);
+    }
+
+    RecordHeader entry{};
+    entry.size = static_cast<std::uint32_t>(size);
+    entry.status = record.status;
+    entry.route_length = static_cast<std::uint8_t>(route.size());
+    entry.flags = has_body ? HAS_BODY : 0;
+    entry.arrival_ns =
+        static_cast<std::uint64_t>(std::max<std::int64_t>(record.arrival.count(), 0));
+    entry.key_hash = record.key_hash;
+    entry.filename_hash = record.filename_hash;
+    entry.bytes_in = record.bytes_in;
+    entry.bytes_out = record.bytes_out;
+    entry.latency_us =
+        saturate(static_cast<std::uint64_t>(std::max<std::int64_t>(record.latency.count(), 0)));
+    entry.body_length = static_cast<std::uint32_t>(body.size());
+
+    const std::lock_guard lock(mutex_);
+    auto* header = header_of(mapping_);
+    auto* data = static_cast<char*>(mapping_) + HEADER_SIZE;
+
+    if (capacity_ - header->head < size) {
+        // Too little room before the end: mark the rest unused and wrap.
+        const auto gap = capacity_ - header->head;
+        while (capacity_ - header->used < gap) {
+            evict_oldest();
+        }
+        const std::uint32_t wrap = 0;
+        std::memcpy(data + header->head, &wrap, sizeof(wrap));
+        header->used += gap;
+        header->head = 0;
+    }
+    while (capacity_ - header->used < size) {
+        evict_oldest();
+    }
+
+    auto* out = data + header->head;
+    std::memcpy(out, &entry, sizeof(entry));
+    std::memcpy(out + sizeof(entry), route.data(), route.size());
+    if (!body.empty()) {
+        std::memcpy(out + sizeof(entry) + route.size(), body.data(), body.size());
+    }
+    header->head += size;
+    if (header->head == capacity_) {
+        header->head = 0;
+    }
+    header->used += size;
+    ++header->records;
+}
+
+void CaptureWriter::evict_oldest() noexcept {
+    auto* header = header_of(mapping_);
+    const auto* data = static_cast<const char*>(mapping_) + HEADER_SIZE;
+    std::uint32_t size = 0;
+    std::memcpy(&size, data + header->tail, sizeof(size));
+    if (size == 0) {
+        header->used -= capacity_ - header->tail;
+        header->tail = 0;
+        return;
+    }
+    header->tail += size;
+    if (header->tail == capacity_) {
+        header->tail = 0;
+    }
+    header->used -= size;
+    --header->records;
+    ++header->overwritten;
+}
+
+CaptureReader::CaptureReader(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "Cannot open capture " + path);
+    }
+    struct stat status{};
+    if (::fstat(fd, &status) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), "Cannot stat capture " + path);
+    }
+    mapping_size_ = static_cast<std::size_t>(status.st_size);
+    if (mapping_size_ < HEADER_SIZE) {
+        ::close(fd);
+        throw std::runtime_error(path + " is not a capture file");
+    }
+    void* mapping = ::mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int map_errno = errno;
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        throw std::system_error(map_errno, std::generic_category(), "Cannot map capture " + path);
+    }
+    mapping_ = mapping;
+
+    FileHeader header;
+    std::memcpy(&header, mapping_, sizeof(header));
+    if (header.magic != MAGIC || header.capacity != mapping_size_ - HEADER_SIZE ||
+        header.head >= header.capacity || header.tail >= header.capacity ||
+        header.used > header.capacity) {
+        ::munmap(const_cast<void*>(mapping_), mapping_size_);
+        mapping_ = nullptr;
+        throw std::runtime_error(path + " is not a capture file");
+    }
+}
+
+CaptureReader::~CaptureReader() {
+    if (mapping_ != nullptr) {
+        ::munmap(const_cast<void*>(mapping_), mapping_size_);
+    }
+}
+
+std::vector<CaptureRecord> CaptureReader::records() const {
+    FileHeader header;
+    std::memcpy(&header, mapping_, sizeof(header));
+    const auto* data = static_cast<const char*>(mapping_) + HEADER_SIZE;
+
+    std::vector<CaptureRecord> records;
+    records.reserve(header.records);
+    auto position = header.tail;
+    auto remaining = header.used;
+    while (remaining > 0 && header.capacity - position >= sizeof(std::uint32_t)) {
+        std::uint32_t size = 0;
+        std::memcpy(&size, data + position, sizeof(size));
+        if (size == 0) {
+            const auto gap = header.capacity - position;
+            if (gap > remaining) {
+                break;
+            }
+            remaining -= gap;
+            position = 0;
+            continue;
+        }
+        if (size < sizeof(RecordHeader) || size % RECORD_ALIGNMENT != 0 || size > remaining ||
+            size > header.capacity - position) {
+            break;
+        }
+        RecordHeader entry;
+        std::memcpy(&entry, data + position, sizeof(entry));
+        if (sizeof(entry) + entry.route_length + entry.body_length > size) {
+            break;
+        }
+
+        const auto* route = data + position + sizeof(entry);
+        CaptureRecord& record = records.emplace_back();
+        record.arrival = std::chrono::nanoseconds(static_cast<std::int64_t>(entry.arrival_ns));
+        record.route = std::string_view(route, entry.route_length);
+        record.status = entry.status;
+        record.key_hash = entry.key_hash;
+        record.filename_hash = entry.filename_hash;
+        record.bytes_in = entry.bytes_in;
+        record.bytes_out = entry.bytes_out;
+        record.latency = std::chrono::microseconds(entry.latency_us);
+        if ((entry.flags & HAS_BODY) != 0) {
+            record.body = std::string_view(route + entry.route_length, entry.body_length);
+        }
+
+        position += size;
+        if (position == header.capacity) {
+            position = 0;
+        }
+        remaining -= size;
+    }
+    return records;
+}
+
+std::uint64_t CaptureReader::overwritten() const noexcept {
+    FileHeader header;
+    std::memcpy(&header, mapping_, sizeof(header));
+    return header.overwritten;
+}
+
+std::chrono::system_clock::time_point CaptureReader::started() const noexcept {
+    FileHeader header;
+    std::memcpy(&header, mapping_, sizeof(header));
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+            std::chrono::nanoseconds(header.started_unix_ns)));
+}
+
+} // namespace simple_data_server
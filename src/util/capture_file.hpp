@@ -0,0 +1,150 @@
+#ifndef SIMPLE_DATA_SERVER_UTIL_CAPTURE_FILE_HPP
+#define SIMPLE_DATA_SERVER_UTIL_CAPTURE_FILE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace simple_data_server {
+
+/**
+ * @brief One request as kept in a capture file.
+ *
+ * Keys and filenames are kept as XXH64 hashes only, so a capture shows the
+ * shape of the traffic without the names; bodies are kept only if asked for.
+ */
+struct CaptureRecord {
+    /** When the request arrived, relative to the start of the capture. */
+    std::chrono::nanoseconds arrival{0};
+    /** Route pattern, e.g. "/api/get"; at most 255 bytes are kept. */
+    std::string_view route;
+    std::uint16_t status = 0;
+    /** content_hash() of the key; zero if the request named none. */
+    std::uint64_t key_hash = 0;
+    /** content_hash() of the filename; zero if the request named none. */
+    std::uint64_t filename_hash = 0;
+    std::uint32_t bytes_in = 0;
+    std::uint32_t bytes_out = 0;
+    /** Time from arrival to the last byte of the response. */
+    std::chrono::microseconds latency{0};
+    /** The request body, if bodies are captured. */
+    std::optional<std::string_view> body;
+};
+
+/**
+ * @brief Appends requests to a fixed-size ring file, overwriting the oldest once it is full.
+ *
+ * The file is allocated up front and mapped, so an append is a copy into
+ * memory under an uncontended lock; the kernel writes the pages back. The
+ * ring state in the file header is updated after every append, so the file
+ * can be read with CaptureReader after the server stops or crashes. The
+ * format uses native byte order.
+ */
+class CaptureWriter {
+public:
+    /**
+     * @brief Smallest accepted capacity.
+     */
+    static constexpr std::size_t MIN_CAPACITY = 64 * 1024;
+
+    /**
+     * @brief Create or replace a capture file.
+     *
+     * @param path The file.
+     * @param capacity Bytes kept for records, at least MIN_CAPACITY.
+     * @param bodies Also keep request bodies; those over a quarter of the
+     *        capacity are left out.
+     * @throws std::system_error if the file cannot be created, allocated or mapped.
+     * @throws std::invalid_argument if capacity is below MIN_CAPACITY.
+     */
+    CaptureWriter(const std::string& path, std::size_t capacity, bool bodies);
+
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    /**
+     * @brief Append a request.
+     *
+     * @param record The request; its body is ignored unless bodies are captured.
+     */
+    void append(const CaptureRecord& record) noexcept;
+
+    /**
+     * @brief Get when the capture started, the origin of CaptureRecord::arrival.
+     *
+     * @return std::chrono::steady_clock::time_point The start.
+     */
+    [[nodiscard]] std::chrono::steady_clock::time_point start() const noexcept {
+        return start_;
+    }
+
+private:
+    void evict_oldest() noexcept;
+
+    std::size_t capacity_;
+    bool bodies_;
+    std::chrono::steady_clock::time_point start_;
+    void* mapping_ = nullptr;
+    std::size_t mapping_size_ = 0;
+    std::mutex mutex_;
+};
+
+/**
+ * @brief Reads a capture file written by CaptureWriter.
+ */
+class CaptureReader {
+public:
+    /**
+     * @brief Open and map a capture file.
+     *
+     * @param path The file.
+     * @throws std::system_error if the file cannot be opened or mapped.
+     * @throws std::runtime_error if it is not a capture file.
+     */
+    explicit CaptureReader(const std::string& path);
+
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    /**
+     * @brief Get the records still in the ring, in the order they were appended.
+     *
+     * Stops at the first malformed record, which only a file read while
+     * being written, or damaged, contains.
+     *
+     * @return std::vector<CaptureRecord> The records; views into the mapping,
+     *         valid while the reader lives.
+     */
+    [[nodiscard]] std::vector<CaptureRecord> records() const;
+
+    /**
+     * @brief Get how many records were overwritten after the ring filled up.
+     *
+     * @return std::uint64_t The count.
+     */
+    [[nodiscard]] std::uint64_t overwritten() const noexcept;
+
+    /**
+     * @brief Get the wall clock time the capture started.
+     *
+     * @return std::chrono::system_clock::time_point The start.
+     */
+    [[nodiscard]] std::chrono::system_clock::time_point started() const noexcept;
+
+private:
+    const void* mapping_ = nullptr;
+    std::size_t mapping_size_ = 0;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_UTIL_CAPTURE_FILE_HPP
@@ -0,0 +1,46 @@
+#include "util/rate_limiter.hpp"
+
+#include <algorithm>
+
+#include "util/stop_sleep.hpp"
+
+namespace simple_data_server {
+
+RateLimiter::RateLimiter(double rate_per_second, double burst)
+    : rate_per_second_(rate_per_second),
+      burst_(std::max(burst, 1.0)),
+      tokens_(burst_),
+      last_refill_(Clock::now()) {
+}
+
+bool RateLimiter::acquire(double amount, std::stop_token stop_token) {
+    if (rate_per_second_ <= 0) {
+        return !stop_token.stop_requested();
+    }
+
+    std::unique_lock lock(mutex_);
+    for (;;) {
+        if (stop_token.stop_requested()) {
+            return false;
+        }
+
+        refill(Clock::now());
+        if (tokens_ >= 0) {
+            tokens_ -= amount;
+            return true;
+        }
+
+        const auto wait = std::chrono::duration<double>(-tokens_ / rate_per_second_);
+        lock.unlock();
+        sleep_for(stop_token, std::chrono::duration_cast<std::chrono::nanoseconds>(wait));
+        lock.lock();
+    }
+}
+
+void RateLimiter::refill(Clock::time_point now) {
+    const std::chrono::duration<double> elapsed = now - last_refill_;
+    last_refill_ = now;
+    tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_per_second_);
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,53 @@
+#ifndef SIMPLE_DATA_SERVER_UTIL_RATE_LIMITER_HPP
+#define SIMPLE_DATA_SERVER_UTIL_RATE_LIMITER_HPP
+
+#include <chrono>
+#include <mutex>
+#include <stop_token>
+
+namespace simple_data_server {
+
+/**
+ * @brief Thread-safe token bucket.
+ *
+ * Tokens refill continuously at a fixed rate up to a burst limit. A request
+ * larger than the current balance is granted as soon as the balance is
+ * non-negative and drives it into debt, so single items larger than the
+ * burst (e.g. a big file against a bandwidth budget) still make progress
+ * while the long-run rate is honoured.
+ */
+class RateLimiter {
+public:
+    /**
+     * @brief Construct a RateLimiter.
+     *
+     * @param rate_per_second Tokens added per second; zero or less disables limiting.
+     * @param burst Maximum number of tokens that can accumulate.
+     */
+    RateLimiter(double rate_per_second, double burst);
+
+    /**
+     * @brief Take tokens, waiting until they are available.
+     *
+     * @param amount Number of tokens to take.
+     * @param stop_token Aborts the wait when stop is requested.
+     * @return true if the tokens were taken, false if stop was requested.
+     */
+    bool acquire(double amount, std::stop_token stop_token);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void refill(Clock::time_point now);
+
+    double rate_per_second_;
+    double burst_;
+    double tokens_;
+    Clock::time_point last_refill_;
+
+    std::mutex mutex_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_UTIL_RATE_LIMITER_HPP
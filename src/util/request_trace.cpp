@@ -0,0 +1,180 @@
+#include "util/request_trace.hpp"
+
+#include "storage/content_hash.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define SDS_TRACE_X86 1
+#endif
+
+namespace simple_data_server {
+
+namespace {
+
+constexpr std::array<std::string_view, TRACE_STAGE_COUNT> STAGE_NAMES{
+    "receive", "queue", "parse", "lookup", "storage", "serialize", "send"};
+
+constexpr std::chrono::milliseconds CALIBRATION_PERIOD{10};
+
+/**
+ * @brief CPUID leaf 0x80000007 EDX bit 8: the TSC ticks at a constant rate
+ *        in all power states and is synchronized across cores.
+ */
+constexpr unsigned INVARIANT_TSC_BIT = 1U << 8;
+
+thread_local RequestTrace* current_trace = nullptr;
+
+bool invariant_tsc() noexcept {
+#ifdef SDS_TRACE_X86
+    unsigned eax = 0;
+    unsigned ebx = 0;
+    unsigned ecx = 0;
+    unsigned edx = 0;
+    return __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) != 0 && (edx & INVARIANT_TSC_BIT) != 0;
+#else
+    return false;
+#endif
+}
+
+bool use_tsc() noexcept {
+    static const bool usable = invariant_tsc();
+    return usable;
+}
+
+std::uint64_t steady_ticks() noexcept {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          std::chrono::steady_clock::now().time_since_epoch())
+                                          .count());
+}
+
+/**
+ * @brief Nanoseconds per tick, measured the first time it is needed.
+ */
+double nanoseconds_per_tick() noexcept {
+    static const double rate = [] {
+        if (!use_tsc()) {
+            return 1.0;
+        }
+        const auto start_time = std::chrono::steady_clock::now();
+        const auto start_ticks = TraceClock::now();
+        std::this_thread::sleep_for(CALIBRATION_PERIOD);
+        const auto elapsed = std::chrono::steady_clock::now() - start_time;
+        const auto ticks = TraceClock::now() - start_ticks;
+        if (ticks == 0) {
+            return 1.0;
+        }
+        return static_cast<double>(
+                   std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) /
+               static_cast<double>(ticks);
+    }();
+    return rate;
+}
+
+} // namespace
+
+std::string_view trace_stage_name(TraceStage stage) noexcept {
+    return STAGE_NAMES[static_cast<std::size_t>(stage)];
+}
+
+void TraceClock::calibrate() noexcept {
+    static_cast<void>(nanoseconds_per_tick());
+}
+
+std::uint64_t TraceClock::now() noexcept {
+#ifdef SDS_TRACE_X86
+    if (use_tsc()) {
+        return __rdtsc();
+    }
+#endif
+    return steady_ticks();
+}
+
+std::chrono::nanoseconds TraceClock::to_duration(std::uint64_t ticks) noexcept {
+    return std::chrono::nanoseconds(
+        static_cast<std::int64_t>(static_cast<double>(ticks) * nanoseconds_per_tick()));
+}
+
+RequestTrace::RequestTrace() noexcept : start_(TraceClock::now()) {
+}
+
+void RequestTrace::mark(TraceStage stage) noexcept {
+    ends_[static_cast<std::size_t>(stage)] = TraceClock::now();
+}
+
+bool RequestTrace::marked(TraceStage stage) const noexcept {
+    return ends_[static_cast<std::size_t>(stage)] != 0;
+}
+
+std::chrono::nanoseconds RequestTrace::duration(TraceStage stage) const noexcept {
+    const auto index = static_cast<std::size_t>(stage);
+    if (ends_[index] == 0) {
+        return std::chrono::nanoseconds{0};
+    }
+    auto begin = start_;
+    for (std::size_t i = index; i-- > 0;) {
+        if (ends_[i] != 0) {
+            begin = ends_[i];
+            break;
+        }
+    }
+    // A stage marked out of order, or a counter read on another core that is
+    // slightly behind, must not produce a huge unsigned difference.
+    return ends_[index] > begin ? TraceClock::to_duration(ends_[index] - begin)
+                                : std::chrono::nanoseconds{0};
+}
+
+std::chrono::nanoseconds RequestTrace::total() const noexcept {
+    std::uint64_t end = start_;
+    for (const auto stage_end : ends_) {
+        end = std::max(end, stage_end);
+    }
+    return TraceClock::to_duration(end - start_);
+}
+
+void RequestTrace::want_target() noexcept {
+    wants_target_ = true;
+}
+
+bool RequestTrace::wants_target() const noexcept {
+    return wants_target_;
+}
+
+void RequestTrace::set_target(std::uint64_t key_hash, std::uint64_t filename_hash) noexcept {
+    key_hash_ = key_hash;
+    filename_hash_ = filename_hash;
+}
+
+std::uint64_t RequestTrace::key_hash() const noexcept {
+    return key_hash_;
+}
+
+std::uint64_t RequestTrace::filename_hash() const noexcept {
+    return filename_hash_;
+}
+
+RequestTrace::Scope::Scope(RequestTrace& trace) noexcept : previous_(current_trace) {
+    current_trace = &trace;
+}
+
+RequestTrace::Scope::~Scope() {
+    current_trace = previous_;
+}
+
+void trace_stage(TraceStage stage) noexcept {
+    if (current_trace != nullptr) {
+        current_trace->mark(stage);
+    }
+}
+
+void trace_target(std::string_view key, std::string_view filename) noexcept {
+    if (current_trace != nullptr && current_trace->wants_target()) {
+        current_trace->set_target(content_hash(key),
+                                  filename.empty() ? 0 : content_hash(filename));
+    }
+}
+
+} // namespace simple_data_server
@@ -0,0 +1,216 @@
+#ifndef SIMPLE_DATA_SERVER_UTIL_REQUEST_TRACE_HPP
+#define SIMPLE_DATA_SERVER_UTIL_REQUEST_TRACE_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace simple_data_server {
+
+/**
+ * @brief Consecutive stages of a request, in the order they end.
+ */
+enum class TraceStage : std::size_t {
+    /** Receiving the request body. */
+    Receive,
+    /** Waiting for a worker thread, for handlers that run off the event loop. */
+    Queue,
+    /** Parsing and validating the request body. */
+    Parse,
+    /** Resolving the key directory. */
+    Lookup,
+    /** Everything the handler does after that, mostly file I/O. */
+    Storage,
+    /** Building the response body, and getting back to the event loop if it was left. */
+    Serialize,
+    /** Writing the response to the socket. */
+    Send
+};
+
+/**
+ * @brief Number of TraceStage values.
+ */
+inline constexpr std::size_t TRACE_STAGE_COUNT = 7;
+
+/**
+ * @brief Get a stage's name, e.g. "parse".
+ *
+ * @param stage The stage.
+ * @return std::string_view The name.
+ */
+[[nodiscard]] std::string_view trace_stage_name(TraceStage stage) noexcept;
+
+/**
+ * @brief A cheap timestamp source for request tracing.
+ *
+ * Reads the time stamp counter where it is invariant, i.e. ticks at a
+ * constant rate on every core, and falls back to std::chrono::steady_clock
+ * elsewhere. Ticks are converted to time with a rate measured once against
+ * steady_clock.
+ */
+class TraceClock {
+public:
+    /**
+     * @brief Measure the tick rate now rather than on the first conversion.
+     *
+     * Takes about ten milliseconds the first time; later calls return at once.
+     */
+    static void calibrate() noexcept;
+
+    /**
+     * @brief Read the clock.
+     *
+     * @return std::uint64_t The current tick count.
+     */
+    [[nodiscard]] static std::uint64_t now() noexcept;
+
+    /**
+     * @brief Convert a tick count to a duration.
+     *
+     * @param ticks Ticks between two now() readings.
+     * @return std::chrono::nanoseconds The duration.
+     */
+    [[nodiscard]] static std::chrono::nanoseconds to_duration(std::uint64_t ticks) noexcept;
+};
+
+/**
+ * @brief When each stage of one request ended.
+ *
+ * A stage lasts from the end of the latest earlier stage that was marked, or
+ * from the start of the request, to its own mark; stages never marked take
+ * no time. Recording a mark is a single clock read.
+ */
+class RequestTrace {
+public:
+    /**
+     * @brief Start tracing a request now.
+     */
+    RequestTrace() noexcept;
+
+    /**
+     * @brief Mark the end of a stage; marking it again moves the end.
+     *
+     * @param stage The stage that just ended.
+     */
+    void mark(TraceStage stage) noexcept;
+
+    /**
+     * @brief Check whether a stage was marked.
+     *
+     * @param stage The stage.
+     * @return bool true if mark() was called for it.
+     */
+    [[nodiscard]] bool marked(TraceStage stage) const noexcept;
+
+    /**
+     * @brief Get how long a stage took.
+     *
+     * @param stage The stage.
+     * @return std::chrono::nanoseconds Its duration; zero if it was not marked.
+     */
+    [[nodiscard]] std::chrono::nanoseconds duration(TraceStage stage) const noexcept;
+
+    /**
+     * @brief Get the time from the start of the request to the last mark.
+     *
+     * @return std::chrono::nanoseconds The duration.
+     */
+    [[nodiscard]] std::chrono::nanoseconds total() const noexcept;
+
+    /**
+     * @brief Have trace_target() record the key and filename the request names.
+     *
+     * Off by default, so requests only pay for hashing the names while
+     * they are being captured.
+     */
+    void want_target() noexcept;
+
+    /**
+     * @brief Check whether want_target() was called.
+     *
+     * @return bool true if the names should be recorded.
+     */
+    [[nodiscard]] bool wants_target() const noexcept;
+
+    /**
+     * @brief Record the hashes of the names the request targets.
+     *
+     * @param key_hash content_hash() of the key; zero for none.
+     * @param filename_hash content_hash() of the filename; zero for none.
+     */
+    void set_target(std::uint64_t key_hash, std::uint64_t filename_hash) noexcept;
+
+    /**
+     * @brief Get the hash of the key the request named.
+     *
+     * @return std::uint64_t The hash; zero if none was recorded.
+     */
+    [[nodiscard]] std::uint64_t key_hash() const noexcept;
+
+    /**
+     * @brief Get the hash of the filename the request named.
+     *
+     * @return std::uint64_t The hash; zero if none was recorded.
+     */
+    [[nodiscard]] std::uint64_t filename_hash() const noexcept;
+
+    /**
+     * @brief Makes a trace the one trace_stage() marks on the calling thread.
+     *
+     * Lets code below the handler, e.g. the storage layer, mark stages
+     * without the trace being passed down.
+     */
+    class Scope {
+    public:
+        /**
+         * @brief Make a trace current until the scope ends.
+         *
+         * @param trace The trace; must outlive the scope.
+         */
+        explicit Scope(RequestTrace& trace) noexcept;
+
+        /**
+         * @brief Restore the trace that was current before.
+         */
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        RequestTrace* previous_;
+    };
+
+private:
+    std::uint64_t start_;
+
+    /**
+     * @brief Tick count at the end of each stage; zero if not marked.
+     */
+    std::array<std::uint64_t, TRACE_STAGE_COUNT> ends_{};
+
+    bool wants_target_ = false;
+    std::uint64_t key_hash_ = 0;
+    std::uint64_t filename_hash_ = 0;
+};
+
+/**
+ * @brief Mark the end of a stage of the request traced on this thread, if any.
+ *
+ * @param stage The stage that just ended.
+ */
+void trace_stage(TraceStage stage) noexcept;
+
+/**
+ * @brief Record the key and filename of the request traced on this thread, if it wants them.
+ *
+ * @param key The key.
+ * @param filename The filename; empty for requests that name only a key.
+ */
+void trace_target(std::string_view key, std::string_view filename = {}) noexcept;
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_UTIL_REQUEST_TRACE_HPP
@@ -0,0 +1,17 @@
+#include "util/stop_sleep.hpp"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace simple_data_server {
+
+bool sleep_for(std::stop_token stop_token, std::chrono::nanoseconds duration) {
+    // Nothing notifies the condition variable; it only wakes on the stop request.
+    std::mutex mutex;
+    std::condition_variable_any condition;
+    std::unique_lock lock(mutex);
+    condition.wait_for(lock, stop_token, duration, [] { return false; });
+    return !stop_token.stop_requested();
+}
+
+} // namespace simple_data_server
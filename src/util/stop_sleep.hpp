@@ -0,0 +1,23 @@
+#ifndef SIMPLE_DATA_SERVER_UTIL_STOP_SLEEP_HPP
+#define SIMPLE_DATA_SERVER_UTIL_STOP_SLEEP_HPP
+
+#include <chrono>
+#include <stop_token>
+
+namespace simple_data_server {
+
+/**
+ * @brief Sleep for a duration, waking early when stop is requested.
+ *
+ * For background threads that pause between rounds of work and must not
+ * hold up shutdown.
+ *
+ * @param stop_token Ends the sleep when stop is requested.
+ * @param duration How long to sleep.
+ * @return true if the whole duration passed, false if stop was requested.
+ */
+bool sleep_for(std::stop_token stop_token, std::chrono::nanoseconds duration);
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_UTIL_STOP_SLEEP_HPP
@@ -0,0 +1,64 @@
+#ifndef SIMPLE_DATA_SERVER_UTIL_TCP_SOCKET_HPP
+#define SIMPLE_DATA_SERVER_UTIL_TCP_SOCKET_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace simple_data_server {
+
+/**
+ * @brief Write a whole buffer to a socket.
+ *
+ * @param fd The socket.
+ * @param data The bytes to send.
+ * @return true on success, false if the connection failed or timed out.
+ */
+[[nodiscard]] bool send_all(int fd, std::string_view data);
+
+/**
+ * @brief Read exactly size bytes from a socket.
+ *
+ * @param fd The socket.
+ * @param data Destination buffer.
+ * @param size Number of bytes to read.
+ * @return true on success, false if the connection closed, failed or timed out.
+ */
+[[nodiscard]] bool receive_all(int fd, char* data, std::size_t size);
+
+/**
+ * @brief Connect to host:port over TCP with Nagle's algorithm disabled.
+ *
+ * @param host Host name or address.
+ * @param port The port.
+ * @param timeout Send and receive timeout for the socket.
+ * @return int The socket, or -1 on failure.
+ */
+[[nodiscard]] int connect_tcp(const std::string& host,
+                              std::uint16_t port,
+                              std::chrono::milliseconds timeout);
+
+/**
+ * @brief Listen on a TCP port of one local address.
+ *
+ * "::" listens on all interfaces, IPv4 included.
+ *
+ * @param host Local host name or address to bind, e.g. "127.0.0.1".
+ * @param port The port.
+ * @return int The listening socket, or -1 on failure.
+ */
+[[nodiscard]] int listen_tcp(const std::string& host, std::uint16_t port);
+
+/**
+ * @brief Set the send and receive timeouts of a socket.
+ *
+ * @param fd The socket.
+ * @param timeout The timeout.
+ */
+void set_socket_timeout(int fd, std::chrono::milliseconds timeout);
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_UTIL_TCP_SOCKET_HPP
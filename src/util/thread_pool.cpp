@@ -0,0 +1,50 @@
+#include "util/thread_pool.hpp"
+
+#include <algorithm>
+
+namespace simple_data_server {
+
+ThreadPool::ThreadPool(unsigned thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers_.reserve(thread_count);
+    for (unsigned i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this](std::stop_token stop_token) { worker_loop(stop_token); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    for (auto& worker : workers_) {
+        worker.request_stop();
+    }
+    condition_.notify_all();
+    workers_.clear();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    condition_.notify_one();
+}
+
+void ThreadPool::worker_loop(std::stop_token stop_token) {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            condition_.wait(lock, stop_token, [this] { return !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace simple_data_server
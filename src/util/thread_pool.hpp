@@ -0,0 +1,94 @@
+#ifndef SIMPLE_DATA_SERVER_UTIL_THREAD_POOL_HPP
+#define SIMPLE_DATA_SERVER_UTIL_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <latch>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace simple_data_server {
+
+/**
+ * @brief A fixed-size pool of worker threads executing queued tasks.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Construct a ThreadPool.
+     *
+     * @param thread_count Number of worker threads; zero means one per hardware thread.
+     */
+    explicit ThreadPool(unsigned thread_count);
+
+    /**
+     * @brief Finishes all queued tasks and joins the workers.
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Queue a task for execution on a worker thread.
+     *
+     * @param task The task to run.
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * @brief Run fn(i) for every i in [0, count) across the pool and wait for completion.
+     *
+     * Indices are handed out dynamically, so uneven work items balance across
+     * workers. Must not be called from a task running on this pool.
+     *
+     * @param count Number of work items.
+     * @param fn Callable taking a std::size_t index.
+     */
+    template <typename Fn>
+    void parallel_for(std::size_t count, Fn&& fn) {
+        if (count == 0) {
+            return;
+        }
+
+        const auto task_count = std::min<std::size_t>(count, workers_.size());
+        std::atomic<std::size_t> next_index{0};
+        std::latch done(static_cast<std::ptrdiff_t>(task_count));
+
+        for (std::size_t t = 0; t < task_count; ++t) {
+            submit([&] {
+                for (auto i = next_index.fetch_add(1); i < count; i = next_index.fetch_add(1)) {
+                    fn(i);
+                }
+                done.count_down();
+            });
+        }
+        done.wait();
+    }
+
+    /**
+     * @brief Get the number of worker threads.
+     *
+     * @return std::size_t The thread count.
+     */
+    [[nodiscard]] std::size_t size() const noexcept {
+        return workers_.size();
+    }
+
+private:
+    void worker_loop(std::stop_token stop_token);
+
+    std::mutex mutex_;
+    std::condition_variable_any condition_;
+    std::deque<std::function<void()>> tasks_;
+    std::vector<std::jthread> workers_;
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_UTIL_THREAD_POOL_HPP
@@ -0,0 +1,157 @@
+#ifndef SIMPLE_DATA_SERVER_UTIL_TIMING_WHEEL_HPP
+#define SIMPLE_DATA_SERVER_UTIL_TIMING_WHEEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace simple_data_server {
+
+/**
+ * @brief Hierarchical timing wheel with four levels of 256 slots.
+ *
+ * Level 0 holds timers due within 256 ticks, level 1 within 256^2 ticks and
+ * so on, so scheduling is O(1) and advancing one tick touches one level-0
+ * slot, plus one slot per higher level every 256^n ticks, when that slot's
+ * timers are cascaded down. With one-second ticks the wheel spans about 136
+ * years; later deadlines are clamped.
+ *
+ * Not thread-safe.
+ *
+ * @tparam T Payload stored with each timer.
+ */
+template <typename T>
+class TimingWheel {
+public:
+    /**
+     * @brief Construct a TimingWheel.
+     *
+     * @param current_tick The tick the wheel starts at.
+     */
+    explicit TimingWheel(std::uint64_t current_tick) : current_tick_(current_tick) {
+    }
+
+    /**
+     * @brief Schedule a timer.
+     *
+     * @param tick The tick at which the timer fires; ticks not after the
+     *             current tick fire on the next advance.
+     * @param value The payload passed to the expiry callback.
+     */
+    void schedule(std::uint64_t tick, T value) {
+        place(std::max(tick, current_tick_ + 1), std::move(value));
+        ++size_;
+    }
+
+    /**
+     * @brief Advance the wheel and fire all timers due at or before now.
+     *
+     * @param now The new current tick.
+     * @param on_expire Callable invoked with (tick, T&&) for each due timer.
+     */
+    template <typename Fn>
+    void advance(std::uint64_t now, Fn&& on_expire) {
+        if (size_ == 0) {
+            current_tick_ = std::max(current_tick_, now);
+            return;
+        }
+
+        while (current_tick_ < now) {
+            ++current_tick_;
+            cascade();
+
+            auto& slot = slots_[0][current_tick_ & SLOT_MASK];
+            if (slot.empty()) {
+                continue;
+            }
+            auto due = std::move(slot);
+            slot.clear();
+            size_ -= due.size();
+            for (auto& [tick, value] : due) {
+                on_expire(tick, std::move(value));
+            }
+        }
+    }
+
+    /**
+     * @brief Get the current tick.
+     *
+     * @return std::uint64_t The tick.
+     */
+    [[nodiscard]] std::uint64_t current_tick() const noexcept {
+        return current_tick_;
+    }
+
+    /**
+     * @brief Get the number of scheduled timers.
+     *
+     * @return std::size_t The count.
+     */
+    [[nodiscard]] std::size_t size() const noexcept {
+        return size_;
+    }
+
+private:
+    static constexpr unsigned SLOT_BITS = 8;
+    static constexpr std::size_t SLOT_COUNT = std::size_t{1} << SLOT_BITS;
+    static constexpr std::uint64_t SLOT_MASK = SLOT_COUNT - 1;
+    static constexpr unsigned LEVEL_COUNT = 4;
+
+    using Slot = std::vector<std::pair<std::uint64_t, T>>;
+
+    void place(std::uint64_t tick, T value) {
+        const auto delta = tick - current_tick_;
+        unsigned level = 0;
+        while (level + 1 < LEVEL_COUNT && delta >= (std::uint64_t{1} << (SLOT_BITS * (level + 1)))) {
+            ++level;
+        }
+
+        const auto max_delta = (std::uint64_t{1} << (SLOT_BITS * LEVEL_COUNT)) - 1;
+        if (delta > max_delta) {
+            tick = current_tick_ + max_delta;
+        }
+
+        const auto index = (tick >> (SLOT_BITS * level)) & SLOT_MASK;
+        slots_[level][index].emplace_back(tick, std::move(value));
+    }
+
+    /**
+     * @brief Move timers from higher levels down when their slot comes due.
+     *
+     * Higher levels are cascaded first, so timers they redistribute into a
+     * lower level's due slot are cascaded again in the same tick.
+     */
+    void cascade() {
+        unsigned top = 0;
+        while (top + 1 < LEVEL_COUNT && ((current_tick_ >> (SLOT_BITS * top)) & SLOT_MASK) == 0) {
+            ++top;
+        }
+
+        for (unsigned level = top; level >= 1; --level) {
+            auto& slot = slots_[level][(current_tick_ >> (SLOT_BITS * level)) & SLOT_MASK];
+            if (slot.empty()) {
+                continue;
+            }
+            auto entries = std::move(slot);
+            slot.clear();
+            for (auto& [tick, value] : entries) {
+                if (tick <= current_tick_) {
+                    slots_[0][current_tick_ & SLOT_MASK].emplace_back(tick, std::move(value));
+                } else {
+                    place(tick, std::move(value));
+                }
+            }
+        }
+    }
+
+    std::uint64_t current_tick_;
+    std::size_t size_ = 0;
+    std::array<std::array<Slot, SLOT_COUNT>, LEVEL_COUNT> slots_{};
+};
+
+} // namespace simple_data_server
+
+#endif // SIMPLE_DATA_SERVER_UTIL_TIMING_WHEEL_HPP
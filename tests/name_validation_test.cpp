@@ -0,0 +1,127 @@
+// Checks the vectorized key and filename kernels against their scalar
+// references, exhaustively for every byte value at every position of short
+// names and for every pair of adjacent bytes, then on random names; and
+// checks stored filenames against the previous sanitize_filename() and
+// ensure_json_extension(). Exits non-zero on any mismatch.
+
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+
+#include "stored_filename_reference.hpp"
+
+namespace {
+
+constexpr std::size_t MAX_EXHAUSTIVE_LENGTH = 80;
+constexpr int RANDOM_NAMES = 200'000;
+
+using simple_data_server::testing::legacy_stored_filename;
+using simple_data_server::testing::stored_filename;
+
+class Checker {
+public:
+    void check(const std::string& name) {
+        ++checked_;
+        if (simple_data_server::is_valid_key(name) !=
+            simple_data_server::is_valid_key_scalar(name)) {
+            report("is_valid_key", name);
+        }
+
+        vector_out_.assign(name.size(), '\0');
+        scalar_out_.assign(name.size(), '\0');
+        const auto vector_length =
+            simple_data_server::sanitize_filename(name, vector_out_.data());
+        const auto scalar_length =
+            simple_data_server::sanitize_filename_scalar(name, scalar_out_.data());
+        if (vector_out_.substr(0, vector_length) != scalar_out_.substr(0, scalar_length)) {
+            report("sanitize_filename", name);
+        }
+        if (stored_filename(name) != legacy_stored_filename(name)) {
+            report("stored filename vs previous implementation", name);
+        }
+    }
+
+    [[nodiscard]] bool ok() const {
+        return mismatches_ == 0;
+    }
+
+    [[nodiscard]] long checked() const {
+        return checked_;
+    }
+
+private:
+    void report(std::string_view what, const std::string& name) {
+        if (++mismatches_ <= 10) {
+            std::cout << "MISMATCH in " << what << " for name of " << name.size()
+                      << " bytes:";
+            for (const char c : name) {
+                std::cout << ' ' << static_cast<int>(static_cast<unsigned char>(c));
+            }
+            std::cout << '\n';
+        }
+    }
+
+    std::string vector_out_;
+    std::string scalar_out_;
+    long checked_ = 0;
+    long mismatches_ = 0;
+};
+
+bool check_equivalence() {
+    Checker checker;
+
+    // Every byte at every position, on backgrounds that take each block path.
+    for (const char background : {'a', '.', '-', '/'}) {
+        for (std::size_t length = 0; length <= MAX_EXHAUSTIVE_LENGTH; ++length) {
+            std::string name(length, background);
+            checker.check(name);
+            for (std::size_t position = 0; position < length; ++position) {
+                for (int byte = 0; byte < 256; ++byte) {
+                    name[position] = static_cast<char>(byte);
+                    checker.check(name);
+                }
+                name[position] = background;
+            }
+        }
+    }
+
+    // Every pair of adjacent bytes, straddling a 16-byte block boundary.
+    std::string name(40, 'k');
+    for (int first = 0; first < 256; ++first) {
+        for (int second = 0; second < 256; ++second) {
+            name[15] = static_cast<char>(first);
+            name[16] = static_cast<char>(second);
+            checker.check(name);
+        }
+    }
+
+    // Random names over a mix of kept, dropped and special bytes.
+    std::mt19937 random(42);
+    const auto alphabet = std::string_view("aZ09_-./\\\0\x1f\x7f\x80\xff @", 17);
+    std::uniform_int_distribution<std::size_t> pick(0, alphabet.size() - 1);
+    std::uniform_int_distribution<std::size_t> length(0, 300);
+    std::uniform_int_distribution<int> valid_run(0, 3);
+    for (int i = 0; i < RANDOM_NAMES; ++i) {
+        std::string random_name(length(random), 'x');
+        // Mostly valid names with a few odd bytes reach both block paths.
+        const bool sparse = valid_run(random) != 0;
+        for (auto& c : random_name) {
+            if (!sparse || pick(random) == 0) {
+                c = alphabet[pick(random)];
+            }
+        }
+        checker.check(random_name);
+    }
+
+    std::cout << "checked " << checker.checked() << " names against the scalar references"
+              << (checker.ok() ? "" : ": MISMATCH") << '\n';
+    return checker.ok();
+}
+
+} // namespace
+
+int main() {
+    return check_equivalence() ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+#ifndef SIMPLE_DATA_SERVER_TESTS_STORED_FILENAME_REFERENCE_HPP
+#define SIMPLE_DATA_SERVER_TESTS_STORED_FILENAME_REFERENCE_HPP
+
+#include <cctype>
+#include <string>
+#include <string_view>
+
+#include "storage/file_io.hpp"
+#include "storage/name_validation.hpp"
+
+namespace simple_data_server::testing {
+
+/**
+ * @brief The stored filename as FileManager built it before the kernels.
+ */
+inline std::string legacy_stored_filename(std::string_view filename) {
+    std::string result;
+    result.reserve(filename.size());
+    for (char c : filename) {
+        if (c == '/' || c == '\\' || c == '\0') {
+            continue;
+        }
+        if (c == '.' && !result.empty() && result.back() == '.') {
+            continue;
+        }
+        if (c == '.') {
+            result.push_back('_');
+            continue;
+        }
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-') {
+            result.push_back(c);
+        }
+    }
+    while (!result.empty() && (result.back() == '_' || result.back() == '-')) {
+        result.pop_back();
+    }
+    if (result.empty()) {
+        return result;
+    }
+    if (result.size() >= JSON_EXTENSION.size()) {
+        const auto ext = result.substr(result.size() - JSON_EXTENSION.size());
+        if (ext == JSON_EXTENSION) {
+            return result;
+        }
+    }
+    return result + JSON_EXTENSION.data();
+}
+
+/**
+ * @brief The stored filename built like FileManager::stored_filename().
+ */
+inline std::string stored_filename(std::string_view filename) {
+    std::string result(filename.size() + JSON_EXTENSION.size(), '\0');
+    const auto length = sanitize_filename(filename, result.data());
+    if (length == 0) {
+        return {};
+    }
+    result.resize(length);
+    result += JSON_EXTENSION;
+    return result;
+}
+
+} // namespace simple_data_server::testing
+
+#endif // SIMPLE_DATA_SERVER_TESTS_STORED_FILENAME_REFERENCE_HPP
@@ -0,0 +1,1197 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "storage/name_validation.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using simple_data_server::is_valid_key;
+
+constexpr std::string_view DEFAULT_HOST = "127.0.0.1";
+constexpr std::uint16_t DEFAULT_PORT = 8080;
+constexpr double DEFAULT_RATE = 1000.0;
+constexpr double DEFAULT_DURATION_SECONDS = 10.0;
+constexpr double DEFAULT_WARMUP_SECONDS = 1.0;
+constexpr unsigned DEFAULT_CONNECTIONS = 64;
+constexpr unsigned DEFAULT_KEYS = 100;
+constexpr unsigned DEFAULT_DOCUMENTS_PER_KEY = 100;
+constexpr std::string_view DEFAULT_MIX = "put=10,get=80,list=10";
+constexpr std::string_view DEFAULT_SIZES = "fixed:1024";
+constexpr std::string_view DEFAULT_KEY_PREFIX = "bench-";
+constexpr std::chrono::seconds DRAIN_TIMEOUT{5};
+
+/**
+ * @brief Largest document the server accepts; see MAX_REQUEST_SIZE.
+ */
+constexpr std::size_t MAX_DOCUMENT_SIZE = 1000 * 1000;
+
+/**
+ * @brief Random printable bytes that document payloads are cut from, so the
+ *        blob store does not deduplicate every document into one.
+ */
+constexpr std::size_t PAYLOAD_POOL_SIZE = 2 * MAX_DOCUMENT_SIZE;
+
+/**
+ * @brief Bytes a document has besides its payload: {"payload":""}.
+ */
+constexpr std::size_t DOCUMENT_OVERHEAD = 14;
+
+constexpr std::size_t READ_CHUNK_SIZE = 64 * 1024;
+constexpr int MAX_EVENTS = 256;
+constexpr std::uint32_t TIMER_TAG = UINT32_MAX;
+constexpr std::array<double, 6> REPORTED_PERCENTILES{50.0, 90.0, 99.0, 99.9, 99.99, 100.0};
+
+enum class Operation : std::size_t { Put, Get, List };
+
+constexpr std::size_t OPERATION_COUNT = 3;
+constexpr std::array<std::string_view, OPERATION_COUNT> OPERATION_NAMES{"put", "get", "list"};
+constexpr std::array<std::string_view, OPERATION_COUNT> OPERATION_PATHS{"/api/put", "/api/get",
+                                                                        "/api/list"};
+
+/**
+ * @brief How the sizes of put documents are drawn.
+ */
+struct SizeDistribution {
+    enum class Kind { Fixed, Uniform, LogNormal };
+
+    Kind kind = Kind::Fixed;
+    double first = 1024;
+    double second = 0;
+    std::string spec{DEFAULT_SIZES};
+
+    [[nodiscard]] std::size_t sample(std::mt19937_64& random) const {
+        double size = first;
+        if (kind == Kind::Uniform) {
+            size = std::uniform_real_distribution<double>(first, second)(random);
+        } else if (kind == Kind::LogNormal) {
+            size = std::lognormal_distribution<double>(std::log(first), second)(random);
+        }
+        return std::clamp<std::size_t>(static_cast<std::size_t>(size), DOCUMENT_OVERHEAD,
+                                        MAX_DOCUMENT_SIZE);
+    }
+};
+
+struct BenchOptions {
+    std::string host{DEFAULT_HOST};
+    std::uint16_t port = DEFAULT_PORT;
+    double rate = DEFAULT_RATE;
+    double duration_seconds = DEFAULT_DURATION_SECONDS;
+    double warmup_seconds = DEFAULT_WARMUP_SECONDS;
+    unsigned connections = DEFAULT_CONNECTIONS;
+    unsigned threads = 1;
+    std::array<double, OPERATION_COUNT> mix{};
+    std::string mix_spec{DEFAULT_MIX};
+    unsigned keys = DEFAULT_KEYS;
+    unsigned documents_per_key = DEFAULT_DOCUMENTS_PER_KEY;
+    std::string key_prefix{DEFAULT_KEY_PREFIX};
+    SizeDistribution sizes;
+    std::string data_directory;
+    bool preload = true;
+    std::uint64_t seed = 1;
+    std::string output;
+    std::string label;
+};
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n"
+              << "Drives a running server at a fixed request rate and reports latency\n"
+              << "measured from when each request was due, so queueing is not hidden.\n"
+              << "Options:\n"
+              << "  --host HOST        Server host (default: " << DEFAULT_HOST << ")\n"
+              << "  -p, --port PORT    Server port (default: " << DEFAULT_PORT << ")\n"
+              << "  -r, --rate N       Requests per second across all connections (default: "
+              << DEFAULT_RATE << ")\n"
+              << "  --duration S       Seconds to send requests for (default: "
+              << DEFAULT_DURATION_SECONDS << ")\n"
+              << "  --warmup S         Leading seconds left out of the results (default: "
+              << DEFAULT_WARMUP_SECONDS << ")\n"
+              << "  -c, --connections N  Keep-alive connections (default: "
+              << DEFAULT_CONNECTIONS << ")\n"
+              << "  -t, --threads N    Event loops the connections are spread over (default: 1)\n"
+              << "  --mix SPEC         Operation weights (default: " << DEFAULT_MIX << ")\n"
+              << "  --keys N           Synthetic keys (default: " << DEFAULT_KEYS << ")\n"
+              << "  --docs N           Documents per key (default: " << DEFAULT_DOCUMENTS_PER_KEY
+              << ")\n"
+              << "  --key-prefix P     Prefix of the synthetic keys (default: "
+              << DEFAULT_KEY_PREFIX << ")\n"
+              << "  --sizes SPEC       Document sizes in bytes: fixed:N, uniform:MIN:MAX or\n"
+              << "                     lognormal:MEDIAN:SIGMA (default: " << DEFAULT_SIZES
+              << ")\n"
+              << "  -d, --dir DIR      Create the key directories in DIR, the server's data\n"
+              << "                     directory, before starting\n"
+              << "  --no-preload       Do not put every document once before the run\n"
+              << "  --seed N           Random seed (default: 1)\n"
+              << "  -o, --output FILE  Write the results as JSON to FILE ('-' for stdout)\n"
+              << "  --label TEXT       Label stored in the JSON results, e.g. a commit\n"
+              << "  -h, --help         Show this help message\n";
+}
+
+/**
+ * @brief Latency histogram with HdrHistogram's bucket layout.
+ *
+ * Values below 2048 ns get a bucket each; every power of two above that is
+ * split into 1024 equal buckets, so values are kept to about three
+ * significant digits from nanoseconds to minutes in a fixed 248 KB.
+ */
+class LatencyHistogram {
+public:
+    LatencyHistogram() : counts_(bucket_index(MAX_VALUE) + 1, 0) {
+    }
+
+    void record(std::chrono::nanoseconds latency) {
+        const auto value =
+            std::min(static_cast<std::uint64_t>(std::max<std::int64_t>(latency.count(), 0)),
+                     MAX_VALUE);
+        ++counts_[bucket_index(value)];
+        ++total_;
+        sum_ += value;
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (std::size_t i = 0; i < counts_.size(); ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        sum_ += other.sum_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    [[nodiscard]] std::uint64_t count() const {
+        return total_;
+    }
+
+    [[nodiscard]] double mean_nanoseconds() const {
+        return total_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(total_);
+    }
+
+    /**
+     * @brief Get the value at a percentile, as the highest value of its bucket.
+     */
+    [[nodiscard]] std::uint64_t percentile_nanoseconds(double percentile) const {
+        if (total_ == 0) {
+            return 0;
+        }
+        const auto target = std::max<std::uint64_t>(
+            1, static_cast<std::uint64_t>(
+                   std::ceil(percentile / 100.0 * static_cast<double>(total_))));
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= target) {
+                return std::min(highest_in_bucket(i), max_);
+            }
+        }
+        return max_;
+    }
+
+private:
+    static constexpr unsigned SUB_BUCKET_BITS = 11;
+    static constexpr std::uint64_t SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS;
+    static constexpr std::uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+    static constexpr std::uint64_t MAX_VALUE = (1ULL << 40) - 1; // about 18 minutes
+
+    static std::size_t bucket_index(std::uint64_t value) {
+        if (value < SUB_BUCKET_COUNT) {
+            return static_cast<std::size_t>(value);
+        }
+        const auto shift = static_cast<unsigned>(std::bit_width(value)) - SUB_BUCKET_BITS;
+        return static_cast<std::size_t>(SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF +
+                                        ((value >> shift) - SUB_BUCKET_HALF));
+    }
+
+    static std::uint64_t highest_in_bucket(std::size_t index) {
+        if (index < SUB_BUCKET_COUNT) {
+            return index;
+        }
+        const auto offset = index - SUB_BUCKET_COUNT;
+        const auto shift = offset / SUB_BUCKET_HALF + 1;
+        const auto lowest = (offset % SUB_BUCKET_HALF + SUB_BUCKET_HALF) << shift;
+        return lowest + (1ULL << shift) - 1;
+    }
+
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t total_ = 0;
+    std::uint64_t sum_ = 0;
+    std::uint64_t max_ = 0;
+};
+
+struct OperationStats {
+    /** From when the request was due to its response; what a user would see. */
+    LatencyHistogram latency;
+    /** From when the request was written to its response; hides queueing. */
+    LatencyHistogram service_time;
+    std::map<int, std::uint64_t> statuses;
+
+    void merge(const OperationStats& other) {
+        latency.merge(other.latency);
+        service_time.merge(other.service_time);
+        for (const auto& [status, count] : other.statuses) {
+            statuses[status] += count;
+        }
+    }
+};
+
+struct RunStats {
+    std::array<OperationStats, OPERATION_COUNT> operations;
+    std::uint64_t connection_errors = 0;
+    std::uint64_t timed_out = 0;
+    std::uint64_t bytes_sent = 0;
+    std::uint64_t bytes_received = 0;
+
+    void merge(const RunStats& other) {
+        for (std::size_t i = 0; i < OPERATION_COUNT; ++i) {
+            operations[i].merge(other.operations[i]);
+        }
+        connection_errors += other.connection_errors;
+        timed_out += other.timed_out;
+        bytes_sent += other.bytes_sent;
+        bytes_received += other.bytes_received;
+    }
+};
+
+/**
+ * @brief A request waiting for a connection or in flight.
+ */
+struct Request {
+    Operation operation;
+    std::uint32_t key;
+    std::uint32_t document;
+    Clock::time_point due;
+};
+
+bool equals_ignoring_case(std::string_view text, std::string_view lowercase) {
+    return text.size() == lowercase.size() &&
+           std::equal(text.begin(), text.end(), lowercase.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) == b;
+           });
+}
+
+std::string key_name(const BenchOptions& options, std::uint32_t key) {
+    char digits[16];
+    std::snprintf(digits, sizeof(digits), "%06u", key);
+    return options.key_prefix + digits;
+}
+
+std::string document_name(std::uint32_t document) {
+    char name[24];
+    std::snprintf(name, sizeof(name), "doc-%06u", document);
+    return name;
+}
+
+/**
+ * @brief One event loop driving a share of the connections at a share of the rate.
+ *
+ * Requests are scheduled at fixed times whether or not a connection is free
+ * (open loop); a request that has to wait for a connection is written as
+ * soon as one frees up, and its latency still counts from when it was due.
+ * A timerfd wakes the loop at the next due time with nanosecond precision.
+ */
+class Worker {
+public:
+    Worker(const BenchOptions& options,
+           const sockaddr_storage& address,
+           socklen_t address_length,
+           const std::string& payload_pool,
+           unsigned index,
+           unsigned connections)
+        : options_(options),
+          address_(address),
+          address_length_(address_length),
+          payload_pool_(payload_pool),
+          index_(index),
+          random_(options.seed * 0x9E3779B97F4A7C15ULL + index),
+          pick_operation_(options.mix.begin(), options.mix.end()),
+          connections_(connections) {
+        epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+        timer_fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (epoll_fd_ < 0 || timer_fd_ < 0) {
+            throw std::runtime_error("Cannot create event loop");
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = TIMER_TAG;
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, timer_fd_, &event);
+    }
+
+    ~Worker() {
+        for (auto& connection : connections_) {
+            if (connection.fd >= 0) {
+                ::close(connection.fd);
+            }
+        }
+        ::close(timer_fd_);
+        ::close(epoll_fd_);
+    }
+
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+
+    /**
+     * @brief Put documents as fast as the connections allow, without recording them.
+     *
+     * @param first First document index, counting across all keys.
+     * @param count Number of documents.
+     */
+    void preload(std::uint64_t first, std::uint64_t count) {
+        const auto now = Clock::now();
+        for (auto i = first; i < first + count; ++i) {
+            pending_.push_back(Request{Operation::Put,
+                                       static_cast<std::uint32_t>(i / options_.documents_per_key),
+                                       static_cast<std::uint32_t>(i % options_.documents_per_key),
+                                       now});
+        }
+        recording_ = false;
+        scheduled_ = 0;
+        total_scheduled_ = 0;
+        loop();
+    }
+
+    /**
+     * @brief Send this worker's share of the paced requests.
+     *
+     * @param start When the first request is due, the same for all workers.
+     */
+    void run(Clock::time_point start) {
+        // Workers interleave their due times, so together they send evenly.
+        const auto threads = static_cast<double>(options_.threads);
+        interval_ = std::chrono::duration<double>(threads / options_.rate);
+        start_ = start + std::chrono::duration_cast<Clock::duration>(
+                             std::chrono::duration<double>(index_ / options_.rate));
+        record_from_ = start + std::chrono::duration_cast<Clock::duration>(
+                                   std::chrono::duration<double>(options_.warmup_seconds));
+        const auto total = options_.rate * (options_.warmup_seconds + options_.duration_seconds);
+        total_scheduled_ = static_cast<std::uint64_t>(
+            std::max(0.0, std::ceil((total - index_) / threads)));
+        scheduled_ = 0;
+        recording_ = true;
+        stats_ = RunStats{};
+        loop();
+    }
+
+    [[nodiscard]] const RunStats& stats() const {
+        return stats_;
+    }
+
+private:
+    struct Connection {
+        int fd = -1;
+        bool connected = false;
+        bool watching_writable = true;
+        bool busy = false;
+        std::string out;
+        std::size_t written = 0;
+        std::string in;
+        Request request{};
+        Clock::time_point sent;
+    };
+
+    [[nodiscard]] Clock::time_point due_time(std::uint64_t n) const {
+        return start_ + std::chrono::duration_cast<Clock::duration>(interval_ * n);
+    }
+
+    void loop() {
+        for (std::size_t i = 0; i < connections_.size(); ++i) {
+            if (connections_[i].fd < 0) {
+                open_connection(i);
+            }
+        }
+        std::array<epoll_event, MAX_EVENTS> events;
+
+        while (true) {
+            const auto now = Clock::now();
+            while (scheduled_ < total_scheduled_ && due_time(scheduled_) <= now) {
+                pending_.push_back(next_request(due_time(scheduled_)));
+                ++scheduled_;
+            }
+            dispatch();
+
+            if (scheduled_ == total_scheduled_) {
+                if (pending_.empty() && in_flight_ == 0) {
+                    return;
+                }
+                // Keep draining while responses arrive; give up once they stop.
+                const auto deadline = std::max(last_response_, due_time(scheduled_)) +
+                                      DRAIN_TIMEOUT;
+                if (now >= deadline) {
+                    abandon_outstanding();
+                    return;
+                }
+                arm_timer(deadline);
+            } else {
+                arm_timer(due_time(scheduled_));
+            }
+
+            const int ready = ::epoll_wait(epoll_fd_, events.data(), MAX_EVENTS, -1);
+            if (ready < 0 && errno != EINTR) {
+                throw std::runtime_error("epoll_wait failed");
+            }
+            for (int i = 0; i < ready; ++i) {
+                if (events[i].data.u32 == TIMER_TAG) {
+                    std::uint64_t expirations;
+                    static_cast<void>(::read(timer_fd_, &expirations, sizeof(expirations)));
+                    continue;
+                }
+                handle_event(events[i].data.u32, events[i].events);
+            }
+        }
+    }
+
+    Request next_request(Clock::time_point due) {
+        return Request{static_cast<Operation>(pick_operation_(random_)),
+                       static_cast<std::uint32_t>(random_() % options_.keys),
+                       static_cast<std::uint32_t>(random_() % options_.documents_per_key), due};
+    }
+
+    void arm_timer(Clock::time_point when) {
+        const auto since_epoch =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(when.time_since_epoch()).count();
+        itimerspec spec{};
+        spec.it_value.tv_sec = static_cast<time_t>(since_epoch / 1'000'000'000);
+        spec.it_value.tv_nsec = static_cast<long>(since_epoch % 1'000'000'000);
+        if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+            spec.it_value.tv_nsec = 1;
+        }
+        ::timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr);
+    }
+
+    void open_connection(std::size_t index) {
+        auto& connection = connections_[index];
+        connection = Connection{};
+        const int fd = ::socket(address_.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot create socket");
+        }
+        const int enabled = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&address_), address_length_) != 0 &&
+            errno != EINPROGRESS) {
+            ::close(fd);
+            connection_failed();
+            return;
+        }
+        connection.fd = fd;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+        event.data.u32 = static_cast<std::uint32_t>(index);
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    /**
+     * @brief Count a failed connection; give up if the server is clearly unreachable.
+     */
+    void connection_failed() {
+        ++stats_.connection_errors;
+        if (++consecutive_failures_ > connections_.size() * 3) {
+            throw std::runtime_error("Cannot connect to the server");
+        }
+    }
+
+    /**
+     * @brief Replace a connection that failed or was closed by the server.
+     *
+     * Only a connection that fails while connecting or with a request in
+     * flight counts as an error; the server may close idle ones.
+     */
+    void close_connection(std::size_t index) {
+        auto& connection = connections_[index];
+        if (connection.busy) {
+            --in_flight_;
+        }
+        if (connection.busy || !connection.connected) {
+            connection_failed();
+        }
+        std::erase(idle_, index);
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection.fd, nullptr);
+        ::close(connection.fd);
+        open_connection(index);
+    }
+
+    void handle_event(std::size_t index, std::uint32_t events) {
+        auto& connection = connections_[index];
+        if (!connection.connected && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0) {
+            int error = 0;
+            socklen_t length = sizeof(error);
+            ::getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+            if (error != 0) {
+                close_connection(index);
+                return;
+            }
+            connection.connected = true;
+            consecutive_failures_ = 0;
+            watch_writable(index, false);
+            idle_.push_back(index);
+            return;
+        }
+        if ((events & EPOLLOUT) != 0 && !flush(index)) {
+            return;
+        }
+        if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) != 0) {
+            receive(index);
+        }
+    }
+
+    void watch_writable(std::size_t index, bool writable) {
+        if (connections_[index].watching_writable == writable) {
+            return;
+        }
+        connections_[index].watching_writable = writable;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP | (writable ? EPOLLOUT : 0U);
+        event.data.u32 = static_cast<std::uint32_t>(index);
+        ::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connections_[index].fd, &event);
+    }
+
+    void dispatch() {
+        while (!pending_.empty() && !idle_.empty()) {
+            const auto index = idle_.back();
+            idle_.pop_back();
+            auto& connection = connections_[index];
+            connection.request = pending_.front();
+            pending_.pop_front();
+            build_request(connection.request, connection.out);
+            connection.written = 0;
+            connection.busy = true;
+            connection.sent = Clock::now();
+            ++in_flight_;
+            flush(index);
+        }
+    }
+
+    void build_request(const Request& request, std::string& out) {
+        auto body = R"({"key":")" + key_name(options_, request.key) + '"';
+        if (request.operation != Operation::List) {
+            body += R"(,"filename":")" + document_name(request.document) + '"';
+        }
+        if (request.operation == Operation::Put) {
+            const auto size = options_.sizes.sample(random_);
+            const auto payload = size - DOCUMENT_OVERHEAD;
+            const auto offset = random_() % (payload_pool_.size() - payload + 1);
+            body += R"(,"data":{"payload":")";
+            body.append(payload_pool_, offset, payload);
+            body += "\"}";
+        }
+        body += '}';
+
+        out.clear();
+        out += "POST ";
+        out += OPERATION_PATHS[static_cast<std::size_t>(request.operation)];
+        out += " HTTP/1.1\r\nHost: ";
+        out += options_.host;
+        out += "\r\nContent-Type: application/json\r\nContent-Length: ";
+        out += std::to_string(body.size());
+        out += "\r\n\r\n";
+        out += body;
+    }
+
+    /**
+     * @brief Write what is left of the request; watch for writability if the socket is full.
+     *
+     * @return bool false if the connection was closed.
+     */
+    bool flush(std::size_t index) {
+        auto& connection = connections_[index];
+        while (connection.written < connection.out.size()) {
+            const auto sent = ::send(connection.fd, connection.out.data() + connection.written,
+                                     connection.out.size() - connection.written, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            }
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                watch_writable(index, true);
+                return true;
+            }
+            if (sent <= 0) {
+                close_connection(index);
+                return false;
+            }
+            connection.written += static_cast<std::size_t>(sent);
+            stats_.bytes_sent += static_cast<std::uint64_t>(sent);
+        }
+        watch_writable(index, false);
+        return true;
+    }
+
+    void receive(std::size_t index) {
+        auto& connection = connections_[index];
+        char buffer[READ_CHUNK_SIZE];
+        while (true) {
+            const auto received = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                break;
+            }
+            if (received <= 0) {
+                close_connection(index);
+                return;
+            }
+            stats_.bytes_received += static_cast<std::uint64_t>(received);
+            connection.in.append(buffer, static_cast<std::size_t>(received));
+        }
+        if (!connection.busy) {
+            return;
+        }
+        const auto status = parse_response(connection.in);
+        if (!status) {
+            return;
+        }
+        if (*status < 0) {
+            close_connection(index);
+            return;
+        }
+        complete(connection, *status);
+        idle_.push_back(index);
+    }
+
+    /**
+     * @brief Parse one complete response off the front of the buffer.
+     *
+     * @return std::optional<int> The status, -1 for a response that cannot be
+     *         parsed, or std::nullopt if more bytes are needed.
+     */
+    static std::optional<int> parse_response(std::string& in) {
+        const auto header_end = in.find("\r\n\r\n");
+        if (header_end == std::string::npos) {
+            return std::nullopt;
+        }
+        int status = -1;
+        if (in.starts_with("HTTP/1.") && header_end >= 12) {
+            std::from_chars(in.data() + 9, in.data() + 12, status);
+        }
+        std::size_t content_length = 0;
+        std::string_view headers(in.data(), header_end);
+        for (std::size_t line_start = headers.find("\r\n"); line_start != std::string::npos;) {
+            line_start += 2;
+            const auto line_end = headers.find("\r\n", line_start);
+            const auto line = headers.substr(line_start, line_end - line_start);
+            const auto colon = line.find(':');
+            const auto name = line.substr(0, colon);
+            if (colon != std::string_view::npos && equals_ignoring_case(name, "content-length")) {
+                auto value = line.substr(colon + 1);
+                value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+                std::from_chars(value.data(), value.data() + value.size(), content_length);
+            } else if (equals_ignoring_case(name, "transfer-encoding")) {
+                return -1;
+            }
+            line_start = line_end;
+        }
+        const auto total = header_end + 4 + content_length;
+        if (in.size() < total) {
+            return std::nullopt;
+        }
+        in.erase(0, total);
+        return status;
+    }
+
+    void complete(Connection& connection, int status) {
+        const auto now = Clock::now();
+        last_response_ = now;
+        connection.busy = false;
+        --in_flight_;
+        if (!recording_ || connection.request.due < record_from_) {
+            return;
+        }
+        auto& operation = stats_.operations[static_cast<std::size_t>(connection.request.operation)];
+        operation.latency.record(now - connection.request.due);
+        operation.service_time.record(now - connection.sent);
+        ++operation.statuses[status];
+    }
+
+    /**
+     * @brief Count what is still queued or in flight after the drain timeout.
+     */
+    void abandon_outstanding() {
+        for (const auto& request : pending_) {
+            if (recording_ && request.due >= record_from_) {
+                ++stats_.timed_out;
+            }
+        }
+        pending_.clear();
+        for (std::size_t i = 0; i < connections_.size(); ++i) {
+            auto& connection = connections_[i];
+            if (connection.busy) {
+                if (recording_ && connection.request.due >= record_from_) {
+                    ++stats_.timed_out;
+                }
+                ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, connection.fd, nullptr);
+                ::close(connection.fd);
+                connection.fd = -1;
+            }
+        }
+        in_flight_ = 0;
+        idle_.erase(std::remove_if(idle_.begin(), idle_.end(),
+                                   [this](std::size_t i) { return connections_[i].fd < 0; }),
+                    idle_.end());
+    }
+
+    const BenchOptions& options_;
+    sockaddr_storage address_;
+    socklen_t address_length_;
+    const std::string& payload_pool_;
+    unsigned index_;
+    std::mt19937_64 random_;
+    std::discrete_distribution<std::size_t> pick_operation_;
+    int epoll_fd_ = -1;
+    int timer_fd_ = -1;
+    std::vector<Connection> connections_;
+    std::vector<std::size_t> idle_;
+    std::deque<Request> pending_;
+    std::size_t in_flight_ = 0;
+    std::size_t consecutive_failures_ = 0;
+
+    Clock::time_point start_;
+    Clock::time_point record_from_;
+    std::chrono::duration<double> interval_{0};
+    std::uint64_t scheduled_ = 0;
+    std::uint64_t total_scheduled_ = 0;
+    Clock::time_point last_response_;
+    bool recording_ = false;
+
+    RunStats stats_;
+};
+
+std::optional<double> parse_number(std::string_view text) {
+    double value = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+/**
+ * @brief Parse "put=10,get=80,list=10" into operation weights.
+ */
+bool parse_mix(std::string_view spec, std::array<double, OPERATION_COUNT>& mix) {
+    mix.fill(0);
+    while (!spec.empty()) {
+        const auto comma = spec.find(',');
+        const auto item = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+        const auto equals = item.find('=');
+        if (equals == std::string_view::npos) {
+            return false;
+        }
+        const auto name = std::find(OPERATION_NAMES.begin(), OPERATION_NAMES.end(),
+                                    item.substr(0, equals));
+        const auto weight = parse_number(item.substr(equals + 1));
+        if (name == OPERATION_NAMES.end() || !weight || *weight < 0) {
+            return false;
+        }
+        mix[static_cast<std::size_t>(name - OPERATION_NAMES.begin())] = *weight;
+    }
+    return std::any_of(mix.begin(), mix.end(), [](double weight) { return weight > 0; });
+}
+
+/**
+ * @brief Parse "fixed:N", "uniform:MIN:MAX" or "lognormal:MEDIAN:SIGMA".
+ */
+std::optional<SizeDistribution> parse_sizes(std::string_view spec) {
+    SizeDistribution sizes;
+    sizes.spec = spec;
+    std::vector<double> values;
+    const auto colon = spec.find(':');
+    const auto kind = spec.substr(0, colon);
+    for (auto rest = colon == std::string_view::npos ? std::string_view{} : spec.substr(colon + 1);
+         !rest.empty();) {
+        const auto next = rest.find(':');
+        const auto value = parse_number(rest.substr(0, next));
+        if (!value || *value < 0) {
+            return std::nullopt;
+        }
+        values.push_back(*value);
+        rest = next == std::string_view::npos ? std::string_view{} : rest.substr(next + 1);
+    }
+    if (kind == "fixed" && values.size() == 1) {
+        sizes.kind = SizeDistribution::Kind::Fixed;
+    } else if (kind == "uniform" && values.size() == 2 && values[0] <= values[1]) {
+        sizes.kind = SizeDistribution::Kind::Uniform;
+    } else if (kind == "lognormal" && values.size() == 2 && values[0] > 0) {
+        sizes.kind = SizeDistribution::Kind::LogNormal;
+    } else {
+        return std::nullopt;
+    }
+    sizes.first = values[0];
+    sizes.second = values.size() > 1 ? values[1] : 0;
+    return sizes;
+}
+
+std::optional<BenchOptions> parse_arguments(int argc, char* argv[], int& exit_code) {
+    BenchOptions options;
+    parse_mix(options.mix_spec, options.mix);
+
+    const auto fail = [&exit_code](std::string_view message, std::string_view value) {
+        std::cerr << message << value << "\n";
+        exit_code = 1;
+        return std::nullopt;
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+
+        if (arg == "--no-preload") {
+            options.preload = false;
+            continue;
+        }
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            exit_code = 0;
+            return std::nullopt;
+        }
+        if (!arg.starts_with('-')) {
+            std::cerr << "Unknown option: " << arg << "\n";
+            print_usage(argv[0]);
+            exit_code = 1;
+            return std::nullopt;
+        }
+        if (i + 1 >= argc) {
+            return fail("Option requires an argument: ", arg);
+        }
+        const std::string_view value(argv[++i]);
+        const auto number = parse_number(value);
+        const auto whole = number && *number >= 1 && *number == std::floor(*number);
+
+        if (arg == "--host") {
+            options.host = value;
+        } else if (arg == "-p" || arg == "--port") {
+            if (!whole || *number > UINT16_MAX) {
+                return fail("Invalid port: ", value);
+            }
+            options.port = static_cast<std::uint16_t>(*number);
+        } else if (arg == "-r" || arg == "--rate") {
+            if (!number || *number <= 0) {
+                return fail("Invalid rate: ", value);
+            }
+            options.rate = *number;
+        } else if (arg == "--duration" || arg == "--warmup") {
+            if (!number || *number < 0 || (arg == "--duration" && *number == 0)) {
+                return fail("Invalid number of seconds: ", value);
+            }
+            (arg == "--duration" ? options.duration_seconds : options.warmup_seconds) = *number;
+        } else if (arg == "-c" || arg == "--connections" || arg == "-t" || arg == "--threads" ||
+                   arg == "--keys" || arg == "--docs") {
+            if (!whole || *number > UINT32_MAX) {
+                return fail("Invalid count: ", value);
+            }
+            const auto count = static_cast<unsigned>(*number);
+            if (arg == "-c" || arg == "--connections") {
+                options.connections = count;
+            } else if (arg == "-t" || arg == "--threads") {
+                options.threads = count;
+            } else if (arg == "--keys") {
+                options.keys = count;
+            } else {
+                options.documents_per_key = count;
+            }
+        } else if (arg == "--mix") {
+            if (!parse_mix(value, options.mix)) {
+                return fail("Invalid mix: ", value);
+            }
+            options.mix_spec = value;
+        } else if (arg == "--sizes") {
+            auto sizes = parse_sizes(value);
+            if (!sizes) {
+                return fail("Invalid size distribution: ", value);
+            }
+            options.sizes = std::move(*sizes);
+        } else if (arg == "--key-prefix") {
+            options.key_prefix = value;
+        } else if (arg == "-d" || arg == "--dir") {
+            options.data_directory = value;
+        } else if (arg == "--seed") {
+            if (!number || *number < 0 || *number != std::floor(*number)) {
+                return fail("Invalid seed: ", value);
+            }
+            options.seed = static_cast<std::uint64_t>(*number);
+        } else if (arg == "-o" || arg == "--output") {
+            options.output = value;
+        } else if (arg == "--label") {
+            options.label = value;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            print_usage(argv[0]);
+            exit_code = 1;
+            return std::nullopt;
+        }
+    }
+
+    if (options.threads > options.connections) {
+        return fail("Need at least one connection per thread: ", "--threads");
+    }
+    if (!is_valid_key(key_name(options, options.keys - 1))) {
+        return fail("Invalid key prefix: ", options.key_prefix);
+    }
+    return options;
+}
+
+std::optional<std::pair<sockaddr_storage, socklen_t>> resolve(const BenchOptions& options) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (::getaddrinfo(options.host.c_str(), std::to_string(options.port).c_str(), &hints,
+                      &addresses) != 0 ||
+        addresses == nullptr) {
+        return std::nullopt;
+    }
+    sockaddr_storage address{};
+    std::memcpy(&address, addresses->ai_addr, addresses->ai_addrlen);
+    const auto length = addresses->ai_addrlen;
+    ::freeaddrinfo(addresses);
+    return std::pair{address, length};
+}
+
+std::string make_payload_pool(std::uint64_t seed) {
+    constexpr std::string_view ALPHABET =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    std::mt19937_64 random(seed);
+    std::string pool(PAYLOAD_POOL_SIZE, '\0');
+    for (auto& c : pool) {
+        c = ALPHABET[random() % ALPHABET.size()];
+    }
+    return pool;
+}
+
+/**
+ * @brief Run one worker per thread, each with its share of the connections.
+ *
+ * @param work Called with each worker on its own thread.
+ */
+template <typename Work>
+RunStats run_workers(std::vector<std::unique_ptr<Worker>>& workers, const Work& work) {
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(workers.size());
+    for (std::size_t i = 0; i < workers.size(); ++i) {
+        threads.emplace_back([&, i] {
+            try {
+                work(*workers[i], i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    RunStats total;
+    for (const auto& worker : workers) {
+        total.merge(worker->stats());
+    }
+    return total;
+}
+
+nlohmann::ordered_json summarize(const LatencyHistogram& histogram) {
+    const auto microseconds = [](double nanoseconds) { return nanoseconds / 1000.0; };
+    nlohmann::ordered_json summary;
+    summary["mean"] = microseconds(histogram.mean_nanoseconds());
+    for (const auto percentile : REPORTED_PERCENTILES) {
+        std::ostringstream name;
+        if (percentile == 100.0) {
+            name << "max";
+        } else {
+            name << 'p' << percentile;
+        }
+        summary[name.str()] = microseconds(
+            static_cast<double>(histogram.percentile_nanoseconds(percentile)));
+    }
+    return summary;
+}
+
+nlohmann::ordered_json report(const BenchOptions& options, const RunStats& stats, double seconds) {
+    nlohmann::ordered_json result;
+    result["label"] = options.label;
+    result["target"] = options.host + ":" + std::to_string(options.port);
+
+    auto& config = result["config"];
+    config["rate"] = options.rate;
+    config["duration_s"] = options.duration_seconds;
+    config["warmup_s"] = options.warmup_seconds;
+    config["connections"] = options.connections;
+    config["threads"] = options.threads;
+    config["mix"] = options.mix_spec;
+    config["keys"] = options.keys;
+    config["docs_per_key"] = options.documents_per_key;
+    config["sizes"] = options.sizes.spec;
+    config["preload"] = options.preload;
+    config["seed"] = options.seed;
+
+    LatencyHistogram all_latency;
+    LatencyHistogram all_service_time;
+    std::uint64_t requests = 0;
+    std::uint64_t failed = 0;
+    nlohmann::ordered_json operations = nlohmann::ordered_json::object();
+    for (std::size_t i = 0; i < OPERATION_COUNT; ++i) {
+        const auto& operation = stats.operations[i];
+        if (operation.latency.count() == 0) {
+            continue;
+        }
+        auto& entry = operations[std::string(OPERATION_NAMES[i])];
+        entry["count"] = operation.latency.count();
+        auto& statuses = entry["statuses"];
+        for (const auto& [status, count] : operation.statuses) {
+            statuses[std::to_string(status)] = count;
+            if (status < 200 || status >= 300) {
+                failed += count;
+            }
+        }
+        entry["latency_us"] = summarize(operation.latency);
+        entry["service_time_us"] = summarize(operation.service_time);
+        all_latency.merge(operation.latency);
+        all_service_time.merge(operation.service_time);
+        requests += operation.latency.count();
+    }
+
+    result["requests"] = requests;
+    result["achieved_rate"] = seconds > 0 ? static_cast<double>(requests) / seconds : 0.0;
+    result["errors"] = {{"status", failed},
+                        {"connection", stats.connection_errors},
+                        {"timed_out", stats.timed_out}};
+    result["bytes_sent"] = stats.bytes_sent;
+    result["bytes_received"] = stats.bytes_received;
+    result["all"] = {{"latency_us", summarize(all_latency)},
+                     {"service_time_us", summarize(all_service_time)}};
+    result["operations"] = std::move(operations);
+    return result;
+}
+
+void print_report(const nlohmann::ordered_json& result) {
+    std::cout << result["requests"] << " requests, " << std::fixed << std::setprecision(1)
+              << result["achieved_rate"].get<double>() << " req/s; errors: "
+              << result["errors"]["status"] << " status, " << result["errors"]["connection"]
+              << " connection, " << result["errors"]["timed_out"] << " timed out\n"
+              << "Latency from due time (service time) in microseconds:\n";
+    const auto print_row = [](std::string_view name, const nlohmann::ordered_json& entry) {
+        std::cout << "  " << std::left << std::setw(5) << name << std::right;
+        for (const auto& [percentile, value] : entry["latency_us"].items()) {
+            std::cout << "  " << percentile << " " << value.get<double>() << " ("
+                      << entry["service_time_us"][percentile].get<double>() << ")";
+        }
+        std::cout << "\n";
+    };
+    for (const auto& [name, entry] : result["operations"].items()) {
+        print_row(name, entry);
+    }
+    print_row("all", result["all"]);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int exit_code = 0;
+    const auto parsed_options = parse_arguments(argc, argv, exit_code);
+    if (!parsed_options) {
+        return exit_code;
+    }
+    const auto& options = parsed_options.value();
+
+    const auto address = resolve(options);
+    if (!address) {
+        std::cerr << "Cannot resolve " << options.host << "\n";
+        return 1;
+    }
+
+    if (!options.data_directory.empty()) {
+        for (std::uint32_t key = 0; key < options.keys; ++key) {
+            std::error_code ec;
+            std::filesystem::create_directories(
+                std::filesystem::path(options.data_directory) / key_name(options, key), ec);
+            if (ec) {
+                std::cerr << "Cannot create key directory: " << ec.message() << "\n";
+                return 1;
+            }
+        }
+    }
+
+    const auto payload_pool = make_payload_pool(options.seed);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned i = 0; i < options.threads; ++i) {
+        const auto connections = options.connections / options.threads +
+                                 (i < options.connections % options.threads ? 1 : 0);
+        workers.push_back(std::make_unique<Worker>(options, address->first, address->second,
+                                                   payload_pool, i, connections));
+    }
+
+    try {
+        if (options.preload) {
+            const auto documents =
+                static_cast<std::uint64_t>(options.keys) * options.documents_per_key;
+            const auto preload_start = Clock::now();
+            run_workers(workers, [&](Worker& worker, std::size_t i) {
+                const auto share = documents / workers.size();
+                const auto first = share * i;
+                worker.preload(first, i + 1 == workers.size() ? documents - first : share);
+            });
+            std::cerr << "Preloaded " << documents << " documents in "
+                      << std::chrono::duration<double>(Clock::now() - preload_start).count()
+                      << " s\n";
+        }
+
+        // Give every thread time to start before the first request is due.
+        const auto start = Clock::now() + std::chrono::milliseconds(10);
+        const auto stats =
+            run_workers(workers, [start](Worker& worker, std::size_t) { worker.run(start); });
+        const auto result = report(options, stats, options.duration_seconds);
+
+        print_report(result);
+        if (options.output == "-") {
+            std::cout << result.dump(2) << std::endl;
+        } else if (!options.output.empty()) {
+            std::ofstream output(options.output);
+            output << result.dump(2) << '\n';
+            if (!output) {
+                std::cerr << "Cannot write " << options.output << "\n";
+                return 1;
+            }
+        }
+
+        const auto& errors = result["errors"];
+        const bool clean = errors["status"] == 0 && errors["connection"] == 0 &&
+                           errors["timed_out"] == 0;
+        return clean ? 0 : 2;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,427 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unistd.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "storage/file_manager.hpp"
+#include "storage/name_validation.hpp"
+#include "util/thread_pool.hpp"
+
+namespace {
+
+using simple_data_server::FileError;
+using simple_data_server::FileManager;
+using simple_data_server::is_valid_key;
+using simple_data_server::ThreadPool;
+
+constexpr std::string_view DEFAULT_DATA_DIR = "data";
+constexpr std::size_t DEFAULT_BATCH_RECORDS = 10000;
+constexpr std::size_t MAX_BATCH_BYTES = 64 * 1024 * 1024; // 64MB
+constexpr std::size_t MAX_REPORTED_ERRORS = 20;
+constexpr double BYTES_PER_MEGABYTE = 1024.0 * 1024.0;
+
+struct LoadOptions {
+    std::string input = "-";
+    std::string data_directory{DEFAULT_DATA_DIR};
+    std::string default_key;
+    unsigned threads = 0;
+    std::size_t batch_records = DEFAULT_BATCH_RECORDS;
+    bool create_keys = true;
+    bool sync = true;
+    bool deduplicate = true;
+};
+
+/**
+ * @brief A run of consecutive input lines, loaded as one unit.
+ */
+struct Batch {
+    std::vector<std::string> lines;
+    std::size_t first_line = 0;
+    std::size_t bytes = 0;
+};
+
+/**
+ * @brief One parsed input line.
+ */
+struct Record {
+    std::string key;
+    std::string filename;
+    nlohmann::json data;
+    std::string error;
+    bool skip = false;
+};
+
+struct LoadTotals {
+    std::size_t loaded = 0;
+    std::size_t failed = 0;
+    std::size_t skipped = 0;
+    std::size_t bytes = 0;
+    std::size_t reported_errors = 0;
+};
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options] [FILE]\n"
+              << "Loads a JSON Lines file of {\"key\", \"filename\", \"data\"} records into a\n"
+              << "data directory. Reads standard input if FILE is omitted or \"-\".\n"
+              << "The server must not be running on the same data directory.\n"
+              << "Options:\n"
+              << "  -d, --dir DIR      Data directory (default: " << DEFAULT_DATA_DIR << ")\n"
+              << "  -k, --key KEY      Key for records without a \"key\" member, e.g. files\n"
+              << "                     written by /api/export\n"
+              << "  -t, --threads N    Parse and write threads (default: all cores)\n"
+              << "  --batch N          Records per batch and per sync (default: "
+              << DEFAULT_BATCH_RECORDS << ")\n"
+              << "  --no-create-keys   Reject records whose key directory does not exist\n"
+              << "  --no-sync          Do not sync the data directory after each batch\n"
+              << "  --no-dedup         Store every document separately instead of sharing\n"
+              << "                     identical content through the blob store\n"
+              << "  -h, --help         Show this help message\n";
+}
+
+std::string_view describe_error(FileError error) {
+    switch (error) {
+        case FileError::KeyDirectoryNotFound:
+            return "key directory not found";
+        case FileError::FileNotFound:
+            return "file not found";
+        case FileError::InvalidJson:
+            return "invalid JSON";
+        case FileError::FileTooLarge:
+            return "document too large";
+        case FileError::InvalidFilename:
+            return "invalid filename";
+        case FileError::IoError:
+            return "I/O error";
+        case FileError::JsonEncodingError:
+            return "JSON encoding error";
+        case FileError::VersionMismatch:
+            return "version mismatch";
+        case FileError::QuotaExceeded:
+            return "quota exceeded";
+    }
+    return "unknown error";
+}
+
+/**
+ * @brief Read up to batch_records lines (and at most MAX_BATCH_BYTES) from the input.
+ */
+Batch read_batch(std::istream& input, std::size_t first_line, std::size_t batch_records) {
+    Batch batch;
+    batch.first_line = first_line;
+    batch.lines.reserve(batch_records);
+
+    std::string line;
+    while (batch.lines.size() < batch_records && batch.bytes < MAX_BATCH_BYTES &&
+           std::getline(input, line)) {
+        batch.bytes += line.size() + 1;
+        batch.lines.push_back(std::move(line));
+    }
+    return batch;
+}
+
+/**
+ * @brief Parse one input line into a record; errors are stored in the record.
+ */
+Record parse_record(std::string_view line, const std::string& default_key) {
+    Record record;
+    if (line.find_first_not_of(" \t\r") == std::string_view::npos) {
+        record.skip = true;
+        return record;
+    }
+
+    auto parsed = nlohmann::json::parse(line, nullptr, false);
+    if (parsed.is_discarded() || !parsed.is_object()) {
+        record.error = "invalid JSON";
+        return record;
+    }
+
+    const auto filename = parsed.find("filename");
+    if (filename == parsed.end()) {
+        // The header line of an /api/export file carries the file count instead.
+        record.skip = parsed.contains("files");
+        if (!record.skip) {
+            record.error = "missing filename";
+        }
+        return record;
+    }
+    const auto key = parsed.find("key");
+    const auto data = parsed.find("data");
+    if (!filename->is_string() || (key != parsed.end() && !key->is_string()) ||
+        data == parsed.end()) {
+        record.error = "record needs string \"filename\" and \"key\" members and a \"data\" member";
+        return record;
+    }
+
+    record.key = key != parsed.end() ? key->get<std::string>() : default_key;
+    if (record.key.empty()) {
+        record.error = "missing key";
+        return record;
+    }
+    record.filename = filename->get<std::string>();
+    record.data = std::move(*data);
+    return record;
+}
+
+/**
+ * @brief Create the key directories a batch needs that do not exist yet.
+ *
+ * Every key is checked once per run, so a file with many records per key
+ * costs one directory lookup per key rather than one per record.
+ */
+void prepare_key_directories(std::vector<Record>& records,
+                             const LoadOptions& options,
+                             std::unordered_set<std::string>& known_keys) {
+    std::unordered_set<std::string> missing_keys;
+    for (const auto& record : records) {
+        if (record.skip || !record.error.empty() || known_keys.contains(record.key)) {
+            continue;
+        }
+        if (!is_valid_key(record.key)) {
+            continue;
+        }
+        missing_keys.insert(record.key);
+    }
+
+    for (const auto& key : missing_keys) {
+        const auto path = std::filesystem::path(options.data_directory) / key;
+        std::error_code ec;
+        if (options.create_keys) {
+            std::filesystem::create_directory(path, ec);
+        }
+        if (!ec && std::filesystem::is_directory(path, ec)) {
+            known_keys.insert(key);
+        }
+    }
+}
+
+/**
+ * @brief Mark records overwritten by a later record for the same document in the batch.
+ *
+ * Records are written in parallel, so this keeps the last occurrence winning.
+ * Documents are compared by stored filename, since different filenames can
+ * name the same document.
+ */
+void skip_superseded_records(std::vector<Record>& records, const FileManager& file_manager) {
+    std::unordered_map<std::string, std::size_t> last_index;
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        if (records[i].skip || !records[i].error.empty()) {
+            continue;
+        }
+        const auto stored = file_manager.stored_filename(records[i].filename);
+        if (stored.empty()) {
+            // Rejected by put_json; each such record reports its own error.
+            continue;
+        }
+        auto name = records[i].key;
+        name += '/';
+        name += stored;
+        const auto [it, inserted] = last_index.try_emplace(std::move(name), i);
+        if (!inserted) {
+            records[it->second].skip = true;
+            it->second = i;
+        }
+    }
+}
+
+/**
+ * @brief Flush everything written to the data directory's filesystem in one call.
+ */
+bool sync_data_directory(const std::string& data_directory) {
+    const int fd = ::open(data_directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::syncfs(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+void report_error(LoadTotals& totals, std::size_t line_number, std::string_view message) {
+    if (++totals.reported_errors <= MAX_REPORTED_ERRORS) {
+        std::cerr << "line " << line_number << ": " << message << "\n";
+    } else if (totals.reported_errors == MAX_REPORTED_ERRORS + 1) {
+        std::cerr << "further errors are counted but not shown\n";
+    }
+}
+
+void load_batch(Batch& batch,
+                const LoadOptions& options,
+                FileManager& file_manager,
+                ThreadPool& pool,
+                std::unordered_set<std::string>& known_keys,
+                LoadTotals& totals) {
+    std::vector<Record> records(batch.lines.size());
+    pool.parallel_for(records.size(), [&](std::size_t i) {
+        records[i] = parse_record(batch.lines[i], options.default_key);
+    });
+
+    prepare_key_directories(records, options, known_keys);
+    skip_superseded_records(records, file_manager);
+
+    std::vector<std::optional<FileError>> results(records.size());
+    pool.parallel_for(records.size(), [&](std::size_t i) {
+        auto& record = records[i];
+        if (record.skip || !record.error.empty()) {
+            return;
+        }
+        const auto stored = file_manager.put_json(record.key, record.filename, record.data);
+        if (!stored) {
+            results[i] = stored.error();
+        }
+        record.data = nlohmann::json();
+    });
+
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        const auto line_number = batch.first_line + i;
+        if (!records[i].error.empty()) {
+            ++totals.failed;
+            report_error(totals, line_number, records[i].error);
+        } else if (results[i].has_value()) {
+            ++totals.failed;
+            report_error(totals, line_number, describe_error(results[i].value()));
+        } else if (records[i].skip) {
+            ++totals.skipped;
+        } else {
+            ++totals.loaded;
+        }
+    }
+    totals.bytes += batch.bytes;
+
+    if (options.sync && !sync_data_directory(options.data_directory)) {
+        throw std::runtime_error("Failed to sync data directory");
+    }
+}
+
+std::optional<LoadOptions> parse_arguments(int argc, char* argv[], int& exit_code) {
+    LoadOptions options;
+    bool have_input = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg(argv[i]);
+
+        if (arg == "-d" || arg == "--dir" || arg == "-k" || arg == "--key") {
+            if (i + 1 >= argc) {
+                std::cerr << "Option " << arg << " requires an argument\n";
+                exit_code = 1;
+                return std::nullopt;
+            }
+            (arg == "-d" || arg == "--dir" ? options.data_directory : options.default_key) =
+                argv[++i];
+        } else if (arg == "-t" || arg == "--threads" || arg == "--batch") {
+            if (i + 1 >= argc) {
+                std::cerr << "Option " << arg << " requires an argument\n";
+                exit_code = 1;
+                return std::nullopt;
+            }
+            try {
+                const auto value = std::stoul(argv[++i]);
+                if (arg == "--batch") {
+                    if (value == 0) {
+                        throw std::out_of_range("empty batch");
+                    }
+                    options.batch_records = value;
+                } else {
+                    options.threads = static_cast<unsigned>(value);
+                }
+            } catch (const std::exception&) {
+                std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+                exit_code = 1;
+                return std::nullopt;
+            }
+        } else if (arg == "--no-create-keys") {
+            options.create_keys = false;
+        } else if (arg == "--no-sync") {
+            options.sync = false;
+        } else if (arg == "--no-dedup") {
+            options.deduplicate = false;
+        } else if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            exit_code = 0;
+            return std::nullopt;
+        } else if ((arg == "-" || !arg.starts_with('-')) && !have_input) {
+            options.input = arg;
+            have_input = true;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            print_usage(argv[0]);
+            exit_code = 1;
+            return std::nullopt;
+        }
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int exit_code = 0;
+    const auto parsed_options = parse_arguments(argc, argv, exit_code);
+    if (!parsed_options) {
+        return exit_code;
+    }
+    const auto& options = parsed_options.value();
+
+    std::ifstream input_file;
+    if (options.input != "-") {
+        input_file.open(options.input, std::ios::binary);
+        if (!input_file.is_open()) {
+            std::cerr << "Cannot open " << options.input << "\n";
+            return 1;
+        }
+    }
+    std::istream& input = options.input == "-" ? std::cin : input_file;
+
+    simple_data_server::StorageOptions storage_options;
+    storage_options.deduplicate = options.deduplicate;
+    storage_options.scan_threads = options.threads;
+    storage_options.scrub.enabled = false;
+
+    LoadTotals totals;
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        FileManager file_manager(options.data_directory, storage_options);
+        ThreadPool pool(options.threads);
+        std::unordered_set<std::string> known_keys;
+
+        // Read the next batch while the current one is parsed and written.
+        auto batch = read_batch(input, 1, options.batch_records);
+        while (!batch.lines.empty()) {
+            const auto next_line = batch.first_line + batch.lines.size();
+            auto next = std::async(std::launch::async, [&input, next_line, &options] {
+                return read_batch(input, next_line, options.batch_records);
+            });
+            load_batch(batch, options, file_manager, pool, known_keys, totals);
+            batch = next.get();
+        }
+        if (input.bad()) {
+            throw std::runtime_error("Failed to read " + options.input);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    const auto seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const auto rate = [seconds](double amount) { return seconds > 0 ? amount / seconds : 0.0; };
+    std::cout << "Loaded " << totals.loaded << " records (" << totals.failed << " failed, "
+              << totals.skipped << " skipped) in " << seconds << " s: "
+              << rate(static_cast<double>(totals.loaded)) << " records/s, "
+              << rate(static_cast<double>(totals.bytes) / BYTES_PER_MEGABYTE) << " MB/s"
+              << std::endl;
+
+    return totals.failed == 0 ? 0 : 2;
+}
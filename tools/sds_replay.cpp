@@ -0,0 +1,751 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+#include "storage/content_hash.hpp"
+#include "storage/name_validation.hpp"
+#include "util/capture_file.hpp"
+#include "util/tcp_socket.hpp"
+
+namespace {
+
+using simple_data_server::CaptureReader;
+using simple_data_server::CaptureRecord;
+using Clock = std::chrono::steady_clock;
+
+constexpr std::string_view DEFAULT_HOST = "127.0.0.1";
+constexpr std::uint16_t DEFAULT_PORT = 8080;
+constexpr unsigned DEFAULT_CONNECTIONS = 16;
+constexpr std::string_view DEFAULT_KEY_PREFIX = "replay-";
+constexpr std::chrono::seconds SOCKET_TIMEOUT{30};
+constexpr std::size_t READ_CHUNK_SIZE = 64 * 1024;
+constexpr int HTTP_OK = 200;
+
+/**
+ * @brief Largest synthesized document, the server's limit with room for the envelope.
+ */
+constexpr std::size_t MAX_DOCUMENT_SIZE = 1000 * 1000;
+
+/**
+ * @brief Bytes a get response adds around the document: status, version and member names.
+ */
+constexpr std::size_t GET_RESPONSE_OVERHEAD = 50;
+
+/**
+ * @brief Bytes a put body adds around the key, filename and document.
+ */
+constexpr std::size_t PUT_ENVELOPE_OVERHEAD = 32;
+
+constexpr std::array<double, 5> REPORTED_PERCENTILES{50.0, 90.0, 99.0, 99.9, 100.0};
+
+struct ReplayOptions {
+    std::string capture;
+    std::string host{DEFAULT_HOST};
+    std::uint16_t port = DEFAULT_PORT;
+    double speed = 1.0;
+    unsigned connections = DEFAULT_CONNECTIONS;
+    std::string key_prefix{DEFAULT_KEY_PREFIX};
+    std::string data_directory;
+    bool preload = true;
+    std::string output;
+    std::string label;
+};
+
+void print_usage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options] CAPTURE\n"
+              << "Re-issues the requests in a capture file written by simpledataserver\n"
+              << "--capture against a running server, on the captured schedule, and reports\n"
+              << "latency per route next to the captured latency. Latency is measured from\n"
+              << "when each request was due, so queueing is not hidden.\n"
+              << "Requests captured without bodies are rebuilt from the captured sizes and\n"
+              << "hashed names for put, get, list, stats and export; others are skipped.\n"
+              << "Options:\n"
+              << "  --host HOST        Server host (default: " << DEFAULT_HOST << ")\n"
+              << "  -p, --port PORT    Server port (default: " << DEFAULT_PORT << ")\n"
+              << "  -s, --speed X      Replay X times as fast as captured (default: 1)\n"
+              << "  -c, --connections N  Keep-alive connections; requests are spread over\n"
+              << "                     them in turn (default: " << DEFAULT_CONNECTIONS << ")\n"
+              << "  --key-prefix P     Prefix of rebuilt keys (default: " << DEFAULT_KEY_PREFIX
+              << ")\n"
+              << "  -d, --dir DIR      Create the rebuilt keys' directories in DIR, the\n"
+              << "                     server's data directory, before starting\n"
+              << "  --no-preload       Do not put the documents rebuilt gets read first\n"
+              << "  -o, --output FILE  Write the results as JSON to FILE ('-' for stdout)\n"
+              << "  --label TEXT       Label stored in the JSON results, e.g. a commit\n"
+              << "  -h, --help         Show this help message\n";
+}
+
+/**
+ * @brief How a request captured without its body is rebuilt.
+ */
+enum class Rebuild { None, Key, Document, Put };
+
+Rebuild rebuild_for(std::string_view route) {
+    if (route == "/api/put") {
+        return Rebuild::Put;
+    }
+    if (route == "/api/get") {
+        return Rebuild::Document;
+    }
+    if (route == "/api/list" || route == "/api/stats" || route == "/api/export") {
+        return Rebuild::Key;
+    }
+    return Rebuild::None;
+}
+
+std::string key_name(const ReplayOptions& options, std::uint64_t hash) {
+    return options.key_prefix + simple_data_server::format_content_hash(hash);
+}
+
+std::string document_name(std::uint64_t hash) {
+    return simple_data_server::format_content_hash(hash) + ".json";
+}
+
+/**
+ * @brief A put body of about the given size, padded with part of the payload.
+ */
+std::string put_body(std::string_view key,
+                     std::string_view filename,
+                     std::size_t size,
+                     const std::string& payload) {
+    std::string body = R"({"key":")";
+    body += key;
+    body += R"(","filename":")";
+    body += filename;
+    body += R"(","data":{"payload":")";
+    constexpr std::string_view CLOSING = "\"}}";
+    const auto fixed = body.size() + CLOSING.size();
+    body.append(payload, 0, std::min(size > fixed ? size - fixed : 0, payload.size()));
+    body += CLOSING;
+    return body;
+}
+
+/**
+ * @brief The body to replay a record with: the captured one, or one rebuilt from the metadata.
+ *
+ * @return std::optional<std::string> The body, or std::nullopt if the record cannot be replayed.
+ */
+std::optional<std::string> request_body(const CaptureRecord& record,
+                                        const ReplayOptions& options,
+                                        const std::string& payload) {
+    if (record.body) {
+        return std::string(*record.body);
+    }
+    const auto rebuild = rebuild_for(record.route);
+    if (rebuild == Rebuild::None || record.key_hash == 0 ||
+        (rebuild != Rebuild::Key && record.filename_hash == 0)) {
+        return std::nullopt;
+    }
+    const auto key = key_name(options, record.key_hash);
+    if (rebuild == Rebuild::Key) {
+        return R"({"key":")" + key + "\"}";
+    }
+    const auto filename = document_name(record.filename_hash);
+    if (rebuild == Rebuild::Document) {
+        return R"({"key":")" + key + R"(","filename":")" + filename + "\"}";
+    }
+    return put_body(key, filename, record.bytes_in, payload);
+}
+
+std::string http_request(const ReplayOptions& options, std::string_view route,
+                         std::string_view body) {
+    std::string out = "POST ";
+    out += route;
+    out += " HTTP/1.1\r\nHost: ";
+    out += options.host;
+    out += "\r\nContent-Type: application/json\r\nContent-Length: ";
+    out += std::to_string(body.size());
+    out += "\r\n\r\n";
+    out += body;
+    return out;
+}
+
+bool equals_ignoring_case(std::string_view text, std::string_view lowercase) {
+    return text.size() == lowercase.size() &&
+           std::equal(text.begin(), text.end(), lowercase.begin(), [](char a, char b) {
+               return std::tolower(static_cast<unsigned char>(a)) == b;
+           });
+}
+
+/**
+ * @brief Find the end of a chunked body that starts at offset.
+ *
+ * @return std::optional<std::size_t> The offset just past it, or std::nullopt if incomplete.
+ */
+std::optional<std::size_t> chunked_body_end(std::string_view in, std::size_t offset) {
+    while (true) {
+        const auto line_end = in.find("\r\n", offset);
+        if (line_end == std::string_view::npos) {
+            return std::nullopt;
+        }
+        std::size_t size = 0;
+        std::from_chars(in.data() + offset, in.data() + line_end, size, 16);
+        offset = line_end + 2 + size + 2;
+        if (size == 0) {
+            return in.size() >= offset ? std::optional(offset) : std::nullopt;
+        }
+        if (in.size() < offset) {
+            return std::nullopt;
+        }
+    }
+}
+
+/**
+ * @brief Parse one complete response off the front of the buffer.
+ *
+ * @return std::optional<int> The status, -1 for a response that cannot be
+ *         parsed, or std::nullopt if more bytes are needed.
+ */
+std::optional<int> parse_response(std::string& in) {
+    const auto header_end = in.find("\r\n\r\n");
+    if (header_end == std::string::npos) {
+        return std::nullopt;
+    }
+    int status = -1;
+    if (in.starts_with("HTTP/1.") && header_end >= 12) {
+        std::from_chars(in.data() + 9, in.data() + 12, status);
+    }
+    std::size_t content_length = 0;
+    bool chunked = false;
+    std::string_view headers(in.data(), header_end);
+    for (std::size_t line_start = headers.find("\r\n"); line_start != std::string::npos;) {
+        line_start += 2;
+        const auto line_end = headers.find("\r\n", line_start);
+        const auto line = headers.substr(line_start, line_end - line_start);
+        const auto colon = line.find(':');
+        const auto name = line.substr(0, colon);
+        if (colon != std::string_view::npos && equals_ignoring_case(name, "content-length")) {
+            auto value = line.substr(colon + 1);
+            value.remove_prefix(std::min(value.find_first_not_of(' '), value.size()));
+            std::from_chars(value.data(), value.data() + value.size(), content_length);
+        } else if (colon != std::string_view::npos &&
+                   equals_ignoring_case(name, "transfer-encoding")) {
+            chunked = true;
+        }
+        line_start = line_end;
+    }
+    std::size_t total = header_end + 4 + content_length;
+    if (chunked) {
+        const auto end = chunked_body_end(in, header_end + 4);
+        if (!end) {
+            return std::nullopt;
+        }
+        total = *end;
+    }
+    if (in.size() < total) {
+        return std::nullopt;
+    }
+    in.erase(0, total);
+    return status;
+}
+
+/**
+ * @brief A blocking keep-alive connection, reopened after a failure.
+ */
+class Connection {
+public:
+    explicit Connection(const ReplayOptions& options) : options_(options) {
+    }
+
+    ~Connection() {
+        close();
+    }
+
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
+    /**
+     * @brief Send a request and wait for its response.
+     *
+     * @return std::optional<int> The status, or std::nullopt if the connection failed.
+     */
+    std::optional<int> exchange(const std::string& request) {
+        if (fd_ < 0) {
+            fd_ = simple_data_server::connect_tcp(options_.host, options_.port, SOCKET_TIMEOUT);
+            if (fd_ < 0) {
+                return std::nullopt;
+            }
+        }
+        if (!simple_data_server::send_all(fd_, request)) {
+            close();
+            return std::nullopt;
+        }
+        char buffer[READ_CHUNK_SIZE];
+        while (true) {
+            const auto status = parse_response(in_);
+            if (status && *status >= 0) {
+                return status;
+            }
+            if (status) {
+                close();
+                return std::nullopt;
+            }
+            const auto received = ::recv(fd_, buffer, sizeof(buffer), 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                close();
+                return std::nullopt;
+            }
+            in_.append(buffer, static_cast<std::size_t>(received));
+        }
+    }
+
+private:
+    void close() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        in_.clear();
+    }
+
+    const ReplayOptions& options_;
+    int fd_ = -1;
+    std::string in_;
+};
+
+/**
+ * @brief A captured request and when to send it, relative to the start of the replay.
+ */
+struct Planned {
+    const CaptureRecord* record;
+    std::chrono::nanoseconds due;
+};
+
+struct RouteStats {
+    /** Replay latency from the due time, in nanoseconds. */
+    std::vector<std::int64_t> latencies;
+    /** Latency the server reported when the request was captured, in nanoseconds. */
+    std::vector<std::int64_t> captured;
+    std::uint64_t errors = 0;
+    std::uint64_t status_mismatches = 0;
+
+    void merge(const RouteStats& other) {
+        latencies.insert(latencies.end(), other.latencies.begin(), other.latencies.end());
+        captured.insert(captured.end(), other.captured.begin(), other.captured.end());
+        errors += other.errors;
+        status_mismatches += other.status_mismatches;
+    }
+};
+
+struct ReplayStats {
+    std::map<std::string, RouteStats, std::less<>> routes;
+    std::uint64_t skipped = 0;
+    /** Longest a request was sent after it was due, which shows the replayer falling behind. */
+    std::chrono::nanoseconds max_send_lag{0};
+
+    void merge(const ReplayStats& other) {
+        for (const auto& [route, stats] : other.routes) {
+            routes[route].merge(stats);
+        }
+        skipped += other.skipped;
+        max_send_lag = std::max(max_send_lag, other.max_send_lag);
+    }
+};
+
+/**
+ * @brief Replay every step-th planned request from first on, over one connection.
+ */
+ReplayStats replay_share(const ReplayOptions& options,
+                         const std::vector<Planned>& plan,
+                         std::size_t first,
+                         std::size_t step,
+                         Clock::time_point start,
+                         const std::string& payload) {
+    ReplayStats stats;
+    Connection connection(options);
+    for (auto i = first; i < plan.size(); i += step) {
+        const auto& planned = plan[i];
+        const auto& record = *planned.record;
+        const auto body = request_body(record, options, payload);
+        if (!body) {
+            ++stats.skipped;
+            continue;
+        }
+        const auto request = http_request(options, record.route, *body);
+
+        const auto due = start + planned.due;
+        std::this_thread::sleep_until(due);
+        stats.max_send_lag = std::max(stats.max_send_lag,
+                                      std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                          Clock::now() - due));
+        const auto status = connection.exchange(request);
+        const auto latency = Clock::now() - due;
+
+        auto& route = stats.routes[std::string(record.route)];
+        if (!status) {
+            ++route.errors;
+            continue;
+        }
+        route.latencies.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+        route.captured.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(record.latency).count());
+        if (*status != record.status) {
+            ++route.status_mismatches;
+        }
+    }
+    return stats;
+}
+
+/**
+ * @brief Run a function on every connection's thread and merge what they return.
+ */
+template <typename Work>
+ReplayStats run_connections(unsigned connections, const Work& work) {
+    std::vector<ReplayStats> results(connections);
+    std::vector<std::exception_ptr> errors(connections);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < connections; ++i) {
+        threads.emplace_back([&, i] {
+            try {
+                results[i] = work(i);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    ReplayStats merged;
+    for (const auto& result : results) {
+        merged.merge(result);
+    }
+    return merged;
+}
+
+/**
+ * @brief Put every document a rebuilt get reads, at the size the get returned.
+ *
+ * @return std::size_t Documents that could not be stored.
+ */
+std::size_t preload(const ReplayOptions& options,
+                    const std::vector<Planned>& plan,
+                    const std::string& payload) {
+    std::map<std::pair<std::uint64_t, std::uint64_t>, std::size_t> documents;
+    for (const auto& planned : plan) {
+        const auto& record = *planned.record;
+        if (!record.body && rebuild_for(record.route) == Rebuild::Document &&
+            record.status == HTTP_OK && record.key_hash != 0 && record.filename_hash != 0) {
+            auto& size = documents[{record.key_hash, record.filename_hash}];
+            size = std::max<std::size_t>(size, record.bytes_out);
+        }
+    }
+    std::vector<std::string> requests;
+    requests.reserve(documents.size());
+    for (const auto& [names, size] : documents) {
+        const auto document_size =
+            std::min(size > GET_RESPONSE_OVERHEAD ? size - GET_RESPONSE_OVERHEAD : 0,
+                     MAX_DOCUMENT_SIZE);
+        const auto key = key_name(options, names.first);
+        const auto filename = document_name(names.second);
+        const auto body_size =
+            document_size + key.size() + filename.size() + PUT_ENVELOPE_OVERHEAD;
+        requests.push_back(
+            http_request(options, "/api/put", put_body(key, filename, body_size, payload)));
+    }
+
+    const auto stats = run_connections(options.connections, [&](unsigned connection_index) {
+        ReplayStats stats;
+        Connection connection(options);
+        for (std::size_t i = connection_index; i < requests.size(); i += options.connections) {
+            const auto status = connection.exchange(requests[i]);
+            if (!status || *status != HTTP_OK) {
+                ++stats.skipped;
+            }
+        }
+        return stats;
+    });
+    return stats.skipped;
+}
+
+std::optional<double> parse_number(std::string_view text) {
+    double value = 0;
+    const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || end != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<ReplayOptions> parse_arguments(int argc, char* argv[], int& exit_code) {
+    ReplayOptions options;
+    exit_code = 1;
+
+    const auto fail = [&exit_code](std::string_view message, std::string_view value) {
+        std::cerr << message << ": " << value << "\n";
+        exit_code = 1;
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_usage(argv[0]);
+            exit_code = 0;
+            return std::nullopt;
+        }
+        if (arg == "--no-preload") {
+            options.preload = false;
+            continue;
+        }
+        if (!arg.starts_with("-")) {
+            if (!options.capture.empty()) {
+                fail("Unexpected argument", arg);
+                return std::nullopt;
+            }
+            options.capture = arg;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            fail("Option requires an argument", arg);
+            return std::nullopt;
+        }
+        const std::string_view value = argv[++i];
+        if (arg == "--host") {
+            options.host = value;
+        } else if (arg == "-p" || arg == "--port") {
+            const auto port = parse_number(value);
+            if (!port || *port < 1 || *port > UINT16_MAX || *port != std::floor(*port)) {
+                fail("Invalid port", value);
+                return std::nullopt;
+            }
+            options.port = static_cast<std::uint16_t>(*port);
+        } else if (arg == "-s" || arg == "--speed") {
+            const auto speed = parse_number(value);
+            if (!speed || !(*speed > 0)) {
+                fail("Invalid speed", value);
+                return std::nullopt;
+            }
+            options.speed = *speed;
+        } else if (arg == "-c" || arg == "--connections") {
+            const auto connections = parse_number(value);
+            if (!connections || *connections < 1 || *connections > 10000 ||
+                *connections != std::floor(*connections)) {
+                fail("Invalid connection count", value);
+                return std::nullopt;
+            }
+            options.connections = static_cast<unsigned>(*connections);
+        } else if (arg == "--key-prefix") {
+            options.key_prefix = value;
+        } else if (arg == "-d" || arg == "--dir") {
+            options.data_directory = value;
+        } else if (arg == "-o" || arg == "--output") {
+            options.output = value;
+        } else if (arg == "--label") {
+            options.label = value;
+        } else {
+            fail("Unknown option", arg);
+            return std::nullopt;
+        }
+    }
+
+    if (options.capture.empty()) {
+        print_usage(argv[0]);
+        return std::nullopt;
+    }
+    if (!simple_data_server::is_valid_key(key_name(options, UINT64_MAX))) {
+        fail("Invalid key prefix", options.key_prefix);
+        return std::nullopt;
+    }
+    exit_code = 0;
+    return options;
+}
+
+double percentile(const std::vector<std::int64_t>& sorted, double percent) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    const auto rank = static_cast<std::size_t>(
+        std::ceil(percent / 100.0 * static_cast<double>(sorted.size())));
+    return static_cast<double>(sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1]);
+}
+
+nlohmann::ordered_json summarize(std::vector<std::int64_t> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    nlohmann::ordered_json summary;
+    for (const auto percent : REPORTED_PERCENTILES) {
+        char name[16];
+        std::snprintf(name, sizeof(name), percent == 100.0 ? "max" : "p%g", percent);
+        summary[name] = percentile(latencies, percent) / 1000.0;
+    }
+    return summary;
+}
+
+nlohmann::ordered_json report(const ReplayOptions& options,
+                              const CaptureReader& capture,
+                              std::size_t records,
+                              const ReplayStats& stats,
+                              double seconds) {
+    nlohmann::ordered_json result;
+    if (!options.label.empty()) {
+        result["label"] = options.label;
+    }
+    result["capture"] = options.capture;
+    result["speed"] = options.speed;
+    result["connections"] = options.connections;
+    result["records"] = records;
+    result["overwritten_in_capture"] = capture.overwritten();
+    result["skipped"] = stats.skipped;
+    result["seconds"] = seconds;
+    result["max_send_lag_ms"] =
+        std::chrono::duration<double, std::milli>(stats.max_send_lag).count();
+
+    auto& routes = result["routes"];
+    routes = nlohmann::ordered_json::object();
+    for (const auto& [route, route_stats] : stats.routes) {
+        auto& entry = routes[route];
+        entry["requests"] = route_stats.latencies.size() + route_stats.errors;
+        entry["errors"] = route_stats.errors;
+        entry["status_mismatches"] = route_stats.status_mismatches;
+        entry["latency_us"] = summarize(route_stats.latencies);
+        entry["captured_latency_us"] = summarize(route_stats.captured);
+    }
+    return result;
+}
+
+void print_report(const nlohmann::ordered_json& result) {
+    std::cerr << "Replayed " << result["records"] << " captured requests at "
+              << result["speed"].get<double>() << "x in " << result["seconds"].get<double>()
+              << " s; skipped " << result["skipped"] << ", max send lag "
+              << result["max_send_lag_ms"].get<double>() << " ms\n";
+    char line[200];
+    std::snprintf(line, sizeof(line), "%-16s %9s %7s %9s %26s %26s", "route", "requests",
+                  "errors", "mismatch", "replay p50/p99/max ms", "captured p50/p99/max ms");
+    std::cerr << line << "\n";
+    const auto triple = [](const nlohmann::ordered_json& summary) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "%.2f/%.2f/%.2f", summary["p50"].get<double>() / 1000,
+                      summary["p99"].get<double>() / 1000, summary["max"].get<double>() / 1000);
+        return std::string(text);
+    };
+    for (const auto& [route, entry] : result["routes"].items()) {
+        std::snprintf(line, sizeof(line), "%-16s %9llu %7llu %9llu %26s %26s", route.c_str(),
+                      entry["requests"].get<unsigned long long>(),
+                      entry["errors"].get<unsigned long long>(),
+                      entry["status_mismatches"].get<unsigned long long>(),
+                      triple(entry["latency_us"]).c_str(),
+                      triple(entry["captured_latency_us"]).c_str());
+        std::cerr << line << "\n";
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int exit_code = 0;
+    const auto parsed_options = parse_arguments(argc, argv, exit_code);
+    if (!parsed_options) {
+        return exit_code;
+    }
+    const auto& options = parsed_options.value();
+
+    try {
+        const CaptureReader capture(options.capture);
+        auto records = capture.records();
+        // Records are in the order requests finished; replay them in the order they arrived.
+        std::stable_sort(records.begin(), records.end(), [](const auto& a, const auto& b) {
+            return a.arrival < b.arrival;
+        });
+        if (records.empty()) {
+            std::cerr << "No requests in " << options.capture << "\n";
+            return 1;
+        }
+
+        std::vector<Planned> plan;
+        plan.reserve(records.size());
+        const auto origin = records.front().arrival;
+        for (const auto& record : records) {
+            const auto offset = static_cast<double>((record.arrival - origin).count());
+            plan.push_back({&record, std::chrono::nanoseconds(
+                                         static_cast<std::int64_t>(offset / options.speed))});
+        }
+
+        if (!options.data_directory.empty()) {
+            std::set<std::uint64_t> keys;
+            for (const auto& record : records) {
+                if (!record.body && rebuild_for(record.route) != Rebuild::None &&
+                    record.key_hash != 0) {
+                    keys.insert(record.key_hash);
+                }
+            }
+            for (const auto key : keys) {
+                std::error_code ec;
+                std::filesystem::create_directories(
+                    std::filesystem::path(options.data_directory) / key_name(options, key), ec);
+                if (ec) {
+                    std::cerr << "Cannot create key directory: " << ec.message() << "\n";
+                    return 1;
+                }
+            }
+        }
+
+        const std::string payload(MAX_DOCUMENT_SIZE, 'x');
+        if (options.preload) {
+            const auto preload_start = Clock::now();
+            const auto failed = preload(options, plan, payload);
+            std::cerr << "Preloaded documents in "
+                      << std::chrono::duration<double>(Clock::now() - preload_start).count()
+                      << " s" << (failed > 0 ? ", " + std::to_string(failed) + " failed" : "")
+                      << "\n";
+        }
+
+        // Give every thread time to connect before the first request is due.
+        const auto start = Clock::now() + std::chrono::milliseconds(100);
+        const auto stats = run_connections(options.connections, [&](unsigned i) {
+            return replay_share(options, plan, i, options.connections, start, payload);
+        });
+        const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        const auto result = report(options, capture, records.size(), stats, seconds);
+
+        print_report(result);
+        if (options.output == "-") {
+            std::cout << result.dump(2) << std::endl;
+        } else if (!options.output.empty()) {
+            std::ofstream output(options.output);
+            output << result.dump(2) << '\n';
+            if (!output) {
+                std::cerr << "Cannot write " << options.output << "\n";
+                return 1;
+            }
+        }
+
+        std::uint64_t errors = 0;
+        for (const auto& [route, route_stats] : stats.routes) {
+            errors += route_stats.errors;
+        }
+        return errors == 0 ? 0 : 2;
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}